@@ -0,0 +1,72 @@
+#ifndef INSTANCE_HLSLI
+#define INSTANCE_HLSLI
+
+// Must match ash::scene_inst_format.
+#define INSTANCE_FORMAT_MATRIX 0
+#define INSTANCE_FORMAT_AFFINE 1
+#define INSTANCE_FORMAT_QUANTIZED_TRS 2
+
+#ifndef INSTANCE_FORMAT
+#define INSTANCE_FORMAT INSTANCE_FORMAT_MATRIX
+#endif
+
+#if INSTANCE_FORMAT == INSTANCE_FORMAT_AFFINE
+struct InstanceData
+{
+    float4 rows[3];
+};
+
+float3 transformInstance(InstanceData data, float3 position)
+{
+    float4 p = float4(position, 1.0f);
+    return float3(dot(data.rows[0], p), dot(data.rows[1], p), dot(data.rows[2], p));
+}
+#elif INSTANCE_FORMAT == INSTANCE_FORMAT_QUANTIZED_TRS
+struct InstanceData
+{
+    float3 position;
+    uint rotation;
+    uint scaleXY;
+    uint scaleZ;
+};
+
+float4 decodeRotation(uint packed)
+{
+    uint largest = packed >> 30;
+    float3 smallest = float3((packed >> 20) & 0x3ff, (packed >> 10) & 0x3ff, packed & 0x3ff);
+    smallest = (smallest / 1023.0f * 2.0f - 1.0f) * 0.70710678f;
+    float dropped = sqrt(saturate(1.0f - dot(smallest, smallest)));
+
+    float4 q;
+    if (largest == 0)
+        q = float4(dropped, smallest.x, smallest.y, smallest.z);
+    else if (largest == 1)
+        q = float4(smallest.x, dropped, smallest.y, smallest.z);
+    else if (largest == 2)
+        q = float4(smallest.x, smallest.y, dropped, smallest.z);
+    else
+        q = float4(smallest.x, smallest.y, smallest.z, dropped);
+    return normalize(q);
+}
+
+float3 transformInstance(InstanceData data, float3 position)
+{
+    float3 scale = float3(f16tof32(data.scaleXY), f16tof32(data.scaleXY >> 16), f16tof32(data.scaleZ));
+    float4 q = decodeRotation(data.rotation);
+    float3 v = position * scale;
+    v += 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+    return v + data.position;
+}
+#else
+struct InstanceData
+{
+    float4x4 worldMatrix;
+};
+
+float3 transformInstance(InstanceData data, float3 position)
+{
+    return mul(float4(position, 1.0f), data.worldMatrix).xyz;
+}
+#endif
+
+#endif
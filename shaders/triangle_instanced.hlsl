@@ -1,5 +1,7 @@
 #define RS "RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT | SAMPLER_HEAP_DIRECTLY_INDEXED | CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED ), " \
-            "RootConstants(num32BitConstants=17, b0)"
+            "RootConstants(num32BitConstants=18, b0)"
+
+#include "instance.hlsli"
 
 struct VSOutput
 {
@@ -11,11 +13,7 @@ struct SceneBuffer
 {
     float4x4 vp;
     uint instanceBufferIdx;
-};
-
-struct InstanceData
-{
-    float4x4 worldMatrix;
+    uint visibleBufferIdx;
 };
 
 ConstantBuffer<SceneBuffer> sb : register(b0);
@@ -37,11 +35,12 @@ VSOutput vs_main(uint vertexId : SV_VertexID, uint instanceId : SV_InstanceID)
         float2(-0.5f, -0.5f)
     };
     
+    StructuredBuffer<uint> visibleSlots = ResourceDescriptorHeap[sb.visibleBufferIdx];
     StructuredBuffer<InstanceData> instances = ResourceDescriptorHeap[sb.instanceBufferIdx];
-    InstanceData data = instances[instanceId];
+    InstanceData data = instances[visibleSlots[instanceId]];
     
     VSOutput output;
-    float4 worldPos = mul(float4(positions[vertexId], 0.0f, 1.0f), data.worldMatrix);
+    float4 worldPos = float4(transformInstance(data, float3(positions[vertexId], 0.0f)), 1.0f);
     output.position = mul(worldPos, sb.vp);
     output.uv = uv[vertexId];
     return output;
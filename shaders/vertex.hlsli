@@ -0,0 +1,102 @@
+#ifndef VERTEX_HLSLI
+#define VERTEX_HLSLI
+
+// Must match ash::scene_vtx_format.
+#define VERTEX_FORMAT_FULL 0
+#define VERTEX_FORMAT_QUANTIZED 1
+#define VERTEX_FORMAT_COMPACT 2
+
+#ifndef VERTEX_FORMAT
+#define VERTEX_FORMAT VERTEX_FORMAT_QUANTIZED
+#endif
+
+// Must match ash::scene_vtx_stream.
+struct VertexStream
+{
+    uint format;
+    uint stride;
+    uint firstVertex;
+    uint dataOffset;
+    float3 positionOffset;
+    float3 positionScale;
+};
+
+struct Vertex
+{
+    float3 position;
+    float3 normal;
+    float4 tangent; // w is the bitangent sign; zero when the format stores no tangent
+    float2 uv;
+};
+
+float3 decodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+// Must match ash::scene_vtx_tangent_basis.
+float4 decodeTangent(uint bits, float3 n)
+{
+    float s = n.z >= 0.0f ? 1.0f : -1.0f;
+    float a = -1.0f / (s + n.z);
+    float b = n.x * n.y * a;
+    float3 axis1 = float3(1.0f + s * n.x * n.x * a, s * b, -s * n.x);
+    float3 axis2 = float3(b, s + n.y * n.y * a, -n.y);
+
+    float angle = float(bits & 0x7fff) * (6.28318531f / 32768.0f);
+    return float4(axis1 * cos(angle) + axis2 * sin(angle), (bits & 0x8000) != 0 ? -1.0f : 1.0f);
+}
+
+float decodeSnorm16(uint bits)
+{
+    return max(float(int(bits << 16) >> 16) / 32767.0f, -1.0f);
+}
+
+float decodeSnorm8(uint bits)
+{
+    return max(float(int(bits << 24) >> 24) / 127.0f, -1.0f);
+}
+
+float3 decodePosition(uint xy, uint z, VertexStream stream)
+{
+    float3 q = float3(xy & 0xffff, xy >> 16, z & 0xffff);
+    return stream.positionOffset + q * stream.positionScale;
+}
+
+float2 decodeUv(uint packed)
+{
+    return float2(f16tof32(packed), f16tof32(packed >> 16));
+}
+
+// `vertexId` is an arena vertex index of the stream's mesh.
+Vertex loadVertex(ByteAddressBuffer vertexData, VertexStream stream, uint vertexId)
+{
+    uint address = stream.dataOffset + (vertexId - stream.firstVertex) * stream.stride;
+
+    Vertex v;
+#if VERTEX_FORMAT == VERTEX_FORMAT_QUANTIZED
+    uint4 packed = vertexData.Load4(address);
+    v.position = decodePosition(packed.x, packed.y, stream);
+    v.normal = decodeOctahedral(float2(decodeSnorm16(packed.z), decodeSnorm16(packed.z >> 16)));
+    v.tangent = decodeTangent(packed.y >> 16, v.normal);
+    v.uv = decodeUv(packed.w);
+#elif VERTEX_FORMAT == VERTEX_FORMAT_COMPACT
+    uint3 packed = vertexData.Load3(address);
+    v.position = decodePosition(packed.x, packed.y, stream);
+    v.normal = decodeOctahedral(float2(decodeSnorm8(packed.y >> 16), decodeSnorm8(packed.y >> 24)));
+    v.tangent = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    v.uv = decodeUv(packed.z);
+#else
+    v.position = asfloat(vertexData.Load3(address));
+    v.normal = asfloat(vertexData.Load3(address + 12));
+    v.tangent = asfloat(vertexData.Load4(address + 24));
+    v.uv = asfloat(vertexData.Load2(address + 40));
+#endif
+    return v;
+}
+
+#endif
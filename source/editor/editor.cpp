@@ -6,8 +6,11 @@
 #include "hierarchy.h"
 #include "inspector.h"
 #include "renderer/core/command_queue.h"
+#include "renderer/core/frame_ring.h"
 #include "renderer/core/swapchain.h"
 #include "renderer/renderer.h"
+#include "scene/gltf_import.h"
+#include "scene/occlusion.h"
 #include "scene/scene.h"
 #include "viewport.h"
 #include "window/window.h"
@@ -69,7 +72,7 @@ void ash::ed_init()
     ImGui_ImplDX12_InitInfo init_info = {};
     init_info.Device = rhi_g_device.get();
     init_info.CommandQueue = rhi_cmd_g_direct.get();
-    init_info.NumFramesInFlight = 1;
+    init_info.NumFramesInFlight = static_cast<int>(rhi_frame_g_ring.frame_count);
     init_info.RTVFormat = rhi_sw_g_format;
 
     init_info.SrvDescriptorHeap = rhi_g_cbv_srv_uav_heap.get();
@@ -214,10 +217,15 @@ void ash::ed_render()
                 if (auto selected_path = choose_gltf_scene_file(); selected_path.has_value())
                 {
                     ed_console_log(ed_console_log_level::info, "[Editor] glTF file selected from dialog.");
-                    scene_load_gltf(selected_path.value());
+                    scene_gltf_import_async(selected_path.value());
                 }
             }
 
+            if (ImGui::MenuItem("Create Occlusion Test Scene"))
+            {
+                scene_occ_create_test_scene();
+            }
+
             ImGui::EndMenu();
         }
 
@@ -276,8 +284,8 @@ void ash::ed_shutdown()
     }
 }
 
-void ash::ed_render_backend()
+void ash::ed_render_backend(ID3D12GraphicsCommandList *command_list)
 {
     SCOPED_CPU_EVENT(L"ash::ed_render_backend")
-    ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), rhi_cmd_g_command_list.get());
+    ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), command_list);
 }
@@ -12,5 +12,5 @@ namespace ash
 void ed_init();
 void ed_shutdown();
 void ed_render();
-void ed_render_backend();
+void ed_render_backend(ID3D12GraphicsCommandList *command_list);
 } // namespace ash
@@ -2,6 +2,7 @@
 #include "IconsMaterialSymbols.h"
 #include "editor.h"
 #include "renderer/renderer.h"
+#include "scene/pick.h"
 #include <imgui/imgui.h>
 
 #include "common.h"
@@ -49,6 +50,13 @@ void ash::ed_vp_render()
         gpu_handle.ptr += 1 * handle_size;
 
         ImGui::Image((ImTextureID)(intptr_t)gpu_handle.ptr, ImVec2(newWidth, newHeight));
+        if (ImGui::IsItemClicked(ImGuiMouseButton_Left))
+        {
+            const ImVec2 image_min = ImGui::GetItemRectMin();
+            const ImVec2 mouse = ImGui::GetMousePos();
+            ash::scene_pick_select(mouse.x - image_min.x, mouse.y - image_min.y, static_cast<float>(newWidth),
+                                   static_cast<float>(newHeight));
+        }
     }
 
     ImGui::End();
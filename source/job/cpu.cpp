@@ -0,0 +1,351 @@
+#include "cpu.h"
+#include <algorithm>
+#include <thread>
+
+#if ASH_CPU_X86
+#include <intrin.h>
+#endif
+
+#if defined(_WIN32)
+#include <common.h>
+#elif defined(__linux__)
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <tuple>
+#endif
+
+namespace
+{
+bool detect_avx2()
+{
+#if ASH_CPU_X86
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(info, 1);
+    const bool os_xsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!os_xsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+#if defined(_WIN32)
+// Processors the process may run on, as one mask per processor group. GetProcessAffinityMask reports the mask of a
+// process confined to one group; for a process spanning several groups it returns zero, and every processor of the
+// groups GetProcessGroupAffinity lists is allowed. Empty when neither call succeeds.
+std::vector<KAFFINITY> get_process_affinity()
+{
+    USHORT group_count = 0;
+    GetProcessGroupAffinity(GetCurrentProcess(), &group_count, nullptr);
+    std::vector<USHORT> groups(group_count);
+    if (group_count == 0 || !GetProcessGroupAffinity(GetCurrentProcess(), &group_count, groups.data()))
+    {
+        return {};
+    }
+
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    const bool single_group = GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) &&
+                              process_mask != 0;
+
+    std::vector<KAFFINITY> masks;
+    for (USHORT group : groups)
+    {
+        masks.resize(std::max<size_t>(masks.size(), group + 1), 0);
+        masks[group] = single_group ? static_cast<KAFFINITY>(process_mask) : ~KAFFINITY(0);
+    }
+    return masks;
+}
+
+bool detect_logical(std::vector<ash::job_cpu_logical> &logical)
+{
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+    if (length == 0)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(length);
+    auto *first = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *>(buffer.data());
+    if (!GetLogicalProcessorInformationEx(RelationProcessorCore, first, &length))
+    {
+        return false;
+    }
+
+    // Like sched_getaffinity on Linux, processors outside the process affinity are left out, and cores with none
+    // left get no index, so core numbers stay dense.
+    const std::vector<KAFFINITY> allowed = get_process_affinity();
+    uint32_t core = 0;
+    for (DWORD offset = 0; offset < length;)
+    {
+        const auto *info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *>(buffer.data() + offset);
+        const PROCESSOR_RELATIONSHIP &processor = info->Processor;
+        const size_t core_first = logical.size();
+        for (WORD g = 0; g < processor.GroupCount; ++g)
+        {
+            const GROUP_AFFINITY &affinity = processor.GroupMask[g];
+            const KAFFINITY mask =
+                allowed.empty() ? affinity.Mask
+                                : (affinity.Group < allowed.size() ? affinity.Mask & allowed[affinity.Group] : 0);
+            for (uint32_t bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit)
+            {
+                if ((mask & (KAFFINITY(1) << bit)) != 0)
+                {
+                    logical.push_back({bit, affinity.Group, core, processor.EfficiencyClass});
+                }
+            }
+        }
+        core += logical.size() != core_first ? 1 : 0;
+        offset += info->Size;
+    }
+    return !logical.empty();
+}
+#elif defined(__linux__)
+// Parses a sysfs cpu list such as "0-3,8,10-11".
+std::vector<uint32_t> read_cpu_list(const std::filesystem::path &path)
+{
+    std::vector<uint32_t> cpus;
+    std::ifstream file(path);
+    std::string list;
+    if (!std::getline(file, list))
+    {
+        return cpus;
+    }
+
+    size_t position = 0;
+    while (position < list.size())
+    {
+        size_t end = list.find(',', position);
+        end = end == std::string::npos ? list.size() : end;
+        const std::string range = list.substr(position, end - position);
+        const size_t dash = range.find('-');
+        if (!range.empty() && range.find_first_not_of("0123456789-") == std::string::npos)
+        {
+            const uint32_t low = static_cast<uint32_t>(std::stoul(range.substr(0, dash)));
+            const uint32_t high =
+                dash == std::string::npos ? low : static_cast<uint32_t>(std::stoul(range.substr(dash + 1)));
+            for (uint32_t cpu = low; cpu <= high; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        position = end + 1;
+    }
+    return cpus;
+}
+
+int64_t read_number(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    int64_t value = -1;
+    file >> value;
+    return file ? value : -1;
+}
+
+bool detect_logical(std::vector<ash::job_cpu_logical> &logical, const std::filesystem::path &devices)
+{
+    const std::filesystem::path cpu_root = devices / "system" / "cpu";
+    std::vector<uint32_t> cpus = read_cpu_list(cpu_root / "online");
+    if (cpus.empty())
+    {
+        return false;
+    }
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool has_allowed = devices == "/sys/devices" && sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    // Intel hybrid parts list their P-cores under cpu_core and their E-cores under cpu_atom. Elsewhere (ARM
+    // big.LITTLE) cpu_capacity ranks the cores.
+    std::vector<uint32_t> performance_cpus = read_cpu_list(devices / "cpu_core" / "cpus");
+    const bool intel_hybrid = !performance_cpus.empty() && std::filesystem::exists(devices / "cpu_atom" / "cpus");
+
+    std::map<std::tuple<int64_t, int64_t, int64_t>, uint32_t> cores;
+    std::vector<int64_t> capacities;
+    for (uint32_t cpu : cpus)
+    {
+        if (has_allowed && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)))
+        {
+            continue;
+        }
+
+        const std::filesystem::path topology = cpu_root / ("cpu" + std::to_string(cpu)) / "topology";
+        // A processor without a core_id gets a core of its own.
+        auto key = std::make_tuple(read_number(topology / "physical_package_id"), read_number(topology / "die_id"),
+                                   read_number(topology / "core_id"));
+        if (std::get<2>(key) < 0)
+        {
+            key = std::make_tuple(int64_t(-1), int64_t(-1), -static_cast<int64_t>(cpu) - 1);
+        }
+        const uint32_t core = cores.emplace(key, static_cast<uint32_t>(cores.size())).first->second;
+
+        int64_t capacity = 0;
+        if (intel_hybrid)
+        {
+            capacity = std::find(performance_cpus.begin(), performance_cpus.end(), cpu) != performance_cpus.end();
+        }
+        else
+        {
+            capacity = std::max<int64_t>(read_number(cpu_root / ("cpu" + std::to_string(cpu)) / "cpu_capacity"), 0);
+        }
+
+        logical.push_back({cpu, 0, core, 0});
+        capacities.push_back(capacity);
+    }
+
+    // Rank the distinct capacities so efficiency stays small and comparable with Windows' EfficiencyClass.
+    std::vector<int64_t> ranks = capacities;
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+    for (size_t i = 0; i < logical.size(); ++i)
+    {
+        const size_t rank = std::lower_bound(ranks.begin(), ranks.end(), capacities[i]) - ranks.begin();
+        logical[i].efficiency = static_cast<uint8_t>(std::min<size_t>(rank, UINT8_MAX));
+    }
+    return !logical.empty();
+}
+#endif
+
+ash::job_cpu_topology detect_topology()
+{
+    ash::job_cpu_topology topology;
+#if defined(_WIN32)
+    const bool detected = detect_logical(topology.logical);
+#elif defined(__linux__)
+    const bool detected = detect_logical(topology.logical, "/sys/devices");
+#else
+    const bool detected = false;
+#endif
+
+    if (!detected)
+    {
+        topology.logical.clear();
+        const uint32_t count = std::max(std::thread::hardware_concurrency(), 1u);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            topology.logical.push_back({i, 0, i, 0});
+        }
+    }
+
+    uint8_t max_efficiency = 0;
+    uint8_t min_efficiency = UINT8_MAX;
+    for (const ash::job_cpu_logical &logical : topology.logical)
+    {
+        topology.core_count = std::max(topology.core_count, logical.core + 1);
+        max_efficiency = std::max(max_efficiency, logical.efficiency);
+        min_efficiency = std::min(min_efficiency, logical.efficiency);
+    }
+    topology.hybrid = max_efficiency != min_efficiency;
+
+    std::vector<bool> counted(topology.core_count, false);
+    for (const ash::job_cpu_logical &logical : topology.logical)
+    {
+        if (logical.efficiency == max_efficiency && !counted[logical.core])
+        {
+            counted[logical.core] = true;
+            ++topology.performance_core_count;
+        }
+    }
+    return topology;
+}
+} // namespace
+
+bool ash::job_cpu_has_avx2()
+{
+    static const bool has_avx2 = detect_avx2();
+    return has_avx2;
+}
+
+const ash::job_cpu_topology &ash::job_cpu_get_topology()
+{
+    static const job_cpu_topology topology = detect_topology();
+    return topology;
+}
+
+std::vector<uint32_t> ash::job_cpu_get_placement(const job_cpu_topology &topology)
+{
+    const uint32_t count = static_cast<uint32_t>(topology.logical.size());
+    std::vector<uint32_t> by_efficiency(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        by_efficiency[i] = i;
+    }
+    std::stable_sort(by_efficiency.begin(), by_efficiency.end(), [&](uint32_t a, uint32_t b) {
+        return topology.logical[a].efficiency > topology.logical[b].efficiency;
+    });
+
+    const uint8_t max_efficiency = count != 0 ? topology.logical[by_efficiency[0]].efficiency : 0;
+    std::vector<uint32_t> placement;
+    placement.reserve(count);
+    std::vector<bool> core_taken(topology.core_count, false);
+    std::vector<bool> placed(count, false);
+
+    // First one processor per performance core, then one per remaining core, then the SMT siblings.
+    for (uint32_t pass = 0; pass < 3; ++pass)
+    {
+        for (uint32_t i : by_efficiency)
+        {
+            const job_cpu_logical &logical = topology.logical[i];
+            const bool skip_core = pass < 2 && core_taken[logical.core];
+            if (placed[i] || skip_core || (pass == 0 && logical.efficiency != max_efficiency))
+            {
+                continue;
+            }
+
+            placed[i] = true;
+            core_taken[logical.core] = true;
+            placement.push_back(i);
+        }
+    }
+    return placement;
+}
+
+bool ash::job_cpu_place_current_thread(const job_cpu_logical &logical, bool pin)
+{
+#if defined(_WIN32)
+    if (pin)
+    {
+        GROUP_AFFINITY affinity = {};
+        affinity.Mask = KAFFINITY(1) << logical.id;
+        affinity.Group = logical.group;
+        return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+    }
+
+    PROCESSOR_NUMBER number = {};
+    number.Group = logical.group;
+    number.Number = static_cast<BYTE>(logical.id);
+    return SetThreadIdealProcessorEx(GetCurrentThread(), &number, nullptr) != 0;
+#elif defined(__linux__)
+    if (!pin)
+    {
+        // Linux has no soft preference; the scheduler spreads threads over idle cores on its own.
+        return true;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(logical.id, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)logical;
+    (void)pin;
+    return false;
+#endif
+}
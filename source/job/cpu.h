@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#define ASH_CPU_X86 1
+#else
+#define ASH_CPU_X86 0
+#endif
+
+namespace ash
+{
+struct job_cpu_logical
+{
+    // OS number of the processor; on Windows it is relative to `group`.
+    uint32_t id = 0;
+    uint16_t group = 0;
+    // Index of the physical core the processor belongs to; SMT siblings share it.
+    uint32_t core = 0;
+    // Relative performance of the core, higher is faster. Equal for every core of a non-hybrid CPU.
+    uint8_t efficiency = 0;
+};
+
+struct job_cpu_topology
+{
+    std::vector<job_cpu_logical> logical;
+    uint32_t core_count = 0;
+    // Cores at the highest efficiency.
+    uint32_t performance_core_count = 0;
+    bool hybrid = false;
+};
+} // namespace ash
+
+namespace ash
+{
+// True when both the CPU and the OS support AVX2. Detected once on first call.
+bool job_cpu_has_avx2();
+
+// Logical processors and physical cores the process can run on, from GetLogicalProcessorInformationEx on Windows
+// and sysfs on Linux. Falls back to one core per hardware thread when neither is available. Detected once on first
+// call.
+const job_cpu_topology &job_cpu_get_topology();
+
+// Indices into topology.logical in the order threads should be placed: one processor on each performance core,
+// then one on each remaining core, then the SMT siblings. Threads placed first get a physical core to themselves.
+std::vector<uint32_t> job_cpu_get_placement(const job_cpu_topology &topology);
+
+// Moves the calling thread to `logical`. Pinning restricts it to that processor; otherwise the OS is only given a
+// preference where it supports one (the ideal processor on Windows). Returns false if the OS refused.
+bool job_cpu_place_current_thread(const job_cpu_logical &logical, bool pin);
+} // namespace ash
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ash
+{
+// Chase-Lev work-stealing deque over a fixed ring of `Capacity` pointers, a power of two. Only the owner pushes and
+// pops at the bottom; any thread steals from the top.
+template <typename T, uint32_t Capacity> struct job_deque
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "job_deque capacity must be a power of two");
+
+    alignas(64) std::atomic<int64_t> top = 0;
+    alignas(64) std::atomic<int64_t> bottom = 0;
+    alignas(64) std::atomic<T *> ring[Capacity] = {};
+};
+
+// Owner only. Returns false, leaving the deque unchanged, when it is full.
+template <typename T, uint32_t Capacity> bool job_deque_push(job_deque<T, Capacity> &deque, T *item)
+{
+    const int64_t bottom = deque.bottom.load(std::memory_order_relaxed);
+    const int64_t top = deque.top.load(std::memory_order_acquire);
+    if (bottom - top >= static_cast<int64_t>(Capacity))
+    {
+        return false;
+    }
+
+    deque.ring[bottom & (Capacity - 1)].store(item, std::memory_order_relaxed);
+    deque.bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+// Owner only. Takes the most recently pushed item, or returns nullptr when the deque is empty or a thief won the
+// last one.
+template <typename T, uint32_t Capacity> T *job_deque_pop(job_deque<T, Capacity> &deque)
+{
+    const int64_t bottom = deque.bottom.load(std::memory_order_relaxed) - 1;
+    deque.bottom.store(bottom, std::memory_order_seq_cst);
+    int64_t top = deque.top.load(std::memory_order_seq_cst);
+    if (top > bottom)
+    {
+        deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    T *item = deque.ring[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // Last item: race the thieves for it.
+        if (!deque.top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            item = nullptr;
+        }
+        deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+}
+
+// Any thread. Takes the oldest item, retrying while other thieves win the race, or returns nullptr when the deque is
+// empty.
+template <typename T, uint32_t Capacity> T *job_deque_steal(job_deque<T, Capacity> &deque)
+{
+    while (true)
+    {
+        int64_t top = deque.top.load(std::memory_order_seq_cst);
+        const int64_t bottom = deque.bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        T *item = deque.ring[top & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (deque.top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return item;
+        }
+    }
+}
+} // namespace ash
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "job/scheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+namespace ash
+{
+template <typename Fn> struct job_parallel_for_context
+{
+    Fn *fn;
+    uint32_t count;
+    uint32_t grain;
+    uint32_t chunk_count;
+    std::atomic<uint32_t> next_chunk = 0;
+};
+
+template <typename Fn> void job_parallel_for_run(job_parallel_for_context<Fn> &context)
+{
+    for (uint32_t chunk = context.next_chunk.fetch_add(1, std::memory_order_relaxed); chunk < context.chunk_count;
+         chunk = context.next_chunk.fetch_add(1, std::memory_order_relaxed))
+    {
+        const uint32_t begin = chunk * context.grain;
+        const uint32_t end = std::min(begin + context.grain, context.count);
+        (*context.fn)(begin, end);
+    }
+}
+
+// Splits [0, count) into chunks of at most `grain` items and runs fn(begin, end) for each chunk on worker threads.
+// Returns once every chunk has finished. The calling thread takes chunks too, and runs other jobs while it waits.
+template <typename Fn> void job_parallel_for(uint32_t count, uint32_t grain, Fn &&fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grain = grain == 0 ? 1 : grain;
+    const uint32_t chunk_count = (count + grain - 1) / grain;
+    if (chunk_count == 1)
+    {
+        fn(0u, count);
+        return;
+    }
+
+    if (!job_is_running())
+    {
+        std::vector<uint32_t> chunks(chunk_count);
+        std::iota(chunks.begin(), chunks.end(), 0u);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](uint32_t chunk) {
+            const uint32_t begin = chunk * grain;
+            const uint32_t end = std::min(begin + grain, count);
+            fn(begin, end);
+        });
+        return;
+    }
+
+    // Chunks are handed out from a shared cursor, so one job per thread balances the load; jobs that start after
+    // the last chunk was taken return at once.
+    using context_type = job_parallel_for_context<std::remove_reference_t<Fn>>;
+    context_type context{&fn, count, grain, chunk_count};
+
+    job_decl jobs[job_max_threads];
+    const uint32_t job_count = std::min(chunk_count, job_get_thread_count()) - 1;
+    for (uint32_t i = 0; i < job_count; ++i)
+    {
+        jobs[i].fn = [](void *data) { job_parallel_for_run(*static_cast<context_type *>(data)); };
+        jobs[i].data = &context;
+    }
+
+    job_counter counter;
+    job_submit(jobs, job_count, &counter);
+    job_parallel_for_run(context);
+    job_wait(counter);
+}
+} // namespace ash
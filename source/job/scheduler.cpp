@@ -0,0 +1,488 @@
+#include "scheduler.h"
+#include "cpu.h"
+#include "deque.h"
+#include "editor/console.h"
+#include <algorithm>
+#include <common.h>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One allocation per submission: the header followed by its `count` entries. Freed by whichever thread finishes
+// the last of them.
+struct ash::job_batch
+{
+    std::atomic<uint32_t> remaining;
+    uint32_t count;
+    job_counter *counter;
+    job_batch *next;
+};
+
+namespace
+{
+struct job_entry
+{
+    ash::job_decl decl;
+    ash::job_batch *batch;
+};
+
+constexpr uint64_t g_pending_mask = 0xffffffffull;
+constexpr uint64_t g_releasing_one = 1ull << 32;
+
+// Failed scans a thread retries, yielding in between, before it goes to sleep.
+constexpr uint32_t g_spin_rounds = 64;
+
+using work_deque = ash::job_deque<job_entry, ash::job_deque_capacity>;
+
+std::unique_ptr<work_deque> g_deques[ash::job_max_threads];
+std::atomic<uint32_t> g_thread_count = 0;
+std::mutex g_attach_mutex;
+
+std::vector<std::thread> g_workers;
+// Topology indices for the critical thread (slot 0) and then the workers.
+std::vector<uint32_t> g_placement;
+std::atomic<bool> g_running = false;
+
+std::mutex g_injection_mutex;
+std::deque<job_entry *> g_injection;
+std::atomic<uint32_t> g_injection_size = 0;
+
+// Sleepers read g_epoch before scanning for work and only sleep if no submission or completion bumped it since.
+std::mutex g_sleep_mutex;
+std::condition_variable g_sleep_cv;
+std::atomic<uint32_t> g_sleepers = 0;
+std::atomic<uint64_t> g_epoch = 0;
+
+thread_local uint32_t g_thread_index = UINT32_MAX;
+thread_local uint32_t g_steal_seed = 0;
+
+job_entry *batch_entries(ash::job_batch *batch)
+{
+    return reinterpret_cast<job_entry *>(batch + 1);
+}
+
+void wake(uint32_t count)
+{
+    g_epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (g_sleepers.load(std::memory_order_seq_cst) == 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_sleep_mutex);
+    }
+    if (count == 1)
+    {
+        g_sleep_cv.notify_one();
+    }
+    else
+    {
+        g_sleep_cv.notify_all();
+    }
+}
+
+void sleep_until_work(uint64_t epoch)
+{
+    std::unique_lock<std::mutex> lock(g_sleep_mutex);
+    g_sleepers.fetch_add(1, std::memory_order_seq_cst);
+    if (g_epoch.load(std::memory_order_seq_cst) == epoch && g_running.load(std::memory_order_acquire))
+    {
+        g_sleep_cv.wait(lock);
+    }
+    g_sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void push_batch(ash::job_batch *batch)
+{
+    // The batch can finish and be freed as soon as its first entry is visible, so nothing reads it after that.
+    job_entry *entries = batch_entries(batch);
+    const uint32_t count = batch->count;
+    uint32_t pushed = 0;
+    if (g_thread_index != UINT32_MAX)
+    {
+        work_deque &deque = *g_deques[g_thread_index];
+        while (pushed < count && ash::job_deque_push(deque, &entries[pushed]))
+        {
+            ++pushed;
+        }
+    }
+
+    if (pushed < count)
+    {
+        std::lock_guard<std::mutex> lock(g_injection_mutex);
+        for (uint32_t i = pushed; i < count; ++i)
+        {
+            g_injection.push_back(&entries[i]);
+        }
+        g_injection_size.store(static_cast<uint32_t>(g_injection.size()), std::memory_order_release);
+    }
+
+    wake(count);
+}
+
+job_entry *find_job(uint32_t self)
+{
+    if (self != UINT32_MAX)
+    {
+        if (job_entry *entry = ash::job_deque_pop(*g_deques[self]))
+        {
+            return entry;
+        }
+    }
+
+    if (g_injection_size.load(std::memory_order_acquire) != 0)
+    {
+        std::lock_guard<std::mutex> lock(g_injection_mutex);
+        if (!g_injection.empty())
+        {
+            job_entry *entry = g_injection.front();
+            g_injection.pop_front();
+            g_injection_size.store(static_cast<uint32_t>(g_injection.size()), std::memory_order_release);
+            return entry;
+        }
+    }
+
+    const uint32_t thread_count = g_thread_count.load(std::memory_order_acquire);
+    if (thread_count == 0)
+    {
+        return nullptr;
+    }
+
+    // xorshift32 picks where the victim scan starts so thieves spread out.
+    uint32_t seed = g_steal_seed;
+    if (seed == 0)
+    {
+        seed = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&g_steal_seed)) | 1u;
+    }
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    g_steal_seed = seed;
+
+    const uint32_t start = seed % thread_count;
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        const uint32_t victim = (start + i) % thread_count;
+        if (victim == self)
+        {
+            continue;
+        }
+
+        if (job_entry *entry = ash::job_deque_steal(*g_deques[victim]))
+        {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void signal_counter(ash::job_counter &counter)
+{
+    // Drop one submission and register as releasing in the same step, so a waiter that sees the counter at zero
+    // knows no thread is still touching it.
+    const uint64_t previous = counter.state.fetch_add(g_releasing_one - 1, std::memory_order_acq_rel);
+    ash::job_batch *released = nullptr;
+    if ((previous & g_pending_mask) == 1)
+    {
+        std::lock_guard<std::mutex> lock(counter.lock);
+        // A submission made since the decrement keeps the continuations parked until it finishes too.
+        if ((counter.state.load(std::memory_order_acquire) & g_pending_mask) == 0)
+        {
+            released = counter.continuations;
+            counter.continuations = nullptr;
+        }
+    }
+    counter.state.fetch_sub(g_releasing_one, std::memory_order_release);
+
+    if ((previous & g_pending_mask) == 1)
+    {
+        wake(UINT32_MAX);
+    }
+
+    while (released != nullptr)
+    {
+        ash::job_batch *next = released->next;
+        push_batch(released);
+        released = next;
+    }
+}
+
+void run_job(job_entry *entry)
+{
+    entry->decl.fn(entry->decl.data);
+
+    ash::job_batch *batch = entry->batch;
+    if (batch->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    ash::job_counter *counter = batch->counter;
+    batch->~job_batch();
+    ::operator delete(batch);
+    if (counter != nullptr)
+    {
+        signal_counter(*counter);
+    }
+}
+
+ash::job_batch *make_batch(const ash::job_decl *jobs, uint32_t count, ash::job_counter *counter)
+{
+    void *memory = ::operator new(sizeof(ash::job_batch) + sizeof(job_entry) * count);
+    ash::job_batch *batch = new (memory) ash::job_batch{};
+    batch->remaining.store(count, std::memory_order_relaxed);
+    batch->count = count;
+    batch->counter = counter;
+    batch->next = nullptr;
+
+    job_entry *entries = batch_entries(batch);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        new (&entries[i]) job_entry{jobs[i], batch};
+    }
+
+    if (counter != nullptr)
+    {
+        counter->state.fetch_add(1, std::memory_order_relaxed);
+    }
+    return batch;
+}
+
+void set_thread_name(std::thread &thread, uint32_t index)
+{
+#if defined(_WIN32)
+    const std::wstring name = std::format(L"Job Worker {}", index);
+    SetThreadDescription(static_cast<HANDLE>(thread.native_handle()), name.c_str());
+#else
+    (void)thread;
+    (void)index;
+#endif
+}
+
+void place_thread(uint32_t slot)
+{
+    if (slot >= g_placement.size())
+    {
+        return;
+    }
+
+    const ash::job_cpu_logical &logical = ash::job_cpu_get_topology().logical[g_placement[slot]];
+    if (!ash::job_cpu_place_current_thread(logical, ash::job_g_pin_threads))
+    {
+        ash::ed_console_log(ash::ed_console_log_level::warning,
+                            std::format("[Job] Could not place thread on processor {}:{}.", logical.group, logical.id));
+    }
+}
+
+void worker_main(uint32_t index)
+{
+    g_thread_index = index;
+    place_thread(index + 1);
+
+    uint32_t idle = 0;
+    while (g_running.load(std::memory_order_acquire))
+    {
+        const uint64_t epoch = g_epoch.load(std::memory_order_seq_cst);
+        if (job_entry *entry = find_job(index))
+        {
+            run_job(entry);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < g_spin_rounds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        sleep_until_work(epoch);
+        idle = 0;
+    }
+}
+
+uint32_t add_deque()
+{
+    std::lock_guard<std::mutex> lock(g_attach_mutex);
+    const uint32_t index = g_thread_count.load(std::memory_order_relaxed);
+    assert(index < ash::job_max_threads);
+    g_deques[index] = std::make_unique<work_deque>();
+    g_thread_count.store(index + 1, std::memory_order_release);
+    return index;
+}
+} // namespace
+
+void ash::job_init(uint32_t worker_count)
+{
+    SCOPED_CPU_EVENT(L"ash::job_init")
+
+    assert(!g_running.load(std::memory_order_relaxed));
+    const job_cpu_topology &topology = job_cpu_get_topology();
+    g_placement = job_cpu_get_placement(topology);
+    ed_console_log(ed_console_log_level::info,
+                   std::format("[Job] CPU topology: {} logical processors, {} cores, {} performance cores{}.",
+                               topology.logical.size(), topology.core_count, topology.performance_core_count,
+                               topology.hybrid ? " (hybrid)" : ""));
+
+    if (worker_count == 0)
+    {
+        // Leave a hardware thread each for the main and renderer threads.
+        const uint32_t hardware_threads = static_cast<uint32_t>(topology.logical.size());
+        worker_count = hardware_threads > 3 ? hardware_threads - 2 : 1;
+    }
+    // Keep a few deques for attached threads.
+    worker_count = std::min(worker_count, job_max_threads - 4);
+
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        add_deque();
+    }
+
+    g_running.store(true, std::memory_order_release);
+    g_workers.reserve(worker_count);
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        g_workers.emplace_back(worker_main, i);
+        set_thread_name(g_workers.back(), i);
+    }
+
+    job_attach_thread();
+    ed_console_log(ed_console_log_level::info, std::format("[Job] Scheduler started with {} workers.", worker_count));
+}
+
+void ash::job_shutdown()
+{
+    SCOPED_CPU_EVENT(L"ash::job_shutdown")
+
+    if (!g_running.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_sleep_mutex);
+        g_running.store(false, std::memory_order_release);
+    }
+    g_sleep_cv.notify_all();
+
+    for (std::thread &worker : g_workers)
+    {
+        worker.join();
+    }
+    g_workers.clear();
+
+    assert(g_injection.empty());
+    for (std::unique_ptr<work_deque> &deque : g_deques)
+    {
+        deque.reset();
+    }
+    g_thread_count.store(0, std::memory_order_release);
+    g_thread_index = UINT32_MAX;
+    ed_console_log(ed_console_log_level::info, "[Job] Scheduler stopped.");
+}
+
+void ash::job_place_critical_thread()
+{
+    place_thread(0);
+}
+
+bool ash::job_is_running()
+{
+    return g_running.load(std::memory_order_acquire);
+}
+
+void ash::job_attach_thread()
+{
+    if (g_thread_index == UINT32_MAX)
+    {
+        g_thread_index = add_deque();
+    }
+}
+
+void ash::job_submit(const job_decl *jobs, uint32_t count, job_counter *counter)
+{
+    assert(job_is_running());
+    if (count == 0)
+    {
+        return;
+    }
+
+    push_batch(make_batch(jobs, count, counter));
+}
+
+void ash::job_submit_after(job_counter &dependency, const job_decl *jobs, uint32_t count, job_counter *counter)
+{
+    assert(job_is_running());
+    if (count == 0)
+    {
+        return;
+    }
+
+    job_batch *batch = make_batch(jobs, count, counter);
+    {
+        std::lock_guard<std::mutex> lock(dependency.lock);
+        if ((dependency.state.load(std::memory_order_acquire) & g_pending_mask) != 0)
+        {
+            batch->next = dependency.continuations;
+            dependency.continuations = batch;
+            return;
+        }
+    }
+    push_batch(batch);
+}
+
+void ash::job_counter_increment(job_counter &counter)
+{
+    counter.state.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ash::job_counter_decrement(job_counter &counter)
+{
+    signal_counter(counter);
+}
+
+void ash::job_wait(job_counter &counter)
+{
+    const uint32_t self = g_thread_index;
+    uint32_t idle = 0;
+    while (counter.state.load(std::memory_order_acquire) != 0)
+    {
+        const uint64_t epoch = g_epoch.load(std::memory_order_seq_cst);
+        if (job_entry *entry = find_job(self))
+        {
+            run_job(entry);
+            idle = 0;
+            continue;
+        }
+
+        if (counter.state.load(std::memory_order_acquire) == 0)
+        {
+            break;
+        }
+
+        if (++idle < g_spin_rounds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        sleep_until_work(epoch);
+        idle = 0;
+    }
+}
+
+uint32_t ash::job_get_thread_count()
+{
+    return g_thread_count.load(std::memory_order_acquire);
+}
+
+uint32_t ash::job_get_thread_index()
+{
+    return g_thread_index;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace ash
+{
+// Upper bound on threads that own a job deque: the pool's workers plus attached threads such as the main and
+// renderer threads.
+constexpr uint32_t job_max_threads = 64;
+
+// Capacity of each thread's deque. Jobs pushed to a full deque go to the global injection queue instead.
+constexpr uint32_t job_deque_capacity = 4096;
+
+// Makes job_init and job_place_critical_thread pin threads to their processors rather than only preferring them.
+inline bool job_g_pin_threads = false;
+
+struct job_decl
+{
+    void (*fn)(void *data) = nullptr;
+    void *data = nullptr;
+};
+
+struct job_batch;
+
+// Tracks the submissions made against it; it reads zero once every job of every one of them has finished. Jobs
+// submitted with job_submit_after wait on it. The thread finishing the last job still touches the counter briefly
+// after that, so a counter may only be destroyed or reused once job_wait on it has returned, even if it was only
+// used as a dependency.
+struct job_counter
+{
+    // Low 32 bits: unfinished submissions. High 32 bits: threads still inside the counter after taking it to zero.
+    std::atomic<uint64_t> state = 0;
+    std::mutex lock;
+    job_batch *continuations = nullptr;
+};
+} // namespace ash
+
+namespace ash
+{
+// Starts the worker pool and attaches the calling thread. worker_count 0 uses one worker per hardware thread that
+// is not already taken by the main and renderer threads. Workers are placed in job_cpu_get_placement order after the
+// critical thread's processor, so the first ones get performance cores of their own and SMT siblings come last.
+void job_init(uint32_t worker_count = 0);
+
+// Stops and joins the workers. Every submitted job must have finished.
+void job_shutdown();
+
+bool job_is_running();
+
+// Puts the calling thread on the first performance core, which job_init keeps free of workers. For the one thread
+// whose latency bounds the frame, the renderer.
+void job_place_critical_thread();
+
+// Gives the calling thread its own deque, so the jobs it submits are pushed locally and stolen by the pool, and
+// job_wait on it pops them LIFO. Threads that are not attached still submit (through the injection queue) and
+// still run jobs while they wait.
+void job_attach_thread();
+
+// Schedules `count` jobs. When `counter` is set it is raised before this returns and drops when the last of the
+// jobs finishes.
+void job_submit(const job_decl *jobs, uint32_t count, job_counter *counter = nullptr);
+
+// Like job_submit, but the jobs only become runnable once `dependency` reaches zero.
+void job_submit_after(job_counter &dependency, const job_decl *jobs, uint32_t count, job_counter *counter = nullptr);
+
+// Raises and drops `counter` for work that is not a submitted job, such as a coroutine that finishes on whichever
+// thread resumed it last. Every increment needs exactly one decrement.
+void job_counter_increment(job_counter &counter);
+void job_counter_decrement(job_counter &counter);
+
+// Runs queued jobs on the calling thread until `counter` reaches zero, sleeping only when there is nothing left to
+// run. Safe to call from inside a job.
+void job_wait(job_counter &counter);
+
+// Workers plus attached threads; job_get_thread_index is always below this.
+uint32_t job_get_thread_count();
+
+// Index of the calling thread's deque, or UINT32_MAX when the thread is not part of the scheduler.
+uint32_t job_get_thread_index();
+} // namespace ash
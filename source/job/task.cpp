@@ -0,0 +1,257 @@
+#include "task.h"
+#include "editor/console.h"
+#include <common.h>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+// Fire-and-forget coroutine owning a spawned root task; its frame frees itself when it finishes.
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+struct mailbox
+{
+    std::mutex mutex;
+    std::vector<std::coroutine_handle<>> handles;
+};
+
+struct io_request
+{
+    std::filesystem::path path;
+    ash::job_file_data *result;
+    std::coroutine_handle<> handle;
+};
+
+mailbox g_mailboxes[static_cast<size_t>(ash::job_affinity::count)];
+thread_local int32_t g_affinity = -1;
+#if defined(_WIN32)
+std::atomic<DWORD> g_main_thread_id = 0;
+#endif
+
+std::thread g_io_thread;
+std::mutex g_io_mutex;
+std::condition_variable g_io_cv;
+std::deque<io_request> g_io_requests;
+bool g_io_running = false;
+
+void resume_job(void *address)
+{
+    std::coroutine_handle<>::from_address(address).resume();
+}
+
+void read_file(const std::filesystem::path &path, ash::job_file_data &result)
+{
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(path, error);
+    std::ifstream file(path, std::ios::binary);
+    if (error || !file)
+    {
+        return;
+    }
+
+    result.bytes.resize(static_cast<size_t>(size));
+    file.read(reinterpret_cast<char *>(result.bytes.data()), static_cast<std::streamsize>(size));
+    result.ok = static_cast<uintmax_t>(file.gcount()) == size;
+}
+
+void io_main()
+{
+#if defined(_WIN32)
+    SetThreadDescription(GetCurrentThread(), L"Job IO Thread");
+#endif
+
+    while (true)
+    {
+        io_request request;
+        {
+            std::unique_lock<std::mutex> lock(g_io_mutex);
+            g_io_cv.wait(lock, [] { return !g_io_running || !g_io_requests.empty(); });
+            if (g_io_requests.empty())
+            {
+                return;
+            }
+            request = std::move(g_io_requests.front());
+            g_io_requests.pop_front();
+        }
+
+        read_file(request.path, *request.result);
+
+        // Continue on the pool so the awaiting task never runs on, or stalls, the I/O thread.
+        const ash::job_decl job = {resume_job, request.handle.address()};
+        ash::job_submit(&job, 1);
+    }
+}
+
+// Queues the read and resumes the awaiting task from the I/O thread's completion job.
+struct file_read_awaiter
+{
+    const std::filesystem::path &path;
+    ash::job_file_data &result;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_io_mutex);
+            assert(g_io_running);
+            g_io_requests.push_back({path, &result, handle});
+        }
+        g_io_cv.notify_one();
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+};
+
+detached_task run_detached(ash::task<void> root, ash::job_cancel_source *cancel)
+{
+    root.handle.promise().cancel = cancel;
+    co_await ash::job_resume_on_worker{};
+    try
+    {
+        co_await root;
+    }
+    catch (const ash::job_task_cancelled &)
+    {
+    }
+    catch (const std::exception &exception)
+    {
+        ash::ed_console_log(ash::ed_console_log_level::error,
+                            std::format("[Job] Spawned task failed: {}", exception.what()));
+    }
+    catch (...)
+    {
+        ash::ed_console_log(ash::ed_console_log_level::error, "[Job] Spawned task failed.");
+    }
+}
+} // namespace
+
+void ash::job_task_init()
+{
+    SCOPED_CPU_EVENT(L"ash::job_task_init")
+
+    std::lock_guard<std::mutex> lock(g_io_mutex);
+    assert(!g_io_running);
+    g_io_running = true;
+    g_io_thread = std::thread(io_main);
+}
+
+void ash::job_task_shutdown()
+{
+    SCOPED_CPU_EVENT(L"ash::job_task_shutdown")
+
+    {
+        std::lock_guard<std::mutex> lock(g_io_mutex);
+        if (!g_io_running)
+        {
+            return;
+        }
+        g_io_running = false;
+    }
+    g_io_cv.notify_all();
+    g_io_thread.join();
+}
+
+void ash::job_task_attach(job_affinity affinity)
+{
+    g_affinity = static_cast<int32_t>(affinity);
+#if defined(_WIN32)
+    if (affinity == job_affinity::main)
+    {
+        g_main_thread_id.store(GetCurrentThreadId(), std::memory_order_release);
+    }
+#endif
+}
+
+void ash::job_task_drain(job_affinity affinity)
+{
+    assert(job_task_is_on(affinity));
+
+    mailbox &box = g_mailboxes[static_cast<size_t>(affinity)];
+    std::vector<std::coroutine_handle<>> handles;
+    {
+        std::lock_guard<std::mutex> lock(box.mutex);
+        handles.swap(box.handles);
+    }
+
+    for (std::coroutine_handle<> handle : handles)
+    {
+        handle.resume();
+    }
+}
+
+bool ash::job_task_is_on(job_affinity affinity)
+{
+    return g_affinity == static_cast<int32_t>(affinity);
+}
+
+void ash::job_task_post(job_affinity affinity, std::coroutine_handle<> handle)
+{
+    mailbox &box = g_mailboxes[static_cast<size_t>(affinity)];
+    {
+        std::lock_guard<std::mutex> lock(box.mutex);
+        box.handles.push_back(handle);
+    }
+
+#if defined(_WIN32)
+    // The main thread sleeps in GetMessage; a thread message wakes it up to drain. The render thread drains every
+    // frame anyway.
+    if (affinity == job_affinity::main)
+    {
+        PostThreadMessage(g_main_thread_id.load(std::memory_order_acquire), WM_NULL, 0, 0);
+    }
+#endif
+}
+
+void ash::job_spawn(task<void> root, job_cancel_source *cancel)
+{
+    run_detached(std::move(root), cancel);
+}
+
+ash::task<ash::job_file_data> ash::job_read_file(std::filesystem::path path)
+{
+    job_file_data result;
+    co_await file_read_awaiter{path, result};
+    if (co_await job_cancel_requested{})
+    {
+        throw job_task_cancelled();
+    }
+    co_return result;
+}
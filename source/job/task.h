@@ -0,0 +1,353 @@
+#pragma once
+
+#include "job/scheduler.h"
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ash
+{
+// Threads a coroutine can ask to be resumed on. Each one drains its queue with job_task_drain.
+enum class job_affinity : uint8_t
+{
+    main,
+    render,
+    count
+};
+
+// Shared by a root task and every task it awaits, directly or not. Once requested, the next job_* suspension point
+// of any task in the chain throws job_task_cancelled; code in between can poll with job_cancel_requested.
+struct job_cancel_source
+{
+    std::atomic<bool> requested = false;
+};
+
+struct job_task_cancelled : std::exception
+{
+    const char *what() const noexcept override
+    {
+        return "task cancelled";
+    }
+};
+
+struct job_file_data
+{
+    std::vector<uint8_t> bytes;
+    bool ok = false;
+};
+
+struct job_promise_base
+{
+    // Resumed by symmetric transfer when this task finishes; set by the task awaiting it.
+    std::coroutine_handle<> continuation;
+    // Dropped when a root task started by job_sync_wait finishes.
+    job_counter *completion = nullptr;
+    job_cancel_source *cancel = nullptr;
+    std::exception_ptr exception;
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    auto final_suspend() noexcept;
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+};
+
+// Hands control to the awaiting task, or signals job_sync_wait, once a task has finished.
+struct job_final_awaiter
+{
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template <typename Promise> std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        job_promise_base &promise = handle.promise();
+        if (promise.continuation)
+        {
+            return promise.continuation;
+        }
+        if (promise.completion != nullptr)
+        {
+            job_counter_decrement(*promise.completion);
+        }
+        return std::noop_coroutine();
+    }
+
+    void await_resume() noexcept
+    {
+    }
+};
+
+inline auto job_promise_base::final_suspend() noexcept
+{
+    return job_final_awaiter{};
+}
+
+template <typename Promise> job_cancel_source *job_get_cancel_source(std::coroutine_handle<Promise> handle)
+{
+    if constexpr (std::is_base_of_v<job_promise_base, Promise>)
+    {
+        return handle.promise().cancel;
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+inline void job_throw_if_cancelled(const job_cancel_source *cancel)
+{
+    if (cancel != nullptr && cancel->requested.load(std::memory_order_relaxed))
+    {
+        throw job_task_cancelled();
+    }
+}
+
+template <typename T> struct job_promise : job_promise_base
+{
+    std::optional<T> value;
+
+    template <typename U> void return_value(U &&result)
+    {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T take_result()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <> struct job_promise<void> : job_promise_base
+{
+    void return_void()
+    {
+    }
+
+    void take_result()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+// Lazily started coroutine producing a T. It runs inline on the thread that awaits it until its first suspension
+// point, and resumes its awaiter when it finishes, on whatever thread that is; job_resume_on_worker and
+// job_resume_on choose the thread explicitly. Exceptions propagate to the awaiter.
+template <typename T = void> struct [[nodiscard]] task
+{
+    struct promise_type : job_promise<T>
+    {
+        task get_return_object()
+        {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    task() = default;
+
+    explicit task(std::coroutine_handle<promise_type> handle) : handle(handle)
+    {
+    }
+
+    task(task &&other) noexcept : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+
+    task &operator=(task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+
+    ~task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    struct awaiter
+    {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            if constexpr (std::is_base_of_v<job_promise_base, Promise>)
+            {
+                handle.promise().cancel = awaiting.promise().cancel;
+            }
+            return handle;
+        }
+
+        T await_resume()
+        {
+            return handle.promise().take_result();
+        }
+    };
+
+    awaiter operator co_await() noexcept
+    {
+        return awaiter{handle};
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Suspends and continues on a pool worker.
+struct job_resume_on_worker
+{
+    job_cancel_source *cancel = nullptr;
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template <typename Promise> void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        cancel = job_get_cancel_source(handle);
+        const job_decl job = {[](void *address) { std::coroutine_handle<>::from_address(address).resume(); },
+                              handle.address()};
+        // The coroutine may already be running elsewhere once this returns, so `this` is not touched after it.
+        job_submit(&job, 1);
+    }
+
+    void await_resume() const
+    {
+        job_throw_if_cancelled(cancel);
+    }
+};
+} // namespace ash
+
+namespace ash
+{
+// Starts the file I/O thread. Call after job_init.
+void job_task_init();
+
+// Stops the file I/O thread. Every task must have finished.
+void job_task_shutdown();
+
+// Marks the calling thread as the one job_resume_on(affinity) resumes on. It must call job_task_drain regularly.
+void job_task_attach(job_affinity affinity);
+
+// Resumes the coroutines queued for `affinity`. Call from the attached thread.
+void job_task_drain(job_affinity affinity);
+
+// True when the calling thread is attached as `affinity`.
+bool job_task_is_on(job_affinity affinity);
+
+void job_task_post(job_affinity affinity, std::coroutine_handle<> handle);
+
+// Runs `root` to completion in the background on the pool. A root that throws is logged and dropped.
+void job_spawn(task<void> root, job_cancel_source *cancel = nullptr);
+
+// Reads a whole file on the I/O thread and continues on a pool worker with its contents. No worker is blocked
+// while the read is in flight.
+task<job_file_data> job_read_file(std::filesystem::path path);
+
+// Suspends and continues on the thread attached as `affinity`, or continues at once when already on it. Either way
+// it is a cancellation point.
+struct job_resume_on
+{
+    job_affinity affinity;
+    job_cancel_source *cancel = nullptr;
+
+    bool await_ready() const noexcept
+    {
+        // await_suspend always runs, so the cancel source is picked up even when no thread switch is needed.
+        return false;
+    }
+
+    template <typename Promise> bool await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        cancel = job_get_cancel_source(handle);
+        if (job_task_is_on(affinity))
+        {
+            return false;
+        }
+
+        // The coroutine may already be running on the target thread once this returns, so `this` is not touched
+        // after it.
+        job_task_post(affinity, handle);
+        return true;
+    }
+
+    void await_resume() const
+    {
+        job_throw_if_cancelled(cancel);
+    }
+};
+
+// Evaluates to true once the calling task's chain was cancelled, without suspending.
+struct job_cancel_requested
+{
+    job_cancel_source *cancel = nullptr;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    template <typename Promise> bool await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        cancel = job_get_cancel_source(handle);
+        return false;
+    }
+
+    bool await_resume() const noexcept
+    {
+        return cancel != nullptr && cancel->requested.load(std::memory_order_relaxed);
+    }
+};
+
+// Runs `root` on the calling thread until it first suspends, then runs other jobs until it finishes, and returns its
+// result or rethrows its exception. Must not be called on a thread the task resumes on through job_resume_on.
+template <typename T> T job_sync_wait(task<T> root, job_cancel_source *cancel = nullptr)
+{
+    job_counter counter;
+    job_counter_increment(counter);
+    root.handle.promise().completion = &counter;
+    root.handle.promise().cancel = cancel;
+    root.handle.resume();
+    job_wait(counter);
+    return root.handle.promise().take_result();
+}
+} // namespace ash
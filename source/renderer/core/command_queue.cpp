@@ -1,8 +1,33 @@
 #include "command_queue.h"
+#include "frame_ring.h"
+#include "job/scheduler.h"
 #include <renderer/renderer.h>
+#include <vector>
 
 namespace
 {
+struct pooled_list
+{
+    winrt::com_ptr<ID3D12CommandAllocator> allocator;
+    winrt::com_ptr<ID3D12GraphicsCommandList> list;
+};
+
+// Lists one thread has acquired for one queue type in one frame slot. Only that thread touches it while the frame
+// records, and only the render thread between frames, so it needs no lock.
+struct list_pool
+{
+    std::vector<pooled_list> lists;
+    uint32_t used = 0;
+};
+
+list_pool g_pools[ash::rhi_frame_max_in_flight][ash::job_max_threads]
+                 [static_cast<size_t>(ash::rhi_cmd_queue_type::count)];
+
+constexpr D3D12_COMMAND_LIST_TYPE g_list_types[] = {D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_TYPE_COMPUTE,
+                                                    D3D12_COMMAND_LIST_TYPE_COPY};
+constexpr const wchar_t *g_list_names[] = {L"Pooled Direct Command List", L"Pooled Compute Command List",
+                                           L"Pooled Copy Command List"};
+
 void create(D3D12_COMMAND_LIST_TYPE type, D3D12_COMMAND_QUEUE_PRIORITY priority, ID3D12CommandQueue **queue)
 {
     D3D12_COMMAND_QUEUE_DESC qDesc = {};
@@ -26,11 +51,60 @@ void ash::rhi_cmd_init()
     SET_OBJECT_NAME(rhi_cmd_g_direct.get(), L"Direct Queue")
     SET_OBJECT_NAME(rhi_cmd_g_compute.get(), L"Compute Queue")
     SET_OBJECT_NAME(rhi_cmd_g_copy.get(), L"Copy Queue")
+}
+
+void ash::rhi_cmd_shutdown()
+{
+    for (auto &frame_pools : g_pools)
+    {
+        for (auto &thread_pools : frame_pools)
+        {
+            for (list_pool &pool : thread_pools)
+            {
+                pool = {};
+            }
+        }
+    }
+}
+
+void ash::rhi_cmd_begin_frame(uint32_t frame_index)
+{
+    SCOPED_CPU_EVENT(L"ash::rhi_cmd_begin_frame")
+
+    // Allocators are reset lazily by rhi_cmd_acquire, so a thread that records nothing this frame costs nothing.
+    for (auto &thread_pools : g_pools[frame_index])
+    {
+        for (list_pool &pool : thread_pools)
+        {
+            pool.used = 0;
+        }
+    }
+}
+
+ID3D12GraphicsCommandList *ash::rhi_cmd_acquire(rhi_cmd_queue_type type)
+{
+    const uint32_t thread_index = job_get_thread_index();
+    assert(thread_index != UINT32_MAX);
+
+    const size_t type_index = static_cast<size_t>(type);
+    list_pool &pool = g_pools[rhi_frame_g_ring.index][thread_index][type_index];
+
+    if (pool.used < pool.lists.size())
+    {
+        pooled_list &entry = pool.lists[pool.used++];
+        entry.allocator->Reset();
+        entry.list->Reset(entry.allocator.get(), nullptr);
+        return entry.list.get();
+    }
 
-    rhi_g_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
-                                             IID_PPV_ARGS(rhi_cmd_g_command_allocator.put()));
-    rhi_g_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, rhi_cmd_g_command_allocator.get(), nullptr,
-                                        IID_PPV_ARGS(rhi_cmd_g_command_list.put()));
+    pooled_list &entry = pool.lists.emplace_back();
+    ++pool.used;
+    rhi_g_device->CreateCommandAllocator(g_list_types[type_index], IID_PPV_ARGS(entry.allocator.put()));
+    assert(entry.allocator.get());
+    rhi_g_device->CreateCommandList(0, g_list_types[type_index], entry.allocator.get(), nullptr,
+                                    IID_PPV_ARGS(entry.list.put()));
+    assert(entry.list.get());
+    SET_OBJECT_NAME(entry.list.get(), g_list_names[type_index]);
 
-    SET_OBJECT_NAME(rhi_cmd_g_command_list.get(), L"Triangle Command List");
+    return entry.list.get();
 }
@@ -8,11 +8,28 @@ inline winrt::com_ptr<ID3D12CommandQueue> rhi_cmd_g_direct = nullptr;
 inline winrt::com_ptr<ID3D12CommandQueue> rhi_cmd_g_compute = nullptr;
 inline winrt::com_ptr<ID3D12CommandQueue> rhi_cmd_g_copy = nullptr;
 
-inline winrt::com_ptr<ID3D12CommandAllocator> rhi_cmd_g_command_allocator;
-inline winrt::com_ptr<ID3D12GraphicsCommandList> rhi_cmd_g_command_list;
+enum class rhi_cmd_queue_type : uint8_t
+{
+    direct,
+    compute,
+    copy,
+    count
+};
 } // namespace ash
 
 namespace ash
 {
 void rhi_cmd_init();
+
+// Releases every pooled command list. The GPU must be idle.
+void rhi_cmd_shutdown();
+
+// Recycles the command lists recorded in frame slot `frame_index`. Call on the render thread once the fence of the
+// frame that last used the slot has been reached, and before that frame acquires any list.
+void rhi_cmd_begin_frame(uint32_t frame_index);
+
+// Returns an open command list for `type` with an allocator of its own, from the calling thread's pool for the
+// current frame slot. Lists are owned by the pool: close them and submit them before the slot comes around again.
+// Any thread attached to the job scheduler may record in parallel, each into its own lists, without locking.
+ID3D12GraphicsCommandList *rhi_cmd_acquire(rhi_cmd_queue_type type);
 } // namespace ash
@@ -0,0 +1,26 @@
+#include "frame_ring.h"
+#include <algorithm>
+
+void ash::rhi_frame_init(rhi_frame_ring &ring, uint32_t frame_count)
+{
+    ring = {};
+    ring.frame_count = std::clamp(frame_count, 1u, rhi_frame_max_in_flight);
+}
+
+uint64_t ash::rhi_frame_get_wait_value(const rhi_frame_ring &ring)
+{
+    return ring.fence_values[ring.index];
+}
+
+uint64_t ash::rhi_frame_advance(rhi_frame_ring &ring)
+{
+    const uint64_t value = ++ring.last_signalled;
+    ring.fence_values[ring.index] = value;
+    ring.index = (ring.index + 1) % ring.frame_count;
+    return value;
+}
+
+bool ash::rhi_frame_is_idle(const rhi_frame_ring &ring, uint64_t completed)
+{
+    return completed >= ring.last_signalled;
+}
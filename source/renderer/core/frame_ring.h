@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ash
+{
+// Most frames the CPU may record ahead of the GPU; sizes every per-frame array.
+constexpr uint32_t rhi_frame_max_in_flight = 3;
+
+// Bookkeeping for frames in flight, independent of the graphics API. Each slot owns the per-frame resources
+// (command allocator, upload memory, retired buffers) of every rhi_frame_max_in_flight-th frame, and remembers the
+// fence value signalled after that frame's submission. A slot can be reused once the fence reaches that value.
+struct rhi_frame_ring
+{
+    uint32_t frame_count = 2;
+    // Slot of the frame being recorded.
+    uint32_t index = 0;
+    uint64_t fence_values[rhi_frame_max_in_flight] = {};
+    uint64_t last_signalled = 0;
+};
+
+// Frames in flight, 2 or 3. Read by rhi_init.
+inline uint32_t rhi_frame_g_count = 2;
+
+inline rhi_frame_ring rhi_frame_g_ring;
+} // namespace ash
+
+namespace ash
+{
+// Resets `ring` to `frame_count` slots, clamped to [1, rhi_frame_max_in_flight], with nothing in flight.
+void rhi_frame_init(rhi_frame_ring &ring, uint32_t frame_count);
+
+// Fence value that has to be reached before the current slot's resources are reused, or 0 when the slot was never
+// submitted.
+uint64_t rhi_frame_get_wait_value(const rhi_frame_ring &ring);
+
+// Ends the frame being recorded: returns the fence value to signal after its submission and moves to the next slot.
+uint64_t rhi_frame_advance(rhi_frame_ring &ring);
+
+// True once `completed`, the fence's completed value, covers every frame submitted so far.
+bool rhi_frame_is_idle(const rhi_frame_ring &ring, uint64_t completed);
+} // namespace ash
@@ -5,14 +5,15 @@
 
 using namespace winrt;
 
-void ash::rhi_pl_init()
+namespace
 {
-    SCOPED_CPU_EVENT(L"ash::rhi_pl_init");
-    rhi_g_device->CreateRootSignature(0, rhi_sh_g_triangle_vs.root_blob->GetBufferPointer(),
-                                      rhi_sh_g_triangle_vs.root_blob->GetBufferSize(),
-                                      IID_PPV_ARGS(rhi_pl_g_triangle.root_signature.put()));
+void init_instanced(ash::rhi_pl_pipeline_state &pipeline, const ash::rhi_sh_shader &vs, const ash::rhi_sh_shader &ps,
+                    const wchar_t *root_name, const wchar_t *pso_name)
+{
+    ash::rhi_g_device->CreateRootSignature(0, vs.root_blob->GetBufferPointer(), vs.root_blob->GetBufferSize(),
+                                           IID_PPV_ARGS(pipeline.root_signature.put()));
 
-    SET_OBJECT_NAME(rhi_pl_g_triangle.root_signature.get(), L"Triangle Root");
+    SET_OBJECT_NAME(pipeline.root_signature.get(), root_name);
 
     D3D12_RASTERIZER_DESC raster_desc = {};
     raster_desc.FillMode = D3D12_FILL_MODE_SOLID;
@@ -37,9 +38,9 @@ void ash::rhi_pl_init()
     blend_desc.RenderTarget[0] = defaultBlend;
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-    psoDesc.pRootSignature = rhi_pl_g_triangle.root_signature.get();
-    psoDesc.VS = {rhi_sh_g_triangle_vs.blob->GetBufferPointer(), rhi_sh_g_triangle_vs.blob->GetBufferSize()};
-    psoDesc.PS = {rhi_sh_g_triangle_ps.blob->GetBufferPointer(), rhi_sh_g_triangle_ps.blob->GetBufferSize()};
+    psoDesc.pRootSignature = pipeline.root_signature.get();
+    psoDesc.VS = {vs.blob->GetBufferPointer(), vs.blob->GetBufferSize()};
+    psoDesc.PS = {ps.blob->GetBufferPointer(), ps.blob->GetBufferSize()};
 
     D3D12_DEPTH_STENCIL_DESC ds = {};
     ds.DepthEnable = TRUE;
@@ -56,21 +57,26 @@ void ash::rhi_pl_init()
     psoDesc.DepthStencilState = ds;
     psoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 
-    rhi_g_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(rhi_pl_g_triangle.pso.put()));
-    SET_OBJECT_NAME(rhi_pl_g_triangle.pso.get(), L"Triangle PSO");
+    ash::rhi_g_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(pipeline.pso.put()));
+    SET_OBJECT_NAME(pipeline.pso.get(), pso_name);
+}
+} // namespace
 
-    rhi_g_device->CreateRootSignature(0, rhi_sh_g_triangle_instanced_vs.root_blob->GetBufferPointer(),
-                                      rhi_sh_g_triangle_instanced_vs.root_blob->GetBufferSize(),
-                                      IID_PPV_ARGS(rhi_pl_g_triangle_instanced.root_signature.put()));
+void ash::rhi_pl_init()
+{
+    SCOPED_CPU_EVENT(L"ash::rhi_pl_init");
+    rhi_g_device->CreateRootSignature(0, rhi_sh_g_triangle_vs.root_blob->GetBufferPointer(),
+                                      rhi_sh_g_triangle_vs.root_blob->GetBufferSize(),
+                                      IID_PPV_ARGS(rhi_pl_g_triangle.root_signature.put()));
 
-    SET_OBJECT_NAME(rhi_pl_g_triangle_instanced.root_signature.get(), L"Triangle Instanced Root");
+    SET_OBJECT_NAME(rhi_pl_g_triangle.root_signature.get(), L"Triangle Root");
 
-    raster_desc = {};
+    D3D12_RASTERIZER_DESC raster_desc = {};
     raster_desc.FillMode = D3D12_FILL_MODE_SOLID;
     raster_desc.CullMode = D3D12_CULL_MODE_NONE;
     raster_desc.FrontCounterClockwise = false;
 
-    defaultBlend = {};
+    D3D12_RENDER_TARGET_BLEND_DESC defaultBlend = {};
     defaultBlend.BlendEnable = FALSE;
     defaultBlend.LogicOpEnable = FALSE;
     defaultBlend.SrcBlend = D3D12_BLEND_ONE;
@@ -82,19 +88,17 @@ void ash::rhi_pl_init()
     defaultBlend.LogicOp = D3D12_LOGIC_OP_NOOP;
     defaultBlend.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
 
-    blend_desc = {};
+    D3D12_BLEND_DESC blend_desc = {};
     blend_desc.AlphaToCoverageEnable = FALSE;
     blend_desc.IndependentBlendEnable = FALSE;
     blend_desc.RenderTarget[0] = defaultBlend;
 
-    psoDesc = {};
-    psoDesc.pRootSignature = rhi_pl_g_triangle_instanced.root_signature.get();
-    psoDesc.VS = {rhi_sh_g_triangle_instanced_vs.blob->GetBufferPointer(),
-                  rhi_sh_g_triangle_instanced_vs.blob->GetBufferSize()};
-    psoDesc.PS = {rhi_sh_g_triangle_instanced_ps.blob->GetBufferPointer(),
-                  rhi_sh_g_triangle_instanced_ps.blob->GetBufferSize()};
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+    psoDesc.pRootSignature = rhi_pl_g_triangle.root_signature.get();
+    psoDesc.VS = {rhi_sh_g_triangle_vs.blob->GetBufferPointer(), rhi_sh_g_triangle_vs.blob->GetBufferSize()};
+    psoDesc.PS = {rhi_sh_g_triangle_ps.blob->GetBufferPointer(), rhi_sh_g_triangle_ps.blob->GetBufferSize()};
 
-    ds = {};
+    D3D12_DEPTH_STENCIL_DESC ds = {};
     ds.DepthEnable = TRUE;
     ds.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
     ds.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
@@ -109,6 +113,13 @@ void ash::rhi_pl_init()
     psoDesc.DepthStencilState = ds;
     psoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 
-    rhi_g_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(rhi_pl_g_triangle_instanced.pso.put()));
-    SET_OBJECT_NAME(rhi_pl_g_triangle_instanced.pso.get(), L"Triangle Instanced PSO");
+    rhi_g_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(rhi_pl_g_triangle.pso.put()));
+    SET_OBJECT_NAME(rhi_pl_g_triangle.pso.get(), L"Triangle PSO");
+
+    init_instanced(rhi_pl_g_triangle_instanced, rhi_sh_g_triangle_instanced_vs, rhi_sh_g_triangle_instanced_ps,
+                   L"Triangle Instanced Root", L"Triangle Instanced PSO");
+    init_instanced(rhi_pl_g_triangle_instanced_affine, rhi_sh_g_triangle_instanced_affine_vs,
+                   rhi_sh_g_triangle_instanced_ps, L"Triangle Instanced Affine Root", L"Triangle Instanced Affine PSO");
+    init_instanced(rhi_pl_g_triangle_instanced_trs, rhi_sh_g_triangle_instanced_trs_vs, rhi_sh_g_triangle_instanced_ps,
+                   L"Triangle Instanced TRS Root", L"Triangle Instanced TRS PSO");
 }
@@ -12,6 +12,8 @@ struct rhi_pl_pipeline_state
 };
 inline rhi_pl_pipeline_state rhi_pl_g_triangle;
 inline rhi_pl_pipeline_state rhi_pl_g_triangle_instanced;
+inline rhi_pl_pipeline_state rhi_pl_g_triangle_instanced_affine;
+inline rhi_pl_pipeline_state rhi_pl_g_triangle_instanced_trs;
 } // namespace ash
 
 namespace ash
@@ -5,7 +5,8 @@ using namespace winrt;
 
 namespace
 {
-void init_shader(ash::rhi_sh_shader &shader, const wchar_t *file, const wchar_t *entryPoint, const wchar_t *target)
+void init_shader(ash::rhi_sh_shader &shader, const wchar_t *file, const wchar_t *entryPoint, const wchar_t *target,
+                 const DxcDefine *defines = nullptr, uint32_t define_count = 0)
 {
     com_ptr<IDxcBlobUtf8> error_blob;
     com_ptr<IDxcResult> result;
@@ -13,7 +14,7 @@ void init_shader(ash::rhi_sh_shader &shader, const wchar_t *file, const wchar_t
     com_ptr<ID3D12ShaderReflection> reflector;
     com_ptr<IDxcBlob> reflection_blob;
 
-    ash::rhi_sc_compile(file, entryPoint, target, result.put(), error_blob.put());
+    ash::rhi_sc_compile(file, entryPoint, target, result.put(), error_blob.put(), defines, define_count);
 
     result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(shader.blob.put()), nullptr);
     result->GetOutput(DXC_OUT_ROOT_SIGNATURE, IID_PPV_ARGS(shader.root_blob.put()), nullptr);
@@ -38,5 +39,15 @@ void ash::rhi_sh_init()
     init_shader(rhi_sh_g_triangle_ps, L"triangle.hlsl", L"ps_main", L"ps_6_6");
 
     init_shader(rhi_sh_g_triangle_instanced_vs, L"triangle_instanced.hlsl", L"vs_main", L"vs_6_6");
+
+    // INSTANCE_FORMAT values are listed in instance.hlsli.
+    const DxcDefine affine_defines[] = {{L"INSTANCE_FORMAT", L"1"}};
+    init_shader(rhi_sh_g_triangle_instanced_affine_vs, L"triangle_instanced.hlsl", L"vs_main", L"vs_6_6",
+                affine_defines, _countof(affine_defines));
+
+    const DxcDefine trs_defines[] = {{L"INSTANCE_FORMAT", L"2"}};
+    init_shader(rhi_sh_g_triangle_instanced_trs_vs, L"triangle_instanced.hlsl", L"vs_main", L"vs_6_6", trs_defines,
+                _countof(trs_defines));
+
     init_shader(rhi_sh_g_triangle_instanced_ps, L"triangle_instanced.hlsl", L"ps_main", L"ps_6_6");
 }
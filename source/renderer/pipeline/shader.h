@@ -25,6 +25,8 @@ inline rhi_sh_shader rhi_sh_g_triangle_vs;
 inline rhi_sh_shader rhi_sh_g_triangle_ps;
 
 inline rhi_sh_shader rhi_sh_g_triangle_instanced_vs;
+inline rhi_sh_shader rhi_sh_g_triangle_instanced_affine_vs;
+inline rhi_sh_shader rhi_sh_g_triangle_instanced_trs_vs;
 inline rhi_sh_shader rhi_sh_g_triangle_instanced_ps;
 } // namespace ash
 
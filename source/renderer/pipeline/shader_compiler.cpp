@@ -72,7 +72,7 @@ void ash::rhi_sc_init()
 }
 
 HRESULT ash::rhi_sc_compile(const wchar_t *file, const wchar_t *entryPoint, const wchar_t *target, IDxcResult **result,
-                            IDxcBlobUtf8 **error_blob)
+                            IDxcBlobUtf8 **error_blob, const DxcDefine *defines, uint32_t define_count)
 {
     ed_console_log(ed_console_log_level::info, "[Shader] Compile begin.");
     std::wstring full_path = std::wstring(cfg_SHADER_PATH) + file;
@@ -81,20 +81,24 @@ HRESULT ash::rhi_sc_compile(const wchar_t *file, const wchar_t *entryPoint, cons
     com_ptr<IDxcBlobEncoding> source_blob;
     rhi_sc_g_utils->CreateBlobFromPinned(source_data.data(), (UINT32)source_data.size(), CP_UTF8, source_blob.put());
 
-    const wchar_t *args[] = {L"-Zi", L"-Qembed_debug", L"-Od", L"-Qstrip_reflect", L"-Zpr"};
+    const wchar_t *args[] = {L"-Zi", L"-Qembed_debug", L"-Od", L"-Qstrip_reflect", L"-Zpr", L"-I", cfg_SHADER_PATH};
 
     com_ptr<IDxcCompilerArgs> args_obj;
 
-    HRESULT hr = rhi_sc_g_utils->BuildArguments(file, entryPoint, target, args, 5, nullptr, 0, args_obj.put());
+    HRESULT hr = rhi_sc_g_utils->BuildArguments(file, entryPoint, target, args, _countof(args), defines, define_count,
+                                                args_obj.put());
 
     assert(SUCCEEDED(hr));
 
+    com_ptr<IDxcIncludeHandler> include_handler;
+    rhi_sc_g_utils->CreateDefaultIncludeHandler(include_handler.put());
+
     DxcBuffer source_buffer = {};
     source_buffer.Ptr = source_blob->GetBufferPointer();
     source_buffer.Size = source_blob->GetBufferSize();
     source_buffer.Encoding = DXC_CP_UTF8;
 
-    rhi_sc_g_compiler->Compile(&source_buffer, args_obj->GetArguments(), args_obj->GetCount(), nullptr,
+    rhi_sc_g_compiler->Compile(&source_buffer, args_obj->GetArguments(), args_obj->GetCount(), include_handler.get(),
                                IID_PPV_ARGS(result));
 
     (*result)->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(error_blob), nullptr);
@@ -15,7 +15,7 @@ namespace ash
 {
 void rhi_sc_init();
 HRESULT rhi_sc_compile(const wchar_t *file, const wchar_t *entryPoint, const wchar_t *target, IDxcResult **result,
-                       IDxcBlobUtf8 **error_blob);
+                       IDxcBlobUtf8 **error_blob, const DxcDefine *defines = nullptr, uint32_t define_count = 0);
 std::vector<D3D12_INPUT_ELEMENT_DESC> rhi_sc_get_input_layout(ID3D12ShaderReflection *reflection);
 std::vector<rhi_sh_resource_binding> rhi_sc_get_bindings(ID3D12ShaderReflection *reflection);
 } // namespace ash
@@ -4,10 +4,13 @@
 #include "editor/console.h"
 #include "editor/editor.h"
 #include "editor/viewport.h"
+#include "job/scheduler.h"
+#include "job/task.h"
 #include "pipeline/pipeline.h"
 #include "pipeline/shader.h"
 #include "pipeline/shader_compiler.h"
 #include "renderer/core/command_queue.h"
+#include "renderer/core/frame_ring.h"
 #include "renderer/core/swapchain.h"
 #include "scene/camera.h"
 #include "scene/scene.h"
@@ -18,6 +21,7 @@
 #include <filesystem>
 #include <format>
 #include <string>
+#include <vector>
 
 using namespace winrt;
 
@@ -259,6 +263,18 @@ void init_device()
     ash::ed_console_log(ash::ed_console_log_level::info, "[RHI] Device initialization complete.");
 }
 
+void wait_for_fence(uint64_t value)
+{
+    if (value == 0 || ash::rhi_sw_g_fence->GetCompletedValue() >= value)
+    {
+        return;
+    }
+
+    SCOPED_CPU_EVENT(L"ash::rhi_wait_for_fence")
+    ash::rhi_sw_g_fence->SetEventOnCompletion(value, ash::rhi_sw_g_fence_event);
+    WaitForSingleObject(ash::rhi_sw_g_fence_event, INFINITE);
+}
+
 void handle_window_events()
 {
     SCOPED_CPU_EVENT(L"ash::rhi_handle_window_events")
@@ -289,7 +305,11 @@ void handle_window_events()
     }
 
     if (resize)
+    {
+        // ResizeBuffers needs every reference to the back buffers gone, including those of frames in flight.
+        ash::rhi_flush();
         ash::rhi_sw_resize();
+    }
 }
 } // namespace
 
@@ -309,6 +329,7 @@ void ash::rhi_init()
 
     init_device();
 
+    rhi_frame_init(rhi_frame_g_ring, rhi_frame_g_count);
     rhi_cmd_init();
     rhi_sw_init();
     rhi_sc_init();
@@ -369,7 +390,13 @@ void ash::rhi_init()
 
 void ash::rhi_render()
 {
+    job_place_critical_thread();
+    // Per-frame passes fan out to the job pool; attaching lets this thread run their jobs while it waits on them.
+    job_attach_thread();
+    job_task_attach(job_affinity::render);
+
     auto last_time = std::chrono::high_resolution_clock::now();
+    std::vector<ID3D12CommandList *> command_lists;
 
     while (rhi_g_running.load(std::memory_order_relaxed))
     {
@@ -379,6 +406,11 @@ void ash::rhi_render()
         std::chrono::duration<float> delta_time = now - last_time;
         last_time = now;
 
+        // Only the frame that last used this slot has to be finished; the others stay in flight.
+        wait_for_fence(rhi_frame_get_wait_value(rhi_frame_g_ring));
+        rhi_cmd_begin_frame(rhi_frame_g_ring.index);
+
+        job_task_drain(job_affinity::render);
         handle_window_events();
 
         ed_render();
@@ -390,10 +422,11 @@ void ash::rhi_render()
         }
         win_input_release_front_buffer(ash::g_win_input);
 
-        scene_render();
+        command_lists.clear();
+        scene_render(command_lists);
 
-        ID3D12CommandList *cmdLists[] = {rhi_cmd_g_command_list.get()};
-        rhi_cmd_g_direct->ExecuteCommandLists(1, cmdLists);
+        // One submission, in the order scene_render recorded the passes, however many threads recorded them.
+        rhi_cmd_g_direct->ExecuteCommandLists(static_cast<UINT>(command_lists.size()), command_lists.data());
         HRESULT present_hr = rhi_sw_g_swapchain->Present(1, 0);
         if (FAILED(present_hr))
         {
@@ -403,18 +436,22 @@ void ash::rhi_render()
         drain_debug_messages();
 #endif
 
-        rhi_sw_g_fence_value++;
-        rhi_cmd_g_direct->Signal(rhi_sw_g_fence.get(), rhi_sw_g_fence_value);
+        rhi_cmd_g_direct->Signal(rhi_sw_g_fence.get(), rhi_frame_advance(rhi_frame_g_ring));
+    }
 
-        if (rhi_sw_g_fence->GetCompletedValue() < rhi_sw_g_fence_value)
-        {
-            rhi_sw_g_fence->SetEventOnCompletion(rhi_sw_g_fence_value, rhi_sw_g_fence_event);
-            WaitForSingleObject(rhi_sw_g_fence_event, INFINITE);
-        }
+    // Nothing may be released while the GPU still runs the frames in flight.
+    rhi_flush();
+}
+
+void ash::rhi_flush()
+{
+    SCOPED_CPU_EVENT(L"ash::rhi_flush")
 
-        rhi_cmd_g_command_allocator->Reset();
-        rhi_cmd_g_command_list->Reset(rhi_cmd_g_command_allocator.get(), nullptr);
+    if (!rhi_sw_g_fence || rhi_frame_is_idle(rhi_frame_g_ring, rhi_sw_g_fence->GetCompletedValue()))
+    {
+        return;
     }
+    wait_for_fence(rhi_frame_g_ring.last_signalled);
 }
 
 void ash::rhi_stop()
@@ -445,6 +482,15 @@ void ash::rhi_shutdown()
     rhi_pl_g_triangle.pso = nullptr;
     rhi_pl_g_triangle.root_signature = nullptr;
 
+    rhi_pl_g_triangle_instanced.pso = nullptr;
+    rhi_pl_g_triangle_instanced.root_signature = nullptr;
+
+    rhi_pl_g_triangle_instanced_affine.pso = nullptr;
+    rhi_pl_g_triangle_instanced_affine.root_signature = nullptr;
+
+    rhi_pl_g_triangle_instanced_trs.pso = nullptr;
+    rhi_pl_g_triangle_instanced_trs.root_signature = nullptr;
+
     rhi_sh_g_triangle_vs.blob = nullptr;
     rhi_sh_g_triangle_vs.root_blob = nullptr;
     rhi_sh_g_triangle_vs.input_layout.clear();
@@ -455,8 +501,27 @@ void ash::rhi_shutdown()
     rhi_sh_g_triangle_ps.input_layout.clear();
     rhi_sh_g_triangle_ps.bindings.clear();
 
-    rhi_cmd_g_command_list = nullptr;
-    rhi_cmd_g_command_allocator = nullptr;
+    rhi_sh_g_triangle_instanced_vs.blob = nullptr;
+    rhi_sh_g_triangle_instanced_vs.root_blob = nullptr;
+    rhi_sh_g_triangle_instanced_vs.input_layout.clear();
+    rhi_sh_g_triangle_instanced_vs.bindings.clear();
+
+    rhi_sh_g_triangle_instanced_affine_vs.blob = nullptr;
+    rhi_sh_g_triangle_instanced_affine_vs.root_blob = nullptr;
+    rhi_sh_g_triangle_instanced_affine_vs.input_layout.clear();
+    rhi_sh_g_triangle_instanced_affine_vs.bindings.clear();
+
+    rhi_sh_g_triangle_instanced_trs_vs.blob = nullptr;
+    rhi_sh_g_triangle_instanced_trs_vs.root_blob = nullptr;
+    rhi_sh_g_triangle_instanced_trs_vs.input_layout.clear();
+    rhi_sh_g_triangle_instanced_trs_vs.bindings.clear();
+
+    rhi_sh_g_triangle_instanced_ps.blob = nullptr;
+    rhi_sh_g_triangle_instanced_ps.root_blob = nullptr;
+    rhi_sh_g_triangle_instanced_ps.input_layout.clear();
+    rhi_sh_g_triangle_instanced_ps.bindings.clear();
+
+    rhi_cmd_shutdown();
     rhi_cmd_g_copy = nullptr;
     rhi_cmd_g_compute = nullptr;
     rhi_cmd_g_direct = nullptr;
@@ -495,6 +560,8 @@ void ash::rhi_resize(D3D12_VIEWPORT viewport)
     SCOPED_CPU_EVENT(L"ash::rhi_resize")
     ed_console_log(ed_console_log_level::info, "[RHI] Viewport resource resize.");
 
+    // The texture and its descriptor are replaced in place, so no frame in flight may still sample them.
+    rhi_flush();
     rhi_g_viewport = viewport;
 
     D3D12_RESOURCE_DESC tex_desc = {};
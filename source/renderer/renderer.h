@@ -34,6 +34,8 @@ void rhi_init();
 void rhi_render();
 void rhi_start();
 void rhi_stop();
+// Blocks until the GPU has finished every submitted frame.
+void rhi_flush();
 void rhi_shutdown();
 void rhi_resize(D3D12_VIEWPORT viewport);
 } // namespace ash
@@ -0,0 +1,814 @@
+#include "bvh.h"
+#include "scene/scene.h"
+#include "scene/transform.h"
+#include <algorithm>
+#include <cfloat>
+#include <common.h>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_leaf_size = 4;
+constexpr uint32_t g_max_leaf_size = 8;
+constexpr uint32_t g_bin_count = 12;
+constexpr float g_degraded_area_ratio = 2.0f;
+constexpr uint32_t g_rebuild_item_budget = 64 * 1024;
+constexpr uint32_t g_min_overflow_before_rebuild = 64;
+
+std::vector<flecs::entity> g_observers;
+
+struct build_task
+{
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+};
+
+struct aabb
+{
+    XMFLOAT3 min = {FLT_MAX, FLT_MAX, FLT_MAX};
+    XMFLOAT3 max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+};
+
+void grow(aabb &box, const XMFLOAT3 &min, const XMFLOAT3 &max)
+{
+    box.min = {std::min(box.min.x, min.x), std::min(box.min.y, min.y), std::min(box.min.z, min.z)};
+    box.max = {std::max(box.max.x, max.x), std::max(box.max.y, max.y), std::max(box.max.z, max.z)};
+}
+
+float surface_area(const XMFLOAT3 &min, const XMFLOAT3 &max)
+{
+    if (max.x < min.x || max.y < min.y || max.z < min.z)
+    {
+        return 0.0f;
+    }
+
+    const float dx = max.x - min.x;
+    const float dy = max.y - min.y;
+    const float dz = max.z - min.z;
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+float get_axis(const XMFLOAT3 &v, uint32_t axis)
+{
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+float centroid(const ash::scene_bvh_item &item, uint32_t axis)
+{
+    return 0.5f * (get_axis(item.min, axis) + get_axis(item.max, axis));
+}
+
+bool is_live(const ash::scene_bvh_item &item)
+{
+    return item.entity != 0;
+}
+
+void make_leaf(ash::scene_bvh &bvh, uint32_t node_index, uint32_t first, uint32_t count)
+{
+    ash::scene_bvh_node &node = bvh.nodes[node_index];
+    node.first = first;
+    node.count = count;
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        bvh.items[bvh.item_refs[i]].node = node_index;
+    }
+}
+
+// Binned SAH build over item_refs[first, first + count) into the existing node `root`, which keeps its parent link.
+// Children are always appended after their parent, so reverse index order visits children first.
+void build_subtree(ash::scene_bvh &bvh, uint32_t root, uint32_t first, uint32_t count)
+{
+    std::vector<build_task> stack;
+    stack.push_back({root, first, count});
+
+    while (!stack.empty())
+    {
+        const build_task task = stack.back();
+        stack.pop_back();
+
+        aabb bounds;
+        aabb centroid_bounds;
+        for (uint32_t i = task.first; i < task.first + task.count; ++i)
+        {
+            const ash::scene_bvh_item &item = bvh.items[bvh.item_refs[i]];
+            if (!is_live(item))
+            {
+                continue;
+            }
+
+            grow(bounds, item.min, item.max);
+            const XMFLOAT3 c = {centroid(item, 0), centroid(item, 1), centroid(item, 2)};
+            grow(centroid_bounds, c, c);
+        }
+
+        ash::scene_bvh_node &node = bvh.nodes[task.node];
+        node.min = bounds.min;
+        node.max = bounds.max;
+        node.range_first = task.first;
+        node.range_count = task.count;
+        node.built_area = surface_area(bounds.min, bounds.max);
+
+        if (task.count <= g_leaf_size)
+        {
+            make_leaf(bvh, task.node, task.first, task.count);
+            continue;
+        }
+
+        const XMFLOAT3 extent = {centroid_bounds.max.x - centroid_bounds.min.x,
+                                 centroid_bounds.max.y - centroid_bounds.min.y,
+                                 centroid_bounds.max.z - centroid_bounds.min.z};
+        const uint32_t axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+        const float axis_min = get_axis(centroid_bounds.min, axis);
+        const float axis_extent = get_axis(extent, axis);
+
+        uint32_t mid = task.first + task.count / 2;
+        if (axis_extent > 1e-6f)
+        {
+            const float bin_scale = g_bin_count / axis_extent;
+            auto bin_of = [&](uint32_t ref) {
+                const ash::scene_bvh_item &item = bvh.items[ref];
+                if (!is_live(item))
+                {
+                    return 0u;
+                }
+                const uint32_t bin = static_cast<uint32_t>((centroid(item, axis) - axis_min) * bin_scale);
+                return std::min(bin, g_bin_count - 1);
+            };
+
+            aabb bin_bounds[g_bin_count];
+            uint32_t bin_counts[g_bin_count] = {};
+            for (uint32_t i = task.first; i < task.first + task.count; ++i)
+            {
+                const uint32_t ref = bvh.item_refs[i];
+                const uint32_t bin = bin_of(ref);
+                bin_counts[bin]++;
+                if (is_live(bvh.items[ref]))
+                {
+                    grow(bin_bounds[bin], bvh.items[ref].min, bvh.items[ref].max);
+                }
+            }
+
+            float right_area[g_bin_count] = {};
+            uint32_t right_count[g_bin_count] = {};
+            aabb accumulated;
+            uint32_t accumulated_count = 0;
+            for (uint32_t b = g_bin_count - 1; b > 0; --b)
+            {
+                grow(accumulated, bin_bounds[b].min, bin_bounds[b].max);
+                accumulated_count += bin_counts[b];
+                right_area[b] = surface_area(accumulated.min, accumulated.max);
+                right_count[b] = accumulated_count;
+            }
+
+            float best_cost = FLT_MAX;
+            uint32_t best_split = 0;
+            accumulated = {};
+            accumulated_count = 0;
+            for (uint32_t b = 0; b < g_bin_count - 1; ++b)
+            {
+                grow(accumulated, bin_bounds[b].min, bin_bounds[b].max);
+                accumulated_count += bin_counts[b];
+                const float cost = surface_area(accumulated.min, accumulated.max) * accumulated_count +
+                                   right_area[b + 1] * right_count[b + 1];
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_split = b;
+                }
+            }
+
+            const float leaf_cost = node.built_area * task.count;
+            if (best_cost >= leaf_cost && task.count <= g_max_leaf_size)
+            {
+                make_leaf(bvh, task.node, task.first, task.count);
+                continue;
+            }
+
+            uint32_t *begin = bvh.item_refs.data() + task.first;
+            uint32_t *split = std::partition(begin, begin + task.count,
+                                             [&](uint32_t ref) { return bin_of(ref) <= best_split; });
+            mid = static_cast<uint32_t>(split - bvh.item_refs.data());
+            if (mid == task.first || mid == task.first + task.count)
+            {
+                mid = task.first + task.count / 2;
+            }
+        }
+
+        const uint32_t left = static_cast<uint32_t>(bvh.nodes.size());
+        bvh.nodes.push_back({});
+        bvh.nodes.push_back({});
+        bvh.nodes[task.node].first = left;
+        bvh.nodes[task.node].count = 0;
+        bvh.nodes[left].parent = task.node;
+        bvh.nodes[left + 1].parent = task.node;
+
+        stack.push_back({left, task.first, mid - task.first});
+        stack.push_back({left + 1, mid, task.first + task.count - mid});
+    }
+}
+
+// Rebuilds the subtree at `root` over the slots [first, first + slot_count). The items in them are packed to the
+// front and built with build_subtree, then every leaf is moved to its own run of slots and the free slots are shared
+// out evenly between leaves, so later insertions find room without touching the rest of item_refs.
+void build_with_slack(ash::scene_bvh &bvh, uint32_t root, uint32_t first, uint32_t slot_count)
+{
+    uint32_t *slots = bvh.item_refs.data() + first;
+    const uint32_t *packed_end = std::remove(slots, slots + slot_count, ash::scene_bvh_invalid);
+    const uint32_t count = static_cast<uint32_t>(packed_end - slots);
+    build_subtree(bvh, root, first, count);
+
+    thread_local std::vector<uint32_t> order;
+    thread_local std::vector<uint32_t> stack;
+    thread_local std::vector<uint32_t> refs;
+    order.clear();
+    stack.assign(1, root);
+    uint32_t leaf_count = 0;
+    while (!stack.empty())
+    {
+        const uint32_t node_index = stack.back();
+        stack.pop_back();
+        order.push_back(node_index);
+        const ash::scene_bvh_node &node = bvh.nodes[node_index];
+        if (node.count > 0)
+        {
+            leaf_count++;
+            continue;
+        }
+        stack.push_back(node.first + 1);
+        stack.push_back(node.first);
+    }
+
+    // Pre-order with left children first visits leaves in slot order; reverse order then visits children first.
+    refs.assign(slots, slots + count);
+    const uint32_t spare = slot_count - count;
+    uint32_t slot = first;
+    uint32_t leaf_index = 0;
+    for (uint32_t node_index : order)
+    {
+        ash::scene_bvh_node &node = bvh.nodes[node_index];
+        if (node.count == 0)
+        {
+            continue;
+        }
+
+        const uint32_t capacity = node.count + spare / leaf_count + (leaf_index++ < spare % leaf_count ? 1 : 0);
+        std::copy_n(refs.data() + (node.first - first), node.count, bvh.item_refs.data() + slot);
+        std::fill_n(bvh.item_refs.data() + slot + node.count, capacity - node.count, ash::scene_bvh_invalid);
+        node.first = slot;
+        node.range_first = slot;
+        node.range_count = capacity;
+        slot += capacity;
+    }
+
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        ash::scene_bvh_node &node = bvh.nodes[*it];
+        if (node.count == 0)
+        {
+            const ash::scene_bvh_node &right = bvh.nodes[node.first + 1];
+            node.range_first = bvh.nodes[node.first].range_first;
+            node.range_count = right.range_first + right.range_count - node.range_first;
+        }
+    }
+}
+
+void remove_from_overflow(ash::scene_bvh &bvh, uint32_t slot)
+{
+    const uint32_t last = bvh.overflow.back();
+    bvh.overflow[slot] = last;
+    bvh.items[last].overflow_slot = slot;
+    bvh.overflow.pop_back();
+}
+
+// Descends from the root towards the child whose bounds grow least, and moves each overflow item into the leaf it
+// reaches when that leaf has a free slot. The next refit grows the leaf and its ancestors.
+void insert_overflow(ash::scene_bvh &bvh)
+{
+    if (bvh.nodes.empty())
+    {
+        return;
+    }
+
+    for (uint32_t o = 0; o < bvh.overflow.size();)
+    {
+        const uint32_t index = bvh.overflow[o];
+        ash::scene_bvh_item &item = bvh.items[index];
+        uint32_t node_index = 0;
+        while (bvh.nodes[node_index].count == 0)
+        {
+            const uint32_t left = bvh.nodes[node_index].first;
+            float growth[2];
+            for (uint32_t c = 0; c < 2; ++c)
+            {
+                const ash::scene_bvh_node &child = bvh.nodes[left + c];
+                aabb box = {child.min, child.max};
+                grow(box, item.min, item.max);
+                growth[c] = surface_area(box.min, box.max) - surface_area(child.min, child.max);
+            }
+            node_index = growth[1] < growth[0] ? left + 1 : left;
+        }
+
+        ash::scene_bvh_node &leaf = bvh.nodes[node_index];
+        if (leaf.count == leaf.range_count)
+        {
+            ++o;
+            continue;
+        }
+
+        bvh.item_refs[leaf.first + leaf.count++] = index;
+        item.node = node_index;
+        bvh.changed_leaves.push_back(node_index);
+        remove_from_overflow(bvh, o);
+    }
+}
+
+bool is_garbage(const ash::scene_bvh_node &node)
+{
+    return node.range_count == ash::scene_bvh_invalid;
+}
+
+uint32_t release_descendants(ash::scene_bvh &bvh, uint32_t root)
+{
+    uint32_t released = 0;
+    std::vector<uint32_t> stack;
+    if (bvh.nodes[root].count == 0)
+    {
+        stack.push_back(bvh.nodes[root].first);
+        stack.push_back(bvh.nodes[root].first + 1);
+    }
+
+    while (!stack.empty())
+    {
+        ash::scene_bvh_node &node = bvh.nodes[stack.back()];
+        stack.pop_back();
+        if (node.count == 0)
+        {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+        }
+        node.range_count = ash::scene_bvh_invalid;
+        released++;
+    }
+
+    return released;
+}
+
+bool refit_node(ash::scene_bvh &bvh, uint32_t node_index)
+{
+    ash::scene_bvh_node &node = bvh.nodes[node_index];
+    aabb bounds;
+    if (node.count > 0)
+    {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            const ash::scene_bvh_item &item = bvh.items[bvh.item_refs[i]];
+            if (is_live(item))
+            {
+                grow(bounds, item.min, item.max);
+            }
+        }
+    }
+    else
+    {
+        grow(bounds, bvh.nodes[node.first].min, bvh.nodes[node.first].max);
+        grow(bounds, bvh.nodes[node.first + 1].min, bvh.nodes[node.first + 1].max);
+    }
+
+    const bool changed = memcmp(&bounds.min, &node.min, sizeof(XMFLOAT3)) != 0 ||
+                         memcmp(&bounds.max, &node.max, sizeof(XMFLOAT3)) != 0;
+    node.min = bounds.min;
+    node.max = bounds.max;
+    return changed;
+}
+
+void refit(ash::scene_bvh &bvh, std::vector<uint32_t> &degraded)
+{
+    for (uint32_t leaf : bvh.changed_leaves)
+    {
+        for (uint32_t node_index = leaf; node_index != ash::scene_bvh_invalid;
+             node_index = bvh.nodes[node_index].parent)
+        {
+            if (!refit_node(bvh, node_index))
+            {
+                break;
+            }
+
+            const ash::scene_bvh_node &node = bvh.nodes[node_index];
+            if (node.count == 0 && surface_area(node.min, node.max) > node.built_area * g_degraded_area_ratio)
+            {
+                degraded.push_back(node_index);
+            }
+        }
+    }
+
+    bvh.changed_leaves.clear();
+}
+
+void rebuild_degraded(ash::scene_bvh &bvh, std::vector<uint32_t> &degraded)
+{
+    std::sort(degraded.begin(), degraded.end());
+    degraded.erase(std::unique(degraded.begin(), degraded.end()), degraded.end());
+
+    uint32_t budget = g_rebuild_item_budget;
+    for (uint32_t node_index : degraded)
+    {
+        const ash::scene_bvh_node &node = bvh.nodes[node_index];
+        if (is_garbage(node) || node.count > 0 || node.range_count > budget)
+        {
+            continue;
+        }
+
+        const uint32_t first = node.range_first;
+        const uint32_t slot_count = node.range_count;
+        budget -= slot_count;
+        bvh.garbage_nodes += release_descendants(bvh, node_index);
+        build_with_slack(bvh, node_index, first, slot_count);
+    }
+}
+
+void get_world_aabb(const ash::bounds &local_bounds, const XMFLOAT4X4 &world, XMFLOAT3 &min, XMFLOAT3 &max)
+{
+    const XMMATRIX m = XMLoadFloat4x4(&world);
+    const XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&local_bounds.center), m);
+    const XMVECTOR extents = XMLoadFloat3(&local_bounds.extents);
+
+    // Row-vector convention: world extent j = sum_i |m[i][j]| * extent[i].
+    XMVECTOR world_extents = XMVectorMultiply(XMVectorAbs(m.r[0]), XMVectorSplatX(extents));
+    world_extents = XMVectorMultiplyAdd(XMVectorAbs(m.r[1]), XMVectorSplatY(extents), world_extents);
+    world_extents = XMVectorMultiplyAdd(XMVectorAbs(m.r[2]), XMVectorSplatZ(extents), world_extents);
+
+    XMStoreFloat3(&min, XMVectorSubtract(center, world_extents));
+    XMStoreFloat3(&max, XMVectorAdd(center, world_extents));
+}
+
+enum class frustum_test : uint8_t
+{
+    outside,
+    partial,
+    inside
+};
+
+frustum_test classify(const ash::scene_cull_frustum &frustum, const XMFLOAT3 &min, const XMFLOAT3 &max)
+{
+    const XMFLOAT3 c = {0.5f * (min.x + max.x), 0.5f * (min.y + max.y), 0.5f * (min.z + max.z)};
+    const XMFLOAT3 e = {0.5f * (max.x - min.x), 0.5f * (max.y - min.y), 0.5f * (max.z - min.z)};
+
+    frustum_test result = frustum_test::inside;
+    for (const XMFLOAT4 &plane : frustum.planes)
+    {
+        const float distance = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+        const float radius = std::abs(plane.x) * e.x + std::abs(plane.y) * e.y + std::abs(plane.z) * e.z;
+        if (distance + radius < 0.0f)
+        {
+            return frustum_test::outside;
+        }
+        if (distance - radius < 0.0f)
+        {
+            result = frustum_test::partial;
+        }
+    }
+
+    return result;
+}
+
+bool overlaps(const XMFLOAT3 &a_min, const XMFLOAT3 &a_max, const XMFLOAT3 &b_min, const XMFLOAT3 &b_max)
+{
+    return a_min.x <= b_max.x && a_max.x >= b_min.x && a_min.y <= b_max.y && a_max.y >= b_min.y &&
+           a_min.z <= b_max.z && a_max.z >= b_min.z;
+}
+
+bool overlaps_sphere(const XMFLOAT3 &min, const XMFLOAT3 &max, const XMFLOAT4 &sphere)
+{
+    const float dx = std::max({min.x - sphere.x, 0.0f, sphere.x - max.x});
+    const float dy = std::max({min.y - sphere.y, 0.0f, sphere.y - max.y});
+    const float dz = std::max({min.z - sphere.z, 0.0f, sphere.z - max.z});
+    return dx * dx + dy * dy + dz * dz <= sphere.w * sphere.w;
+}
+
+bool intersect_ray(const XMFLOAT3 &min, const XMFLOAT3 &max, const XMFLOAT3 &origin, const XMFLOAT3 &inv_direction,
+                   float max_distance, float &entry)
+{
+    const float tx1 = (min.x - origin.x) * inv_direction.x, tx2 = (max.x - origin.x) * inv_direction.x;
+    const float ty1 = (min.y - origin.y) * inv_direction.y, ty2 = (max.y - origin.y) * inv_direction.y;
+    const float tz1 = (min.z - origin.z) * inv_direction.z, tz2 = (max.z - origin.z) * inv_direction.z;
+
+    const float t_near = std::max({std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f});
+    const float t_far = std::min({std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), max_distance});
+    entry = t_near;
+    return t_near <= t_far;
+}
+
+// Visits every live item whose bounds pass `item_test`, descending only into nodes that pass `node_test`.
+template <typename NodeTest, typename ItemTest, typename Visit>
+void traverse(const ash::scene_bvh &bvh, NodeTest &&node_test, ItemTest &&item_test, Visit &&visit)
+{
+    if (!bvh.nodes.empty())
+    {
+        uint32_t stack[64];
+        uint32_t stack_size = 0;
+        stack[stack_size++] = 0;
+
+        while (stack_size > 0)
+        {
+            const ash::scene_bvh_node &node = bvh.nodes[stack[--stack_size]];
+            if (!node_test(node.min, node.max))
+            {
+                continue;
+            }
+
+            if (node.count == 0 && stack_size + 2 <= 64)
+            {
+                stack[stack_size++] = node.first;
+                stack[stack_size++] = node.first + 1;
+                continue;
+            }
+
+            const uint32_t first = node.count == 0 ? node.range_first : node.first;
+            const uint32_t count = node.count == 0 ? node.range_count : node.count;
+            for (uint32_t i = first; i < first + count; ++i)
+            {
+                if (bvh.item_refs[i] == ash::scene_bvh_invalid)
+                {
+                    continue;
+                }
+                const ash::scene_bvh_item &item = bvh.items[bvh.item_refs[i]];
+                if (is_live(item) && item_test(item))
+                {
+                    visit(item);
+                }
+            }
+        }
+    }
+
+    for (uint32_t index : bvh.overflow)
+    {
+        const ash::scene_bvh_item &item = bvh.items[index];
+        if (is_live(item) && item_test(item))
+        {
+            visit(item);
+        }
+    }
+}
+} // namespace
+
+void ash::scene_bvh_init()
+{
+    g_observers.push_back(
+        scene_g_world.observer<const bounds>()
+            .event(flecs::OnRemove)
+            .each([](flecs::entity entity, const bounds &) { scene_bvh_remove(scene_bvh_g_tree, entity.id()); }));
+}
+
+void ash::scene_bvh_shutdown()
+{
+    for (flecs::entity observer : g_observers)
+    {
+        observer.destruct();
+    }
+
+    g_observers.clear();
+    scene_bvh_g_tree = {};
+}
+
+void ash::scene_bvh_set_bounds(scene_bvh &bvh, flecs::entity_t entity, const XMFLOAT3 &min, const XMFLOAT3 &max,
+                               const XMFLOAT4 &sphere)
+{
+    if (auto it = bvh.lookup.find(entity); it != bvh.lookup.end())
+    {
+        scene_bvh_item &item = bvh.items[it->second];
+        item.min = min;
+        item.max = max;
+        item.sphere = sphere;
+        if (item.node != scene_bvh_invalid)
+        {
+            bvh.changed_leaves.push_back(item.node);
+        }
+        return;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(bvh.items.size());
+    bvh.items.push_back({entity, scene_bvh_invalid, min, max, sphere, static_cast<uint32_t>(bvh.overflow.size())});
+    bvh.lookup.emplace(entity, index);
+    bvh.overflow.push_back(index);
+}
+
+void ash::scene_bvh_remove(scene_bvh &bvh, flecs::entity_t entity)
+{
+    auto it = bvh.lookup.find(entity);
+    if (it == bvh.lookup.end())
+    {
+        return;
+    }
+
+    scene_bvh_item &item = bvh.items[it->second];
+    item.entity = 0;
+    if (item.node == scene_bvh_invalid)
+    {
+        remove_from_overflow(bvh, item.overflow_slot);
+    }
+    else
+    {
+        bvh.changed_leaves.push_back(item.node);
+    }
+
+    bvh.dead_items++;
+    bvh.lookup.erase(it);
+}
+
+void ash::scene_bvh_rebuild(scene_bvh &bvh)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_bvh_rebuild")
+
+    std::vector<scene_bvh_item> live_items;
+    live_items.reserve(bvh.items.size() - bvh.dead_items);
+    for (const scene_bvh_item &item : bvh.items)
+    {
+        if (is_live(item))
+        {
+            live_items.push_back(item);
+        }
+    }
+
+    bvh.items = std::move(live_items);
+    bvh.lookup.clear();
+    // One free slot per item, shared out between the leaves by build_with_slack.
+    bvh.item_refs.assign(2 * bvh.items.size(), scene_bvh_invalid);
+    for (uint32_t i = 0; i < bvh.items.size(); ++i)
+    {
+        bvh.lookup.emplace(bvh.items[i].entity, i);
+        bvh.item_refs[i] = i;
+    }
+
+    bvh.nodes.clear();
+    bvh.overflow.clear();
+    bvh.changed_leaves.clear();
+    bvh.dead_items = 0;
+    bvh.garbage_nodes = 0;
+
+    if (bvh.items.empty())
+    {
+        return;
+    }
+
+    bvh.nodes.reserve(2 * bvh.items.size() / g_leaf_size + 1);
+    bvh.nodes.push_back({});
+    bvh.nodes[0].parent = scene_bvh_invalid;
+    build_with_slack(bvh, 0, 0, static_cast<uint32_t>(bvh.item_refs.size()));
+}
+
+void ash::scene_bvh_update(scene_bvh &bvh)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_bvh_update")
+
+    for (flecs::entity_t id : scene_tf_get_updated())
+    {
+        const flecs::entity entity(scene_g_world, id);
+        const bounds *entity_bounds = entity.try_get<bounds>();
+        if (!entity_bounds)
+        {
+            continue;
+        }
+
+        XMFLOAT3 min, max;
+        get_world_aabb(*entity_bounds, entity.get<world_transform>().matrix, min, max);
+        scene_bvh_set_bounds(bvh, id, min, max, entity_bounds->world_sphere);
+    }
+
+    insert_overflow(bvh);
+
+    const uint32_t item_count = static_cast<uint32_t>(bvh.items.size());
+    const bool overflowed = bvh.overflow.size() > std::max(g_min_overflow_before_rebuild, item_count / 64);
+    const bool fragmented = bvh.dead_items > item_count / 4 || bvh.garbage_nodes > bvh.nodes.size() / 2;
+    if (overflowed || (fragmented && item_count > 0))
+    {
+        scene_bvh_rebuild(bvh);
+        return;
+    }
+
+    thread_local std::vector<uint32_t> degraded;
+    degraded.clear();
+    refit(bvh, degraded);
+    rebuild_degraded(bvh, degraded);
+}
+
+void ash::scene_bvh_query_frustum(const scene_bvh &bvh, const scene_cull_frustum &frustum,
+                                  std::vector<flecs::entity_t> &out)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_bvh_query_frustum")
+
+    thread_local scene_cull_spheres candidates;
+    thread_local std::vector<flecs::entity_t> candidate_entities;
+    thread_local std::vector<uint32_t> visible;
+    scene_cull_spheres_clear(candidates);
+    candidate_entities.clear();
+
+    // Subtrees fully inside the frustum are emitted directly. Items of partially covered leaves and of the overflow
+    // list are collected and sphere-tested in one batch.
+    auto add_candidate = [&](const scene_bvh_item &item) {
+        scene_cull_spheres_push(candidates, item.sphere);
+        candidate_entities.push_back(item.entity);
+    };
+
+    if (!bvh.nodes.empty())
+    {
+        std::vector<uint32_t> stack;
+        stack.push_back(0);
+        while (!stack.empty())
+        {
+            const scene_bvh_node &node = bvh.nodes[stack.back()];
+            stack.pop_back();
+
+            const frustum_test test = classify(frustum, node.min, node.max);
+            if (test == frustum_test::outside)
+            {
+                continue;
+            }
+
+            if (test == frustum_test::inside || node.count > 0)
+            {
+                const uint32_t first = node.count == 0 ? node.range_first : node.first;
+                const uint32_t count = node.count == 0 ? node.range_count : node.count;
+                for (uint32_t i = first; i < first + count; ++i)
+                {
+                    if (bvh.item_refs[i] == scene_bvh_invalid || !is_live(bvh.items[bvh.item_refs[i]]))
+                    {
+                        continue;
+                    }
+                    const scene_bvh_item &item = bvh.items[bvh.item_refs[i]];
+
+                    if (test == frustum_test::inside)
+                    {
+                        out.push_back(item.entity);
+                    }
+                    else
+                    {
+                        add_candidate(item);
+                    }
+                }
+                continue;
+            }
+
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+        }
+    }
+
+    for (uint32_t index : bvh.overflow)
+    {
+        if (is_live(bvh.items[index]))
+        {
+            add_candidate(bvh.items[index]);
+        }
+    }
+
+    visible.resize(candidate_entities.size());
+    const uint32_t visible_count = scene_cull_frustum_spheres(frustum, candidates, visible.data());
+    for (uint32_t i = 0; i < visible_count; ++i)
+    {
+        out.push_back(candidate_entities[visible[i]]);
+    }
+}
+
+void ash::scene_bvh_query_aabb(const scene_bvh &bvh, const XMFLOAT3 &min, const XMFLOAT3 &max,
+                               std::vector<flecs::entity_t> &out)
+{
+    traverse(
+        bvh, [&](const XMFLOAT3 &node_min, const XMFLOAT3 &node_max) { return overlaps(node_min, node_max, min, max); },
+        [&](const scene_bvh_item &item) { return overlaps(item.min, item.max, min, max); },
+        [&](const scene_bvh_item &item) { out.push_back(item.entity); });
+}
+
+void ash::scene_bvh_query_sphere(const scene_bvh &bvh, const XMFLOAT4 &sphere, std::vector<flecs::entity_t> &out)
+{
+    traverse(
+        bvh,
+        [&](const XMFLOAT3 &node_min, const XMFLOAT3 &node_max) {
+            return overlaps_sphere(node_min, node_max, sphere);
+        },
+        [&](const scene_bvh_item &item) { return overlaps_sphere(item.min, item.max, sphere); },
+        [&](const scene_bvh_item &item) { out.push_back(item.entity); });
+}
+
+void ash::scene_bvh_query_ray(const scene_bvh &bvh, const XMFLOAT3 &origin, const XMFLOAT3 &direction,
+                              float max_distance, std::vector<scene_bvh_ray_hit> &out)
+{
+    const XMFLOAT3 inv_direction = {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+    const size_t first_hit = out.size();
+
+    float entry = 0.0f;
+    traverse(
+        bvh,
+        [&](const XMFLOAT3 &node_min, const XMFLOAT3 &node_max) {
+            return intersect_ray(node_min, node_max, origin, inv_direction, max_distance, entry);
+        },
+        [&](const scene_bvh_item &item) {
+            return intersect_ray(item.min, item.max, origin, inv_direction, max_distance, entry);
+        },
+        [&](const scene_bvh_item &item) { out.push_back({item.entity, entry}); });
+
+    std::sort(out.begin() + first_hit, out.end(),
+              [](const scene_bvh_ray_hit &a, const scene_bvh_ray_hit &b) { return a.distance < b.distance; });
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <flecs.h>
+#include <scene/culling.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ash
+{
+struct scene_bvh_node
+{
+    DirectX::XMFLOAT3 min;
+    uint32_t first; // leaf: first slot in item_refs, interior: left child (right child is first + 1)
+    DirectX::XMFLOAT3 max;
+    uint32_t count; // leaf: item count, interior: 0
+    uint32_t parent;
+    uint32_t range_first; // item_refs slots covered by the whole subtree; a leaf's range includes its free slots
+    uint32_t range_count;
+    float built_area; // surface area right after the subtree was (re)built
+};
+
+struct scene_bvh_item
+{
+    flecs::entity_t entity;
+    uint32_t node; // owning leaf, or scene_bvh_invalid while waiting in the overflow list
+    DirectX::XMFLOAT3 min;
+    DirectX::XMFLOAT3 max;
+    DirectX::XMFLOAT4 sphere;
+    uint32_t overflow_slot; // position in the overflow list while node is scene_bvh_invalid
+};
+
+struct scene_bvh_ray_hit
+{
+    flecs::entity_t entity;
+    float distance; // distance at which the ray enters the entity's bounds
+};
+
+// Dynamic bounding volume hierarchy over scene entities. Items are refitted in place when their bounds move. Leaves
+// are built with free item_refs slots (scene_bvh_invalid), and new items are inserted into the leaf whose bounds grow
+// least; items finding no free slot wait in a small overflow list until the next rebuild. Subtrees whose surface area
+// grew too far past their build-time area are rebuilt incrementally within a per-frame item budget.
+struct scene_bvh
+{
+    std::vector<scene_bvh_node> nodes;
+    std::vector<scene_bvh_item> items;
+    std::vector<uint32_t> item_refs;
+    std::vector<uint32_t> overflow;
+    std::vector<uint32_t> changed_leaves;
+    std::unordered_map<flecs::entity_t, uint32_t> lookup;
+    uint32_t dead_items = 0;
+    uint32_t garbage_nodes = 0;
+};
+
+constexpr uint32_t scene_bvh_invalid = ~0u;
+
+inline scene_bvh scene_bvh_g_tree;
+} // namespace ash
+
+namespace ash
+{
+void scene_bvh_init();
+void scene_bvh_shutdown();
+void scene_bvh_update(scene_bvh &bvh);
+void scene_bvh_rebuild(scene_bvh &bvh);
+void scene_bvh_set_bounds(scene_bvh &bvh, flecs::entity_t entity, const DirectX::XMFLOAT3 &min,
+                          const DirectX::XMFLOAT3 &max, const DirectX::XMFLOAT4 &sphere);
+void scene_bvh_remove(scene_bvh &bvh, flecs::entity_t entity);
+
+void scene_bvh_query_frustum(const scene_bvh &bvh, const scene_cull_frustum &frustum,
+                             std::vector<flecs::entity_t> &out);
+void scene_bvh_query_aabb(const scene_bvh &bvh, const DirectX::XMFLOAT3 &min, const DirectX::XMFLOAT3 &max,
+                          std::vector<flecs::entity_t> &out);
+void scene_bvh_query_sphere(const scene_bvh &bvh, const DirectX::XMFLOAT4 &sphere, std::vector<flecs::entity_t> &out);
+
+// Returns every entity whose bounds the ray crosses within max_distance, sorted front to back.
+void scene_bvh_query_ray(const scene_bvh &bvh, const DirectX::XMFLOAT3 &origin, const DirectX::XMFLOAT3 &direction,
+                         float max_distance, std::vector<scene_bvh_ray_hit> &out);
+} // namespace ash
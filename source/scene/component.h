@@ -1,6 +1,9 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <flecs.h>
 
 namespace ash
@@ -16,6 +19,41 @@ struct transform
     DirectX::XMFLOAT3 scale = {1.0f, 1.0f, 1.0f};
 };
 
+// Cached local-to-world matrix, recomputed by scene_tf_update only when the entity's transform or one of its
+// ancestors' transforms changed.
+struct world_transform
+{
+    DirectX::XMFLOAT4X4 matrix = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                                  0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+};
+
+// Local-space AABB used for culling. world_sphere is the cached world-space bounding sphere (xyz = center, w =
+// radius), refreshed by scene_tf_update alongside world_transform.
+struct bounds
+{
+    DirectX::XMFLOAT3 center = {0.0f, 0.0f, 0.0f};
+    DirectX::XMFLOAT3 extents = {0.5f, 0.5f, 0.0f};
+    DirectX::XMFLOAT4 world_sphere = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+// Index of the entity's geometry in scene_mesh_g_arena.meshes.
+struct mesh
+{
+    uint32_t index = UINT32_MAX;
+};
+
+// LOD of the entity's mesh picked by scene_lod_select for the last rendered view. Added automatically with mesh.
+struct mesh_lod
+{
+    uint32_t lod = 0;
+};
+
+// Tag for entities whose bounds box is solid enough to hide what is behind it. Occluders are rasterized into the
+// software depth buffer used by occlusion culling.
+struct occluder
+{
+};
+
 inline DirectX::XMMATRIX get_local_transform_matrix(const ash::transform &transform)
 {
     const DirectX::XMMATRIX scale = DirectX::XMMatrixScaling(transform.scale.x, transform.scale.y, transform.scale.z);
@@ -26,24 +64,17 @@ inline DirectX::XMMATRIX get_local_transform_matrix(const ash::transform &transf
     return scale * rotation_matrix * translation;
 }
 
-inline DirectX::XMMATRIX get_world_transform_matrix(flecs::entity entity)
-{
-    std::vector<flecs::entity> chain;
-    for (flecs::entity cursor = entity; cursor.is_valid(); cursor = cursor.parent())
-    {
-        chain.push_back(cursor);
-    }
-
-    DirectX::XMMATRIX world = DirectX::XMMatrixIdentity();
-    for (auto it = chain.rbegin(); it != chain.rend(); ++it)
-    {
-        if (it->has<ash::transform>())
-        {
-            const ash::transform &node_transform = it->get<ash::transform>();
-            world = get_local_transform_matrix(node_transform) * world;
-        }
-    }
-
-    return world;
+inline DirectX::XMFLOAT4 get_world_bounding_sphere(const ash::bounds &local_bounds, DirectX::FXMMATRIX world)
+{
+    const DirectX::XMVECTOR center = DirectX::XMVector3TransformCoord(XMLoadFloat3(&local_bounds.center), world);
+    const float max_scale_sq = (std::max)({DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[0])),
+                                           DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[1])),
+                                           DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[2]))});
+    const float radius =
+        DirectX::XMVectorGetX(DirectX::XMVector3Length(XMLoadFloat3(&local_bounds.extents))) * std::sqrt(max_scale_sq);
+
+    DirectX::XMFLOAT4 sphere;
+    DirectX::XMStoreFloat4(&sphere, DirectX::XMVectorSetW(center, radius));
+    return sphere;
 }
 } // namespace ash
@@ -0,0 +1,144 @@
+#include "culling.h"
+#include "job/cpu.h"
+#include <bit>
+#include <common.h>
+
+#if ASH_CPU_X86
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+bool is_sphere_visible(const ash::scene_cull_frustum &frustum, float x, float y, float z, float r)
+{
+    for (const XMFLOAT4 &plane : frustum.planes)
+    {
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < -r)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t cull_scalar(const ash::scene_cull_frustum &frustum, const ash::scene_cull_spheres &spheres, uint32_t first,
+                     uint32_t end, uint32_t *visible_indices)
+{
+    uint32_t visible_count = 0;
+    for (uint32_t i = first; i < end; ++i)
+    {
+        if (is_sphere_visible(frustum, spheres.center_x[i], spheres.center_y[i], spheres.center_z[i],
+                              spheres.radius[i]))
+        {
+            visible_indices[visible_count++] = i;
+        }
+    }
+
+    return visible_count;
+}
+
+#if ASH_CPU_X86
+uint32_t cull_sse(const ash::scene_cull_frustum &frustum, const ash::scene_cull_spheres &spheres, uint32_t count,
+                  uint32_t *visible_indices, uint32_t &visible_count)
+{
+    __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for (uint32_t p = 0; p < 6; ++p)
+    {
+        plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+        plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+        plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+        plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+
+    const __m128 sign_bit = _mm_set1_ps(-0.0f);
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(&spheres.center_x[i]);
+        const __m128 y = _mm_loadu_ps(&spheres.center_y[i]);
+        const __m128 z = _mm_loadu_ps(&spheres.center_z[i]);
+        const __m128 negative_r = _mm_xor_ps(_mm_loadu_ps(&spheres.radius[i]), sign_bit);
+
+        // Same operations in the same order as is_sphere_visible, so both paths agree on spheres touching a plane.
+        __m128 outside = _mm_setzero_ps();
+        for (uint32_t p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y));
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane_z[p], z));
+            distance = _mm_add_ps(distance, plane_w[p]);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negative_r));
+        }
+
+        uint32_t visible_mask = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xF;
+        while (visible_mask)
+        {
+            const uint32_t lane = static_cast<uint32_t>(std::countr_zero(visible_mask));
+            visible_indices[visible_count++] = i + lane;
+            visible_mask &= visible_mask - 1;
+        }
+    }
+
+    return i;
+}
+#endif
+} // namespace
+
+ash::scene_cull_frustum ash::scene_cull_extract_frustum(FXMMATRIX view_proj)
+{
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, view_proj);
+
+    // Row-vector convention: clip = v * M, so each plane is a combination of the matrix columns.
+    const XMVECTOR col0 = XMVectorSet(m._11, m._21, m._31, m._41);
+    const XMVECTOR col1 = XMVectorSet(m._12, m._22, m._32, m._42);
+    const XMVECTOR col2 = XMVectorSet(m._13, m._23, m._33, m._43);
+    const XMVECTOR col3 = XMVectorSet(m._14, m._24, m._34, m._44);
+
+    const XMVECTOR planes[6] = {
+        XMVectorAdd(col3, col0),      XMVectorSubtract(col3, col0), XMVectorAdd(col3, col1),
+        XMVectorSubtract(col3, col1), col2,                         XMVectorSubtract(col3, col2),
+    };
+
+    scene_cull_frustum frustum = {};
+    for (uint32_t p = 0; p < 6; ++p)
+    {
+        XMStoreFloat4(&frustum.planes[p], XMPlaneNormalize(planes[p]));
+    }
+
+    return frustum;
+}
+
+void ash::scene_cull_spheres_clear(scene_cull_spheres &spheres)
+{
+    spheres.center_x.clear();
+    spheres.center_y.clear();
+    spheres.center_z.clear();
+    spheres.radius.clear();
+}
+
+void ash::scene_cull_spheres_push(scene_cull_spheres &spheres, const XMFLOAT4 &sphere)
+{
+    spheres.center_x.push_back(sphere.x);
+    spheres.center_y.push_back(sphere.y);
+    spheres.center_z.push_back(sphere.z);
+    spheres.radius.push_back(sphere.w);
+}
+
+uint32_t ash::scene_cull_frustum_spheres(const scene_cull_frustum &frustum, const scene_cull_spheres &spheres,
+                                         uint32_t *visible_indices)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_cull_frustum_spheres")
+
+    const uint32_t count = static_cast<uint32_t>(spheres.radius.size());
+    uint32_t visible_count = 0;
+    uint32_t done = 0;
+#if ASH_CPU_X86
+    done = cull_sse(frustum, spheres, count, visible_indices, visible_count);
+#endif
+    visible_count += cull_scalar(frustum, spheres, done, count, visible_indices + visible_count);
+    return visible_count;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+namespace ash
+{
+// Six normalized planes (left, right, bottom, top, near, far) whose positive half-space is inside the frustum.
+struct scene_cull_frustum
+{
+    DirectX::XMFLOAT4 planes[6];
+};
+
+// World-space bounding spheres in structure-of-arrays form, one entry per cull candidate.
+struct scene_cull_spheres
+{
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> radius;
+};
+} // namespace ash
+
+namespace ash
+{
+scene_cull_frustum scene_cull_extract_frustum(DirectX::FXMMATRIX view_proj);
+void scene_cull_spheres_clear(scene_cull_spheres &spheres);
+void scene_cull_spheres_push(scene_cull_spheres &spheres, const DirectX::XMFLOAT4 &sphere);
+
+// Tests every sphere against the frustum and writes the indices of the visible ones, in ascending order, to
+// visible_indices (which must hold at least spheres.radius.size() entries). Returns the visible count.
+uint32_t scene_cull_frustum_spheres(const scene_cull_frustum &frustum, const scene_cull_spheres &spheres,
+                                    uint32_t *visible_indices);
+} // namespace ash
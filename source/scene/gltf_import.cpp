@@ -0,0 +1,754 @@
+#include "gltf_import.h"
+#include "editor/console.h"
+#include "job/parallel.h"
+#include "job/task.h"
+#include "scene/mesh_bvh.h"
+#include "scene/mesh_cook.h"
+#include "scene/mesh_optimize.h"
+#include "scene/mesh_simplify.h"
+#include "scene/meshlet.h"
+#include "scene/scene.h"
+#include "scene/tangent.h"
+#include "scene/vertex_format.h"
+#include <chrono>
+#include <common.h>
+#include <cstring>
+#include <fastgltf/core.hpp>
+#include <fastgltf/math.hpp>
+#include <fastgltf/tools.hpp>
+#include <fastgltf/types.hpp>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+template <>
+struct fastgltf::ElementTraits<DirectX::XMFLOAT2>
+    : fastgltf::ElementTraitsBase<DirectX::XMFLOAT2, fastgltf::AccessorType::Vec2, float>
+{
+};
+
+template <>
+struct fastgltf::ElementTraits<DirectX::XMFLOAT3>
+    : fastgltf::ElementTraitsBase<DirectX::XMFLOAT3, fastgltf::AccessorType::Vec3, float>
+{
+};
+
+template <>
+struct fastgltf::ElementTraits<DirectX::XMFLOAT4>
+    : fastgltf::ElementTraitsBase<DirectX::XMFLOAT4, fastgltf::AccessorType::Vec4, float>
+{
+};
+
+namespace
+{
+// Nodes created per deferred flush. Background imports use the smaller slice so the frame budget is checked often.
+constexpr std::size_t g_commit_batch_size = 16384;
+constexpr std::size_t g_commit_slice_size = 1024;
+
+enum class import_state : uint8_t
+{
+    parsing,
+    parsed,
+    failed
+};
+
+struct pending_import
+{
+    ash::scene_gltf_import gltf_import;
+    // Written by the import task once it is back on the render thread, so scene_gltf_update reads it unsynchronized.
+    import_state state = import_state::parsing;
+    uint32_t reported_percent = 0;
+    ash::job_cancel_source cancel;
+    // Held while the task reads and parses on the job threads; scene_gltf_shutdown waits for it.
+    ash::job_counter working;
+};
+
+std::vector<std::unique_ptr<pending_import>> g_pending_imports;
+
+enum class accessor_target : uint8_t
+{
+    position,
+    normal,
+    tangent,
+    uv,
+    index,
+};
+
+// One accessor to decode into the arena at `offset` (a vertex index for attributes, an index-buffer position for
+// indices). no_accessor on an index target means the primitive is non-indexed and gets sequential indices.
+struct accessor_decode
+{
+    static constexpr std::size_t no_accessor = SIZE_MAX;
+
+    std::size_t accessor = no_accessor;
+    accessor_target target = accessor_target::position;
+    uint32_t offset = 0;
+    uint32_t vertex_count = 0;
+};
+
+// Copies `accessor` into `destination`. When the accessor is dense and already stored as T, the bytes are copied
+// straight out of the mapped file in one memcpy; anything else (quantized, normalized, strided or sparse data) goes
+// through fastgltf's per-element conversion.
+template <typename T>
+void decode_accessor(const fastgltf::Asset &asset, const fastgltf::Accessor &accessor, T *destination)
+{
+    using traits = fastgltf::ElementTraits<T>;
+    if (accessor.bufferViewIndex.has_value() && !accessor.sparse.has_value() && !accessor.normalized &&
+        accessor.type == traits::type && accessor.componentType == traits::enum_component_type)
+    {
+        const fastgltf::BufferView &view = asset.bufferViews[accessor.bufferViewIndex.value()];
+        if (view.byteStride.value_or(sizeof(T)) == sizeof(T))
+        {
+            const auto bytes = fastgltf::DefaultBufferDataAdapter{}(asset, accessor.bufferViewIndex.value());
+            if (accessor.byteOffset + accessor.count * sizeof(T) <= bytes.size())
+            {
+                std::memcpy(destination, bytes.data() + accessor.byteOffset, accessor.count * sizeof(T));
+                return;
+            }
+        }
+    }
+
+    fastgltf::copyFromAccessor<T>(asset, accessor, destination);
+}
+
+void run_accessor_decode(const fastgltf::Asset &asset, const accessor_decode &decode, ash::scene_mesh_arena &arena)
+{
+    if (decode.accessor == accessor_decode::no_accessor)
+    {
+        for (uint32_t i = 0; i < decode.vertex_count; ++i)
+        {
+            arena.indices[decode.offset + i] = i;
+        }
+        return;
+    }
+
+    const fastgltf::Accessor &accessor = asset.accessors[decode.accessor];
+    switch (decode.target)
+    {
+    case accessor_target::position:
+        decode_accessor(asset, accessor, arena.positions.data() + decode.offset);
+        break;
+    case accessor_target::normal:
+        decode_accessor(asset, accessor, arena.normals.data() + decode.offset);
+        break;
+    case accessor_target::tangent:
+        decode_accessor(asset, accessor, arena.tangents.data() + decode.offset);
+        break;
+    case accessor_target::uv:
+        decode_accessor(asset, accessor, arena.uvs.data() + decode.offset);
+        break;
+    case accessor_target::index: {
+        uint32_t *indices = arena.indices.data() + decode.offset;
+        decode_accessor(asset, accessor, indices);
+
+        // Out-of-range indices would let later passes read past the primitive's vertices.
+        for (std::size_t i = 0; i < accessor.count; ++i)
+        {
+            indices[i] = indices[i] < decode.vertex_count ? indices[i] : 0;
+        }
+        break;
+    }
+    }
+}
+
+std::size_t find_attribute_accessor(const fastgltf::Primitive &primitive, std::string_view name, std::size_t count,
+                                    const fastgltf::Asset &asset)
+{
+    const auto attribute = primitive.findAttribute(name);
+    if (attribute == primitive.attributes.end() || attribute->accessorIndex >= asset.accessors.size() ||
+        asset.accessors[attribute->accessorIndex].count != count)
+    {
+        return accessor_decode::no_accessor;
+    }
+    return attribute->accessorIndex;
+}
+
+// Lays out every triangle primitive of `asset` in `arena`, then decodes all accessors in parallel straight into
+// their final place. Non-triangle primitives and primitives without positions are skipped.
+void decode_meshes(const fastgltf::Asset &asset, ash::scene_mesh_arena &arena)
+{
+    std::vector<accessor_decode> decodes;
+    std::size_t vertex_count = 0;
+    std::size_t index_count = 0;
+
+    arena.meshes.reserve(asset.meshes.size());
+    for (const fastgltf::Mesh &gltf_mesh : asset.meshes)
+    {
+        ash::scene_mesh &mesh = arena.meshes.emplace_back();
+        mesh.first_primitive = static_cast<uint32_t>(arena.primitives.size());
+
+        for (const fastgltf::Primitive &gltf_primitive : gltf_mesh.primitives)
+        {
+            const auto position = gltf_primitive.findAttribute("POSITION");
+            if (gltf_primitive.type != fastgltf::PrimitiveType::Triangles ||
+                position == gltf_primitive.attributes.end() || position->accessorIndex >= asset.accessors.size())
+            {
+                continue;
+            }
+
+            const std::size_t primitive_vertex_count = asset.accessors[position->accessorIndex].count;
+            std::size_t primitive_index_count = primitive_vertex_count;
+            if (gltf_primitive.indicesAccessor.has_value())
+            {
+                if (gltf_primitive.indicesAccessor.value() >= asset.accessors.size())
+                {
+                    continue;
+                }
+                primitive_index_count = asset.accessors[gltf_primitive.indicesAccessor.value()].count;
+            }
+
+            if (vertex_count + primitive_vertex_count > UINT32_MAX || index_count + primitive_index_count > UINT32_MAX)
+            {
+                continue;
+            }
+
+            ash::scene_mesh_primitive &primitive = arena.primitives.emplace_back();
+            primitive.first_vertex = static_cast<uint32_t>(vertex_count);
+            primitive.vertex_count = static_cast<uint32_t>(primitive_vertex_count);
+            primitive.first_index = static_cast<uint32_t>(index_count);
+            primitive.index_count = static_cast<uint32_t>(primitive_index_count);
+
+            decodes.push_back({position->accessorIndex, accessor_target::position, primitive.first_vertex,
+                               primitive.vertex_count});
+            const std::size_t normal = find_attribute_accessor(gltf_primitive, "NORMAL", primitive_vertex_count, asset);
+            if (normal != accessor_decode::no_accessor)
+            {
+                decodes.push_back({normal, accessor_target::normal, primitive.first_vertex, primitive.vertex_count});
+            }
+
+            const std::size_t tangent =
+                find_attribute_accessor(gltf_primitive, "TANGENT", primitive_vertex_count, asset);
+            if (tangent != accessor_decode::no_accessor)
+            {
+                decodes.push_back({tangent, accessor_target::tangent, primitive.first_vertex, primitive.vertex_count});
+            }
+
+            const std::size_t uv = find_attribute_accessor(gltf_primitive, "TEXCOORD_0", primitive_vertex_count, asset);
+            if (uv != accessor_decode::no_accessor)
+            {
+                decodes.push_back({uv, accessor_target::uv, primitive.first_vertex, primitive.vertex_count});
+            }
+
+            decodes.push_back({gltf_primitive.indicesAccessor.value_or(accessor_decode::no_accessor),
+                               accessor_target::index, primitive.first_index, primitive.vertex_count});
+
+            vertex_count += primitive_vertex_count;
+            index_count += primitive_index_count;
+        }
+
+        mesh.primitive_count = static_cast<uint32_t>(arena.primitives.size()) - mesh.first_primitive;
+    }
+
+    arena.positions.resize(vertex_count);
+    arena.normals.resize(vertex_count);
+    arena.tangents.resize(vertex_count);
+    arena.uvs.resize(vertex_count);
+    arena.indices.resize(index_count);
+
+    ash::job_parallel_for(static_cast<uint32_t>(decodes.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            run_accessor_decode(asset, decodes[i], arena);
+        }
+    });
+
+    ash::scene_mesh_compute_bounds(arena);
+}
+
+ash::transform get_node_transform(const fastgltf::Node &node)
+{
+    ash::transform entity_transform = {};
+    if (const auto *trs = std::get_if<fastgltf::TRS>(&node.transform))
+    {
+        entity_transform.position = {trs->translation[0], trs->translation[1], trs->translation[2]};
+        entity_transform.rotation = {trs->rotation[0], trs->rotation[1], trs->rotation[2], trs->rotation[3]};
+        entity_transform.scale = {trs->scale[0], trs->scale[1], trs->scale[2]};
+    }
+    else
+    {
+        fastgltf::math::fvec3 scale = {1.0f, 1.0f, 1.0f};
+        fastgltf::math::fquat rotation(0.0f, 0.0f, 0.0f, 1.0f);
+        fastgltf::math::fvec3 translation = {0.0f, 0.0f, 0.0f};
+
+        auto matrix = std::get<fastgltf::math::fmat4x4>(node.transform);
+        fastgltf::math::decomposeTransformMatrix(matrix, scale, rotation, translation);
+
+        entity_transform.position = {translation[0], translation[1], translation[2]};
+        entity_transform.rotation = {rotation[0], rotation[1], rotation[2], rotation[3]};
+        entity_transform.scale = {scale[0], scale[1], scale[2]};
+    }
+    return entity_transform;
+}
+
+// Makes the names of one sibling group unique. Every entity of an import is new, so its scope starts empty and
+// uniqueness can be decided here without asking flecs.
+void make_sibling_names_unique(std::vector<ash::scene_gltf_node> &nodes, std::size_t begin, std::size_t end)
+{
+    std::unordered_set<std::string> taken;
+    std::unordered_map<std::string, uint32_t> next_suffix;
+    taken.reserve(end - begin);
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        std::string &name = nodes[i].name;
+        if (taken.insert(name).second)
+        {
+            continue;
+        }
+
+        uint32_t &suffix = next_suffix.try_emplace(name, 2).first->second;
+        std::string candidate_name;
+        do
+        {
+            candidate_name = name + " (" + std::to_string(suffix++) + ")";
+        } while (!taken.insert(candidate_name).second);
+        name = std::move(candidate_name);
+    }
+}
+
+// Flattens the node hierarchy of `gltf_scene` with an explicit work list instead of recursion. The list itself is
+// the queue: each node's children are appended as one contiguous group when the node is visited.
+std::vector<ash::scene_gltf_node> build_import_nodes(const fastgltf::Asset &asset, const fastgltf::Scene &gltf_scene)
+{
+    std::vector<ash::scene_gltf_node> nodes;
+    std::vector<std::size_t> node_indices;
+    std::vector<bool> visited(asset.nodes.size(), false);
+    nodes.reserve(asset.nodes.size());
+    node_indices.reserve(asset.nodes.size());
+
+    auto append_group = [&](const auto &children, uint32_t parent) {
+        const std::size_t group_begin = nodes.size();
+        for (std::size_t node_index : children)
+        {
+            // Out-of-range indices are skipped; revisited indices would make the hierarchy cyclic.
+            if (node_index >= asset.nodes.size() || visited[node_index])
+            {
+                continue;
+            }
+            visited[node_index] = true;
+
+            const auto &node = asset.nodes[node_index];
+            ash::scene_gltf_node &import_node = nodes.emplace_back();
+            import_node.parent = parent;
+            import_node.name =
+                node.name.empty() ? ("Node_" + std::to_string(node_index)) : std::string(node.name.c_str());
+            if (node.meshIndex.has_value())
+            {
+                import_node.name += " [Mesh " + std::to_string(node.meshIndex.value()) + "]";
+                if (node.meshIndex.value() < asset.meshes.size())
+                {
+                    import_node.mesh = static_cast<uint32_t>(node.meshIndex.value());
+                }
+            }
+            import_node.transform = get_node_transform(node);
+            node_indices.push_back(node_index);
+        }
+        make_sibling_names_unique(nodes, group_begin, nodes.size());
+    };
+
+    append_group(gltf_scene.nodeIndices, ash::scene_gltf_node::no_parent);
+    for (std::size_t cursor = 0; cursor < nodes.size(); ++cursor)
+    {
+        append_group(asset.nodes[node_indices[cursor]].children, static_cast<uint32_t>(cursor));
+    }
+
+    return nodes;
+}
+
+// Drops `counter` when it goes out of scope, including when a cancelled task unwinds.
+struct counter_release
+{
+    ash::job_counter &counter;
+
+    ~counter_release()
+    {
+        ash::job_counter_decrement(counter);
+    }
+};
+
+ash::task<void> run_import(pending_import &pending)
+{
+    bool parsed = false;
+    {
+        counter_release release{pending.working};
+        const ash::job_file_data file = co_await ash::job_read_file(pending.gltf_import.path);
+        if (!file.ok)
+        {
+            ash::ed_console_log(ash::ed_console_log_level::error, "glTF import failed: unable to read file.");
+        }
+        else
+        {
+            parsed = ash::scene_gltf_parse(pending.gltf_import.path, file.bytes, pending.gltf_import);
+        }
+    }
+
+    // The world is only touched on the render thread. Shutdown cancels the task here once that thread has stopped.
+    co_await ash::job_resume_on{ash::job_affinity::render};
+    pending.state = parsed ? import_state::parsed : import_state::failed;
+}
+
+// Creates the entities for nodes [begin, end). Commands are deferred so flecs merges each entity's components, parent
+// and name into a single table move when the batch is flushed. Nodes whose parent was deleted in the meantime are
+// skipped along with their subtree.
+void create_import_entities(ash::scene_gltf_import &gltf_import, std::size_t begin, std::size_t end)
+{
+    ash::scene_g_world.defer_begin();
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const ash::scene_gltf_node &node = gltf_import.nodes[i];
+        const flecs::entity_t parent =
+            node.parent == ash::scene_gltf_node::no_parent ? gltf_import.root.id() : gltf_import.entities[node.parent];
+        if (parent == 0 || !ash::scene_g_world.is_alive(parent))
+        {
+            continue;
+        }
+
+        flecs::entity entity = ash::scene_g_world.entity();
+        entity.add<ash::game_object>().set<ash::transform>(node.transform).child_of(parent);
+        if (node.mesh != ash::scene_gltf_node::no_mesh)
+        {
+            const uint32_t mesh_index = gltf_import.mesh_offset + node.mesh;
+            const ash::scene_mesh &mesh = ash::scene_mesh_g_arena.meshes[mesh_index];
+            entity.set<ash::mesh>({mesh_index});
+            entity.set<ash::bounds>({mesh.center, mesh.extents});
+        }
+        entity.set_name(node.name.c_str());
+        gltf_import.entities[i] = entity.id();
+    }
+    ash::scene_g_world.defer_end();
+}
+
+// Runs the CPU passes over freshly decoded geometry, in the order each one expects: tangents need the source
+// topology, meshlets and LODs the optimized index order, and quantization every float stream. Returns false when a
+// builder produced meshlets or a BVH that break the invariants the renderer, picking and cooked files rely on.
+bool process_meshes(ash::scene_mesh_arena &arena)
+{
+    const ash::scene_tan_stats tangent_stats = ash::scene_tan_generate(arena);
+    ash::ed_console_log(ash::ed_console_log_level::info,
+                        std::format("[Scene] Generated tangents for {} primitives ({} triangles), split {} vertices.",
+                                    tangent_stats.primitives, tangent_stats.triangles, tangent_stats.split_vertices));
+
+    const ash::scene_mopt_stats optimize_stats = ash::scene_mopt_optimize(arena);
+    ash::ed_console_log(ash::ed_console_log_level::info,
+                        std::format("[Scene] Mesh optimization: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}.",
+                                    optimize_stats.before.acmr(), optimize_stats.after.acmr(),
+                                    optimize_stats.before.atvr(), optimize_stats.after.atvr()));
+
+    const ash::scene_simp_stats lod_stats = ash::scene_simp_build_lods(arena);
+    ash::ed_console_log(ash::ed_console_log_level::info,
+                        std::format("[Scene] Generated {} LODs with {} triangles from {} source triangles.",
+                                    lod_stats.lod_count, lod_stats.lod_triangles, lod_stats.source_triangles));
+
+    ash::scene_mlet_build(arena);
+    if (!ash::scene_mlet_validate(arena))
+    {
+        ash::ed_console_log(ash::ed_console_log_level::error, "glTF import failed: invalid meshlets.");
+        return false;
+    }
+    ash::ed_console_log(ash::ed_console_log_level::info,
+                        std::format("[Scene] Built {} meshlets.", arena.meshlets.size()));
+
+    ash::scene_mbvh_build(arena);
+    if (!ash::scene_mbvh_validate(arena))
+    {
+        ash::ed_console_log(ash::ed_console_log_level::error, "glTF import failed: invalid triangle BVH.");
+        return false;
+    }
+    ash::ed_console_log(ash::ed_console_log_level::info,
+                        std::format("[Scene] Built {} triangle BVH nodes.", arena.bvh_nodes.size()));
+
+    const ash::scene_vtx_stats vertex_stats = ash::scene_vtx_quantize(arena, ash::scene_vtx_g_format);
+    ash::ed_console_log(ash::ed_console_log_level::info,
+                        std::format("[Scene] Packed vertices: {} KiB -> {} KiB, max error: position {:.6f}, "
+                                    "normal {:.4f} deg, tangent {:.4f} deg, uv {:.6f}.",
+                                    vertex_stats.float_bytes / 1024, vertex_stats.packed_bytes / 1024,
+                                    vertex_stats.max_position_error, vertex_stats.max_normal_error,
+                                    vertex_stats.max_tangent_error, vertex_stats.max_uv_error));
+
+    const std::size_t released_bytes = ash::scene_mesh_release_attributes(arena);
+    ash::ed_console_log(ash::ed_console_log_level::info,
+                        std::format("[Scene] Released {} KiB of float vertex attributes.", released_bytes / 1024));
+    return true;
+}
+
+// Cooked geometry is kept next to the asset as "<file>.ashm".
+std::filesystem::path get_cooked_path(const std::filesystem::path &path)
+{
+    std::filesystem::path cooked_path = path;
+    cooked_path += ".ashm";
+    return cooked_path;
+}
+
+// Loads `path`'s cooked geometry when it is at least as new as the asset file and was packed for `asset`'s meshes in
+// the current vertex format. External buffers are not compared, so editing only a .bin needs the .ashm deleted.
+bool read_cooked_meshes(const std::filesystem::path &path, const fastgltf::Asset &asset, ash::scene_mesh_arena &arena)
+{
+    const std::filesystem::path cooked_path = get_cooked_path(path);
+    std::error_code error;
+    const auto cooked_time = std::filesystem::last_write_time(cooked_path, error);
+    if (error)
+    {
+        return false;
+    }
+    const auto source_time = std::filesystem::last_write_time(path, error);
+    if (error || cooked_time < source_time || !ash::scene_cook_read(cooked_path, arena))
+    {
+        return false;
+    }
+
+    bool matches = arena.meshes.size() == asset.meshes.size() && arena.vertex_streams.size() == arena.meshes.size();
+    for (const ash::scene_vtx_stream &stream : arena.vertex_streams)
+    {
+        matches = matches && stream.format == ash::scene_vtx_g_format;
+    }
+    if (!matches)
+    {
+        ash::scene_mesh_clear(arena);
+    }
+
+    // Files cooked before the attributes were released after packing still carry them.
+    ash::scene_mesh_release_attributes(arena);
+    return matches;
+}
+
+// Decodes and processes the glTF read by `data`; `path` names the asset and locates its external buffers.
+bool parse_asset(const std::filesystem::path &path, fastgltf::GltfDataGetter &data,
+                 ash::scene_gltf_import &gltf_import)
+{
+    fastgltf::Parser parser(fastgltf::Extensions::KHR_mesh_quantization);
+    constexpr auto options = fastgltf::Options::DontRequireValidAssetMember |
+                             fastgltf::Options::DecomposeNodeMatrices | fastgltf::Options::LoadExternalBuffers;
+    constexpr auto categories = fastgltf::Category::Asset | fastgltf::Category::Scenes | fastgltf::Category::Nodes |
+                                fastgltf::Category::Meshes | fastgltf::Category::Buffers |
+                                fastgltf::Category::BufferViews | fastgltf::Category::Accessors;
+
+    auto loaded_asset = parser.loadGltf(data, path.parent_path(), options, categories);
+    if (loaded_asset.error() != fastgltf::Error::None)
+    {
+        std::cerr << "glTF import failed to parse file: " << fastgltf::getErrorMessage(loaded_asset.error()) << '\n';
+        ash::ed_console_log(ash::ed_console_log_level::error, "glTF import failed: parse error.");
+        return false;
+    }
+
+    fastgltf::Asset asset = std::move(loaded_asset.get());
+    if (asset.scenes.empty())
+    {
+        std::cerr << "glTF import failed: no scenes in file.\n";
+        ash::ed_console_log(ash::ed_console_log_level::error, "glTF import failed: no scenes in file.");
+        return false;
+    }
+
+    std::size_t scene_index = asset.defaultScene.value_or(0);
+    if (scene_index >= asset.scenes.size())
+    {
+        scene_index = 0;
+    }
+
+    const auto &gltf_scene = asset.scenes[scene_index];
+    std::string scene_name = gltf_scene.name.empty() ? path.stem().string() : std::string(gltf_scene.name.c_str());
+    if (scene_name.empty())
+    {
+        scene_name = "Imported Scene";
+    }
+
+    gltf_import.path = path;
+    gltf_import.root_name = "glTF: " + scene_name;
+    gltf_import.nodes = build_import_nodes(asset, gltf_scene);
+    gltf_import.entities.assign(gltf_import.nodes.size(), 0);
+    gltf_import.root = {};
+    gltf_import.committed = 0;
+
+    ash::scene_mesh_clear(gltf_import.meshes);
+    const std::filesystem::path cooked_path = get_cooked_path(path);
+    if (read_cooked_meshes(path, asset, gltf_import.meshes))
+    {
+        ash::ed_console_log(ash::ed_console_log_level::info,
+                            std::format("[Scene] Loaded cooked geometry from {}.", cooked_path.filename().string()));
+    }
+    else
+    {
+        decode_meshes(asset, gltf_import.meshes);
+        if (!process_meshes(gltf_import.meshes))
+        {
+            return false;
+        }
+        if (ash::scene_cook_write(cooked_path, gltf_import.meshes, true))
+        {
+            ash::ed_console_log(ash::ed_console_log_level::info,
+                                std::format("[Scene] Cooked geometry to {}.", cooked_path.filename().string()));
+        }
+    }
+
+    ash::ed_console_log(ash::ed_console_log_level::info,
+                        std::format("[Scene] glTF parsed: {} nodes, {} meshes, {} vertices, {} triangles.",
+                                    gltf_import.nodes.size(), gltf_import.meshes.meshes.size(),
+                                    gltf_import.meshes.positions.size(), gltf_import.meshes.indices.size() / 3));
+    return true;
+}
+
+} // namespace
+
+bool ash::scene_gltf_parse(const std::filesystem::path &path, scene_gltf_import &gltf_import)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_gltf_parse")
+
+    ed_console_log(ed_console_log_level::info, "[Scene] glTF import begin.");
+
+    if (!std::filesystem::exists(path))
+    {
+        std::cerr << "glTF import failed. File does not exist: " << path << '\n';
+        ed_console_log(ed_console_log_level::error, "glTF import failed: file does not exist.");
+        return false;
+    }
+
+    auto gltf_file = fastgltf::MappedGltfFile::FromPath(path);
+    if (!bool(gltf_file))
+    {
+        std::cerr << "glTF import failed to open file: " << fastgltf::getErrorMessage(gltf_file.error()) << '\n';
+        ed_console_log(ed_console_log_level::error, "glTF import failed: unable to open file.");
+        return false;
+    }
+
+    return parse_asset(path, gltf_file.get(), gltf_import);
+}
+
+bool ash::scene_gltf_parse(const std::filesystem::path &path, const std::vector<uint8_t> &bytes,
+                           scene_gltf_import &gltf_import)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_gltf_parse")
+
+    ed_console_log(ed_console_log_level::info, "[Scene] glTF import begin.");
+
+    auto gltf_data =
+        fastgltf::GltfDataBuffer::FromBytes(reinterpret_cast<const std::byte *>(bytes.data()), bytes.size());
+    if (!bool(gltf_data))
+    {
+        std::cerr << "glTF import failed to read file: " << fastgltf::getErrorMessage(gltf_data.error()) << '\n';
+        ed_console_log(ed_console_log_level::error, "glTF import failed: unable to read file.");
+        return false;
+    }
+
+    return parse_asset(path, gltf_data.get(), gltf_import);
+}
+
+bool ash::scene_gltf_commit(scene_gltf_import &gltf_import, double budget_ms)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_gltf_commit")
+
+    const auto start = std::chrono::steady_clock::now();
+
+    if (gltf_import.root.id() == 0)
+    {
+        gltf_import.root = scene_g_world.entity().add<ash::game_object>().set<ash::transform>({});
+        scene_set_entity_name_safe(gltf_import.root, gltf_import.root_name);
+        scene_g_selected = gltf_import.root;
+
+        gltf_import.mesh_offset = scene_mesh_append(scene_mesh_g_arena, gltf_import.meshes);
+        scene_mesh_clear(gltf_import.meshes);
+    }
+
+    if (!gltf_import.root.is_alive())
+    {
+        ed_console_log(ed_console_log_level::warning, "[Scene] glTF import canceled: root entity was deleted.");
+        gltf_import.committed = gltf_import.nodes.size();
+        return true;
+    }
+
+    const std::size_t slice_size = budget_ms < 0.0 ? g_commit_batch_size : g_commit_slice_size;
+    while (gltf_import.committed < gltf_import.nodes.size())
+    {
+        const std::size_t end = (std::min)(gltf_import.committed + slice_size, gltf_import.nodes.size());
+        create_import_entities(gltf_import, gltf_import.committed, end);
+        gltf_import.committed = end;
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (budget_ms >= 0.0 && elapsed.count() >= budget_ms)
+        {
+            break;
+        }
+    }
+
+    return gltf_import.committed == gltf_import.nodes.size();
+}
+
+void ash::scene_gltf_import_async(const std::filesystem::path &path)
+{
+    auto pending = std::make_unique<pending_import>();
+    pending->gltf_import.path = path;
+    job_counter_increment(pending->working);
+    job_spawn(run_import(*pending), &pending->cancel);
+    g_pending_imports.push_back(std::move(pending));
+}
+
+void ash::scene_gltf_update()
+{
+    if (g_pending_imports.empty())
+    {
+        return;
+    }
+
+    SCOPED_CPU_EVENT(L"ash::scene_gltf_update")
+
+    const auto start = std::chrono::steady_clock::now();
+    for (auto it = g_pending_imports.begin(); it != g_pending_imports.end();)
+    {
+        pending_import &pending = **it;
+        if (pending.state == import_state::parsing)
+        {
+            ++it;
+            continue;
+        }
+
+        if (pending.state == import_state::failed)
+        {
+            it = g_pending_imports.erase(it);
+            continue;
+        }
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        const double remaining_ms = scene_gltf_commit_budget_ms - elapsed.count();
+        if (remaining_ms <= 0.0)
+        {
+            break;
+        }
+
+        const bool done = scene_gltf_commit(pending.gltf_import, remaining_ms);
+        const std::size_t node_count = pending.gltf_import.nodes.size();
+        const uint32_t percent =
+            node_count == 0 ? 100 : static_cast<uint32_t>(pending.gltf_import.committed * 100 / node_count);
+        if (!done && percent >= pending.reported_percent + 10)
+        {
+            pending.reported_percent = percent - percent % 10;
+            ed_console_log(ed_console_log_level::info,
+                           std::format("[Scene] glTF import {}%: {} / {} nodes.", pending.reported_percent,
+                                       pending.gltf_import.committed, node_count));
+        }
+
+        if (!done)
+        {
+            break;
+        }
+
+        if (pending.gltf_import.root.is_alive())
+        {
+            ed_console_log(ed_console_log_level::info, "[Scene] glTF import complete.");
+        }
+        it = g_pending_imports.erase(it);
+    }
+}
+
+void ash::scene_gltf_shutdown()
+{
+    // Imports still parsing stop at their next suspension point; none may touch its pending_import once released.
+    for (const std::unique_ptr<pending_import> &pending : g_pending_imports)
+    {
+        pending->cancel.requested.store(true, std::memory_order_relaxed);
+    }
+    for (const std::unique_ptr<pending_import> &pending : g_pending_imports)
+    {
+        job_wait(pending->working);
+    }
+    g_pending_imports.clear();
+}
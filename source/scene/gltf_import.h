@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <flecs.h>
+#include <scene/component.h>
+#include <scene/mesh.h>
+#include <string>
+#include <vector>
+
+namespace ash
+{
+// Frame time spent committing background imports into the world, per frame.
+constexpr double scene_gltf_commit_budget_ms = 4.0;
+
+// One glTF node flattened for import. Nodes are ordered so that every parent precedes its children and siblings are
+// contiguous; `parent` indexes into the same list, with no_parent meaning the import root.
+struct scene_gltf_node
+{
+    static constexpr uint32_t no_parent = UINT32_MAX;
+    static constexpr uint32_t no_mesh = UINT32_MAX;
+
+    uint32_t parent = no_parent;
+    uint32_t mesh = no_mesh;
+    std::string name;
+    ash::transform transform;
+};
+
+// A parsed glTF scene and its progress being committed into scene_g_world. `entities[i]` is the entity created for
+// `nodes[i]`, or 0 while it is not committed yet or when its parent was deleted before it could be created. `meshes`
+// holds the decoded geometry until the commit moves it into scene_mesh_g_arena at mesh_offset.
+struct scene_gltf_import
+{
+    std::filesystem::path path;
+    std::string root_name;
+    std::vector<scene_gltf_node> nodes;
+    scene_mesh_arena meshes;
+    uint32_t mesh_offset = 0;
+    std::vector<flecs::entity_t> entities;
+    flecs::entity root;
+    std::size_t committed = 0;
+};
+} // namespace ash
+
+namespace ash
+{
+// Reads `path` into `gltf_import` without touching the world, so it is safe to call from any thread.
+bool scene_gltf_parse(const std::filesystem::path &path, scene_gltf_import &gltf_import);
+
+// Same, from the file's contents already in memory. External buffers are still loaded relative to `path`.
+bool scene_gltf_parse(const std::filesystem::path &path, const std::vector<uint8_t> &bytes,
+                      scene_gltf_import &gltf_import);
+
+// Creates entities for the next nodes of `gltf_import` until `budget_ms` is spent; a negative budget commits
+// everything. Returns true once every node is committed or the import root was deleted.
+bool scene_gltf_commit(scene_gltf_import &gltf_import, double budget_ms);
+
+// Reads `path` on the job I/O thread and parses it on a job worker, then hands it to the render thread, where
+// scene_gltf_update commits it in per-frame slices.
+void scene_gltf_import_async(const std::filesystem::path &path);
+void scene_gltf_update();
+void scene_gltf_shutdown();
+} // namespace ash
@@ -0,0 +1,356 @@
+#include "gpu_scene.h"
+#include "renderer/core/frame_ring.h"
+#include "renderer/renderer.h"
+#include "scene/scene.h"
+#include "scene/transform.h"
+#include <D3D12MemAlloc.h>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace winrt;
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_initial_capacity = 1024;
+
+com_ptr<D3D12MA::Allocation> g_instance_buffer;
+D3D12_RESOURCE_STATES g_instance_state = D3D12_RESOURCE_STATE_COPY_DEST;
+uint32_t g_capacity = 0;
+ash::scene_inst_format g_format = ash::scene_inst_format::affine;
+ash::scene_inst_format g_buffer_format = ash::scene_inst_format::affine;
+
+// CPU-written memory of one frame in flight. The GPU may still be reading the other slots' buffers, so a frame only
+// ever touches the slot at rhi_frame_g_ring.index.
+struct frame_resources
+{
+    com_ptr<D3D12MA::Allocation> staging_buffer;
+    uint8_t *staging_data = nullptr;
+    uint64_t staging_size = 0;
+
+    com_ptr<D3D12MA::Allocation> visible_buffer;
+    uint32_t *visible_data = nullptr;
+    uint32_t visible_capacity = 0;
+
+    // Buffers replaced during this slot's frame stay alive until the slot comes around again, by which time that
+    // frame and every one before it have finished.
+    std::vector<com_ptr<D3D12MA::Allocation>> retired;
+};
+
+frame_resources g_frames[ash::rhi_frame_max_in_flight];
+
+std::unordered_map<flecs::entity_t, uint32_t> g_slots;
+std::vector<uint32_t> g_free_slots;
+uint32_t g_slot_count = 0;
+
+std::vector<std::pair<uint32_t, flecs::entity_t>> g_changed;
+std::vector<flecs::entity> g_observers;
+
+com_ptr<D3D12MA::Allocation> create_buffer(uint64_t size, D3D12_HEAP_TYPE heap_type, D3D12_RESOURCE_STATES state)
+{
+    D3D12_RESOURCE_DESC buf_desc = {};
+    buf_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    buf_desc.Alignment = 0;
+    buf_desc.Width = size;
+    buf_desc.Height = 1;
+    buf_desc.DepthOrArraySize = 1;
+    buf_desc.MipLevels = 1;
+    buf_desc.Format = DXGI_FORMAT_UNKNOWN;
+    buf_desc.SampleDesc.Count = 1;
+    buf_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    buf_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    D3D12MA::ALLOCATION_DESC alloc_desc = {};
+    alloc_desc.HeapType = heap_type;
+
+    com_ptr<D3D12MA::Allocation> buffer;
+    ash::rhi_g_allocator->CreateResource(&alloc_desc, &buf_desc, state, nullptr, buffer.put(), IID_NULL, nullptr);
+    assert(buffer.get());
+    return buffer;
+}
+
+void create_srv(ID3D12Resource *resource, uint32_t descriptor, uint32_t count, uint32_t stride)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Buffer.FirstElement = 0;
+    srv_desc.Buffer.NumElements = count;
+    srv_desc.Buffer.StructureByteStride = stride;
+    srv_desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle = ash::rhi_g_cbv_srv_uav_heap->GetCPUDescriptorHandleForHeapStart();
+    UINT handle_size = ash::rhi_g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    cpu_handle.ptr += descriptor * handle_size;
+
+    ash::rhi_g_device->CreateShaderResourceView(resource, &srv_desc, cpu_handle);
+}
+
+void transition(ID3D12GraphicsCommandList *command_list, ID3D12Resource *resource, D3D12_RESOURCE_STATES before,
+                D3D12_RESOURCE_STATES after)
+{
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Transition.pResource = resource;
+    barrier.Transition.StateBefore = before;
+    barrier.Transition.StateAfter = after;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    command_list->ResourceBarrier(1, &barrier);
+}
+
+uint32_t allocate_slot(flecs::entity_t entity)
+{
+    auto [it, inserted] = g_slots.try_emplace(entity, 0);
+    if (!inserted)
+    {
+        return it->second;
+    }
+
+    if (!g_free_slots.empty())
+    {
+        it->second = g_free_slots.back();
+        g_free_slots.pop_back();
+    }
+    else
+    {
+        it->second = g_slot_count++;
+    }
+
+    return it->second;
+}
+
+void release_slot(flecs::entity_t entity)
+{
+    if (auto it = g_slots.find(entity); it != g_slots.end())
+    {
+        g_free_slots.push_back(it->second);
+        g_slots.erase(it);
+    }
+}
+
+// Grows the instance buffer to hold at least `count` slots, copying the existing instances over on the GPU. Leaves
+// the new buffer in COPY_DEST.
+void grow_instance_buffer(ID3D12GraphicsCommandList *command_list, uint32_t count)
+{
+    const uint32_t stride = ash::scene_inst_get_stride(g_format);
+    const uint32_t capacity = std::max({count, g_capacity * 2, g_initial_capacity});
+    com_ptr<D3D12MA::Allocation> buffer = create_buffer(uint64_t(capacity) * stride, D3D12_HEAP_TYPE_DEFAULT,
+                                                        D3D12_RESOURCE_STATE_COPY_DEST);
+    SET_OBJECT_NAME(buffer->GetResource(), L"Scene Instance Buffer");
+
+    if (g_instance_buffer)
+    {
+        transition(command_list, g_instance_buffer->GetResource(), g_instance_state, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        command_list->CopyBufferRegion(buffer->GetResource(), 0, g_instance_buffer->GetResource(), 0,
+                                       uint64_t(g_capacity) * stride);
+        g_frames[ash::rhi_frame_g_ring.index].retired.push_back(std::move(g_instance_buffer));
+    }
+
+    g_instance_buffer = std::move(buffer);
+    g_instance_state = D3D12_RESOURCE_STATE_COPY_DEST;
+    g_capacity = capacity;
+}
+
+uint8_t *reserve_staging(frame_resources &frame, uint64_t size)
+{
+    if (size > frame.staging_size)
+    {
+        if (frame.staging_buffer)
+        {
+            frame.staging_buffer->GetResource()->Unmap(0, nullptr);
+            frame.retired.push_back(std::move(frame.staging_buffer));
+        }
+
+        frame.staging_size = std::max<uint64_t>(size, frame.staging_size * 2);
+        frame.staging_buffer =
+            create_buffer(frame.staging_size, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+        SET_OBJECT_NAME(frame.staging_buffer->GetResource(), L"Scene Instance Staging Buffer");
+        frame.staging_buffer->GetResource()->Map(0, nullptr, reinterpret_cast<void **>(&frame.staging_data));
+    }
+
+    return frame.staging_data;
+}
+} // namespace
+
+void ash::scene_gpu_init()
+{
+    g_observers.push_back(scene_g_world.observer<const world_transform>()
+                              .event(flecs::OnRemove)
+                              .each([](flecs::entity entity, const world_transform &) { release_slot(entity.id()); }));
+}
+
+void ash::scene_gpu_shutdown()
+{
+    for (flecs::entity observer : g_observers)
+    {
+        observer.destruct();
+    }
+
+    g_observers.clear();
+    g_slots.clear();
+    g_free_slots.clear();
+    g_slot_count = 0;
+
+    for (frame_resources &frame : g_frames)
+    {
+        if (frame.staging_buffer)
+        {
+            frame.staging_buffer->GetResource()->Unmap(0, nullptr);
+        }
+        if (frame.visible_buffer)
+        {
+            frame.visible_buffer->GetResource()->Unmap(0, nullptr);
+        }
+        frame = {};
+    }
+
+    g_instance_buffer = nullptr;
+    g_capacity = 0;
+}
+
+void ash::scene_gpu_upload(ID3D12GraphicsCommandList *command_list)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_gpu_upload")
+
+    // The renderer waits for the frame that last used this slot before recording into it, so what that frame
+    // retired is no longer referenced by the GPU.
+    frame_resources &frame = g_frames[rhi_frame_g_ring.index];
+    frame.retired.clear();
+
+    g_changed.clear();
+    for (flecs::entity_t id : scene_tf_get_updated())
+    {
+        if (flecs::entity(scene_g_world, id).is_alive())
+        {
+            g_changed.emplace_back(allocate_slot(id), id);
+        }
+    }
+
+    // A format switch invalidates every slot: the old buffer is dropped instead of copied and all instances are
+    // encoded again.
+    if (g_buffer_format != g_format)
+    {
+        if (g_instance_buffer)
+        {
+            frame.retired.push_back(std::move(g_instance_buffer));
+        }
+
+        g_capacity = 0;
+        g_buffer_format = g_format;
+        g_changed.clear();
+        for (const auto &[id, slot] : g_slots)
+        {
+            g_changed.emplace_back(slot, id);
+        }
+    }
+
+    const uint32_t stride = scene_inst_get_stride(g_format);
+    scene_gpu_g_stats.uploaded_instances = static_cast<uint32_t>(g_changed.size());
+    scene_gpu_g_stats.uploaded_bytes = g_changed.size() * stride;
+    scene_gpu_g_stats.instance_count = static_cast<uint32_t>(g_slots.size());
+
+    if (g_slot_count > g_capacity)
+    {
+        grow_instance_buffer(command_list, g_slot_count);
+    }
+    scene_gpu_g_stats.capacity = g_capacity;
+
+    // Frames in flight may still read the other slots' descriptors, so each frame rewrites its own one instead of
+    // touching them when the buffer is replaced.
+    if (g_instance_buffer)
+    {
+        create_srv(g_instance_buffer->GetResource(), scene_gpu_instance_descriptor + rhi_frame_g_ring.index,
+                   g_capacity, stride);
+    }
+
+    if (g_changed.empty())
+    {
+        if (g_instance_buffer && g_instance_state != D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE)
+        {
+            transition(command_list, g_instance_buffer->GetResource(), g_instance_state,
+                       D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+            g_instance_state = D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE;
+        }
+        return;
+    }
+
+    // Sorting by slot turns runs of adjacent slots into a single copy.
+    std::sort(g_changed.begin(), g_changed.end());
+
+    uint8_t *staging = reserve_staging(frame, g_changed.size() * stride);
+    for (size_t i = 0; i < g_changed.size(); ++i)
+    {
+        const flecs::entity entity(scene_g_world, g_changed[i].second);
+        scene_inst_encode(g_format, entity.get<world_transform>().matrix, staging + i * stride);
+    }
+
+    if (g_instance_state != D3D12_RESOURCE_STATE_COPY_DEST)
+    {
+        transition(command_list, g_instance_buffer->GetResource(), g_instance_state, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+
+    size_t run_begin = 0;
+    for (size_t i = 1; i <= g_changed.size(); ++i)
+    {
+        if (i < g_changed.size() && g_changed[i].first == g_changed[i - 1].first + 1)
+        {
+            continue;
+        }
+
+        command_list->CopyBufferRegion(g_instance_buffer->GetResource(), uint64_t(g_changed[run_begin].first) * stride,
+                                       frame.staging_buffer->GetResource(), run_begin * stride,
+                                       (i - run_begin) * stride);
+        run_begin = i;
+    }
+
+    transition(command_list, g_instance_buffer->GetResource(), D3D12_RESOURCE_STATE_COPY_DEST,
+               D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    g_instance_state = D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE;
+}
+
+void ash::scene_gpu_set_format(scene_inst_format format)
+{
+    g_format = format;
+}
+
+ash::scene_inst_format ash::scene_gpu_get_format()
+{
+    return g_format;
+}
+
+uint32_t ash::scene_gpu_write_visible(const std::vector<flecs::entity_t> &visible)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_gpu_write_visible")
+
+    frame_resources &frame = g_frames[rhi_frame_g_ring.index];
+    if (visible.size() > frame.visible_capacity)
+    {
+        if (frame.visible_buffer)
+        {
+            frame.visible_buffer->GetResource()->Unmap(0, nullptr);
+            frame.retired.push_back(std::move(frame.visible_buffer));
+        }
+
+        frame.visible_capacity =
+            std::max({static_cast<uint32_t>(visible.size()), frame.visible_capacity * 2, g_initial_capacity});
+        frame.visible_buffer = create_buffer(uint64_t(frame.visible_capacity) * sizeof(uint32_t),
+                                             D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+        SET_OBJECT_NAME(frame.visible_buffer->GetResource(), L"Scene Visible Instance Buffer");
+        frame.visible_buffer->GetResource()->Map(0, nullptr, reinterpret_cast<void **>(&frame.visible_data));
+        create_srv(frame.visible_buffer->GetResource(), scene_gpu_visible_descriptor + rhi_frame_g_ring.index,
+                   frame.visible_capacity, sizeof(uint32_t));
+    }
+
+    uint32_t count = 0;
+    for (flecs::entity_t id : visible)
+    {
+        if (auto it = g_slots.find(id); it != g_slots.end())
+        {
+            frame.visible_data[count++] = it->second;
+        }
+    }
+
+    scene_gpu_g_stats.visible_bytes = uint64_t(count) * sizeof(uint32_t);
+    return count;
+}
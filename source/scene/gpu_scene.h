@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.h"
+#include "renderer/core/frame_ring.h"
+#include <cstdint>
+#include <flecs.h>
+#include <scene/instance_format.h>
+#include <vector>
+
+namespace ash
+{
+// First of rhi_frame_max_in_flight consecutive descriptors each; a frame uses the one at rhi_frame_g_ring.index.
+constexpr uint32_t scene_gpu_instance_descriptor = 5;
+constexpr uint32_t scene_gpu_visible_descriptor = scene_gpu_instance_descriptor + rhi_frame_max_in_flight;
+
+struct scene_gpu_stats
+{
+    uint32_t instance_count = 0;
+    uint32_t capacity = 0;
+    uint32_t uploaded_instances = 0;
+    uint64_t uploaded_bytes = 0;
+    uint64_t visible_bytes = 0;
+};
+
+inline scene_gpu_stats scene_gpu_g_stats;
+} // namespace ash
+
+namespace ash
+{
+void scene_gpu_init();
+void scene_gpu_shutdown();
+
+// Gives every entity with a world_transform a stable slot in the GPU instance buffer and records copies for the
+// slots whose world_transform was recomputed by the last scene_tf_update. Unchanged instances are never re-uploaded.
+void scene_gpu_upload(ID3D12GraphicsCommandList *command_list);
+
+// Writes the instance slots of `visible` into this frame's visible list, read by the vertex shader through
+// SV_InstanceID. Returns the number of instances to draw.
+uint32_t scene_gpu_write_visible(const std::vector<flecs::entity_t> &visible);
+
+// Selects the instance encoding; takes effect at the next scene_gpu_upload, which re-encodes every instance. The
+// draw must use the pipeline compiled for the same format.
+void scene_gpu_set_format(scene_inst_format format);
+scene_inst_format scene_gpu_get_format();
+} // namespace ash
@@ -0,0 +1,144 @@
+#include "instance_format.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <common.h>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr float g_rotation_range = 0.70710678f; // 1 / sqrt(2): bound of the three smallest components
+constexpr float g_rotation_max = 1023.0f;
+
+uint32_t encode_component(float value)
+{
+    const float unorm = std::clamp(value / g_rotation_range * 0.5f + 0.5f, 0.0f, 1.0f);
+    return static_cast<uint32_t>(unorm * g_rotation_max + 0.5f);
+}
+
+float decode_component(uint32_t bits)
+{
+    return (static_cast<float>(bits & 0x3ff) / g_rotation_max * 2.0f - 1.0f) * g_rotation_range;
+}
+} // namespace
+
+uint32_t ash::scene_inst_get_stride(scene_inst_format format)
+{
+    switch (format)
+    {
+    case scene_inst_format::affine:
+        return sizeof(scene_inst_affine);
+    case scene_inst_format::quantized_trs:
+        return sizeof(scene_inst_trs);
+    case scene_inst_format::matrix:
+    default:
+        return sizeof(XMFLOAT4X4);
+    }
+}
+
+void ash::scene_inst_encode(scene_inst_format format, const XMFLOAT4X4 &world, void *out)
+{
+    switch (format)
+    {
+    case scene_inst_format::affine: {
+        scene_inst_affine affine;
+        XMStoreFloat3x4(&affine.matrix, XMLoadFloat4x4(&world));
+        std::memcpy(out, &affine, sizeof(affine));
+        break;
+    }
+    case scene_inst_format::quantized_trs: {
+        const scene_inst_trs trs = scene_inst_encode_trs(XMLoadFloat4x4(&world));
+        std::memcpy(out, &trs, sizeof(trs));
+        break;
+    }
+    case scene_inst_format::matrix:
+    default:
+        std::memcpy(out, &world, sizeof(world));
+        break;
+    }
+}
+
+uint32_t ash::scene_inst_encode_rotation(FXMVECTOR rotation)
+{
+    XMFLOAT4 q;
+    XMStoreFloat4(&q, XMQuaternionNormalize(rotation));
+    const float components[4] = {q.x, q.y, q.z, q.w};
+
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; ++i)
+    {
+        if (std::abs(components[i]) > std::abs(components[largest]))
+        {
+            largest = i;
+        }
+    }
+
+    // q and -q are the same rotation, so flipping the sign keeps the dropped component positive.
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint32_t packed = largest << 30;
+    uint32_t shift = 20;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            packed |= encode_component(components[i] * sign) << shift;
+            shift -= 10;
+        }
+    }
+
+    return packed;
+}
+
+XMVECTOR ash::scene_inst_decode_rotation(uint32_t packed)
+{
+    const uint32_t largest = packed >> 30;
+
+    float components[4];
+    float sum_sq = 0.0f;
+    uint32_t shift = 20;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            components[i] = decode_component(packed >> shift);
+            sum_sq += components[i] * components[i];
+            shift -= 10;
+        }
+    }
+
+    components[largest] = std::sqrt(std::max(0.0f, 1.0f - sum_sq));
+    return XMQuaternionNormalize(XMVectorSet(components[0], components[1], components[2], components[3]));
+}
+
+ash::scene_inst_trs ash::scene_inst_encode_trs(FXMMATRIX world)
+{
+    XMVECTOR scale, rotation, translation;
+    if (!XMMatrixDecompose(&scale, &rotation, &translation, world))
+    {
+        rotation = XMQuaternionIdentity();
+    }
+
+    XMFLOAT3 s;
+    XMStoreFloat3(&s, scale);
+
+    scene_inst_trs trs;
+    XMStoreFloat3(&trs.position, translation);
+    trs.rotation = scene_inst_encode_rotation(rotation);
+    trs.scale_xy = uint32_t(PackedVector::XMConvertFloatToHalf(s.x)) |
+                   (uint32_t(PackedVector::XMConvertFloatToHalf(s.y)) << 16);
+    trs.scale_z = PackedVector::XMConvertFloatToHalf(s.z);
+    return trs;
+}
+
+XMMATRIX ash::scene_inst_decode_trs(const scene_inst_trs &trs)
+{
+    const float sx = PackedVector::XMConvertHalfToFloat(static_cast<PackedVector::HALF>(trs.scale_xy & 0xffff));
+    const float sy = PackedVector::XMConvertHalfToFloat(static_cast<PackedVector::HALF>(trs.scale_xy >> 16));
+    const float sz = PackedVector::XMConvertHalfToFloat(static_cast<PackedVector::HALF>(trs.scale_z & 0xffff));
+
+    return XMMatrixScaling(sx, sy, sz) * XMMatrixRotationQuaternion(scene_inst_decode_rotation(trs.rotation)) *
+           XMMatrixTranslation(trs.position.x, trs.position.y, trs.position.z);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+
+namespace ash
+{
+// Layout of one entry in the GPU instance buffer. Must match INSTANCE_FORMAT in shaders/instance.hlsli.
+enum class scene_inst_format : uint8_t
+{
+    matrix,        // float4x4, 64 bytes
+    affine,        // 3x4 affine matrix in XMStoreFloat3x4 layout, 48 bytes
+    quantized_trs, // float3 position, smallest-three quaternion, half scale, 24 bytes
+    count
+};
+
+struct scene_inst_affine
+{
+    DirectX::XMFLOAT3X4 matrix;
+};
+
+// Rotation is stored smallest-three: bits 30-31 hold the index of the dropped (largest) component, the other three
+// are 10-bit unorms over [-1/sqrt(2), 1/sqrt(2)]. Scale is three halves; shear cannot be represented.
+struct scene_inst_trs
+{
+    DirectX::XMFLOAT3 position;
+    uint32_t rotation;
+    uint32_t scale_xy;
+    uint32_t scale_z;
+};
+
+static_assert(sizeof(scene_inst_affine) == 48);
+static_assert(sizeof(scene_inst_trs) == 24);
+} // namespace ash
+
+namespace ash
+{
+uint32_t scene_inst_get_stride(scene_inst_format format);
+
+// Encodes a row-vector world matrix into `out`, which must hold scene_inst_get_stride(format) bytes.
+void scene_inst_encode(scene_inst_format format, const DirectX::XMFLOAT4X4 &world, void *out);
+
+uint32_t scene_inst_encode_rotation(DirectX::FXMVECTOR rotation);
+DirectX::XMVECTOR scene_inst_decode_rotation(uint32_t packed);
+scene_inst_trs scene_inst_encode_trs(DirectX::FXMMATRIX world);
+DirectX::XMMATRIX scene_inst_decode_trs(const scene_inst_trs &trs);
+} // namespace ash
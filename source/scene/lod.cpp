@@ -0,0 +1,245 @@
+#include "lod.h"
+#include "job/cpu.h"
+#include "job/parallel.h"
+#include "scene/mesh.h"
+#include "scene/mesh_simplify.h"
+#include "scene/scene.h"
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <common.h>
+
+#if ASH_CPU_X86
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+constexpr float g_min_distance = 0.1f;
+constexpr uint32_t g_batch_size = 1024;
+
+// Per-mesh LOD tables, flattened across primitives: level l of a mesh uses level min(l, lod_count - 1) of each of
+// its primitives, so its error is the largest of theirs and its triangle count their sum.
+struct mesh_lods
+{
+    std::array<float, ash::scene_simp_max_lods> error;
+    std::array<uint32_t, ash::scene_simp_max_lods> triangles;
+    uint32_t count = 1;
+    float radius = 0.0f;
+};
+
+std::vector<mesh_lods> g_mesh_lods;
+std::size_t g_cached_primitive_count = 0;
+
+// Visible mesh instances in structure-of-arrays form; error[l] is the object-space error of LOD l, FLT_MAX past the
+// last LOD so it never passes.
+struct lod_batch
+{
+    std::vector<flecs::entity_t> entities;
+    std::vector<uint32_t> meshes;
+    std::vector<float> center_x, center_y, center_z, radius, scale;
+    std::vector<int32_t> current;
+    std::array<std::vector<float>, ash::scene_simp_max_lods> error;
+    std::vector<int32_t> selected;
+};
+
+lod_batch g_batch;
+
+void refresh_mesh_lods()
+{
+    const ash::scene_mesh_arena &arena = ash::scene_mesh_g_arena;
+    if (g_mesh_lods.size() == arena.meshes.size() && g_cached_primitive_count == arena.primitives.size())
+    {
+        return;
+    }
+
+    g_mesh_lods.assign(arena.meshes.size(), {});
+    g_cached_primitive_count = arena.primitives.size();
+    for (std::size_t m = 0; m < arena.meshes.size(); ++m)
+    {
+        const ash::scene_mesh &mesh = arena.meshes[m];
+        mesh_lods &lods = g_mesh_lods[m];
+        lods.error.fill(0.0f);
+        lods.triangles.fill(0);
+        lods.radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&mesh.extents)));
+
+        for (uint32_t p = mesh.first_primitive; p < mesh.first_primitive + mesh.primitive_count; ++p)
+        {
+            lods.count = (std::max)(lods.count, arena.primitives[p].lod_count);
+        }
+
+        for (uint32_t l = 0; l < lods.count; ++l)
+        {
+            for (uint32_t p = mesh.first_primitive; p < mesh.first_primitive + mesh.primitive_count; ++p)
+            {
+                const ash::scene_mesh_primitive &primitive = arena.primitives[p];
+                if (primitive.lod_count == 0)
+                {
+                    lods.triangles[l] += primitive.index_count / 3;
+                    continue;
+                }
+
+                const uint32_t level = (std::min)(l, primitive.lod_count - 1);
+                const ash::scene_mesh_lod &lod = arena.lods[primitive.first_lod + level];
+                lods.error[l] = (std::max)(lods.error[l], lod.error);
+                lods.triangles[l] += lod.index_count / 3;
+            }
+        }
+    }
+}
+
+void select_scalar(lod_batch &batch, uint32_t begin, uint32_t end, const XMFLOAT3 &eye, float projection_scale,
+                   float threshold)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const float dx = batch.center_x[i] - eye.x;
+        const float dy = batch.center_y[i] - eye.y;
+        const float dz = batch.center_z[i] - eye.z;
+        const float distance = (std::max)(std::sqrt(dx * dx + dy * dy + dz * dz) - batch.radius[i], g_min_distance);
+        const float pixels_per_unit = batch.scale[i] * projection_scale / distance;
+
+        int32_t selected = 0;
+        for (int32_t l = 0; l < int32_t(ash::scene_simp_max_lods); ++l)
+        {
+            const float limit = l < batch.current[i]    ? threshold
+                                : l == batch.current[i] ? threshold * (1.0f + ash::scene_lod_hysteresis)
+                                                        : threshold * (1.0f - ash::scene_lod_hysteresis);
+            if (batch.error[l][i] * pixels_per_unit <= limit)
+            {
+                selected = l;
+            }
+        }
+        batch.selected[i] = selected;
+    }
+}
+
+#if ASH_CPU_X86
+uint32_t select_sse(lod_batch &batch, uint32_t begin, uint32_t end, const XMFLOAT3 &eye, float projection_scale,
+                    float threshold)
+{
+    const __m128 eye_x = _mm_set1_ps(eye.x);
+    const __m128 eye_y = _mm_set1_ps(eye.y);
+    const __m128 eye_z = _mm_set1_ps(eye.z);
+    const __m128 min_distance = _mm_set1_ps(g_min_distance);
+    const __m128 scale = _mm_set1_ps(projection_scale);
+    const __m128 finer_limit = _mm_set1_ps(threshold);
+    const __m128 current_limit = _mm_set1_ps(threshold * (1.0f + ash::scene_lod_hysteresis));
+    const __m128 coarser_limit = _mm_set1_ps(threshold * (1.0f - ash::scene_lod_hysteresis));
+
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&batch.center_x[i]), eye_x);
+        const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&batch.center_y[i]), eye_y);
+        const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&batch.center_z[i]), eye_z);
+        const __m128 length =
+            _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        const __m128 distance = _mm_max_ps(_mm_sub_ps(length, _mm_loadu_ps(&batch.radius[i])), min_distance);
+        const __m128 pixels_per_unit = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(&batch.scale[i]), scale), distance);
+        const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&batch.current[i]));
+
+        __m128i selected = _mm_setzero_si128();
+        for (int32_t l = 0; l < int32_t(ash::scene_simp_max_lods); ++l)
+        {
+            const __m128i level = _mm_set1_epi32(l);
+            const __m128 is_current = _mm_castsi128_ps(_mm_cmpeq_epi32(level, current));
+            const __m128 is_finer = _mm_castsi128_ps(_mm_cmplt_epi32(level, current));
+            const __m128 limit =
+                _mm_or_ps(_mm_and_ps(is_current, current_limit),
+                          _mm_or_ps(_mm_and_ps(is_finer, finer_limit),
+                                    _mm_andnot_ps(_mm_or_ps(is_current, is_finer), coarser_limit)));
+
+            const __m128 projected = _mm_mul_ps(_mm_loadu_ps(&batch.error[l][i]), pixels_per_unit);
+            const __m128i passes = _mm_castps_si128(_mm_cmple_ps(projected, limit));
+            selected = _mm_or_si128(_mm_and_si128(passes, level), _mm_andnot_si128(passes, selected));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&batch.selected[i]), selected);
+    }
+    return i;
+}
+#endif
+} // namespace
+
+void ash::scene_lod_init()
+{
+    scene_g_world.component<mesh>().add(flecs::With, scene_g_world.component<mesh_lod>());
+}
+
+void ash::scene_lod_select(const std::vector<flecs::entity_t> &visible, const camera &cam, float viewport_height)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_lod_select")
+
+    refresh_mesh_lods();
+
+    lod_batch &batch = g_batch;
+    batch.entities.clear();
+    batch.meshes.clear();
+    batch.center_x.clear();
+    batch.center_y.clear();
+    batch.center_z.clear();
+    batch.radius.clear();
+    batch.scale.clear();
+    batch.current.clear();
+    for (std::vector<float> &error : batch.error)
+    {
+        error.clear();
+    }
+
+    for (flecs::entity_t entity_id : visible)
+    {
+        const flecs::entity entity(scene_g_world, entity_id);
+        const mesh *entity_mesh = entity.try_get<mesh>();
+        const bounds *entity_bounds = entity.try_get<bounds>();
+        const mesh_lod *entity_lod = entity.try_get<mesh_lod>();
+        if (!entity_mesh || !entity_bounds || !entity_lod || entity_mesh->index >= g_mesh_lods.size())
+        {
+            continue;
+        }
+
+        const mesh_lods &lods = g_mesh_lods[entity_mesh->index];
+        batch.entities.push_back(entity_id);
+        batch.meshes.push_back(entity_mesh->index);
+        batch.center_x.push_back(entity_bounds->world_sphere.x);
+        batch.center_y.push_back(entity_bounds->world_sphere.y);
+        batch.center_z.push_back(entity_bounds->world_sphere.z);
+        batch.radius.push_back(entity_bounds->world_sphere.w);
+        batch.scale.push_back(lods.radius > 0.0f ? entity_bounds->world_sphere.w / lods.radius : 1.0f);
+        batch.current.push_back(static_cast<int32_t>((std::min)(entity_lod->lod, lods.count - 1)));
+        for (uint32_t l = 0; l < scene_simp_max_lods; ++l)
+        {
+            batch.error[l].push_back(l < lods.count ? lods.error[l] : FLT_MAX);
+        }
+    }
+
+    const uint32_t count = static_cast<uint32_t>(batch.entities.size());
+    batch.selected.resize(count);
+
+    const float projection_scale = 0.5f * viewport_height * cam.mat_proj._22;
+    const float threshold = scene_lod_g_pixel_error;
+    job_parallel_for(count, g_batch_size, [&](uint32_t begin, uint32_t end) {
+        uint32_t done = begin;
+#if ASH_CPU_X86
+        done = select_sse(batch, begin, end, cam.position, projection_scale, threshold);
+#endif
+        select_scalar(batch, done, end, cam.position, projection_scale, threshold);
+    });
+
+    scene_lod_stats stats;
+    stats.instances = count;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const mesh_lods &lods = g_mesh_lods[batch.meshes[i]];
+        stats.triangles_before += lods.triangles[0];
+        stats.triangles_after += lods.triangles[batch.selected[i]];
+
+        if (batch.selected[i] != batch.current[i])
+        {
+            flecs::entity(scene_g_world, batch.entities[i]).get_mut<mesh_lod>().lod =
+                static_cast<uint32_t>(batch.selected[i]);
+        }
+    }
+    scene_lod_g_stats = stats;
+}
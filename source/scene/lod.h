@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <flecs.h>
+#include <scene/camera.h>
+#include <vector>
+
+namespace ash
+{
+// A LOD may only replace a finer one once its projected error is below (1 - hysteresis) of the pixel threshold, and
+// the current LOD is kept until its error exceeds (1 + hysteresis) of it, so instances near a boundary do not pop.
+constexpr float scene_lod_hysteresis = 0.25f;
+
+// Largest projected geometric error, in pixels, that a selected LOD may have.
+inline float scene_lod_g_pixel_error = 1.0f;
+
+struct scene_lod_stats
+{
+    uint32_t instances = 0;
+    uint64_t triangles_before = 0;
+    uint64_t triangles_after = 0;
+};
+
+inline scene_lod_stats scene_lod_g_stats;
+} // namespace ash
+
+namespace ash
+{
+void scene_lod_init();
+
+// Picks a LOD for every entity of `visible` that has a mesh, from the projected error of each LOD at the distance of
+// the entity's cached world bounding sphere, and stores it in the entity's mesh_lod. Instances are evaluated four at
+// a time on worker threads. Updates scene_lod_g_stats.
+void scene_lod_select(const std::vector<flecs::entity_t> &visible, const camera &cam, float viewport_height);
+} // namespace ash
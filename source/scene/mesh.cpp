@@ -0,0 +1,165 @@
+#include "mesh.h"
+#include "job/parallel.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <common.h>
+
+using namespace DirectX;
+
+namespace
+{
+void set_center_extents(const XMFLOAT3 &min, const XMFLOAT3 &max, XMFLOAT3 &center, XMFLOAT3 &extents)
+{
+    center = {(min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f};
+    extents = {(max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f};
+}
+} // namespace
+
+void ash::scene_mesh_compute_bounds(scene_mesh_arena &arena)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_mesh_compute_bounds")
+
+    job_parallel_for(static_cast<uint32_t>(arena.primitives.size()), 16, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            scene_mesh_primitive &primitive = arena.primitives[i];
+            if (primitive.vertex_count == 0)
+            {
+                primitive.center = {0.0f, 0.0f, 0.0f};
+                primitive.extents = {0.0f, 0.0f, 0.0f};
+                continue;
+            }
+
+            XMVECTOR min = XMVectorReplicate(FLT_MAX);
+            XMVECTOR max = XMVectorReplicate(-FLT_MAX);
+            const XMFLOAT3 *positions = arena.positions.data() + primitive.first_vertex;
+            for (uint32_t v = 0; v < primitive.vertex_count; ++v)
+            {
+                const XMVECTOR position = XMLoadFloat3(&positions[v]);
+                min = XMVectorMin(min, position);
+                max = XMVectorMax(max, position);
+            }
+
+            XMFLOAT3 min_f, max_f;
+            XMStoreFloat3(&min_f, min);
+            XMStoreFloat3(&max_f, max);
+            set_center_extents(min_f, max_f, primitive.center, primitive.extents);
+        }
+    });
+
+    for (scene_mesh &mesh : arena.meshes)
+    {
+        XMVECTOR min = XMVectorReplicate(FLT_MAX);
+        XMVECTOR max = XMVectorReplicate(-FLT_MAX);
+        for (uint32_t p = mesh.first_primitive; p < mesh.first_primitive + mesh.primitive_count; ++p)
+        {
+            const scene_mesh_primitive &primitive = arena.primitives[p];
+            const XMVECTOR center = XMLoadFloat3(&primitive.center);
+            const XMVECTOR extents = XMLoadFloat3(&primitive.extents);
+            min = XMVectorMin(min, XMVectorSubtract(center, extents));
+            max = XMVectorMax(max, XMVectorAdd(center, extents));
+        }
+
+        if (mesh.primitive_count == 0)
+        {
+            mesh.center = {0.0f, 0.0f, 0.0f};
+            mesh.extents = {0.0f, 0.0f, 0.0f};
+            continue;
+        }
+
+        XMFLOAT3 min_f, max_f;
+        XMStoreFloat3(&min_f, min);
+        XMStoreFloat3(&max_f, max);
+        set_center_extents(min_f, max_f, mesh.center, mesh.extents);
+    }
+}
+
+uint32_t ash::scene_mesh_append(scene_mesh_arena &arena, const scene_mesh_arena &source)
+{
+    assert(arena.positions.empty() || source.positions.empty() || arena.normals.empty() == source.normals.empty());
+    const uint32_t vertex_offset = static_cast<uint32_t>(arena.positions.size());
+    const uint32_t vertex_data_offset = static_cast<uint32_t>(arena.vertex_data.size());
+    const uint32_t index_offset = static_cast<uint32_t>(arena.indices.size());
+    const uint32_t lod_offset = static_cast<uint32_t>(arena.lods.size());
+    const uint32_t meshlet_offset = static_cast<uint32_t>(arena.meshlets.size());
+    const uint32_t meshlet_vertex_offset = static_cast<uint32_t>(arena.meshlet_vertices.size());
+    const uint32_t meshlet_triangle_offset = static_cast<uint32_t>(arena.meshlet_triangles.size() / 3);
+    const uint32_t bvh_node_offset = static_cast<uint32_t>(arena.bvh_nodes.size());
+    const uint32_t bvh_triangle_offset = static_cast<uint32_t>(arena.bvh_triangles.size());
+    const uint32_t primitive_offset = static_cast<uint32_t>(arena.primitives.size());
+    const uint32_t mesh_offset = static_cast<uint32_t>(arena.meshes.size());
+
+    arena.positions.insert(arena.positions.end(), source.positions.begin(), source.positions.end());
+    arena.normals.insert(arena.normals.end(), source.normals.begin(), source.normals.end());
+    arena.tangents.insert(arena.tangents.end(), source.tangents.begin(), source.tangents.end());
+    arena.uvs.insert(arena.uvs.end(), source.uvs.begin(), source.uvs.end());
+    arena.vertex_data.insert(arena.vertex_data.end(), source.vertex_data.begin(), source.vertex_data.end());
+    arena.indices.insert(arena.indices.end(), source.indices.begin(), source.indices.end());
+    arena.meshlet_vertices.insert(arena.meshlet_vertices.end(), source.meshlet_vertices.begin(),
+                                  source.meshlet_vertices.end());
+    arena.meshlet_triangles.insert(arena.meshlet_triangles.end(), source.meshlet_triangles.begin(),
+                                   source.meshlet_triangles.end());
+    arena.bvh_nodes.insert(arena.bvh_nodes.end(), source.bvh_nodes.begin(), source.bvh_nodes.end());
+    arena.bvh_triangles.insert(arena.bvh_triangles.end(), source.bvh_triangles.begin(), source.bvh_triangles.end());
+
+    arena.vertex_streams.reserve(arena.vertex_streams.size() + source.vertex_streams.size());
+    for (scene_vtx_stream stream : source.vertex_streams)
+    {
+        stream.first_vertex += vertex_offset;
+        stream.data_offset += vertex_data_offset;
+        arena.vertex_streams.push_back(stream);
+    }
+
+    arena.lods.reserve(arena.lods.size() + source.lods.size());
+    for (scene_mesh_lod lod : source.lods)
+    {
+        lod.first_index += index_offset;
+        arena.lods.push_back(lod);
+    }
+
+    arena.meshlets.reserve(arena.meshlets.size() + source.meshlets.size());
+    for (scene_mesh_meshlet meshlet : source.meshlets)
+    {
+        meshlet.first_vertex += meshlet_vertex_offset;
+        meshlet.first_triangle += meshlet_triangle_offset;
+        arena.meshlets.push_back(meshlet);
+    }
+
+    arena.primitives.reserve(arena.primitives.size() + source.primitives.size());
+    for (scene_mesh_primitive primitive : source.primitives)
+    {
+        primitive.first_vertex += vertex_offset;
+        primitive.first_index += index_offset;
+        primitive.first_lod += lod_offset;
+        primitive.first_meshlet += meshlet_offset;
+        primitive.first_bvh_node += bvh_node_offset;
+        primitive.first_bvh_triangle += bvh_triangle_offset;
+        arena.primitives.push_back(primitive);
+    }
+
+    arena.meshes.reserve(arena.meshes.size() + source.meshes.size());
+    for (scene_mesh mesh : source.meshes)
+    {
+        mesh.first_primitive += primitive_offset;
+        arena.meshes.push_back(mesh);
+    }
+
+    return mesh_offset;
+}
+
+std::size_t ash::scene_mesh_release_attributes(scene_mesh_arena &arena)
+{
+    const std::size_t bytes = arena.normals.capacity() * sizeof(XMFLOAT3) +
+                              arena.tangents.capacity() * sizeof(XMFLOAT4) + arena.uvs.capacity() * sizeof(XMFLOAT2);
+    // Assigning {} would keep the capacity, swapping with empty vectors frees it.
+    std::vector<XMFLOAT3>().swap(arena.normals);
+    std::vector<XMFLOAT4>().swap(arena.tangents);
+    std::vector<XMFLOAT2>().swap(arena.uvs);
+    return bytes;
+}
+
+void ash::scene_mesh_clear(scene_mesh_arena &arena)
+{
+    arena = {};
+}
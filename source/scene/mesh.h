@@ -0,0 +1,116 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <scene/vertex_format.h>
+#include <vector>
+
+namespace ash
+{
+// One triangle list. Indices are relative to first_vertex, so a primitive can be moved within the arena without
+// rewriting them. center/extents is the local-space AABB of its positions. The triangle BVH takes bvh_node_count
+// nodes from first_bvh_node and one bvh_triangles slot per triangle from first_bvh_triangle.
+struct scene_mesh_primitive
+{
+    uint32_t first_vertex = 0;
+    uint32_t vertex_count = 0;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    uint32_t first_meshlet = 0;
+    uint32_t meshlet_count = 0;
+    uint32_t first_lod = 0;
+    uint32_t lod_count = 0;
+    uint32_t first_bvh_node = 0;
+    uint32_t bvh_node_count = 0;
+    uint32_t first_bvh_triangle = 0;
+    DirectX::XMFLOAT3 center = {0.0f, 0.0f, 0.0f};
+    DirectX::XMFLOAT3 extents = {0.0f, 0.0f, 0.0f};
+};
+
+// A cluster of at most scene_mlet_max_vertices vertices and scene_mlet_max_triangles triangles of one primitive.
+// meshlet_vertices[first_vertex..] holds primitive-relative vertex indices; meshlet_triangles[first_triangle * 3..]
+// holds three meshlet-relative bytes per triangle. The sphere bounds the meshlet; the cone bounds its triangle
+// normals and lets a whole meshlet be rejected when every triangle faces away from the camera.
+struct scene_mesh_meshlet
+{
+    uint32_t first_vertex = 0;
+    uint32_t first_triangle = 0;
+    uint32_t vertex_count = 0;
+    uint32_t triangle_count = 0;
+    DirectX::XMFLOAT4 sphere = {0.0f, 0.0f, 0.0f, 0.0f};
+    DirectX::XMFLOAT3 cone_axis = {0.0f, 0.0f, 1.0f};
+    float cone_cutoff = 1.0f;
+};
+
+// Node of a primitive's triangle BVH, in the primitive's local space. Node and triangle references are relative to
+// the primitive's first_bvh_node and first_bvh_triangle; the root is node 0 and children always follow their parent.
+// bvh_triangles holds primitive-relative triangle numbers, triangle t being indices[first_index + t * 3..].
+struct scene_mesh_bvh_node
+{
+    DirectX::XMFLOAT3 min = {0.0f, 0.0f, 0.0f};
+    uint32_t first = 0; // leaf: first bvh_triangles slot, interior: left child (right child is first + 1)
+    DirectX::XMFLOAT3 max = {0.0f, 0.0f, 0.0f};
+    uint32_t count = 0; // leaf: triangle count, interior: 0
+};
+
+// One level of detail of a primitive: an index list into the primitive's vertices, stored in arena.indices. LOD 0 is
+// the primitive's own index range. error is the object-space distance by which the LOD deviates from LOD 0 and never
+// decreases along the chain.
+struct scene_mesh_lod
+{
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    float error = 0.0f;
+};
+
+// A glTF mesh: a contiguous run of primitives and the AABB enclosing all of them.
+struct scene_mesh
+{
+    uint32_t first_primitive = 0;
+    uint32_t primitive_count = 0;
+    DirectX::XMFLOAT3 center = {0.0f, 0.0f, 0.0f};
+    DirectX::XMFLOAT3 extents = {0.0f, 0.0f, 0.0f};
+};
+
+// Packed CPU-side geometry. Vertex attributes are stored as parallel arrays indexed by vertex; attributes missing
+// from the source are zero-filled so every array has the same length. A tangent's w is its bitangent sign, ±1, and 0
+// when the source had no tangent and none has been generated yet. vertex_data holds the same vertices packed for
+// the GPU, one run per mesh described by vertex_streams[mesh]. Once packed, normals, tangents and uvs are released
+// and left empty; positions stay for bounds, the triangle BVH and picking.
+struct scene_mesh_arena
+{
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<DirectX::XMFLOAT3> normals;
+    std::vector<DirectX::XMFLOAT4> tangents;
+    std::vector<DirectX::XMFLOAT2> uvs;
+    std::vector<uint8_t> vertex_data;
+    std::vector<scene_vtx_stream> vertex_streams;
+    std::vector<uint32_t> indices;
+    std::vector<scene_mesh_lod> lods;
+    std::vector<scene_mesh_meshlet> meshlets;
+    std::vector<uint32_t> meshlet_vertices;
+    std::vector<uint8_t> meshlet_triangles;
+    std::vector<scene_mesh_bvh_node> bvh_nodes;
+    std::vector<uint32_t> bvh_triangles;
+    std::vector<scene_mesh_primitive> primitives;
+    std::vector<scene_mesh> meshes;
+};
+
+inline scene_mesh_arena scene_mesh_g_arena;
+} // namespace ash
+
+namespace ash
+{
+// Computes the AABB of every primitive from its positions, then of every mesh from its primitives.
+void scene_mesh_compute_bounds(scene_mesh_arena &arena);
+
+// Appends all of `source` to `arena` and returns the index in arena.meshes of source's first mesh.
+// Both arenas must agree on whether their vertex attributes have been released.
+uint32_t scene_mesh_append(scene_mesh_arena &arena, const scene_mesh_arena &source);
+
+// Frees the float normals, tangents and uvs of an arena whose vertex_data holds them packed, and returns the number
+// of bytes released. Passes that read those streams, scene_vtx_quantize included, must run before.
+std::size_t scene_mesh_release_attributes(scene_mesh_arena &arena);
+
+void scene_mesh_clear(scene_mesh_arena &arena);
+} // namespace ash
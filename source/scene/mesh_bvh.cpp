@@ -0,0 +1,510 @@
+#include "mesh_bvh.h"
+#include "job/parallel.h"
+#include <algorithm>
+#include <common.h>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_leaf_size = 4;
+constexpr uint32_t g_max_leaf_size = 8;
+constexpr uint32_t g_bin_count = 12;
+// Subtrees of at most this many triangles are split off the top of a large primitive and built as separate jobs.
+constexpr uint32_t g_subtree_size = 64 * 1024;
+
+struct build_task
+{
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+    uint32_t depth;
+};
+
+struct aabb
+{
+    XMFLOAT3 min = {FLT_MAX, FLT_MAX, FLT_MAX};
+    XMFLOAT3 max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+};
+
+// Per-triangle bounds of one primitive and the triangle order being partitioned. Centroids are kept doubled
+// (min + max) since only their relative positions matter.
+struct build_input
+{
+    std::vector<XMFLOAT3> min;
+    std::vector<XMFLOAT3> max;
+    std::vector<XMFLOAT3> centroid;
+    std::vector<uint32_t> triangles;
+};
+
+struct subtree
+{
+    build_task task;
+    std::vector<ash::scene_mesh_bvh_node> nodes;
+};
+
+void grow(aabb &box, const XMFLOAT3 &min, const XMFLOAT3 &max)
+{
+    box.min = {std::min(box.min.x, min.x), std::min(box.min.y, min.y), std::min(box.min.z, min.z)};
+    box.max = {std::max(box.max.x, max.x), std::max(box.max.y, max.y), std::max(box.max.z, max.z)};
+}
+
+float surface_area(const aabb &box)
+{
+    if (box.max.x < box.min.x || box.max.y < box.min.y || box.max.z < box.min.z)
+    {
+        return 0.0f;
+    }
+
+    const float dx = box.max.x - box.min.x;
+    const float dy = box.max.y - box.min.y;
+    const float dz = box.max.z - box.min.z;
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+float get_axis(const XMFLOAT3 &v, uint32_t axis)
+{
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+void prepare_input(const ash::scene_mesh_arena &arena, const ash::scene_mesh_primitive &primitive,
+                   build_input &input)
+{
+    const uint32_t *indices = arena.indices.data() + primitive.first_index;
+    const XMFLOAT3 *positions = arena.positions.data() + primitive.first_vertex;
+    const uint32_t triangle_count = primitive.index_count / 3;
+
+    input.min.resize(triangle_count);
+    input.max.resize(triangle_count);
+    input.centroid.resize(triangle_count);
+    input.triangles.resize(triangle_count);
+    ash::job_parallel_for(triangle_count, g_subtree_size, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t t = begin; t < end; ++t)
+        {
+            const XMVECTOR a = XMLoadFloat3(&positions[indices[t * 3 + 0]]);
+            const XMVECTOR b = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+            const XMVECTOR c = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+            const XMVECTOR min = XMVectorMin(a, XMVectorMin(b, c));
+            const XMVECTOR max = XMVectorMax(a, XMVectorMax(b, c));
+            XMStoreFloat3(&input.min[t], min);
+            XMStoreFloat3(&input.max[t], max);
+            XMStoreFloat3(&input.centroid[t], XMVectorAdd(min, max));
+            input.triangles[t] = t;
+        }
+    });
+}
+
+void make_leaf(ash::scene_mesh_bvh_node &node, const build_task &task)
+{
+    node.first = task.first;
+    node.count = task.count;
+}
+
+// Fits `node` to its triangles and picks a binned SAH split along the longest centroid axis. Returns false when the
+// task should stay a leaf, otherwise partitions input.triangles and returns the first triangle slot of the right half.
+bool split_task(build_input &input, ash::scene_mesh_bvh_node &node, const build_task &task, uint32_t &mid)
+{
+    aabb bounds;
+    aabb centroid_bounds;
+    for (uint32_t i = task.first; i < task.first + task.count; ++i)
+    {
+        const uint32_t t = input.triangles[i];
+        grow(bounds, input.min[t], input.max[t]);
+        grow(centroid_bounds, input.centroid[t], input.centroid[t]);
+    }
+    node.min = bounds.min;
+    node.max = bounds.max;
+
+    if (task.count <= g_leaf_size || task.depth + 1 >= ash::scene_mbvh_max_depth)
+    {
+        return false;
+    }
+
+    const XMFLOAT3 extent = {centroid_bounds.max.x - centroid_bounds.min.x,
+                             centroid_bounds.max.y - centroid_bounds.min.y,
+                             centroid_bounds.max.z - centroid_bounds.min.z};
+    const uint32_t axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+    const float axis_min = get_axis(centroid_bounds.min, axis);
+    const float axis_extent = get_axis(extent, axis);
+
+    uint32_t *begin = input.triangles.data() + task.first;
+    mid = task.first + task.count / 2;
+    if (axis_extent <= 0.0f)
+    {
+        return task.count > g_max_leaf_size;
+    }
+
+    const float bin_scale = g_bin_count / axis_extent;
+    auto bin_of = [&](uint32_t t) {
+        const uint32_t bin = static_cast<uint32_t>((get_axis(input.centroid[t], axis) - axis_min) * bin_scale);
+        return std::min(bin, g_bin_count - 1);
+    };
+
+    aabb bin_bounds[g_bin_count];
+    uint32_t bin_counts[g_bin_count] = {};
+    for (uint32_t i = task.first; i < task.first + task.count; ++i)
+    {
+        const uint32_t t = input.triangles[i];
+        const uint32_t bin = bin_of(t);
+        bin_counts[bin]++;
+        grow(bin_bounds[bin], input.min[t], input.max[t]);
+    }
+
+    float right_area[g_bin_count] = {};
+    uint32_t right_count[g_bin_count] = {};
+    aabb accumulated;
+    uint32_t accumulated_count = 0;
+    for (uint32_t b = g_bin_count - 1; b > 0; --b)
+    {
+        grow(accumulated, bin_bounds[b].min, bin_bounds[b].max);
+        accumulated_count += bin_counts[b];
+        right_area[b] = surface_area(accumulated);
+        right_count[b] = accumulated_count;
+    }
+
+    float best_cost = FLT_MAX;
+    uint32_t best_split = 0;
+    accumulated = {};
+    accumulated_count = 0;
+    for (uint32_t b = 0; b < g_bin_count - 1; ++b)
+    {
+        grow(accumulated, bin_bounds[b].min, bin_bounds[b].max);
+        accumulated_count += bin_counts[b];
+        const float cost = surface_area(accumulated) * accumulated_count + right_area[b + 1] * right_count[b + 1];
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best_split = b;
+        }
+    }
+
+    if (best_cost >= surface_area(bounds) * task.count && task.count <= g_max_leaf_size)
+    {
+        return false;
+    }
+
+    uint32_t *split = std::partition(begin, begin + task.count, [&](uint32_t t) { return bin_of(t) <= best_split; });
+    mid = static_cast<uint32_t>(split - input.triangles.data());
+    if (mid == task.first || mid == task.first + task.count)
+    {
+        // All centroids fell on one side of every bin boundary; any order is as good as another.
+        mid = task.first + task.count / 2;
+    }
+    return true;
+}
+
+// Builds the subtree of `root` into `nodes`. With `deferred`, children of at most g_subtree_size triangles are not
+// built but handed back so they can be built concurrently.
+void build_nodes(build_input &input, std::vector<ash::scene_mesh_bvh_node> &nodes, const build_task &root,
+                 std::vector<build_task> *deferred)
+{
+    std::vector<build_task> stack;
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const build_task task = stack.back();
+        stack.pop_back();
+
+        uint32_t mid = 0;
+        if (!split_task(input, nodes[task.node], task, mid))
+        {
+            make_leaf(nodes[task.node], task);
+            continue;
+        }
+
+        const uint32_t left = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({});
+        nodes.push_back({});
+        nodes[task.node].first = left;
+        nodes[task.node].count = 0;
+
+        const build_task children[2] = {{left, task.first, mid - task.first, task.depth + 1},
+                                        {left + 1, mid, task.first + task.count - mid, task.depth + 1}};
+        for (const build_task &child : children)
+        {
+            if (deferred && child.count <= g_subtree_size)
+            {
+                deferred->push_back(child);
+            }
+            else
+            {
+                stack.push_back(child);
+            }
+        }
+    }
+}
+
+std::vector<ash::scene_mesh_bvh_node> build_primitive(const ash::scene_mesh_arena &arena,
+                                                      const ash::scene_mesh_primitive &primitive,
+                                                      std::vector<uint32_t> &triangles)
+{
+    std::vector<ash::scene_mesh_bvh_node> nodes;
+    const uint32_t triangle_count = primitive.index_count / 3;
+    if (triangle_count == 0)
+    {
+        triangles.clear();
+        return nodes;
+    }
+
+    build_input input;
+    prepare_input(arena, primitive, input);
+
+    // The top of the tree is split serially until the pieces are small enough, then each piece is built as its own
+    // tree with its root at index 0 and stitched in place of the child slot it came from.
+    std::vector<build_task> deferred;
+    nodes.push_back({});
+    build_nodes(input, nodes, {0, 0, triangle_count, 0}, triangle_count > g_subtree_size ? &deferred : nullptr);
+
+    std::vector<subtree> subtrees(deferred.size());
+    ash::job_parallel_for(static_cast<uint32_t>(deferred.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t s = begin; s < end; ++s)
+        {
+            subtrees[s].task = deferred[s];
+            subtrees[s].nodes.push_back({});
+            build_nodes(input, subtrees[s].nodes, {0, deferred[s].first, deferred[s].count, deferred[s].depth},
+                        nullptr);
+        }
+    });
+
+    for (const subtree &piece : subtrees)
+    {
+        const uint32_t base = static_cast<uint32_t>(nodes.size());
+        const auto remap = [&](uint32_t index) { return index == 0 ? piece.task.node : base + index - 1; };
+        for (uint32_t n = 0; n < piece.nodes.size(); ++n)
+        {
+            ash::scene_mesh_bvh_node node = piece.nodes[n];
+            node.first = node.count == 0 ? remap(node.first) : node.first;
+            if (n == 0)
+            {
+                nodes[piece.task.node] = node;
+            }
+            else
+            {
+                nodes.push_back(node);
+            }
+        }
+    }
+
+    triangles = std::move(input.triangles);
+    return nodes;
+}
+
+bool intersect_box(const ash::scene_mesh_bvh_node &node, const XMFLOAT3 &origin, const XMFLOAT3 &inv_direction,
+                   float max_distance, float &entry)
+{
+    const float tx1 = (node.min.x - origin.x) * inv_direction.x, tx2 = (node.max.x - origin.x) * inv_direction.x;
+    const float ty1 = (node.min.y - origin.y) * inv_direction.y, ty2 = (node.max.y - origin.y) * inv_direction.y;
+    const float tz1 = (node.min.z - origin.z) * inv_direction.z, tz2 = (node.max.z - origin.z) * inv_direction.z;
+
+    const float t_near = std::max({std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f});
+    const float t_far = std::min({std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), max_distance});
+    entry = t_near;
+    return t_near <= t_far;
+}
+
+// Möller-Trumbore, accepting both windings.
+bool intersect_triangle(const XMFLOAT3 &a, const XMFLOAT3 &b, const XMFLOAT3 &c, const XMFLOAT3 &origin,
+                        const XMFLOAT3 &direction, float &distance)
+{
+    const XMFLOAT3 e1 = {b.x - a.x, b.y - a.y, b.z - a.z};
+    const XMFLOAT3 e2 = {c.x - a.x, c.y - a.y, c.z - a.z};
+    const XMFLOAT3 p = {direction.y * e2.z - direction.z * e2.y, direction.z * e2.x - direction.x * e2.z,
+                        direction.x * e2.y - direction.y * e2.x};
+    const float determinant = e1.x * p.x + e1.y * p.y + e1.z * p.z;
+    if (determinant == 0.0f)
+    {
+        return false;
+    }
+
+    const float inv_determinant = 1.0f / determinant;
+    const XMFLOAT3 s = {origin.x - a.x, origin.y - a.y, origin.z - a.z};
+    const float u = (s.x * p.x + s.y * p.y + s.z * p.z) * inv_determinant;
+    if (u < 0.0f || u > 1.0f)
+    {
+        return false;
+    }
+
+    const XMFLOAT3 q = {s.y * e1.z - s.z * e1.y, s.z * e1.x - s.x * e1.z, s.x * e1.y - s.y * e1.x};
+    const float v = (direction.x * q.x + direction.y * q.y + direction.z * q.z) * inv_determinant;
+    if (v < 0.0f || u + v > 1.0f)
+    {
+        return false;
+    }
+
+    const float t = (e2.x * q.x + e2.y * q.y + e2.z * q.z) * inv_determinant;
+    if (t < 0.0f || t >= distance)
+    {
+        return false;
+    }
+    distance = t;
+    return true;
+}
+
+// Ordered traversal: the nearer child is visited first and the farther one only if it still starts before the
+// closest hit so far. Each level pushes at most one node, so the stack never exceeds the tree depth.
+bool intersect_primitive(const ash::scene_mesh_arena &arena, uint32_t primitive_index, const XMFLOAT3 &origin,
+                         const XMFLOAT3 &direction, const XMFLOAT3 &inv_direction, ash::scene_mbvh_hit &hit)
+{
+    const ash::scene_mesh_primitive &primitive = arena.primitives[primitive_index];
+    if (primitive.bvh_node_count == 0)
+    {
+        return false;
+    }
+
+    const ash::scene_mesh_bvh_node *nodes = arena.bvh_nodes.data() + primitive.first_bvh_node;
+    const uint32_t *triangles = arena.bvh_triangles.data() + primitive.first_bvh_triangle;
+    const uint32_t *indices = arena.indices.data() + primitive.first_index;
+    const XMFLOAT3 *positions = arena.positions.data() + primitive.first_vertex;
+
+    float entry = 0.0f;
+    if (!intersect_box(nodes[0], origin, inv_direction, hit.distance, entry))
+    {
+        return false;
+    }
+
+    struct stack_entry
+    {
+        uint32_t node;
+        float entry;
+    };
+    stack_entry stack[ash::scene_mbvh_max_depth];
+    uint32_t stack_size = 0;
+    stack[stack_size++] = {0, entry};
+
+    bool found = false;
+    while (stack_size > 0)
+    {
+        const stack_entry current = stack[--stack_size];
+        if (current.entry > hit.distance)
+        {
+            continue;
+        }
+
+        const ash::scene_mesh_bvh_node &node = nodes[current.node];
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                const uint32_t *triangle = indices + std::size_t(triangles[i]) * 3;
+                if (intersect_triangle(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]], origin,
+                                       direction, hit.distance))
+                {
+                    hit.primitive = primitive_index;
+                    hit.triangle = triangles[i];
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        float left_entry = 0.0f;
+        float right_entry = 0.0f;
+        const bool left = intersect_box(nodes[node.first], origin, inv_direction, hit.distance, left_entry);
+        const bool right = intersect_box(nodes[node.first + 1], origin, inv_direction, hit.distance, right_entry);
+        if (left && right)
+        {
+            const bool left_first = left_entry <= right_entry;
+            stack[stack_size++] = {left_first ? node.first + 1 : node.first, left_first ? right_entry : left_entry};
+            stack[stack_size++] = {left_first ? node.first : node.first + 1, left_first ? left_entry : right_entry};
+        }
+        else if (left || right)
+        {
+            stack[stack_size++] = {left ? node.first : node.first + 1, left ? left_entry : right_entry};
+        }
+    }
+    return found;
+}
+} // namespace
+
+void ash::scene_mbvh_build(scene_mesh_arena &arena)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_mbvh_build")
+
+    std::vector<std::vector<scene_mesh_bvh_node>> built(arena.primitives.size());
+    std::vector<std::vector<uint32_t>> triangles(arena.primitives.size());
+    job_parallel_for(static_cast<uint32_t>(arena.primitives.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t p = begin; p < end; ++p)
+        {
+            built[p] = build_primitive(arena, arena.primitives[p], triangles[p]);
+        }
+    });
+
+    arena.bvh_nodes.clear();
+    arena.bvh_triangles.clear();
+    for (std::size_t p = 0; p < built.size(); ++p)
+    {
+        scene_mesh_primitive &primitive = arena.primitives[p];
+        primitive.first_bvh_node = static_cast<uint32_t>(arena.bvh_nodes.size());
+        primitive.bvh_node_count = static_cast<uint32_t>(built[p].size());
+        primitive.first_bvh_triangle = static_cast<uint32_t>(arena.bvh_triangles.size());
+        arena.bvh_nodes.insert(arena.bvh_nodes.end(), built[p].begin(), built[p].end());
+        arena.bvh_triangles.insert(arena.bvh_triangles.end(), triangles[p].begin(), triangles[p].end());
+    }
+}
+
+bool ash::scene_mbvh_validate(const scene_mesh_arena &arena)
+{
+    std::vector<uint32_t> depths;
+    for (const scene_mesh_primitive &primitive : arena.primitives)
+    {
+        const uint32_t triangle_count = primitive.index_count / 3;
+        if ((primitive.bvh_node_count == 0) != (triangle_count == 0) ||
+            uint64_t(primitive.first_bvh_node) + primitive.bvh_node_count > arena.bvh_nodes.size() ||
+            uint64_t(primitive.first_bvh_triangle) + triangle_count > arena.bvh_triangles.size())
+        {
+            return false;
+        }
+
+        const uint32_t *triangles = arena.bvh_triangles.data() + primitive.first_bvh_triangle;
+        for (uint32_t i = 0; i < triangle_count; ++i)
+        {
+            if (triangles[i] >= triangle_count)
+            {
+                return false;
+            }
+        }
+
+        // Children always follow their parent, so one forward pass sees every parent before its children.
+        const scene_mesh_bvh_node *nodes = arena.bvh_nodes.data() + primitive.first_bvh_node;
+        depths.assign(primitive.bvh_node_count, 0);
+        for (uint32_t n = 0; n < primitive.bvh_node_count; ++n)
+        {
+            const scene_mesh_bvh_node &node = nodes[n];
+            if (node.count > 0)
+            {
+                if (uint64_t(node.first) + node.count > triangle_count)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            if (node.first <= n || uint64_t(node.first) + 1 >= primitive.bvh_node_count ||
+                depths[n] + 1 >= scene_mbvh_max_depth)
+            {
+                return false;
+            }
+            depths[node.first] = std::max(depths[node.first], depths[n] + 1);
+            depths[node.first + 1] = std::max(depths[node.first + 1], depths[n] + 1);
+        }
+    }
+    return true;
+}
+
+bool ash::scene_mbvh_intersect(const scene_mesh_arena &arena, uint32_t mesh_index, const XMFLOAT3 &origin,
+                               const XMFLOAT3 &direction, scene_mbvh_hit &hit)
+{
+    if (mesh_index >= arena.meshes.size())
+    {
+        return false;
+    }
+
+    const XMFLOAT3 inv_direction = {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+    const scene_mesh &mesh = arena.meshes[mesh_index];
+    bool found = false;
+    for (uint32_t p = mesh.first_primitive; p < mesh.first_primitive + mesh.primitive_count; ++p)
+    {
+        found |= intersect_primitive(arena, p, origin, direction, inv_direction, hit);
+    }
+    return found;
+}
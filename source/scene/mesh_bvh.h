@@ -0,0 +1,37 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cfloat>
+#include <cstdint>
+#include <scene/mesh.h>
+
+namespace ash
+{
+// Deepest root-to-leaf path of a triangle BVH, which bounds the traversal stack.
+constexpr uint32_t scene_mbvh_max_depth = 64;
+
+// Nearest triangle found by a ray query. distance is the ray parameter t of the hit, so it is in units of the
+// direction's length; primitive indexes arena.primitives and triangle is relative to that primitive.
+struct scene_mbvh_hit
+{
+    float distance = FLT_MAX;
+    uint32_t primitive = UINT32_MAX;
+    uint32_t triangle = UINT32_MAX;
+};
+} // namespace ash
+
+namespace ash
+{
+// Builds a binned-SAH BVH over the triangles of every primitive of `arena`, replacing any existing ones. Run after
+// the last pass that rewrites indices. Primitives are built in parallel, and the subtrees of large primitives too.
+void scene_mbvh_build(scene_mesh_arena &arena);
+
+// Checks that every primitive's BVH stays within its node and triangle ranges, is no deeper than
+// scene_mbvh_max_depth and only references the primitive's own triangles.
+bool scene_mbvh_validate(const scene_mesh_arena &arena);
+
+// Intersects a ray, in the local space of mesh `mesh_index`, with the mesh's triangles. Only hits closer than
+// hit.distance are considered; returns true and updates `hit` when one is found. Both faces of a triangle are hit.
+bool scene_mbvh_intersect(const scene_mesh_arena &arena, uint32_t mesh_index, const DirectX::XMFLOAT3 &origin,
+                          const DirectX::XMFLOAT3 &direction, scene_mbvh_hit &hit);
+} // namespace ash
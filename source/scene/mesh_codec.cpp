@@ -0,0 +1,591 @@
+#include "mesh_codec.h"
+#include "job/cpu.h"
+#include <algorithm>
+#include <cassert>
+#include <common.h>
+#include <cstring>
+
+#if ASH_CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+constexpr uint32_t g_plane_bytes[4] = {0, 4, 8, 16}; // payload of one 16-value plane at 0, 2, 4 and 8 bits
+constexpr uint32_t g_no_edge = 15;
+constexpr uint32_t g_edge_fifo_size = 15;
+constexpr uint32_t g_vertex_fifo_size = 14;
+constexpr uint32_t g_kind_next = 0;
+constexpr uint32_t g_kind_explicit = 15;
+constexpr uint32_t g_no_vertex = UINT32_MAX;
+
+uint16_t zigzag16(uint16_t delta)
+{
+    return static_cast<uint16_t>((delta << 1) ^ static_cast<uint16_t>(static_cast<int16_t>(delta) >> 15));
+}
+
+uint32_t plane_code(const uint8_t *values)
+{
+    const uint8_t max = *std::max_element(values, values + ash::scene_codec_block_size);
+    return max == 0 ? 0 : max < 4 ? 1 : max < 16 ? 2 : 3;
+}
+
+void pack_plane(uint32_t code, const uint8_t *values, std::vector<uint8_t> &out)
+{
+    const std::size_t begin = out.size();
+    out.resize(begin + g_plane_bytes[code], 0);
+    uint8_t *packed = out.data() + begin;
+    switch (code)
+    {
+    case 1:
+        for (uint32_t i = 0; i < ash::scene_codec_block_size; ++i)
+        {
+            packed[i / 4] |= static_cast<uint8_t>(values[i] << (2 * (i % 4)));
+        }
+        break;
+    case 2:
+        for (uint32_t i = 0; i < ash::scene_codec_block_size; ++i)
+        {
+            packed[i / 2] |= static_cast<uint8_t>(values[i] << (4 * (i % 2)));
+        }
+        break;
+    case 3:
+        std::memcpy(packed, values, ash::scene_codec_block_size);
+        break;
+    default:
+        break;
+    }
+}
+
+std::size_t block_header_size(std::size_t stride)
+{
+    return (stride + 3) / 4;
+}
+
+// Reads the code of byte plane `plane` and returns false if its payload does not fit before `end`.
+bool read_plane(const uint8_t *header, std::size_t plane, const uint8_t *&payload, const uint8_t *end,
+                uint32_t &code)
+{
+    code = (header[plane / 4] >> (2 * (plane % 4))) & 3u;
+    if (std::size_t(end - payload) < g_plane_bytes[code])
+    {
+        return false;
+    }
+    return true;
+}
+
+#if ASH_CPU_X86
+__m128i unpack_plane(uint32_t code, const uint8_t *packed)
+{
+    switch (code)
+    {
+    case 1: {
+        int32_t bits;
+        std::memcpy(&bits, packed, sizeof(bits));
+        // Replicate every source byte four times, then keep the 2-bit field that belongs to each lane.
+        __m128i x = _mm_cvtsi32_si128(bits);
+        x = _mm_unpacklo_epi8(x, x);
+        x = _mm_unpacklo_epi16(x, x);
+        const __m128i mask = _mm_set1_epi8(3);
+        __m128i values = _mm_and_si128(_mm_and_si128(x, mask), _mm_set1_epi32(0x000000ff));
+        values = _mm_or_si128(values, _mm_and_si128(_mm_and_si128(_mm_srli_epi16(x, 2), mask), _mm_set1_epi32(0xff00)));
+        values = _mm_or_si128(values,
+                              _mm_and_si128(_mm_and_si128(_mm_srli_epi16(x, 4), mask), _mm_set1_epi32(0xff0000)));
+        return _mm_or_si128(values, _mm_and_si128(_mm_and_si128(_mm_srli_epi16(x, 6), mask),
+                                                  _mm_set1_epi32(static_cast<int32_t>(0xff000000))));
+    }
+    case 2: {
+        const __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(packed));
+        const __m128i mask = _mm_set1_epi8(15);
+        return _mm_unpacklo_epi8(_mm_and_si128(x, mask), _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+    }
+    case 3:
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed));
+    default:
+        return _mm_setzero_si128();
+    }
+}
+
+// Undoes zigzag and delta coding for eight consecutive records of one word lane. `previous` holds the word of the
+// record before them in every lane.
+__m128i decode_words(__m128i zigzag, __m128i previous)
+{
+    const __m128i sign = _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(zigzag, _mm_set1_epi16(1)));
+    __m128i words = _mm_xor_si128(_mm_srli_epi16(zigzag, 1), sign);
+    words = _mm_add_epi16(words, _mm_slli_si128(words, 2));
+    words = _mm_add_epi16(words, _mm_slli_si128(words, 4));
+    words = _mm_add_epi16(words, _mm_slli_si128(words, 8));
+    return _mm_add_epi16(words, previous);
+}
+
+__m128i broadcast_last_word(__m128i words)
+{
+    const __m128i high = _mm_shufflehi_epi16(words, 0xff);
+    return _mm_unpackhi_epi64(high, high);
+}
+
+// Transposes eight word lanes of eight records into eight records of eight words.
+void transpose_words(__m128i rows[8])
+{
+    const __m128i a0 = _mm_unpacklo_epi16(rows[0], rows[1]);
+    const __m128i a1 = _mm_unpackhi_epi16(rows[0], rows[1]);
+    const __m128i a2 = _mm_unpacklo_epi16(rows[2], rows[3]);
+    const __m128i a3 = _mm_unpackhi_epi16(rows[2], rows[3]);
+    const __m128i a4 = _mm_unpacklo_epi16(rows[4], rows[5]);
+    const __m128i a5 = _mm_unpackhi_epi16(rows[4], rows[5]);
+    const __m128i a6 = _mm_unpacklo_epi16(rows[6], rows[7]);
+    const __m128i a7 = _mm_unpackhi_epi16(rows[6], rows[7]);
+    const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+    rows[0] = _mm_unpacklo_epi64(b0, b4);
+    rows[1] = _mm_unpackhi_epi64(b0, b4);
+    rows[2] = _mm_unpacklo_epi64(b1, b5);
+    rows[3] = _mm_unpackhi_epi64(b1, b5);
+    rows[4] = _mm_unpacklo_epi64(b2, b6);
+    rows[5] = _mm_unpackhi_epi64(b2, b6);
+    rows[6] = _mm_unpacklo_epi64(b3, b7);
+    rows[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+// Writes `count` records of a block from its decoded word lanes, eight lanes at a time.
+void store_records(const __m128i (*lanes)[2], std::size_t word_count, std::size_t count, std::size_t stride,
+                   uint8_t *target)
+{
+    for (std::size_t group = 0; group < word_count; group += 8)
+    {
+        const std::size_t group_words = (std::min)(word_count - group, std::size_t(8));
+        for (std::size_t half = 0; half < 2; ++half)
+        {
+            __m128i rows[8];
+            for (std::size_t k = 0; k < 8; ++k)
+            {
+                rows[k] = k < group_words ? lanes[group + k][half] : _mm_setzero_si128();
+            }
+            transpose_words(rows);
+
+            for (std::size_t j = 0; j < 8 && half * 8 + j < count; ++j)
+            {
+                uint8_t *record = target + (half * 8 + j) * stride + group * 2;
+                if (group_words == 8)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(record), rows[j]);
+                }
+                else
+                {
+                    alignas(16) uint8_t words[16];
+                    _mm_store_si128(reinterpret_cast<__m128i *>(words), rows[j]);
+                    std::memcpy(record, words, group_words * 2);
+                }
+            }
+        }
+    }
+}
+#else
+uint16_t unzigzag16(uint16_t value)
+{
+    return static_cast<uint16_t>((value >> 1) ^ (0u - (value & 1u)));
+}
+
+void unpack_plane(uint32_t code, const uint8_t *packed, uint8_t *values)
+{
+    for (uint32_t i = 0; i < ash::scene_codec_block_size; ++i)
+    {
+        switch (code)
+        {
+        case 1:
+            values[i] = (packed[i / 4] >> (2 * (i % 4))) & 3u;
+            break;
+        case 2:
+            values[i] = (packed[i / 2] >> (4 * (i % 2))) & 15u;
+            break;
+        case 3:
+            values[i] = packed[i];
+            break;
+        default:
+            values[i] = 0;
+            break;
+        }
+    }
+}
+#endif
+
+void write_varint(uint32_t value, std::vector<uint8_t> &out)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool read_varint(const uint8_t *&data, const uint8_t *end, uint32_t &value)
+{
+    value = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7)
+    {
+        if (data == end)
+        {
+            return false;
+        }
+        const uint8_t byte = *data++;
+        value |= uint32_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Edge and vertex FIFOs shared by the index encoder and decoder, which must update them identically. Slot 0 is the
+// most recent entry.
+struct index_state
+{
+    uint32_t edges[16][2];
+    uint32_t vertices[16];
+    uint32_t edge_head = 0;
+    uint32_t vertex_head = 0;
+    uint32_t next = 0;
+    uint32_t last = 0;
+
+    index_state()
+    {
+        std::fill(&edges[0][0], &edges[0][0] + 32, g_no_vertex);
+        std::fill(vertices, vertices + 16, g_no_vertex);
+    }
+
+    const uint32_t *edge(uint32_t slot) const { return edges[(edge_head + 15 - slot) & 15]; }
+    uint32_t vertex(uint32_t slot) const { return vertices[(vertex_head + 15 - slot) & 15]; }
+
+    void push_edge(uint32_t a, uint32_t b)
+    {
+        edges[edge_head][0] = a;
+        edges[edge_head][1] = b;
+        edge_head = (edge_head + 1) & 15;
+    }
+
+    uint32_t find_vertex(uint32_t v) const
+    {
+        for (uint32_t slot = 0; slot < g_vertex_fifo_size; ++slot)
+        {
+            if (vertex(slot) == v)
+            {
+                return slot;
+            }
+        }
+        return g_no_vertex;
+    }
+
+    void push_vertex(uint32_t v)
+    {
+        if (find_vertex(v) == g_no_vertex)
+        {
+            vertices[vertex_head] = v;
+            vertex_head = (vertex_head + 1) & 15;
+        }
+    }
+
+    void use(uint32_t v) { next = (std::max)(next, v + 1); }
+};
+
+// Returns the 4-bit kind of `v` and queues the explicit delta in `deltas` if it needs one.
+uint32_t encode_vertex(index_state &state, uint32_t v, std::vector<uint8_t> &deltas)
+{
+    uint32_t kind = g_kind_explicit;
+    if (v == state.next)
+    {
+        kind = g_kind_next;
+    }
+    else if (const uint32_t slot = state.find_vertex(v); slot != g_no_vertex)
+    {
+        kind = slot + 1;
+    }
+    else
+    {
+        const int32_t delta = static_cast<int32_t>(v - state.last);
+        write_varint(static_cast<uint32_t>((delta << 1) ^ (delta >> 31)), deltas);
+        state.last = v;
+    }
+    state.use(v);
+    return kind;
+}
+
+bool decode_vertex(index_state &state, uint32_t kind, const uint8_t *&data, const uint8_t *end, uint32_t &v)
+{
+    if (kind == g_kind_next)
+    {
+        v = state.next;
+    }
+    else if (kind == g_kind_explicit)
+    {
+        uint32_t zigzag;
+        if (!read_varint(data, end, zigzag))
+        {
+            return false;
+        }
+        v = state.last + ((zigzag >> 1) ^ (0u - (zigzag & 1u)));
+        state.last = v;
+    }
+    else
+    {
+        v = state.vertex(kind - 1);
+        if (v == g_no_vertex)
+        {
+            return false;
+        }
+    }
+    state.use(v);
+    return true;
+}
+} // namespace
+
+void ash::scene_codec_encode_vertices(const void *vertices, std::size_t vertex_count, std::size_t stride,
+                                      std::vector<uint8_t> &out)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_codec_encode_vertices")
+
+    assert(stride % 2 == 0 && stride > 0 && stride <= scene_codec_max_stride);
+    const std::size_t word_count = stride / 2;
+    const uint8_t *source = static_cast<const uint8_t *>(vertices);
+
+    uint16_t previous[scene_codec_max_stride / 2] = {};
+    uint8_t planes[scene_codec_max_stride][scene_codec_block_size];
+    for (std::size_t first = 0; first < vertex_count; first += scene_codec_block_size)
+    {
+        const std::size_t count = (std::min)(vertex_count - first, std::size_t(scene_codec_block_size));
+        std::memset(planes, 0, sizeof(planes));
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            for (std::size_t w = 0; w < word_count; ++w)
+            {
+                uint16_t word;
+                std::memcpy(&word, source + (first + i) * stride + w * 2, sizeof(word));
+                const uint16_t zigzag = zigzag16(static_cast<uint16_t>(word - previous[w]));
+                planes[w * 2][i] = static_cast<uint8_t>(zigzag);
+                planes[w * 2 + 1][i] = static_cast<uint8_t>(zigzag >> 8);
+                previous[w] = word;
+            }
+        }
+
+        const std::size_t header = out.size();
+        out.resize(header + block_header_size(stride), 0);
+        for (std::size_t plane = 0; plane < stride; ++plane)
+        {
+            const uint32_t code = plane_code(planes[plane]);
+            out[header + plane / 4] |= static_cast<uint8_t>(code << (2 * (plane % 4)));
+            pack_plane(code, planes[plane], out);
+        }
+    }
+}
+
+bool ash::scene_codec_decode_vertices(void *vertices, std::size_t vertex_count, std::size_t stride,
+                                      const uint8_t *data, std::size_t size)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_codec_decode_vertices")
+
+    if (stride % 2 != 0 || stride == 0 || stride > scene_codec_max_stride)
+    {
+        return false;
+    }
+
+    const std::size_t word_count = stride / 2;
+    const uint8_t *end = data + size;
+    uint8_t *target = static_cast<uint8_t *>(vertices);
+
+#if ASH_CPU_X86
+    // Blocks are zero-padded, so the last word of a block is also the last record's.
+    __m128i previous[scene_codec_max_stride / 2];
+    std::fill(previous, previous + word_count, _mm_setzero_si128());
+    __m128i lanes[scene_codec_max_stride / 2][2];
+#else
+    uint16_t previous[scene_codec_max_stride / 2] = {};
+    uint16_t lanes[scene_codec_max_stride / 2][scene_codec_block_size];
+#endif
+    for (std::size_t first = 0; first < vertex_count; first += scene_codec_block_size)
+    {
+        const std::size_t count = (std::min)(vertex_count - first, std::size_t(scene_codec_block_size));
+        if (std::size_t(end - data) < block_header_size(stride))
+        {
+            return false;
+        }
+        const uint8_t *header = data;
+        data += block_header_size(stride);
+
+        for (std::size_t w = 0; w < word_count; ++w)
+        {
+            uint32_t low_code, high_code;
+            if (!read_plane(header, w * 2, data, end, low_code))
+            {
+                return false;
+            }
+            const uint8_t *low = data;
+            data += g_plane_bytes[low_code];
+            if (!read_plane(header, w * 2 + 1, data, end, high_code))
+            {
+                return false;
+            }
+            const uint8_t *high = data;
+            data += g_plane_bytes[high_code];
+
+#if ASH_CPU_X86
+            const __m128i low_bytes = unpack_plane(low_code, low);
+            const __m128i high_bytes = unpack_plane(high_code, high);
+            const __m128i first_half = decode_words(_mm_unpacklo_epi8(low_bytes, high_bytes), previous[w]);
+            const __m128i second_half =
+                decode_words(_mm_unpackhi_epi8(low_bytes, high_bytes), broadcast_last_word(first_half));
+            lanes[w][0] = first_half;
+            lanes[w][1] = second_half;
+            previous[w] = broadcast_last_word(second_half);
+#else
+            uint8_t low_bytes[scene_codec_block_size], high_bytes[scene_codec_block_size];
+            unpack_plane(low_code, low, low_bytes);
+            unpack_plane(high_code, high, high_bytes);
+            uint16_t word = previous[w];
+            for (uint32_t i = 0; i < scene_codec_block_size; ++i)
+            {
+                const uint16_t zigzag = static_cast<uint16_t>(low_bytes[i] | high_bytes[i] << 8);
+                word = static_cast<uint16_t>(word + unzigzag16(zigzag));
+                lanes[w][i] = word;
+            }
+            previous[w] = lanes[w][count - 1];
+#endif
+        }
+
+#if ASH_CPU_X86
+        store_records(lanes, word_count, count, stride, target + first * stride);
+#else
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            uint8_t *record = target + (first + i) * stride;
+            for (std::size_t w = 0; w < word_count; ++w)
+            {
+                std::memcpy(record + w * 2, &lanes[w][i], sizeof(uint16_t));
+            }
+        }
+#endif
+    }
+    return data == end;
+}
+
+void ash::scene_codec_encode_indices(const uint32_t *indices, std::size_t index_count, std::vector<uint8_t> &out)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_codec_encode_indices")
+
+    assert(index_count % 3 == 0);
+    index_state state;
+    std::vector<uint8_t> deltas;
+    for (std::size_t t = 0; t + 3 <= index_count; t += 3)
+    {
+        const uint32_t triangle[3] = {indices[t], indices[t + 1], indices[t + 2]};
+
+        // Prefer the rotation whose leading edge was seen most recently, reversed, in a neighbouring triangle.
+        uint32_t best_slot = g_no_edge;
+        uint32_t best_rotation = 0;
+        for (uint32_t rotation = 0; rotation < 3; ++rotation)
+        {
+            const uint32_t p = triangle[rotation];
+            const uint32_t q = triangle[(rotation + 1) % 3];
+            for (uint32_t slot = 0; slot < (std::min)(best_slot, g_edge_fifo_size); ++slot)
+            {
+                const uint32_t *edge = state.edge(slot);
+                if (edge[0] == q && edge[1] == p)
+                {
+                    best_slot = slot;
+                    best_rotation = rotation;
+                    break;
+                }
+            }
+        }
+
+        const uint32_t p = triangle[best_rotation];
+        const uint32_t q = triangle[(best_rotation + 1) % 3];
+        const uint32_t s = triangle[(best_rotation + 2) % 3];
+        deltas.clear();
+        if (best_slot != g_no_edge)
+        {
+            const uint32_t kind = encode_vertex(state, s, deltas);
+            out.push_back(static_cast<uint8_t>(best_slot << 4 | kind));
+        }
+        else
+        {
+            const uint32_t kind_p = encode_vertex(state, p, deltas);
+            const uint32_t kind_q = encode_vertex(state, q, deltas);
+            const uint32_t kind_s = encode_vertex(state, s, deltas);
+            out.push_back(static_cast<uint8_t>(g_no_edge << 4 | kind_p));
+            out.push_back(static_cast<uint8_t>(kind_q | kind_s << 4));
+            state.push_vertex(p);
+            state.push_vertex(q);
+            state.push_edge(p, q);
+        }
+        out.insert(out.end(), deltas.begin(), deltas.end());
+        state.push_vertex(s);
+        state.push_edge(q, s);
+        state.push_edge(s, p);
+    }
+}
+
+bool ash::scene_codec_decode_indices(uint32_t *indices, std::size_t index_count, const uint8_t *data,
+                                     std::size_t size)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_codec_decode_indices")
+
+    if (index_count % 3 != 0)
+    {
+        return false;
+    }
+
+    const uint8_t *end = data + size;
+    index_state state;
+    for (std::size_t t = 0; t < index_count; t += 3)
+    {
+        if (data == end)
+        {
+            return false;
+        }
+        const uint8_t code = *data++;
+        const uint32_t slot = code >> 4;
+
+        uint32_t p, q, s;
+        if (slot != g_no_edge)
+        {
+            const uint32_t *edge = state.edge(slot);
+            p = edge[1];
+            q = edge[0];
+            if (p == g_no_vertex || !decode_vertex(state, code & 15u, data, end, s))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if (data == end)
+            {
+                return false;
+            }
+            const uint8_t kinds = *data++;
+            if (!decode_vertex(state, code & 15u, data, end, p) || !decode_vertex(state, kinds & 15u, data, end, q) ||
+                !decode_vertex(state, kinds >> 4, data, end, s))
+            {
+                return false;
+            }
+            state.push_vertex(p);
+            state.push_vertex(q);
+            state.push_edge(p, q);
+        }
+
+        indices[t] = p;
+        indices[t + 1] = q;
+        indices[t + 2] = s;
+        state.push_vertex(s);
+        state.push_edge(q, s);
+        state.push_edge(s, p);
+    }
+    return data == end;
+}
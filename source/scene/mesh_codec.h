@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ash
+{
+// Compression of one stream in a cooked mesh file.
+enum class scene_codec_mode : uint8_t
+{
+    none,   // raw bytes
+    vertex, // fixed-stride records, see scene_codec_encode_vertices
+    index,  // triangle list, see scene_codec_encode_indices
+    count
+};
+
+// Vertices are coded in blocks of this many records.
+constexpr uint32_t scene_codec_block_size = 16;
+constexpr uint32_t scene_codec_max_stride = 256;
+} // namespace ash
+
+namespace ash
+{
+// Appends `vertex_count` records of `stride` bytes to `out`. Each 16-bit word is replaced by the zigzag-coded delta
+// to the same word of the previous record, the deltas are split into byte planes, and every plane of a block is
+// bit-packed at the smallest of 0, 2, 4 or 8 bits that holds it. `stride` must be even and at most
+// scene_codec_max_stride; quantized vertices with smooth ordering pack best.
+void scene_codec_encode_vertices(const void *vertices, std::size_t vertex_count, std::size_t stride,
+                                 std::vector<uint8_t> &out);
+
+// Decodes exactly `size` bytes produced by scene_codec_encode_vertices. Returns false on malformed input, in which
+// case `vertices` holds garbage. Uses SSE2 on x86.
+bool scene_codec_decode_vertices(void *vertices, std::size_t vertex_count, std::size_t stride, const uint8_t *data,
+                                 std::size_t size);
+
+// Appends a triangle list to `out`, one code byte per triangle in the common case. Triangles are rotated so that an
+// edge shared with a recent triangle comes first, which is then referenced through a 15-entry edge FIFO; the third
+// vertex is the next unseen vertex, an entry of a vertex FIFO, or an explicit delta. Triangle order and winding are
+// preserved but not which vertex comes first. `index_count` must be a multiple of 3.
+void scene_codec_encode_indices(const uint32_t *indices, std::size_t index_count, std::vector<uint8_t> &out);
+
+// Decodes exactly `size` bytes produced by scene_codec_encode_indices. Returns false on malformed input.
+bool scene_codec_decode_indices(uint32_t *indices, std::size_t index_count, const uint8_t *data, std::size_t size);
+} // namespace ash
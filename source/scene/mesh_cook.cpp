@@ -0,0 +1,354 @@
+#include "mesh_cook.h"
+#include "editor/console.h"
+#include "scene/mesh_bvh.h"
+#include "scene/meshlet.h"
+#include <common.h>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <string>
+
+namespace
+{
+void write_chunk(std::vector<uint8_t> &file, uint32_t &chunk_count, ash::scene_cook_stream stream,
+                 ash::scene_codec_mode mode, const void *data, std::size_t count, std::size_t stride)
+{
+    std::vector<uint8_t> payload;
+    switch (mode)
+    {
+    case ash::scene_codec_mode::vertex:
+        ash::scene_codec_encode_vertices(data, count, stride, payload);
+        break;
+    case ash::scene_codec_mode::index:
+        ash::scene_codec_encode_indices(static_cast<const uint32_t *>(data), count, payload);
+        break;
+    case ash::scene_codec_mode::none:
+    default:
+        payload.resize(count * stride);
+        if (!payload.empty())
+        {
+            std::memcpy(payload.data(), data, payload.size());
+        }
+        break;
+    }
+
+    ash::scene_cook_chunk chunk;
+    chunk.stream = stream;
+    chunk.mode = mode;
+    chunk.stride = static_cast<uint16_t>(stride);
+    chunk.count = static_cast<uint32_t>(count);
+    chunk.size = payload.size();
+
+    const std::size_t offset = file.size();
+    file.resize(offset + sizeof(chunk) + payload.size());
+    std::memcpy(file.data() + offset, &chunk, sizeof(chunk));
+    if (!payload.empty())
+    {
+        std::memcpy(file.data() + offset + sizeof(chunk), payload.data(), payload.size());
+    }
+    ++chunk_count;
+}
+
+template <typename T>
+void write_array(std::vector<uint8_t> &file, uint32_t &chunk_count, ash::scene_cook_stream stream,
+                 ash::scene_codec_mode mode, const std::vector<T> &array)
+{
+    write_chunk(file, chunk_count, stream, mode, array.data(), array.size(), sizeof(T));
+}
+
+// Rejects chunks whose element count cannot come from a payload of this size, before anything is allocated.
+bool is_chunk_size_plausible(const ash::scene_cook_chunk &chunk)
+{
+    const uint64_t count = chunk.count;
+    switch (chunk.mode)
+    {
+    case ash::scene_codec_mode::vertex: {
+        const uint64_t blocks = (count + ash::scene_codec_block_size - 1) / ash::scene_codec_block_size;
+        return blocks * ((uint64_t(chunk.stride) + 3) / 4) <= chunk.size;
+    }
+    case ash::scene_codec_mode::index:
+        return chunk.stride == sizeof(uint32_t) && count / 3 <= chunk.size;
+    case ash::scene_codec_mode::none:
+        return count * chunk.stride == chunk.size;
+    default:
+        return false;
+    }
+}
+
+bool decode_chunk(const ash::scene_cook_chunk &chunk, const uint8_t *payload, uint8_t *target)
+{
+    switch (chunk.mode)
+    {
+    case ash::scene_codec_mode::vertex:
+        return ash::scene_codec_decode_vertices(target, chunk.count, chunk.stride, payload, chunk.size);
+    case ash::scene_codec_mode::index: {
+        std::vector<uint32_t> indices(chunk.count);
+        if (!ash::scene_codec_decode_indices(indices.data(), indices.size(), payload, chunk.size))
+        {
+            return false;
+        }
+        std::memcpy(target, indices.data(), indices.size() * sizeof(uint32_t));
+        return true;
+    }
+    case ash::scene_codec_mode::none:
+    default:
+        std::memcpy(target, payload, chunk.size);
+        return true;
+    }
+}
+
+// Appends the decoded chunk to `array`. Only vertex_data may use a stride other than the element size.
+template <typename T>
+bool read_array(const ash::scene_cook_chunk &chunk, const uint8_t *payload, std::vector<T> &array)
+{
+    if (chunk.stream != ash::scene_cook_stream::vertex_data && chunk.stride != sizeof(T))
+    {
+        return false;
+    }
+
+    const std::size_t bytes = std::size_t(chunk.count) * chunk.stride;
+    if (bytes % sizeof(T) != 0)
+    {
+        return false;
+    }
+
+    const std::size_t offset = array.size();
+    array.resize(offset + bytes / sizeof(T));
+    return bytes == 0 || decode_chunk(chunk, payload, reinterpret_cast<uint8_t *>(array.data() + offset));
+}
+
+bool read_stream(const ash::scene_cook_chunk &chunk, const uint8_t *payload, ash::scene_mesh_arena &arena)
+{
+    switch (chunk.stream)
+    {
+    case ash::scene_cook_stream::positions:
+        return read_array(chunk, payload, arena.positions);
+    case ash::scene_cook_stream::normals:
+        return read_array(chunk, payload, arena.normals);
+    case ash::scene_cook_stream::tangents:
+        return read_array(chunk, payload, arena.tangents);
+    case ash::scene_cook_stream::uvs:
+        return read_array(chunk, payload, arena.uvs);
+    case ash::scene_cook_stream::vertex_data:
+        return read_array(chunk, payload, arena.vertex_data);
+    case ash::scene_cook_stream::vertex_streams:
+        return read_array(chunk, payload, arena.vertex_streams);
+    case ash::scene_cook_stream::indices:
+        return read_array(chunk, payload, arena.indices);
+    case ash::scene_cook_stream::lods:
+        return read_array(chunk, payload, arena.lods);
+    case ash::scene_cook_stream::meshlets:
+        return read_array(chunk, payload, arena.meshlets);
+    case ash::scene_cook_stream::meshlet_vertices:
+        return read_array(chunk, payload, arena.meshlet_vertices);
+    case ash::scene_cook_stream::meshlet_triangles:
+        return read_array(chunk, payload, arena.meshlet_triangles);
+    case ash::scene_cook_stream::bvh_nodes:
+        return read_array(chunk, payload, arena.bvh_nodes);
+    case ash::scene_cook_stream::bvh_triangles:
+        return read_array(chunk, payload, arena.bvh_triangles);
+    case ash::scene_cook_stream::primitives:
+        return read_array(chunk, payload, arena.primitives);
+    case ash::scene_cook_stream::meshes:
+        return read_array(chunk, payload, arena.meshes);
+    default:
+        return false;
+    }
+}
+
+bool is_index_range_valid(const ash::scene_mesh_arena &arena, uint64_t first, uint64_t count, uint32_t vertex_count)
+{
+    if (first + count > arena.indices.size())
+    {
+        return false;
+    }
+    for (uint64_t i = first; i < first + count; ++i)
+    {
+        if (arena.indices[i] >= vertex_count)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_arena_valid(const ash::scene_mesh_arena &arena)
+{
+    // Attributes are either all present or all released, see scene_mesh_release_attributes.
+    const std::size_t vertex_count = arena.positions.size();
+    const std::size_t attribute_count = arena.normals.empty() ? 0 : vertex_count;
+    if (arena.normals.size() != attribute_count || arena.tangents.size() != attribute_count ||
+        arena.uvs.size() != attribute_count)
+    {
+        return false;
+    }
+
+    for (const ash::scene_mesh_primitive &primitive : arena.primitives)
+    {
+        if (uint64_t(primitive.first_vertex) + primitive.vertex_count > vertex_count ||
+            !is_index_range_valid(arena, primitive.first_index, primitive.index_count, primitive.vertex_count) ||
+            uint64_t(primitive.first_lod) + primitive.lod_count > arena.lods.size())
+        {
+            return false;
+        }
+        for (uint32_t l = primitive.first_lod; l < primitive.first_lod + primitive.lod_count; ++l)
+        {
+            const ash::scene_mesh_lod &lod = arena.lods[l];
+            if (!is_index_range_valid(arena, lod.first_index, lod.index_count, primitive.vertex_count))
+            {
+                return false;
+            }
+        }
+    }
+
+    for (const ash::scene_mesh &mesh : arena.meshes)
+    {
+        if (uint64_t(mesh.first_primitive) + mesh.primitive_count > arena.primitives.size())
+        {
+            return false;
+        }
+    }
+
+    if (!arena.vertex_streams.empty())
+    {
+        if (arena.vertex_streams.size() != arena.meshes.size())
+        {
+            return false;
+        }
+        for (std::size_t m = 0; m < arena.meshes.size(); ++m)
+        {
+            const ash::scene_mesh &mesh = arena.meshes[m];
+            const ash::scene_vtx_stream &stream = arena.vertex_streams[m];
+            if (stream.format >= ash::scene_vtx_format::count ||
+                stream.stride != ash::scene_vtx_get_stride(stream.format))
+            {
+                return false;
+            }
+            for (uint32_t p = mesh.first_primitive; p < mesh.first_primitive + mesh.primitive_count; ++p)
+            {
+                const ash::scene_mesh_primitive &primitive = arena.primitives[p];
+                if (primitive.vertex_count == 0)
+                {
+                    continue;
+                }
+                if (primitive.first_vertex < stream.first_vertex ||
+                    stream.data_offset + uint64_t(primitive.first_vertex - stream.first_vertex +
+                                                  primitive.vertex_count) * stream.stride >
+                        arena.vertex_data.size())
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return ash::scene_mlet_validate(arena) && ash::scene_mbvh_validate(arena);
+}
+} // namespace
+
+bool ash::scene_cook_write(const std::filesystem::path &path, const scene_mesh_arena &arena, bool compress)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_cook_write")
+
+    const scene_codec_mode vertex_mode = compress ? scene_codec_mode::vertex : scene_codec_mode::none;
+    const scene_codec_mode index_mode =
+        compress && arena.indices.size() % 3 == 0 ? scene_codec_mode::index : vertex_mode;
+
+    std::vector<uint8_t> file(sizeof(scene_cook_header));
+    uint32_t chunk_count = 0;
+    write_array(file, chunk_count, scene_cook_stream::positions, vertex_mode, arena.positions);
+    write_array(file, chunk_count, scene_cook_stream::normals, vertex_mode, arena.normals);
+    write_array(file, chunk_count, scene_cook_stream::tangents, vertex_mode, arena.tangents);
+    write_array(file, chunk_count, scene_cook_stream::uvs, vertex_mode, arena.uvs);
+    for (std::size_t m = 0; m < arena.vertex_streams.size(); ++m)
+    {
+        const scene_vtx_stream &stream = arena.vertex_streams[m];
+        const std::size_t end =
+            m + 1 < arena.vertex_streams.size() ? arena.vertex_streams[m + 1].data_offset : arena.vertex_data.size();
+        write_chunk(file, chunk_count, scene_cook_stream::vertex_data, vertex_mode,
+                    arena.vertex_data.data() + stream.data_offset, (end - stream.data_offset) / stream.stride,
+                    stream.stride);
+    }
+    write_array(file, chunk_count, scene_cook_stream::vertex_streams, scene_codec_mode::none, arena.vertex_streams);
+    write_array(file, chunk_count, scene_cook_stream::indices, index_mode, arena.indices);
+    write_array(file, chunk_count, scene_cook_stream::lods, scene_codec_mode::none, arena.lods);
+    write_array(file, chunk_count, scene_cook_stream::meshlets, scene_codec_mode::none, arena.meshlets);
+    write_array(file, chunk_count, scene_cook_stream::meshlet_vertices, vertex_mode, arena.meshlet_vertices);
+    write_array(file, chunk_count, scene_cook_stream::meshlet_triangles, scene_codec_mode::none,
+                arena.meshlet_triangles);
+    write_array(file, chunk_count, scene_cook_stream::bvh_nodes, scene_codec_mode::none, arena.bvh_nodes);
+    write_array(file, chunk_count, scene_cook_stream::bvh_triangles, vertex_mode, arena.bvh_triangles);
+    write_array(file, chunk_count, scene_cook_stream::primitives, scene_codec_mode::none, arena.primitives);
+    write_array(file, chunk_count, scene_cook_stream::meshes, scene_codec_mode::none, arena.meshes);
+
+    scene_cook_header header;
+    header.chunk_count = chunk_count;
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+    if (!stream)
+    {
+        ed_console_log(ed_console_log_level::error, "[Scene] Cooked mesh write failed: unable to write file.");
+        return false;
+    }
+    return true;
+}
+
+bool ash::scene_cook_read(const std::filesystem::path &path, scene_mesh_arena &arena)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_cook_read")
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        ed_console_log(ed_console_log_level::error, "[Scene] Cooked mesh read failed: unable to open file.");
+        return false;
+    }
+    const std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), {});
+
+    scene_cook_header header;
+    if (file.size() < sizeof(header))
+    {
+        ed_console_log(ed_console_log_level::error, "[Scene] Cooked mesh read failed: file is truncated.");
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != scene_cook_magic || header.version != scene_cook_version)
+    {
+        ed_console_log(ed_console_log_level::error, "[Scene] Cooked mesh read failed: unknown format or version.");
+        return false;
+    }
+
+    scene_mesh_arena result;
+    std::size_t offset = sizeof(header);
+    for (uint32_t c = 0; c < header.chunk_count; ++c)
+    {
+        scene_cook_chunk chunk;
+        if (file.size() - offset < sizeof(chunk))
+        {
+            ed_console_log(ed_console_log_level::error, "[Scene] Cooked mesh read failed: file is truncated.");
+            return false;
+        }
+        std::memcpy(&chunk, file.data() + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+
+        if (chunk.size > file.size() - offset || !is_chunk_size_plausible(chunk) ||
+            !read_stream(chunk, file.data() + offset, result))
+        {
+            ed_console_log(ed_console_log_level::error,
+                           std::format("[Scene] Cooked mesh read failed: chunk {} is corrupt.", c));
+            return false;
+        }
+        offset += chunk.size;
+    }
+
+    if (!is_arena_valid(result))
+    {
+        ed_console_log(ed_console_log_level::error, "[Scene] Cooked mesh read failed: geometry ranges are invalid.");
+        return false;
+    }
+
+    arena = std::move(result);
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <scene/mesh.h>
+#include <scene/mesh_codec.h>
+
+namespace ash
+{
+constexpr uint32_t scene_cook_magic = 0x4d485341; // "ASHM"
+constexpr uint32_t scene_cook_version = 3;
+
+// Arena arrays stored in a cooked mesh file.
+enum class scene_cook_stream : uint8_t
+{
+    positions,
+    normals,
+    tangents,
+    uvs,
+    vertex_data,
+    vertex_streams,
+    indices,
+    lods,
+    meshlets,
+    meshlet_vertices,
+    meshlet_triangles,
+    bvh_nodes,
+    bvh_triangles,
+    primitives,
+    meshes,
+    count
+};
+
+// A cooked file is this header followed by chunks. Each chunk is a scene_cook_chunk and `size` payload bytes that
+// decode to `count` elements of `stride` bytes, appended to the arena array named by `stream`. vertex_data is written
+// as one chunk per mesh since its stride varies between meshes.
+struct scene_cook_header
+{
+    uint32_t magic = scene_cook_magic;
+    uint32_t version = scene_cook_version;
+    uint32_t chunk_count = 0;
+    uint32_t reserved = 0;
+};
+
+struct scene_cook_chunk
+{
+    scene_cook_stream stream = scene_cook_stream::count;
+    scene_codec_mode mode = scene_codec_mode::none;
+    uint16_t stride = 0;
+    uint32_t count = 0;
+    uint64_t size = 0;
+};
+
+static_assert(sizeof(scene_cook_header) == 16);
+static_assert(sizeof(scene_cook_chunk) == 16);
+} // namespace ash
+
+namespace ash
+{
+// Writes `arena` to `path`. With `compress`, vertex attribute streams use scene_codec_mode::vertex and the index
+// list scene_codec_mode::index; structural arrays are always stored raw.
+bool scene_cook_write(const std::filesystem::path &path, const scene_mesh_arena &arena, bool compress);
+
+// Replaces `arena` with the contents of a file written by scene_cook_write. Chunk sizes and primitive ranges are
+// validated, so a corrupt file fails cleanly instead of producing out-of-range geometry.
+bool scene_cook_read(const std::filesystem::path &path, scene_mesh_arena &arena);
+} // namespace ash
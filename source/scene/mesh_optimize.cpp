@@ -0,0 +1,516 @@
+#include "mesh_optimize.h"
+#include "job/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <common.h>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+// Forsyth's linear-speed vertex cache optimizer works on a larger LRU cache than the FIFO it is measured against;
+// the score tables below follow the published constants.
+constexpr uint32_t g_lru_cache_size = 32;
+constexpr uint32_t g_max_valence_score = 64;
+constexpr float g_last_triangle_score = 0.75f;
+constexpr float g_cache_decay_power = 1.5f;
+constexpr float g_valence_boost_scale = 2.0f;
+constexpr float g_valence_boost_power = 0.5f;
+
+struct primitive_geometry
+{
+    std::vector<XMFLOAT3> positions;
+    std::vector<XMFLOAT3> normals;
+    std::vector<XMFLOAT4> tangents;
+    std::vector<XMFLOAT2> uvs;
+    std::vector<uint32_t> indices;
+};
+
+struct vertex_key
+{
+    uint32_t bits[12];
+
+    bool operator==(const vertex_key &other) const { return std::memcmp(bits, other.bits, sizeof(bits)) == 0; }
+};
+
+struct vertex_key_hash
+{
+    std::size_t operator()(const vertex_key &key) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t word : key.bits)
+        {
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        return static_cast<std::size_t>(hash);
+    }
+};
+
+void accumulate(ash::scene_mopt_cache_stats &total, const ash::scene_mopt_cache_stats &stats)
+{
+    total.triangles += stats.triangles;
+    total.vertices += stats.vertices;
+    total.transformed += stats.transformed;
+}
+
+// Merges vertices whose position, normal, tangent and uv are bit-identical, then drops triangles that became
+// degenerate.
+void weld_vertices(primitive_geometry &geometry)
+{
+    const std::size_t vertex_count = geometry.positions.size();
+    std::unordered_map<vertex_key, uint32_t, vertex_key_hash> unique_vertices;
+    unique_vertices.reserve(vertex_count);
+
+    std::vector<uint32_t> remap(vertex_count);
+    primitive_geometry welded;
+    welded.positions.reserve(vertex_count);
+    welded.normals.reserve(vertex_count);
+    welded.tangents.reserve(vertex_count);
+    welded.uvs.reserve(vertex_count);
+
+    for (std::size_t v = 0; v < vertex_count; ++v)
+    {
+        vertex_key key;
+        std::memcpy(key.bits + 0, &geometry.positions[v], sizeof(XMFLOAT3));
+        std::memcpy(key.bits + 3, &geometry.normals[v], sizeof(XMFLOAT3));
+        std::memcpy(key.bits + 6, &geometry.tangents[v], sizeof(XMFLOAT4));
+        std::memcpy(key.bits + 10, &geometry.uvs[v], sizeof(XMFLOAT2));
+
+        const auto [it, inserted] = unique_vertices.try_emplace(key, static_cast<uint32_t>(welded.positions.size()));
+        if (inserted)
+        {
+            welded.positions.push_back(geometry.positions[v]);
+            welded.normals.push_back(geometry.normals[v]);
+            welded.tangents.push_back(geometry.tangents[v]);
+            welded.uvs.push_back(geometry.uvs[v]);
+        }
+        remap[v] = it->second;
+    }
+
+    std::size_t write = 0;
+    for (std::size_t i = 0; i + 2 < geometry.indices.size(); i += 3)
+    {
+        const uint32_t a = remap[geometry.indices[i + 0]];
+        const uint32_t b = remap[geometry.indices[i + 1]];
+        const uint32_t c = remap[geometry.indices[i + 2]];
+        if (a != b && b != c && c != a)
+        {
+            geometry.indices[write++] = a;
+            geometry.indices[write++] = b;
+            geometry.indices[write++] = c;
+        }
+    }
+    geometry.indices.resize(write);
+
+    geometry.positions = std::move(welded.positions);
+    geometry.normals = std::move(welded.normals);
+    geometry.tangents = std::move(welded.tangents);
+    geometry.uvs = std::move(welded.uvs);
+}
+
+struct forsyth_tables
+{
+    float cache[g_lru_cache_size];
+    float valence[g_max_valence_score + 1];
+
+    forsyth_tables()
+    {
+        for (uint32_t i = 0; i < g_lru_cache_size; ++i)
+        {
+            if (i < 3)
+            {
+                cache[i] = g_last_triangle_score;
+            }
+            else
+            {
+                const float scaler = 1.0f / float(g_lru_cache_size - 3);
+                cache[i] = std::pow(1.0f - float(i - 3) * scaler, g_cache_decay_power);
+            }
+        }
+
+        valence[0] = 0.0f;
+        for (uint32_t i = 1; i <= g_max_valence_score; ++i)
+        {
+            valence[i] = g_valence_boost_scale * std::pow(float(i), -g_valence_boost_power);
+        }
+    }
+};
+
+float vertex_score(const forsyth_tables &tables, int32_t cache_position, uint32_t live_triangles)
+{
+    if (live_triangles == 0)
+    {
+        return -1.0f;
+    }
+
+    const float cache_score = cache_position < 0 ? 0.0f : tables.cache[cache_position];
+    return cache_score + tables.valence[(std::min)(live_triangles, g_max_valence_score)];
+}
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation". Greedily emits the triangle whose vertices score highest
+// for cache recency and low remaining valence.
+void optimize_vertex_cache(std::vector<uint32_t> &indices, std::size_t vertex_count)
+{
+    static const forsyth_tables tables;
+
+    const std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> live_triangles(vertex_count, 0);
+    for (uint32_t index : indices)
+    {
+        ++live_triangles[index];
+    }
+
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (std::size_t v = 0; v < vertex_count; ++v)
+    {
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (std::size_t t = 0; t < triangle_count; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int32_t> cache_position(vertex_count, -1);
+    std::vector<float> scores(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; ++v)
+    {
+        scores[v] = vertex_score(tables, -1, live_triangles[v]);
+    }
+
+    std::vector<float> triangle_scores(triangle_count);
+    for (std::size_t t = 0; t < triangle_count; ++t)
+    {
+        triangle_scores[t] = scores[indices[t * 3 + 0]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t cache[g_lru_cache_size + 3];
+    uint32_t cache_count = 0;
+    std::size_t scan_cursor = 0;
+    int64_t best_triangle = 0;
+
+    for (std::size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count)
+    {
+        if (best_triangle < 0)
+        {
+            while (emitted[scan_cursor])
+            {
+                ++scan_cursor;
+            }
+            best_triangle = static_cast<int64_t>(scan_cursor);
+        }
+
+        const uint32_t *triangle = &indices[best_triangle * 3];
+        emitted[best_triangle] = true;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // New cache: the triangle's vertices first, then the old entries that are not part of it.
+        uint32_t new_cache[g_lru_cache_size + 3];
+        uint32_t new_count = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            new_cache[new_count++] = triangle[k];
+            --live_triangles[triangle[k]];
+
+            uint32_t *begin = &adjacency[adjacency_offsets[triangle[k]]];
+            uint32_t *end = begin + live_triangles[triangle[k]] + 1;
+            *std::find(begin, end, static_cast<uint32_t>(best_triangle)) = *(end - 1);
+        }
+        for (uint32_t i = 0; i < cache_count; ++i)
+        {
+            const uint32_t vertex = cache[i];
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+            {
+                new_cache[new_count++] = vertex;
+            }
+        }
+
+        for (uint32_t i = 0; i < new_count; ++i)
+        {
+            cache_position[new_cache[i]] = i < g_lru_cache_size ? static_cast<int32_t>(i) : -1;
+        }
+
+        best_triangle = -1;
+        float best_score = -1.0f;
+        for (uint32_t i = 0; i < new_count; ++i)
+        {
+            const uint32_t vertex = new_cache[i];
+            const float score = vertex_score(tables, cache_position[vertex], live_triangles[vertex]);
+            const float delta = score - scores[vertex];
+            scores[vertex] = score;
+
+            for (uint32_t a = adjacency_offsets[vertex]; a < adjacency_offsets[vertex] + live_triangles[vertex]; ++a)
+            {
+                const uint32_t t = adjacency[a];
+                triangle_scores[t] += delta;
+                if (triangle_scores[t] > best_score)
+                {
+                    best_score = triangle_scores[t];
+                    best_triangle = t;
+                }
+            }
+        }
+
+        cache_count = (std::min)(new_count, g_lru_cache_size);
+        std::copy(new_cache, new_cache + cache_count, cache);
+    }
+
+    indices = std::move(result);
+}
+
+// Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw". The cache-optimized order is
+// cut into clusters where the FIFO cache would start cold anyway, and clusters facing away from the mesh center are
+// drawn first so they occlude the ones behind them. Cutting only at full misses keeps ACMR nearly unchanged.
+void optimize_overdraw(std::vector<uint32_t> &indices, const std::vector<XMFLOAT3> &positions)
+{
+    const std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count < 2)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> cluster_starts;
+    std::vector<uint32_t> timestamps(positions.size(), 0);
+    uint32_t time = ash::scene_mopt_fifo_cache_size + 1;
+    for (std::size_t t = 0; t < triangle_count; ++t)
+    {
+        uint32_t misses = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t vertex = indices[t * 3 + k];
+            if (time - timestamps[vertex] > ash::scene_mopt_fifo_cache_size)
+            {
+                timestamps[vertex] = time++;
+                ++misses;
+            }
+        }
+
+        if (misses == 3 || t == 0)
+        {
+            cluster_starts.push_back(static_cast<uint32_t>(t));
+        }
+    }
+
+    if (cluster_starts.size() < 2)
+    {
+        return;
+    }
+    cluster_starts.push_back(static_cast<uint32_t>(triangle_count));
+
+    XMVECTOR mesh_centroid = XMVectorZero();
+    for (const XMFLOAT3 &position : positions)
+    {
+        mesh_centroid = XMVectorAdd(mesh_centroid, XMLoadFloat3(&position));
+    }
+    mesh_centroid = XMVectorScale(mesh_centroid, 1.0f / float(positions.size()));
+
+    const std::size_t cluster_count = cluster_starts.size() - 1;
+    std::vector<float> sort_keys(cluster_count);
+    for (std::size_t c = 0; c < cluster_count; ++c)
+    {
+        XMVECTOR centroid = XMVectorZero();
+        XMVECTOR normal = XMVectorZero();
+        float area = 0.0f;
+        for (uint32_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t)
+        {
+            const XMVECTOR a = XMLoadFloat3(&positions[indices[t * 3 + 0]]);
+            const XMVECTOR b = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+            const XMVECTOR c_ = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+            const XMVECTOR cross = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c_, a));
+            const float triangle_area = XMVectorGetX(XMVector3Length(cross));
+
+            centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c_), triangle_area / 3.0f));
+            normal = XMVectorAdd(normal, cross);
+            area += triangle_area;
+        }
+
+        if (area > 0.0f)
+        {
+            centroid = XMVectorScale(centroid, 1.0f / area);
+            const XMVECTOR offset = XMVectorSubtract(centroid, mesh_centroid);
+            sort_keys[c] = XMVectorGetX(XMVector3Dot(offset, XMVector3Normalize(normal)));
+        }
+        else
+        {
+            sort_keys[c] = 0.0f;
+        }
+    }
+
+    std::vector<uint32_t> order(cluster_count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : order)
+    {
+        result.insert(result.end(), indices.begin() + cluster_starts[c] * 3,
+                      indices.begin() + cluster_starts[c + 1] * 3);
+    }
+    indices = std::move(result);
+}
+
+// Renumbers vertices in the order the index buffer first references them, dropping unreferenced vertices.
+void optimize_vertex_fetch(primitive_geometry &geometry)
+{
+    std::vector<uint32_t> remap(geometry.positions.size(), UINT32_MAX);
+    primitive_geometry fetched;
+    fetched.positions.reserve(geometry.positions.size());
+    fetched.normals.reserve(geometry.positions.size());
+    fetched.tangents.reserve(geometry.positions.size());
+    fetched.uvs.reserve(geometry.positions.size());
+
+    for (uint32_t &index : geometry.indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(fetched.positions.size());
+            fetched.positions.push_back(geometry.positions[index]);
+            fetched.normals.push_back(geometry.normals[index]);
+            fetched.tangents.push_back(geometry.tangents[index]);
+            fetched.uvs.push_back(geometry.uvs[index]);
+        }
+        index = remap[index];
+    }
+
+    geometry.positions = std::move(fetched.positions);
+    geometry.normals = std::move(fetched.normals);
+    geometry.tangents = std::move(fetched.tangents);
+    geometry.uvs = std::move(fetched.uvs);
+}
+} // namespace
+
+ash::scene_mopt_cache_stats ash::scene_mopt_analyze_cache(const uint32_t *indices, std::size_t index_count,
+                                                          std::size_t vertex_count, uint32_t cache_size)
+{
+    scene_mopt_cache_stats stats;
+    stats.triangles = index_count / 3;
+    stats.vertices = vertex_count;
+
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    uint32_t time = cache_size + 1;
+    for (std::size_t i = 0; i < index_count; ++i)
+    {
+        const uint32_t vertex = indices[i];
+        if (time - timestamps[vertex] > cache_size)
+        {
+            timestamps[vertex] = time++;
+            ++stats.transformed;
+        }
+    }
+    return stats;
+}
+
+void ash::scene_mopt_optimize_vertex_cache(std::vector<uint32_t> &indices, std::size_t vertex_count)
+{
+    optimize_vertex_cache(indices, vertex_count);
+}
+
+ash::scene_mopt_stats ash::scene_mopt_optimize(scene_mesh_arena &arena)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_mopt_optimize")
+
+    std::vector<primitive_geometry> optimized(arena.primitives.size());
+    std::vector<scene_mopt_stats> mesh_stats(arena.meshes.size());
+
+    job_parallel_for(static_cast<uint32_t>(arena.meshes.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t m = begin; m < end; ++m)
+        {
+            const scene_mesh &mesh = arena.meshes[m];
+            for (uint32_t p = mesh.first_primitive; p < mesh.first_primitive + mesh.primitive_count; ++p)
+            {
+                const scene_mesh_primitive &primitive = arena.primitives[p];
+                primitive_geometry &geometry = optimized[p];
+
+                const std::size_t first = primitive.first_vertex;
+                const std::size_t last = first + primitive.vertex_count;
+                geometry.positions.assign(arena.positions.begin() + first, arena.positions.begin() + last);
+                geometry.normals.assign(arena.normals.begin() + first, arena.normals.begin() + last);
+                geometry.tangents.assign(arena.tangents.begin() + first, arena.tangents.begin() + last);
+                geometry.uvs.assign(arena.uvs.begin() + first, arena.uvs.begin() + last);
+                geometry.indices.assign(arena.indices.begin() + primitive.first_index,
+                                        arena.indices.begin() + primitive.first_index + primitive.index_count);
+                geometry.indices.resize(geometry.indices.size() - geometry.indices.size() % 3);
+
+                const scene_mopt_cache_stats before =
+                    scene_mopt_analyze_cache(geometry.indices.data(), geometry.indices.size(),
+                                             geometry.positions.size(), scene_mopt_fifo_cache_size);
+
+                weld_vertices(geometry);
+                optimize_vertex_cache(geometry.indices, geometry.positions.size());
+                optimize_overdraw(geometry.indices, geometry.positions);
+                optimize_vertex_fetch(geometry);
+
+                const scene_mopt_cache_stats after =
+                    scene_mopt_analyze_cache(geometry.indices.data(), geometry.indices.size(),
+                                             geometry.positions.size(), scene_mopt_fifo_cache_size);
+
+                accumulate(mesh_stats[m].before, before);
+                accumulate(mesh_stats[m].after, after);
+            }
+        }
+    });
+
+    // Repack: welding and fetch remapping shrink primitives, so every range moves.
+    scene_mesh_arena packed;
+    std::size_t vertex_count = 0;
+    std::size_t index_count = 0;
+    for (const primitive_geometry &geometry : optimized)
+    {
+        vertex_count += geometry.positions.size();
+        index_count += geometry.indices.size();
+    }
+    packed.positions.reserve(vertex_count);
+    packed.normals.reserve(vertex_count);
+    packed.tangents.reserve(vertex_count);
+    packed.uvs.reserve(vertex_count);
+    packed.indices.reserve(index_count);
+
+    for (std::size_t p = 0; p < optimized.size(); ++p)
+    {
+        scene_mesh_primitive &primitive = arena.primitives[p];
+        const primitive_geometry &geometry = optimized[p];
+
+        primitive.first_vertex = static_cast<uint32_t>(packed.positions.size());
+        primitive.vertex_count = static_cast<uint32_t>(geometry.positions.size());
+        primitive.first_index = static_cast<uint32_t>(packed.indices.size());
+        primitive.index_count = static_cast<uint32_t>(geometry.indices.size());
+
+        packed.positions.insert(packed.positions.end(), geometry.positions.begin(), geometry.positions.end());
+        packed.normals.insert(packed.normals.end(), geometry.normals.begin(), geometry.normals.end());
+        packed.tangents.insert(packed.tangents.end(), geometry.tangents.begin(), geometry.tangents.end());
+        packed.uvs.insert(packed.uvs.end(), geometry.uvs.begin(), geometry.uvs.end());
+        packed.indices.insert(packed.indices.end(), geometry.indices.begin(), geometry.indices.end());
+    }
+
+    arena.positions = std::move(packed.positions);
+    arena.normals = std::move(packed.normals);
+    arena.tangents = std::move(packed.tangents);
+    arena.uvs = std::move(packed.uvs);
+    arena.indices = std::move(packed.indices);
+
+    scene_mopt_stats total;
+    for (const scene_mopt_stats &stats : mesh_stats)
+    {
+        accumulate(total.before, stats.before);
+        accumulate(total.after, stats.after);
+    }
+    return total;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <scene/mesh.h>
+#include <vector>
+
+namespace ash
+{
+// FIFO post-transform cache size used to measure ACMR/ATVR, matching common hardware estimates.
+constexpr uint32_t scene_mopt_fifo_cache_size = 16;
+
+// Vertex shader invocations per triangle (ACMR) and per unique vertex (ATVR) under a simulated FIFO cache.
+struct scene_mopt_cache_stats
+{
+    uint64_t triangles = 0;
+    uint64_t vertices = 0;
+    uint64_t transformed = 0;
+
+    double acmr() const { return triangles == 0 ? 0.0 : double(transformed) / double(triangles); }
+    double atvr() const { return vertices == 0 ? 0.0 : double(transformed) / double(vertices); }
+};
+
+struct scene_mopt_stats
+{
+    scene_mopt_cache_stats before;
+    scene_mopt_cache_stats after;
+};
+} // namespace ash
+
+namespace ash
+{
+scene_mopt_cache_stats scene_mopt_analyze_cache(const uint32_t *indices, std::size_t index_count,
+                                                std::size_t vertex_count, uint32_t cache_size);
+
+// Welds bit-identical vertices, reorders triangles for the post-transform cache and then for overdraw, and reorders
+// vertices in first-use order, for every primitive of `arena`. Meshes are processed in parallel and the arena is
+// repacked afterwards. Bounds are unaffected since no vertex moves.
+scene_mopt_stats scene_mopt_optimize(scene_mesh_arena &arena);
+
+// Reorders the triangles of one index list for the post-transform cache, without touching vertices.
+void scene_mopt_optimize_vertex_cache(std::vector<uint32_t> &indices, std::size_t vertex_count);
+} // namespace ash
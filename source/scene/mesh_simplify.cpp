@@ -0,0 +1,397 @@
+#include "mesh_simplify.h"
+#include "job/parallel.h"
+#include "scene/mesh_optimize.h"
+#include <algorithm>
+#include <cmath>
+#include <common.h>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+// Normal and uv deviation are ranked as if they were a distance of this fraction of the primitive's radius, so a
+// collapse across a crease or a uv discontinuity costs about as much as moving the surface by that amount.
+constexpr float g_attribute_weight = 0.01f;
+
+// Symmetric 4x4 plane quadric (Garland and Heckbert) plus the total area of the planes it accumulates, so that
+// evaluating it gives the area-weighted mean squared distance to those planes.
+struct quadric
+{
+    double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0;
+    double yy = 0.0, yz = 0.0, yw = 0.0;
+    double zz = 0.0, zw = 0.0;
+    double ww = 0.0;
+    double weight = 0.0;
+};
+
+void quadric_add(quadric &q, const quadric &other)
+{
+    q.xx += other.xx, q.xy += other.xy, q.xz += other.xz, q.xw += other.xw;
+    q.yy += other.yy, q.yz += other.yz, q.yw += other.yw;
+    q.zz += other.zz, q.zw += other.zw;
+    q.ww += other.ww;
+    q.weight += other.weight;
+}
+
+quadric make_plane_quadric(double a, double b, double c, double d, double weight)
+{
+    quadric q;
+    q.xx = a * a * weight, q.xy = a * b * weight, q.xz = a * c * weight, q.xw = a * d * weight;
+    q.yy = b * b * weight, q.yz = b * c * weight, q.yw = b * d * weight;
+    q.zz = c * c * weight, q.zw = c * d * weight;
+    q.ww = d * d * weight;
+    q.weight = weight;
+    return q;
+}
+
+double quadric_error(const quadric &q, const XMFLOAT3 &p)
+{
+    if (q.weight <= 0.0)
+    {
+        return 0.0;
+    }
+
+    const double x = p.x, y = p.y, z = p.z;
+    const double error = q.xx * x * x + q.yy * y * y + q.zz * z * z +
+                         2.0 * (q.xy * x * y + q.xz * x * z + q.yz * y * z + q.xw * x + q.yw * y + q.zw * z) + q.ww;
+    return (std::max)(error, 0.0) / q.weight;
+}
+
+struct collapse
+{
+    uint32_t from = 0;
+    uint32_t to = 0;
+    float cost = 0.0f;
+    float error = 0.0f;
+};
+
+struct simplifier
+{
+    const XMFLOAT3 *positions = nullptr;
+    const XMFLOAT3 *normals = nullptr;
+    const XMFLOAT2 *uvs = nullptr;
+    uint32_t vertex_count = 0;
+    float attribute_scale_sq = 0.0f;
+
+    std::vector<quadric> quadrics;
+    std::vector<bool> locked;
+    float error = 0.0f;
+};
+
+XMVECTOR triangle_cross(const XMFLOAT3 &a, const XMFLOAT3 &b, const XMFLOAT3 &c)
+{
+    const XMVECTOR pa = XMLoadFloat3(&a);
+    return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b), pa), XMVectorSubtract(XMLoadFloat3(&c), pa));
+}
+
+void init_simplifier(simplifier &s, const std::vector<uint32_t> &indices, float radius)
+{
+    s.quadrics.assign(s.vertex_count, {});
+    s.locked.assign(s.vertex_count, false);
+    s.attribute_scale_sq = (g_attribute_weight * radius) * (g_attribute_weight * radius);
+
+    std::unordered_map<uint64_t, uint32_t> edge_counts;
+    edge_counts.reserve(indices.size());
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const uint32_t triangle[3] = {indices[i], indices[i + 1], indices[i + 2]};
+        const XMVECTOR cross = triangle_cross(s.positions[triangle[0]], s.positions[triangle[1]],
+                                              s.positions[triangle[2]]);
+        const float length = XMVectorGetX(XMVector3Length(cross));
+        if (length > 0.0f)
+        {
+            XMFLOAT3 normal;
+            XMStoreFloat3(&normal, XMVectorScale(cross, 1.0f / length));
+            const XMFLOAT3 &p = s.positions[triangle[0]];
+            const double d = -(double(normal.x) * p.x + double(normal.y) * p.y + double(normal.z) * p.z);
+            const quadric plane = make_plane_quadric(normal.x, normal.y, normal.z, d, 0.5 * length);
+            for (uint32_t vertex : triangle)
+            {
+                quadric_add(s.quadrics[vertex], plane);
+            }
+        }
+
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t a = (std::min)(triangle[k], triangle[(k + 1) % 3]);
+            const uint32_t b = (std::max)(triangle[k], triangle[(k + 1) % 3]);
+            ++edge_counts[(uint64_t(a) << 32) | b];
+        }
+    }
+
+    // Open borders: edges used by a single triangle.
+    for (const auto &[edge, count] : edge_counts)
+    {
+        if (count == 1)
+        {
+            s.locked[uint32_t(edge >> 32)] = true;
+            s.locked[uint32_t(edge)] = true;
+        }
+    }
+
+    // Attribute seams: vertices that share a position but not their attributes.
+    std::unordered_map<uint64_t, uint32_t> first_at_position;
+    first_at_position.reserve(s.vertex_count);
+    for (uint32_t v = 0; v < s.vertex_count; ++v)
+    {
+        uint32_t bits[3];
+        std::memcpy(bits, &s.positions[v], sizeof(bits));
+        const uint64_t key = (uint64_t(bits[0]) * 73856093u) ^ (uint64_t(bits[1]) << 21) ^ (uint64_t(bits[2]) << 42) ^
+                             uint64_t(bits[2]);
+        const auto [it, inserted] = first_at_position.try_emplace(key, v);
+        if (!inserted && std::memcmp(&s.positions[it->second], &s.positions[v], sizeof(XMFLOAT3)) == 0)
+        {
+            s.locked[it->second] = true;
+            s.locked[v] = true;
+        }
+    }
+}
+
+// True when moving `from` onto `to` would turn one of the triangles around `from` upside down or make it degenerate.
+bool collapse_flips(const simplifier &s, const std::vector<uint32_t> &indices, const uint32_t *adjacency_begin,
+                    const uint32_t *adjacency_end, uint32_t from, uint32_t to)
+{
+    for (const uint32_t *a = adjacency_begin; a != adjacency_end; ++a)
+    {
+        const uint32_t *triangle = &indices[*a * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            continue;
+        }
+
+        XMFLOAT3 moved[3] = {s.positions[triangle[0]], s.positions[triangle[1]], s.positions[triangle[2]]};
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            if (triangle[k] == from)
+            {
+                moved[k] = s.positions[to];
+            }
+        }
+
+        const XMVECTOR before = triangle_cross(s.positions[triangle[0]], s.positions[triangle[1]],
+                                               s.positions[triangle[2]]);
+        const XMVECTOR after = triangle_cross(moved[0], moved[1], moved[2]);
+        if (XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One round of independent collapses, cheapest first. Each collapse removes about two triangles; vertices around a
+// collapse are frozen for the rest of the round so the flip test never runs on stale geometry.
+bool simplify_pass(simplifier &s, std::vector<uint32_t> &indices, std::size_t target_index_count)
+{
+    const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+    std::vector<uint32_t> adjacency_offsets(s.vertex_count + 1, 0);
+    for (uint32_t index : indices)
+    {
+        ++adjacency_offsets[index + 1];
+    }
+    for (uint32_t v = 0; v < s.vertex_count; ++v)
+    {
+        adjacency_offsets[v + 1] += adjacency_offsets[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (uint32_t t = 0; t < triangle_count; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    std::vector<collapse> candidates;
+    candidates.reserve(indices.size() * 2);
+    auto add_candidate = [&](uint32_t from, uint32_t to) {
+        if (s.locked[from])
+        {
+            return;
+        }
+
+        quadric merged = s.quadrics[from];
+        quadric_add(merged, s.quadrics[to]);
+        const float position_error = static_cast<float>(quadric_error(merged, s.positions[to]));
+
+        const XMVECTOR normal_delta = XMVectorSubtract(XMLoadFloat3(&s.normals[from]), XMLoadFloat3(&s.normals[to]));
+        const float du = s.uvs[from].x - s.uvs[to].x;
+        const float dv = s.uvs[from].y - s.uvs[to].y;
+        const float attribute_error =
+            s.attribute_scale_sq * (XMVectorGetX(XMVector3LengthSq(normal_delta)) + du * du + dv * dv);
+
+        candidates.push_back({from, to, position_error + attribute_error, position_error});
+    };
+
+    for (uint32_t t = 0; t < triangle_count; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t a = indices[t * 3 + k];
+            const uint32_t b = indices[t * 3 + (k + 1) % 3];
+            add_candidate(a, b);
+            add_candidate(b, a);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const collapse &a, const collapse &b) { return a.cost < b.cost; });
+
+    const std::size_t excess_triangles = (indices.size() - target_index_count) / 3;
+    const std::size_t budget = (std::max)(excess_triangles / 2, std::size_t(1));
+
+    std::vector<uint32_t> remap(s.vertex_count);
+    std::vector<bool> frozen(s.vertex_count, false);
+    for (uint32_t v = 0; v < s.vertex_count; ++v)
+    {
+        remap[v] = v;
+    }
+
+    std::size_t applied = 0;
+    for (const collapse &candidate : candidates)
+    {
+        if (applied >= budget)
+        {
+            break;
+        }
+        if (frozen[candidate.from] || frozen[candidate.to])
+        {
+            continue;
+        }
+
+        const uint32_t *begin = adjacency.data() + adjacency_offsets[candidate.from];
+        const uint32_t *end = adjacency.data() + adjacency_offsets[candidate.from + 1];
+        if (collapse_flips(s, indices, begin, end, candidate.from, candidate.to))
+        {
+            continue;
+        }
+
+        remap[candidate.from] = candidate.to;
+        quadric_add(s.quadrics[candidate.to], s.quadrics[candidate.from]);
+        s.error = (std::max)(s.error, std::sqrt(candidate.error));
+        for (const uint32_t *a = begin; a != end; ++a)
+        {
+            frozen[indices[*a * 3 + 0]] = true;
+            frozen[indices[*a * 3 + 1]] = true;
+            frozen[indices[*a * 3 + 2]] = true;
+        }
+        ++applied;
+    }
+
+    if (applied == 0)
+    {
+        return false;
+    }
+
+    std::size_t write = 0;
+    for (std::size_t i = 0; i < indices.size(); i += 3)
+    {
+        const uint32_t a = remap[indices[i + 0]];
+        const uint32_t b = remap[indices[i + 1]];
+        const uint32_t c = remap[indices[i + 2]];
+        if (a != b && b != c && c != a)
+        {
+            indices[write++] = a;
+            indices[write++] = b;
+            indices[write++] = c;
+        }
+    }
+    indices.resize(write);
+    return true;
+}
+
+struct primitive_lod
+{
+    std::vector<uint32_t> indices;
+    float error = 0.0f;
+};
+
+std::vector<primitive_lod> build_primitive_lods(const ash::scene_mesh_arena &arena,
+                                                const ash::scene_mesh_primitive &primitive)
+{
+    std::vector<primitive_lod> lods;
+
+    simplifier s;
+    s.positions = arena.positions.data() + primitive.first_vertex;
+    s.normals = arena.normals.data() + primitive.first_vertex;
+    s.uvs = arena.uvs.data() + primitive.first_vertex;
+    s.vertex_count = primitive.vertex_count;
+
+    std::vector<uint32_t> indices(arena.indices.begin() + primitive.first_index,
+                                  arena.indices.begin() + primitive.first_index + primitive.index_count);
+    indices.resize(indices.size() - indices.size() % 3);
+    if (indices.size() / 3 <= ash::scene_simp_min_triangles)
+    {
+        return lods;
+    }
+
+    const float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&primitive.extents)));
+    init_simplifier(s, indices, radius);
+
+    for (uint32_t lod = 1; lod < ash::scene_simp_max_lods; ++lod)
+    {
+        const std::size_t previous_triangles = indices.size() / 3;
+        if (previous_triangles <= ash::scene_simp_min_triangles)
+        {
+            break;
+        }
+
+        const std::size_t target_triangles = (std::max)(
+            static_cast<std::size_t>(float(previous_triangles) * ash::scene_simp_lod_ratio),
+            std::size_t(ash::scene_simp_min_triangles));
+        while (indices.size() / 3 > target_triangles && simplify_pass(s, indices, target_triangles * 3))
+        {
+        }
+
+        if (float(indices.size() / 3) > float(previous_triangles) * (1.0f - ash::scene_simp_min_reduction))
+        {
+            break;
+        }
+
+        primitive_lod &result = lods.emplace_back();
+        result.indices = indices;
+        result.error = s.error;
+        ash::scene_mopt_optimize_vertex_cache(result.indices, s.vertex_count);
+    }
+
+    return lods;
+}
+} // namespace
+
+ash::scene_simp_stats ash::scene_simp_build_lods(scene_mesh_arena &arena)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_simp_build_lods")
+
+    std::vector<std::vector<primitive_lod>> built(arena.primitives.size());
+    job_parallel_for(static_cast<uint32_t>(arena.primitives.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t p = begin; p < end; ++p)
+        {
+            built[p] = build_primitive_lods(arena, arena.primitives[p]);
+        }
+    });
+
+    scene_simp_stats stats;
+    arena.lods.clear();
+    for (std::size_t p = 0; p < built.size(); ++p)
+    {
+        scene_mesh_primitive &primitive = arena.primitives[p];
+        primitive.first_lod = static_cast<uint32_t>(arena.lods.size());
+        primitive.lod_count = static_cast<uint32_t>(built[p].size() + 1);
+        arena.lods.push_back({primitive.first_index, primitive.index_count, 0.0f});
+        stats.source_triangles += primitive.index_count / 3;
+
+        for (const primitive_lod &lod : built[p])
+        {
+            arena.lods.push_back({static_cast<uint32_t>(arena.indices.size()),
+                                  static_cast<uint32_t>(lod.indices.size()), lod.error});
+            arena.indices.insert(arena.indices.end(), lod.indices.begin(), lod.indices.end());
+            stats.lod_triangles += lod.indices.size() / 3;
+        }
+        stats.lod_count += static_cast<uint32_t>(built[p].size());
+    }
+    return stats;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <scene/mesh.h>
+
+namespace ash
+{
+constexpr uint32_t scene_simp_max_lods = 8;
+
+// Each LOD targets this fraction of the previous LOD's triangles. The chain stops early once a level no longer
+// removes at least scene_simp_min_reduction of them, e.g. when only locked borders and seams remain.
+constexpr float scene_simp_lod_ratio = 0.5f;
+constexpr float scene_simp_min_reduction = 0.1f;
+constexpr uint32_t scene_simp_min_triangles = 16;
+
+struct scene_simp_stats
+{
+    uint64_t source_triangles = 0;
+    uint64_t lod_triangles = 0;
+    uint32_t lod_count = 0;
+};
+} // namespace ash
+
+namespace ash
+{
+// Generates the LOD chain of every primitive of `arena` in parallel with quadric-error edge collapses onto existing
+// vertices, so every LOD reuses the primitive's vertex range. Vertices on open borders and attribute seams are
+// locked, and collapses are ranked by position error plus normal/uv deviation. LOD index lists are appended to
+// arena.indices and reordered for the vertex cache; LOD 0 stays the primitive's own index range. Run after
+// scene_mopt_optimize, which repacks indices.
+scene_simp_stats scene_simp_build_lods(scene_mesh_arena &arena);
+} // namespace ash
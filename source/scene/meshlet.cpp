@@ -0,0 +1,325 @@
+#include "meshlet.h"
+#include "job/parallel.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <common.h>
+
+using namespace DirectX;
+
+namespace
+{
+// Below this, the normals of a meshlet spread over almost a hemisphere and the cone would never reject anything.
+constexpr float g_min_cone_dot = 0.1f;
+
+struct primitive_meshlets
+{
+    std::vector<ash::scene_mesh_meshlet> meshlets;
+    std::vector<uint32_t> vertices;
+    std::vector<uint8_t> triangles;
+};
+
+void compute_meshlet_bounds(ash::scene_mesh_meshlet &meshlet, const primitive_meshlets &result,
+                            const XMFLOAT3 *positions)
+{
+    const uint32_t *vertices = result.vertices.data() + meshlet.first_vertex;
+    const uint8_t *triangles = result.triangles.data() + meshlet.first_triangle * 3;
+
+    XMVECTOR min = XMVectorReplicate(FLT_MAX);
+    XMVECTOR max = XMVectorReplicate(-FLT_MAX);
+    for (uint32_t v = 0; v < meshlet.vertex_count; ++v)
+    {
+        const XMVECTOR position = XMLoadFloat3(&positions[vertices[v]]);
+        min = XMVectorMin(min, position);
+        max = XMVectorMax(max, position);
+    }
+
+    const XMVECTOR center = XMVectorScale(XMVectorAdd(min, max), 0.5f);
+    float radius_sq = 0.0f;
+    for (uint32_t v = 0; v < meshlet.vertex_count; ++v)
+    {
+        const XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&positions[vertices[v]]), center);
+        radius_sq = (std::max)(radius_sq, XMVectorGetX(XMVector3LengthSq(offset)));
+    }
+    XMStoreFloat4(&meshlet.sphere, XMVectorSetW(center, std::sqrt(radius_sq)));
+
+    std::array<XMVECTOR, ash::scene_mlet_max_triangles> normals;
+    uint32_t normal_count = 0;
+    XMVECTOR normal_sum = XMVectorZero();
+    for (uint32_t t = 0; t < meshlet.triangle_count; ++t)
+    {
+        const XMVECTOR a = XMLoadFloat3(&positions[vertices[triangles[t * 3 + 0]]]);
+        const XMVECTOR b = XMLoadFloat3(&positions[vertices[triangles[t * 3 + 1]]]);
+        const XMVECTOR c = XMLoadFloat3(&positions[vertices[triangles[t * 3 + 2]]]);
+        const XMVECTOR cross = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+        if (XMVectorGetX(XMVector3LengthSq(cross)) <= 0.0f)
+        {
+            continue;
+        }
+
+        normals[normal_count] = XMVector3Normalize(cross);
+        normal_sum = XMVectorAdd(normal_sum, normals[normal_count]);
+        ++normal_count;
+    }
+
+    meshlet.cone_axis = {0.0f, 0.0f, 0.0f};
+    meshlet.cone_cutoff = 1.0f;
+    if (normal_count == 0 || XMVectorGetX(XMVector3LengthSq(normal_sum)) <= 0.0f)
+    {
+        return;
+    }
+
+    const XMVECTOR axis = XMVector3Normalize(normal_sum);
+    float min_dot = 1.0f;
+    for (uint32_t n = 0; n < normal_count; ++n)
+    {
+        min_dot = (std::min)(min_dot, XMVectorGetX(XMVector3Dot(axis, normals[n])));
+    }
+
+    if (min_dot <= g_min_cone_dot)
+    {
+        return;
+    }
+
+    // Stored as the sine of the cone's half-angle, which is what the sphere-aware test in scene_mlet_is_backfacing
+    // compares against.
+    XMStoreFloat3(&meshlet.cone_axis, axis);
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+
+// Greedy builder: grows the current meshlet with the adjacent triangle that adds the fewest new vertices, and starts
+// from the first unused triangle in index order when there is none or the meshlet is full.
+primitive_meshlets build_primitive(const uint32_t *indices, uint32_t index_count, uint32_t vertex_count,
+                                   const XMFLOAT3 *positions)
+{
+    primitive_meshlets result;
+    const uint32_t triangle_count = index_count / 3;
+    if (triangle_count == 0)
+    {
+        return result;
+    }
+
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (uint32_t i = 0; i < triangle_count * 3; ++i)
+    {
+        ++adjacency_offsets[indices[i] + 1];
+    }
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        adjacency_offsets[v + 1] += adjacency_offsets[v];
+    }
+
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (uint32_t t = 0; t < triangle_count; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<int16_t> slot(vertex_count, -1);
+    uint32_t scan_cursor = 0;
+
+    ash::scene_mesh_meshlet current;
+    auto finish_meshlet = [&]() {
+        if (current.triangle_count == 0)
+        {
+            return;
+        }
+
+        for (uint32_t v = 0; v < current.vertex_count; ++v)
+        {
+            slot[result.vertices[current.first_vertex + v]] = -1;
+        }
+        compute_meshlet_bounds(current, result, positions);
+        result.meshlets.push_back(current);
+
+        current = {};
+        current.first_vertex = static_cast<uint32_t>(result.vertices.size());
+        current.first_triangle = static_cast<uint32_t>(result.triangles.size() / 3);
+    };
+
+    auto new_vertex_count = [&](uint32_t t) {
+        return uint32_t(slot[indices[t * 3 + 0]] < 0) + uint32_t(slot[indices[t * 3 + 1]] < 0) +
+               uint32_t(slot[indices[t * 3 + 2]] < 0);
+    };
+
+    for (uint32_t emitted_count = 0; emitted_count < triangle_count;)
+    {
+        uint32_t best_triangle = UINT32_MAX;
+        uint32_t best_new = 4;
+        for (uint32_t v = 0; v < current.vertex_count && best_new > 0; ++v)
+        {
+            const uint32_t vertex = result.vertices[current.first_vertex + v];
+            for (uint32_t a = adjacency_offsets[vertex]; a < adjacency_offsets[vertex + 1]; ++a)
+            {
+                const uint32_t t = adjacency[a];
+                if (emitted[t])
+                {
+                    continue;
+                }
+
+                const uint32_t added = new_vertex_count(t);
+                if (added < best_new || (added == best_new && t < best_triangle))
+                {
+                    best_new = added;
+                    best_triangle = t;
+                }
+            }
+        }
+
+        if (best_triangle == UINT32_MAX)
+        {
+            while (emitted[scan_cursor])
+            {
+                ++scan_cursor;
+            }
+            best_triangle = scan_cursor;
+            best_new = new_vertex_count(best_triangle);
+        }
+
+        if (current.vertex_count + best_new > ash::scene_mlet_max_vertices ||
+            current.triangle_count + 1 > ash::scene_mlet_max_triangles)
+        {
+            finish_meshlet();
+            continue;
+        }
+
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t vertex = indices[best_triangle * 3 + k];
+            if (slot[vertex] < 0)
+            {
+                slot[vertex] = static_cast<int16_t>(current.vertex_count++);
+                result.vertices.push_back(vertex);
+            }
+            result.triangles.push_back(static_cast<uint8_t>(slot[vertex]));
+        }
+        ++current.triangle_count;
+        emitted[best_triangle] = true;
+        ++emitted_count;
+    }
+    finish_meshlet();
+
+    return result;
+}
+
+std::array<uint32_t, 3> canonical_triangle(uint32_t a, uint32_t b, uint32_t c)
+{
+    // Rotate so the smallest index comes first; winding is preserved.
+    if (b < a && b < c)
+    {
+        return {b, c, a};
+    }
+    if (c < a && c < b)
+    {
+        return {c, a, b};
+    }
+    return {a, b, c};
+}
+} // namespace
+
+void ash::scene_mlet_build(scene_mesh_arena &arena)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_mlet_build")
+
+    std::vector<primitive_meshlets> built(arena.primitives.size());
+    job_parallel_for(static_cast<uint32_t>(arena.primitives.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t p = begin; p < end; ++p)
+        {
+            const scene_mesh_primitive &primitive = arena.primitives[p];
+            built[p] = build_primitive(arena.indices.data() + primitive.first_index, primitive.index_count,
+                                       primitive.vertex_count, arena.positions.data() + primitive.first_vertex);
+        }
+    });
+
+    arena.meshlets.clear();
+    arena.meshlet_vertices.clear();
+    arena.meshlet_triangles.clear();
+    for (std::size_t p = 0; p < built.size(); ++p)
+    {
+        scene_mesh_primitive &primitive = arena.primitives[p];
+        const primitive_meshlets &result = built[p];
+        const uint32_t vertex_offset = static_cast<uint32_t>(arena.meshlet_vertices.size());
+        const uint32_t triangle_offset = static_cast<uint32_t>(arena.meshlet_triangles.size() / 3);
+
+        primitive.first_meshlet = static_cast<uint32_t>(arena.meshlets.size());
+        primitive.meshlet_count = static_cast<uint32_t>(result.meshlets.size());
+        for (scene_mesh_meshlet meshlet : result.meshlets)
+        {
+            meshlet.first_vertex += vertex_offset;
+            meshlet.first_triangle += triangle_offset;
+            arena.meshlets.push_back(meshlet);
+        }
+        arena.meshlet_vertices.insert(arena.meshlet_vertices.end(), result.vertices.begin(), result.vertices.end());
+        arena.meshlet_triangles.insert(arena.meshlet_triangles.end(), result.triangles.begin(),
+                                       result.triangles.end());
+    }
+}
+
+bool ash::scene_mlet_validate(const scene_mesh_arena &arena)
+{
+    for (const scene_mesh_primitive &primitive : arena.primitives)
+    {
+        if (primitive.first_meshlet + primitive.meshlet_count > arena.meshlets.size())
+        {
+            return false;
+        }
+
+        std::vector<std::array<uint32_t, 3>> expected;
+        std::vector<std::array<uint32_t, 3>> found;
+        const uint32_t *indices = arena.indices.data() + primitive.first_index;
+        for (uint32_t i = 0; i + 2 < primitive.index_count; i += 3)
+        {
+            expected.push_back(canonical_triangle(indices[i], indices[i + 1], indices[i + 2]));
+        }
+
+        for (uint32_t m = primitive.first_meshlet; m < primitive.first_meshlet + primitive.meshlet_count; ++m)
+        {
+            const scene_mesh_meshlet &meshlet = arena.meshlets[m];
+            if (meshlet.vertex_count > scene_mlet_max_vertices || meshlet.triangle_count > scene_mlet_max_triangles ||
+                meshlet.first_vertex + meshlet.vertex_count > arena.meshlet_vertices.size() ||
+                (meshlet.first_triangle + meshlet.triangle_count) * 3 > arena.meshlet_triangles.size())
+            {
+                return false;
+            }
+
+            const uint32_t *vertices = arena.meshlet_vertices.data() + meshlet.first_vertex;
+            const uint8_t *triangles = arena.meshlet_triangles.data() + meshlet.first_triangle * 3;
+            for (uint32_t t = 0; t < meshlet.triangle_count * 3; ++t)
+            {
+                if (triangles[t] >= meshlet.vertex_count || vertices[triangles[t]] >= primitive.vertex_count)
+                {
+                    return false;
+                }
+            }
+
+            for (uint32_t t = 0; t < meshlet.triangle_count; ++t)
+            {
+                found.push_back(canonical_triangle(vertices[triangles[t * 3 + 0]], vertices[triangles[t * 3 + 1]],
+                                                   vertices[triangles[t * 3 + 2]]));
+            }
+        }
+
+        std::sort(expected.begin(), expected.end());
+        std::sort(found.begin(), found.end());
+        if (expected != found)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ash::scene_mlet_is_backfacing(const scene_mesh_meshlet &meshlet, FXMVECTOR camera_position)
+{
+    const XMVECTOR sphere = XMLoadFloat4(&meshlet.sphere);
+    const XMVECTOR to_center = XMVectorSubtract(sphere, camera_position);
+    const float distance = XMVectorGetX(XMVector3Length(to_center));
+    const float axis_distance = XMVectorGetX(XMVector3Dot(to_center, XMLoadFloat3(&meshlet.cone_axis)));
+    return axis_distance >= meshlet.cone_cutoff * distance + XMVectorGetW(sphere);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <scene/mesh.h>
+
+namespace ash
+{
+// Limits that fit one meshlet in a 64/128-thread mesh shader group; 124 triangles keep the 3-byte triangle list a
+// multiple of four bytes.
+constexpr uint32_t scene_mlet_max_vertices = 64;
+constexpr uint32_t scene_mlet_max_triangles = 124;
+} // namespace ash
+
+namespace ash
+{
+// Partitions every primitive of `arena` into meshlets, replacing any existing ones. Run after scene_mopt_optimize:
+// the builder grows each meshlet from triangles adjacent to it and falls back to index order, so a cache-optimized
+// order gives compact meshlets. Primitives are processed in parallel.
+void scene_mlet_build(scene_mesh_arena &arena);
+
+// Checks that the meshlets of every primitive respect the limits and contain each of its triangles exactly once.
+bool scene_mlet_validate(const scene_mesh_arena &arena);
+
+// True when every triangle of `meshlet` faces away from `camera_position`, both in the meshlet's local space.
+bool scene_mlet_is_backfacing(const scene_mesh_meshlet &meshlet, DirectX::FXMVECTOR camera_position);
+} // namespace ash
@@ -0,0 +1,147 @@
+#include "name.h"
+#include "scene/scene.h"
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+// Next " (N)" suffix to try for one base name within one parent scope.
+struct name_suffixes
+{
+    uint32_t next = 2;
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> released;
+};
+
+std::unordered_map<flecs::entity_t, std::unordered_map<std::string, name_suffixes>> g_name_index;
+flecs::entity g_name_observer;
+
+flecs::entity lookup_name_in_scope(const std::string &name, flecs::entity parent)
+{
+    if (parent.is_valid())
+    {
+        return parent.lookup(name.c_str(), false);
+    }
+
+    return ash::scene_g_world.lookup(name.c_str(), "::", "::", false);
+}
+
+bool is_name_free(const std::string &name, flecs::entity parent, flecs::entity ignore)
+{
+    flecs::entity existing = lookup_name_in_scope(name, parent);
+    return !existing.is_valid() || (ignore.is_valid() && existing.id() == ignore.id());
+}
+
+std::string make_suffixed_name(const std::string &base_name, uint32_t suffix)
+{
+    return base_name + " (" + std::to_string(suffix) + ")";
+}
+
+// Hands the suffix of `name` back to its scope so the next entity asking for the same base name can reuse it.
+void release_name(flecs::entity_t parent, std::string_view name)
+{
+    if (name.size() < 4 || name.back() != ')')
+    {
+        return;
+    }
+
+    const size_t open = name.rfind(" (");
+    if (open == std::string_view::npos || open + 2 >= name.size() - 1)
+    {
+        return;
+    }
+
+    uint32_t suffix = 0;
+    for (size_t i = open + 2; i < name.size() - 1; ++i)
+    {
+        if (name[i] < '0' || name[i] > '9' || suffix > 100000000)
+        {
+            return;
+        }
+        suffix = suffix * 10 + (name[i] - '0');
+    }
+
+    auto scope = g_name_index.find(parent);
+    if (scope == g_name_index.end())
+    {
+        return;
+    }
+
+    auto suffixes = scope->second.find(std::string(name.substr(0, open)));
+    if (suffixes != scope->second.end() && suffix >= 2 && suffix < suffixes->second.next)
+    {
+        suffixes->second.released.push(suffix);
+    }
+}
+} // namespace
+
+std::string ash::scene_make_unique_name(std::string_view desired_name, flecs::entity parent, flecs::entity ignore)
+{
+    const std::string base_name = desired_name.empty() ? "GameObject" : std::string(desired_name);
+    if (is_name_free(base_name, parent, ignore))
+    {
+        return base_name;
+    }
+
+    // Suffixes released by deleted or renamed entities are reused first, then probing continues from the highest
+    // suffix handed out so far. Every candidate is still checked against flecs, so names set outside this index
+    // can never be duplicated.
+    name_suffixes &suffixes = g_name_index[parent.is_valid() ? parent.id() : 0][base_name];
+    while (!suffixes.released.empty())
+    {
+        const uint32_t suffix = suffixes.released.top();
+        suffixes.released.pop();
+
+        std::string candidate_name = make_suffixed_name(base_name, suffix);
+        if (is_name_free(candidate_name, parent, ignore))
+        {
+            return candidate_name;
+        }
+    }
+
+    while (true)
+    {
+        std::string candidate_name = make_suffixed_name(base_name, suffixes.next++);
+        if (is_name_free(candidate_name, parent, ignore))
+        {
+            return candidate_name;
+        }
+    }
+}
+
+void ash::scene_set_entity_name_safe(flecs::entity entity, std::string_view desired_name)
+{
+    if (!entity.is_valid())
+    {
+        return;
+    }
+
+    const flecs::entity parent = entity.parent();
+    const std::string unique_name = scene_make_unique_name(desired_name, parent, entity);
+    const std::string previous_name = entity.name().c_str();
+    entity.set_name(unique_name.c_str());
+
+    if (previous_name != unique_name)
+    {
+        release_name(parent.is_valid() ? parent.id() : 0, previous_name);
+    }
+}
+
+void ash::scene_name_init()
+{
+    g_name_observer = scene_g_world.observer()
+                          .with<flecs::Identifier>(flecs::Name)
+                          .event(flecs::OnRemove)
+                          .each([](flecs::entity entity) {
+                              const flecs::entity parent = entity.parent();
+                              release_name(parent.is_valid() ? parent.id() : 0, entity.name().c_str());
+                              g_name_index.erase(entity.id());
+                          });
+}
+
+void ash::scene_name_shutdown()
+{
+    g_name_observer.destruct();
+    g_name_index.clear();
+}
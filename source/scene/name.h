@@ -0,0 +1,17 @@
+#pragma once
+
+#include <flecs.h>
+#include <string>
+#include <string_view>
+
+namespace ash
+{
+// Returns `desired_name` if it is free in the parent's scope, else "desired_name (N)". A per-scope index keeps the next
+// suffix and the suffixes freed by deleted or renamed entities, so naming many same-named siblings is linear.
+std::string scene_make_unique_name(std::string_view desired_name, flecs::entity parent = {}, flecs::entity ignore = {});
+void scene_set_entity_name_safe(flecs::entity entity, std::string_view desired_name);
+
+// Registers the observer that hands the suffixes of deleted entities back to the index.
+void scene_name_init();
+void scene_name_shutdown();
+} // namespace ash
@@ -0,0 +1,453 @@
+#include "occlusion.h"
+#include "editor/console.h"
+#include "job/cpu.h"
+#include "job/parallel.h"
+#include "scene/scene.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <common.h>
+#include <string>
+
+#if ASH_CPU_X86
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_tiles_x = ash::scene_occ_width / ash::scene_occ_tile_size;
+constexpr uint32_t g_tiles_y = ash::scene_occ_height / ash::scene_occ_tile_size;
+constexpr uint32_t g_band_count = ash::scene_occ_height / ash::scene_occ_band_height;
+constexpr uint32_t g_test_grain = 256;
+constexpr float g_min_w = 1e-4f;
+
+static_assert(ash::scene_occ_width % 8 == 0, "rows are processed 8 pixels at a time");
+static_assert(ash::scene_occ_height % ash::scene_occ_band_height == 0);
+static_assert(ash::scene_occ_band_height % ash::scene_occ_tile_size == 0);
+
+// Corner i has x, y and z taken from the max side when bit 0, 1 and 2 are set.
+constexpr uint8_t g_box_triangles[12][3] = {{0, 2, 6}, {0, 6, 4}, {1, 5, 7}, {1, 7, 3}, {0, 4, 5}, {0, 5, 1},
+                                            {2, 3, 7}, {2, 7, 6}, {0, 1, 3}, {0, 3, 2}, {4, 6, 7}, {4, 7, 5}};
+
+#if ASH_CPU_X86
+const bool g_has_avx2 = ash::job_cpu_has_avx2();
+#endif
+
+// Projects the 8 corners of the bounds box to (pixel x, pixel y, ndc z). Fails if any corner is behind the eye.
+bool project_box(const ash::bounds &local_bounds, FXMMATRIX world_view_proj, XMFLOAT3 out[8])
+{
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        const XMFLOAT3 &c = local_bounds.center;
+        const XMFLOAT3 &e = local_bounds.extents;
+        const XMVECTOR corner =
+            XMVectorSet(c.x + (i & 1 ? e.x : -e.x), c.y + (i & 2 ? e.y : -e.y), c.z + (i & 4 ? e.z : -e.z), 1.0f);
+
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector4Transform(corner, world_view_proj));
+        if (clip.w < g_min_w)
+        {
+            return false;
+        }
+
+        const float inv_w = 1.0f / clip.w;
+        out[i].x = (clip.x * inv_w * 0.5f + 0.5f) * ash::scene_occ_width;
+        out[i].y = (0.5f - clip.y * inv_w * 0.5f) * ash::scene_occ_height;
+        out[i].z = clip.z * inv_w;
+    }
+
+    return true;
+}
+
+bool setup_triangle(const XMFLOAT3 &v0, const XMFLOAT3 &v1, const XMFLOAT3 &v2, ash::scene_occ_triangle &tri)
+{
+    const float dx1 = v1.x - v0.x, dy1 = v1.y - v0.y, dz1 = v1.z - v0.z;
+    const float dx2 = v2.x - v0.x, dy2 = v2.y - v0.y, dz2 = v2.z - v0.z;
+    const float area = dx1 * dy2 - dx2 * dy1;
+    if (std::abs(area) < 1e-6f)
+    {
+        return false;
+    }
+
+    tri.min_x = std::max(0, static_cast<int32_t>(std::floor(std::min({v0.x, v1.x, v2.x}))));
+    tri.max_x = std::min<int32_t>(ash::scene_occ_width - 1,
+                                  static_cast<int32_t>(std::ceil(std::max({v0.x, v1.x, v2.x}))));
+    tri.min_y = std::max(0, static_cast<int32_t>(std::floor(std::min({v0.y, v1.y, v2.y}))));
+    tri.max_y = std::min<int32_t>(ash::scene_occ_height - 1,
+                                  static_cast<int32_t>(std::ceil(std::max({v0.y, v1.y, v2.y}))));
+    if (tri.min_x > tri.max_x || tri.min_y > tri.max_y)
+    {
+        return false;
+    }
+
+    // Occluders are drawn double-sided, so flip the edges of clockwise triangles to keep "inside" non-negative.
+    const float sign = area > 0.0f ? 1.0f : -1.0f;
+    const XMFLOAT3 *v[3] = {&v0, &v1, &v2};
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const XMFLOAT3 &a = *v[i];
+        const XMFLOAT3 &b = *v[(i + 1) % 3];
+        tri.edge_a[i] = sign * (a.y - b.y);
+        tri.edge_b[i] = sign * (b.x - a.x);
+        tri.edge_c[i] = sign * (a.x * b.y - b.x * a.y);
+    }
+
+    tri.z_a = (dz1 * dy2 - dz2 * dy1) / area;
+    tri.z_b = (dx1 * dz2 - dx2 * dz1) / area;
+    tri.z_c = v0.z - tri.z_a * v0.x - tri.z_b * v0.y;
+    return true;
+}
+
+void rasterize_rows_scalar(float *depth, const ash::scene_occ_triangle &tri, int32_t y0, int32_t y1)
+{
+    for (int32_t y = y0; y <= y1; ++y)
+    {
+        const float py = y + 0.5f;
+        const float e0 = tri.edge_b[0] * py + tri.edge_c[0];
+        const float e1 = tri.edge_b[1] * py + tri.edge_c[1];
+        const float e2 = tri.edge_b[2] * py + tri.edge_c[2];
+        const float z = tri.z_b * py + tri.z_c;
+
+        float *row = depth + y * ash::scene_occ_width;
+        for (int32_t x = tri.min_x; x <= tri.max_x; ++x)
+        {
+            const float px = x + 0.5f;
+            if (tri.edge_a[0] * px + e0 >= 0.0f && tri.edge_a[1] * px + e1 >= 0.0f && tri.edge_a[2] * px + e2 >= 0.0f)
+            {
+                row[x] = std::min(row[x], tri.z_a * px + z);
+            }
+        }
+    }
+}
+
+#if ASH_CPU_X86
+// Walks the triangle's bounding box 8 pixels at a time. Edge and depth values are evaluated from the exact pixel
+// centers of each block rather than stepped, so steep depth planes do not accumulate error.
+void rasterize_rows_avx2(float *depth, const ash::scene_occ_triangle &tri, int32_t y0, int32_t y1)
+{
+    const int32_t x_begin = tri.min_x & ~7;
+    const __m256 lane = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 px_begin = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x_begin)), lane);
+    const __m256 px_step = _mm256_set1_ps(8.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 a0 = _mm256_set1_ps(tri.edge_a[0]);
+    const __m256 a1 = _mm256_set1_ps(tri.edge_a[1]);
+    const __m256 a2 = _mm256_set1_ps(tri.edge_a[2]);
+    const __m256 z_a = _mm256_set1_ps(tri.z_a);
+
+    for (int32_t y = y0; y <= y1; ++y)
+    {
+        const float py = y + 0.5f;
+        const __m256 e0 = _mm256_set1_ps(tri.edge_b[0] * py + tri.edge_c[0]);
+        const __m256 e1 = _mm256_set1_ps(tri.edge_b[1] * py + tri.edge_c[1]);
+        const __m256 e2 = _mm256_set1_ps(tri.edge_b[2] * py + tri.edge_c[2]);
+        const __m256 z = _mm256_set1_ps(tri.z_b * py + tri.z_c);
+
+        float *row = depth + y * ash::scene_occ_width;
+        __m256 px = px_begin;
+        for (int32_t x = x_begin; x <= tri.max_x; x += 8, px = _mm256_add_ps(px, px_step))
+        {
+            const __m256 inside0 = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, px), e0), zero, _CMP_GE_OQ);
+            const __m256 inside1 = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, px), e1), zero, _CMP_GE_OQ);
+            const __m256 inside2 = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, px), e2), zero, _CMP_GE_OQ);
+            const __m256 inside = _mm256_and_ps(_mm256_and_ps(inside0, inside1), inside2);
+            if (_mm256_testz_ps(inside, inside))
+            {
+                continue;
+            }
+
+            const __m256 current = _mm256_loadu_ps(row + x);
+            const __m256 pixel_z = _mm256_add_ps(_mm256_mul_ps(z_a, px), z);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, pixel_z), inside));
+        }
+    }
+}
+#endif
+
+void update_tile_max(ash::scene_occ_buffer &buffer, uint32_t tile_y0, uint32_t tile_y1)
+{
+    for (uint32_t ty = tile_y0; ty < tile_y1; ++ty)
+    {
+        for (uint32_t tx = 0; tx < g_tiles_x; ++tx)
+        {
+            float tile_max = 0.0f;
+            for (uint32_t y = 0; y < ash::scene_occ_tile_size; ++y)
+            {
+                const float *row = buffer.depth.data() + (ty * ash::scene_occ_tile_size + y) * ash::scene_occ_width +
+                                   tx * ash::scene_occ_tile_size;
+                tile_max = std::max(tile_max, *std::max_element(row, row + ash::scene_occ_tile_size));
+            }
+            buffer.tile_max[ty * g_tiles_x + tx] = tile_max;
+        }
+    }
+}
+
+void rasterize_band(ash::scene_occ_buffer &buffer, uint32_t band)
+{
+    const int32_t band_y0 = static_cast<int32_t>(band * ash::scene_occ_band_height);
+    const int32_t band_y1 = band_y0 + static_cast<int32_t>(ash::scene_occ_band_height) - 1;
+
+    for (const ash::scene_occ_triangle &tri : buffer.triangles)
+    {
+        const int32_t y0 = std::max(tri.min_y, band_y0);
+        const int32_t y1 = std::min(tri.max_y, band_y1);
+        if (y0 > y1)
+        {
+            continue;
+        }
+
+#if ASH_CPU_X86
+        if (g_has_avx2)
+        {
+            rasterize_rows_avx2(buffer.depth.data(), tri, y0, y1);
+        }
+        else
+#endif
+        {
+            rasterize_rows_scalar(buffer.depth.data(), tri, y0, y1);
+        }
+    }
+
+    const uint32_t tiles_per_band = ash::scene_occ_band_height / ash::scene_occ_tile_size;
+    update_tile_max(buffer, band * tiles_per_band, (band + 1) * tiles_per_band);
+}
+} // namespace
+
+void ash::scene_occ_begin(scene_occ_buffer &buffer, FXMMATRIX view_proj)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_occ_begin")
+
+    buffer.depth.assign(scene_occ_width * scene_occ_height, 1.0f);
+    buffer.tile_max.assign(g_tiles_x * g_tiles_y, 1.0f);
+    buffer.triangles.clear();
+    XMStoreFloat4x4(&buffer.view_proj, view_proj);
+}
+
+void ash::scene_occ_add_occluder(scene_occ_buffer &buffer, const bounds &local_bounds, FXMMATRIX world)
+{
+    XMFLOAT3 corners[8];
+    if (!project_box(local_bounds, world * XMLoadFloat4x4(&buffer.view_proj), corners))
+    {
+        return;
+    }
+
+    for (const auto &indices : g_box_triangles)
+    {
+        scene_occ_triangle tri;
+        if (setup_triangle(corners[indices[0]], corners[indices[1]], corners[indices[2]], tri))
+        {
+            buffer.triangles.push_back(tri);
+        }
+    }
+}
+
+void ash::scene_occ_rasterize(scene_occ_buffer &buffer)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_occ_rasterize")
+
+    // Each band owns a disjoint range of rows and tiles, so bands are rasterized on worker threads without locking.
+    job_parallel_for(g_band_count, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t band = begin; band < end; ++band)
+        {
+            rasterize_band(buffer, band);
+        }
+    });
+
+    // Triangles spanning several bands are rasterized once per band but counted once.
+    scene_occ_g_stats.rasterized_triangles = static_cast<uint32_t>(buffer.triangles.size());
+}
+
+bool ash::scene_occ_test_box(const scene_occ_buffer &buffer, const bounds &local_bounds, FXMMATRIX world)
+{
+    XMFLOAT3 corners[8];
+    if (!project_box(local_bounds, world * XMLoadFloat4x4(&buffer.view_proj), corners))
+    {
+        return true;
+    }
+
+    float min_x = FLT_MAX, min_y = FLT_MAX, min_z = FLT_MAX;
+    float max_x = -FLT_MAX, max_y = -FLT_MAX;
+    for (const XMFLOAT3 &corner : corners)
+    {
+        min_x = std::min(min_x, corner.x);
+        min_y = std::min(min_y, corner.y);
+        min_z = std::min(min_z, corner.z);
+        max_x = std::max(max_x, corner.x);
+        max_y = std::max(max_y, corner.y);
+    }
+
+    const int32_t x0 = std::max(0, static_cast<int32_t>(std::floor(min_x)));
+    const int32_t y0 = std::max(0, static_cast<int32_t>(std::floor(min_y)));
+    const int32_t x1 = std::min<int32_t>(scene_occ_width - 1, static_cast<int32_t>(std::ceil(max_x)));
+    const int32_t y1 = std::min<int32_t>(scene_occ_height - 1, static_cast<int32_t>(std::ceil(max_y)));
+    if (x0 > x1 || y0 > y1)
+    {
+        return true;
+    }
+
+    // Whole tiles farther than the box are rejected from tile_max alone; only the remaining tiles are checked per
+    // pixel against the part of the box rectangle they contain.
+    for (int32_t ty = y0 / scene_occ_tile_size; ty <= y1 / static_cast<int32_t>(scene_occ_tile_size); ++ty)
+    {
+        for (int32_t tx = x0 / scene_occ_tile_size; tx <= x1 / static_cast<int32_t>(scene_occ_tile_size); ++tx)
+        {
+            if (min_z > buffer.tile_max[ty * g_tiles_x + tx])
+            {
+                continue;
+            }
+
+            const int32_t py0 = std::max<int32_t>(y0, ty * scene_occ_tile_size);
+            const int32_t py1 = std::min<int32_t>(y1, (ty + 1) * scene_occ_tile_size - 1);
+            const int32_t px0 = std::max<int32_t>(x0, tx * scene_occ_tile_size);
+            const int32_t px1 = std::min<int32_t>(x1, (tx + 1) * scene_occ_tile_size - 1);
+            for (int32_t y = py0; y <= py1; ++y)
+            {
+                const float *row = buffer.depth.data() + y * scene_occ_width;
+                for (int32_t x = px0; x <= px1; ++x)
+                {
+                    if (min_z <= row[x])
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void ash::scene_occ_cull(std::vector<flecs::entity_t> &visible, FXMMATRIX view_proj, const XMFLOAT3 &eye)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_occ_cull")
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    thread_local std::vector<std::pair<float, flecs::entity_t>> candidates;
+    candidates.clear();
+    for (flecs::entity_t id : visible)
+    {
+        const flecs::entity entity(scene_g_world, id);
+        if (!entity.has<occluder>())
+        {
+            continue;
+        }
+
+        // Screen-space size is approximated by bounding-sphere radius over distance to the eye.
+        const XMFLOAT4 &sphere = entity.get<bounds>().world_sphere;
+        const float dx = sphere.x - eye.x, dy = sphere.y - eye.y, dz = sphere.z - eye.z;
+        const float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 1e-3f);
+        candidates.emplace_back(sphere.w / distance, id);
+    }
+
+    const size_t occluder_count = std::min<size_t>(candidates.size(), scene_occ_max_occluders);
+    std::partial_sort(candidates.begin(), candidates.begin() + occluder_count, candidates.end(),
+                      [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    scene_occ_buffer &buffer = scene_occ_g_buffer;
+    scene_occ_begin(buffer, view_proj);
+    for (size_t i = 0; i < occluder_count; ++i)
+    {
+        const flecs::entity entity(scene_g_world, candidates[i].second);
+        scene_occ_add_occluder(buffer, entity.get<bounds>(), XMLoadFloat4x4(&entity.get<world_transform>().matrix));
+    }
+
+    scene_occ_g_stats.occluders = static_cast<uint32_t>(occluder_count);
+    scene_occ_g_stats.rasterized_triangles = 0;
+    if (!buffer.triangles.empty())
+    {
+        scene_occ_rasterize(buffer);
+    }
+
+    const auto raster_end = std::chrono::high_resolution_clock::now();
+    scene_occ_g_stats.raster_ms = std::chrono::duration<float, std::milli>(raster_end - start).count();
+    scene_occ_g_stats.tested = static_cast<uint32_t>(visible.size());
+    scene_occ_g_stats.culled = 0;
+    if (buffer.triangles.empty())
+    {
+        return;
+    }
+
+    thread_local std::vector<uint8_t> keep;
+    keep.resize(visible.size());
+    job_parallel_for(static_cast<uint32_t>(visible.size()), g_test_grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const flecs::entity entity(scene_g_world, visible[i]);
+            const bounds *entity_bounds = entity.try_get<bounds>();
+            keep[i] = !entity_bounds ||
+                      scene_occ_test_box(buffer, *entity_bounds, XMLoadFloat4x4(&entity.get<world_transform>().matrix));
+        }
+    });
+
+    size_t kept = 0;
+    for (size_t i = 0; i < visible.size(); ++i)
+    {
+        if (keep[i])
+        {
+            visible[kept++] = visible[i];
+        }
+    }
+
+    scene_occ_g_stats.culled = static_cast<uint32_t>(visible.size() - kept);
+    visible.resize(kept);
+}
+
+ash::scene_occ_test_layout ash::scene_occ_get_test_layout()
+{
+    constexpr uint32_t grid_x = 32;
+    constexpr uint32_t grid_y = 16;
+    constexpr uint32_t grid_z = 8;
+
+    // A wall of occluders in front of the camera hides most of a dense block of small instances behind it; the
+    // block is wider than the wall so the edges stay visible.
+    scene_occ_test_layout layout;
+    layout.occluder_bounds = {{0.0f, 0.0f, 0.0f}, {0.5f, 0.5f, 0.1f}};
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        transform wall_transform = {};
+        wall_transform.position = {-12.0f + 8.0f * i, 0.0f, 10.0f};
+        wall_transform.scale = {8.0f, 12.0f, 1.0f};
+        layout.occluders.push_back(wall_transform);
+    }
+
+    for (uint32_t z = 0; z < grid_z; ++z)
+    {
+        for (uint32_t y = 0; y < grid_y; ++y)
+        {
+            for (uint32_t x = 0; x < grid_x; ++x)
+            {
+                transform instance_transform = {};
+                instance_transform.position = {-20.0f + 1.25f * x, -8.0f + 1.0f * y, 14.0f + 2.0f * z};
+                instance_transform.scale = {0.5f, 0.5f, 0.5f};
+                layout.instances.push_back(instance_transform);
+            }
+        }
+    }
+    return layout;
+}
+
+void ash::scene_occ_create_test_scene()
+{
+    const scene_occ_test_layout layout = scene_occ_get_test_layout();
+
+    flecs::entity root = scene_g_world.entity().add<game_object>().set<transform>({});
+    scene_set_entity_name_safe(root, "Occlusion Test");
+
+    for (std::size_t i = 0; i < layout.occluders.size(); ++i)
+    {
+        flecs::entity wall = scene_g_world.entity().add<game_object>().add<occluder>().child_of(root);
+        wall.set<bounds>(layout.occluder_bounds);
+        wall.set<transform>(layout.occluders[i]);
+        scene_set_entity_name_safe(wall, "Occluder_" + std::to_string(i));
+    }
+
+    for (const transform &instance_transform : layout.instances)
+    {
+        scene_g_world.entity().add<game_object>().child_of(root).set<transform>(instance_transform);
+    }
+
+    ed_console_log(ed_console_log_level::info, "[Scene] Occlusion test scene created.");
+}
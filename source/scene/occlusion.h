@@ -0,0 +1,84 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <flecs.h>
+#include <scene/component.h>
+#include <vector>
+
+namespace ash
+{
+constexpr uint32_t scene_occ_width = 320;
+constexpr uint32_t scene_occ_height = 192;
+constexpr uint32_t scene_occ_tile_size = 8;
+constexpr uint32_t scene_occ_band_height = 16;
+constexpr uint32_t scene_occ_max_occluders = 64;
+
+// Screen-space occluder triangle. Edge functions are a * x + b * y + c and are non-negative inside; depth is the
+// plane z = z_a * x + z_b * y + z_c.
+struct scene_occ_triangle
+{
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    float z_a;
+    float z_b;
+    float z_c;
+    int32_t min_x;
+    int32_t max_x;
+    int32_t min_y;
+    int32_t max_y;
+};
+
+// Low-resolution depth buffer (z in [0, 1], 1 = far) plus the farthest depth of every tile, which is what most
+// occlusion tests read.
+struct scene_occ_buffer
+{
+    std::vector<float> depth;
+    std::vector<float> tile_max;
+    std::vector<scene_occ_triangle> triangles;
+    DirectX::XMFLOAT4X4 view_proj;
+};
+
+struct scene_occ_stats
+{
+    uint32_t occluders = 0;
+    uint32_t rasterized_triangles = 0;
+    uint32_t tested = 0;
+    uint32_t culled = 0;
+    float raster_ms = 0.0f;
+};
+
+// Walls and instances of scene_occ_create_test_scene as plain transforms, so the scene can be culled without a world.
+// Instances use the default bounds.
+struct scene_occ_test_layout
+{
+    bounds occluder_bounds;
+    std::vector<transform> occluders;
+    std::vector<transform> instances;
+};
+
+inline scene_occ_buffer scene_occ_g_buffer;
+inline scene_occ_stats scene_occ_g_stats;
+} // namespace ash
+
+namespace ash
+{
+void scene_occ_begin(scene_occ_buffer &buffer, DirectX::FXMMATRIX view_proj);
+
+// Queues the 12 triangles of the entity's bounds box. Boxes crossing the near plane are skipped, which only makes
+// culling less aggressive.
+void scene_occ_add_occluder(scene_occ_buffer &buffer, const bounds &local_bounds, DirectX::FXMMATRIX world);
+void scene_occ_rasterize(scene_occ_buffer &buffer);
+
+// Returns false only when the whole bounds box lies behind the rasterized occluders.
+bool scene_occ_test_box(const scene_occ_buffer &buffer, const bounds &local_bounds, DirectX::FXMMATRIX world);
+
+// Picks the largest on-screen occluders among the frustum-visible entities, rasterizes them and removes every
+// entity they fully hide from `visible`.
+void scene_occ_cull(std::vector<flecs::entity_t> &visible, DirectX::FXMMATRIX view_proj,
+                    const DirectX::XMFLOAT3 &eye);
+
+scene_occ_test_layout scene_occ_get_test_layout();
+void scene_occ_create_test_scene();
+} // namespace ash
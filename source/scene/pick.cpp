@@ -0,0 +1,95 @@
+#include "pick.h"
+#include "scene/mesh_bvh.h"
+#include "scene/scene.h"
+#include <common.h>
+
+using namespace DirectX;
+
+void ash::scene_pick_get_ray(const camera &cam, float x, float y, float width, float height, XMFLOAT3 &origin,
+                             XMFLOAT3 &direction)
+{
+    const XMMATRIX view_proj = XMLoadFloat4x4(&cam.mat_view) * XMLoadFloat4x4(&cam.mat_proj);
+    const XMMATRIX inv_view_proj = XMMatrixInverse(nullptr, view_proj);
+
+    const float ndc_x = 2.0f * x / width - 1.0f;
+    const float ndc_y = 1.0f - 2.0f * y / height;
+    const XMVECTOR near_point = XMVector3TransformCoord(XMVectorSet(ndc_x, ndc_y, 0.0f, 1.0f), inv_view_proj);
+    const XMVECTOR far_point = XMVector3TransformCoord(XMVectorSet(ndc_x, ndc_y, 1.0f, 1.0f), inv_view_proj);
+
+    XMStoreFloat3(&origin, near_point);
+    XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSubtract(far_point, near_point)));
+}
+
+bool ash::scene_pick_ray(const scene_bvh &bvh, const scene_mesh_arena &arena, const XMFLOAT3 &origin,
+                         const XMFLOAT3 &direction, float max_distance, scene_pick_hit &hit)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_pick_ray")
+
+    thread_local std::vector<scene_bvh_ray_hit> candidates;
+    candidates.clear();
+    scene_bvh_query_ray(bvh, origin, direction, max_distance, candidates);
+
+    // The ray is moved into each entity's local space without renormalizing its direction, so the ray parameter of
+    // a local hit is still the world distance and hits of different entities compare directly.
+    scene_mbvh_hit nearest;
+    nearest.distance = max_distance;
+    bool found = false;
+    for (const scene_bvh_ray_hit &candidate : candidates)
+    {
+        if (candidate.distance > nearest.distance)
+        {
+            break;
+        }
+
+        const flecs::entity entity(scene_g_world, candidate.entity);
+        const mesh *entity_mesh = entity.try_get<mesh>();
+        const world_transform *entity_transform = entity.try_get<world_transform>();
+        if (!entity_mesh || !entity_transform)
+        {
+            continue;
+        }
+
+        XMVECTOR determinant;
+        const XMMATRIX world_to_local = XMMatrixInverse(&determinant, XMLoadFloat4x4(&entity_transform->matrix));
+        if (XMVectorGetX(determinant) == 0.0f)
+        {
+            continue;
+        }
+
+        XMFLOAT3 local_origin, local_direction;
+        XMStoreFloat3(&local_origin, XMVector3TransformCoord(XMLoadFloat3(&origin), world_to_local));
+        XMStoreFloat3(&local_direction, XMVector3TransformNormal(XMLoadFloat3(&direction), world_to_local));
+        if (scene_mbvh_intersect(arena, entity_mesh->index, local_origin, local_direction, nearest))
+        {
+            hit.entity = candidate.entity;
+            found = true;
+        }
+    }
+
+    if (found)
+    {
+        hit.distance = nearest.distance;
+        hit.primitive = nearest.primitive;
+        hit.triangle = nearest.triangle;
+    }
+    return found;
+}
+
+flecs::entity ash::scene_pick_select(float x, float y, float width, float height)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_pick_select")
+
+    if (width <= 0.0f || height <= 0.0f)
+    {
+        return scene_g_selected;
+    }
+
+    XMFLOAT3 origin, direction;
+    scene_pick_get_ray(g_camera, x, y, width, height, origin, direction);
+
+    scene_pick_hit hit;
+    scene_g_selected = scene_pick_ray(scene_bvh_g_tree, scene_mesh_g_arena, origin, direction, FLT_MAX, hit)
+                           ? flecs::entity(scene_g_world, hit.entity)
+                           : flecs::entity();
+    return scene_g_selected;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cfloat>
+#include <cstdint>
+#include <flecs.h>
+#include <scene/bvh.h>
+#include <scene/camera.h>
+#include <scene/mesh.h>
+
+namespace ash
+{
+// Nearest mesh entity along a pick ray. distance is in world units from the ray origin; primitive and triangle
+// identify the triangle hit, as in scene_mbvh_hit.
+struct scene_pick_hit
+{
+    flecs::entity_t entity = 0;
+    float distance = FLT_MAX;
+    uint32_t primitive = UINT32_MAX;
+    uint32_t triangle = UINT32_MAX;
+};
+} // namespace ash
+
+namespace ash
+{
+// World-space ray through point (x, y), in pixels from the top-left corner, of a width x height view rendered with
+// `cam`. The ray starts on the near plane and `direction` is unit length.
+void scene_pick_get_ray(const camera &cam, float x, float y, float width, float height, DirectX::XMFLOAT3 &origin,
+                        DirectX::XMFLOAT3 &direction);
+
+// Finds the nearest triangle of any mesh entity in `bvh` hit by a ray with unit-length `direction`. Entities are
+// visited front to back by the entry distance of their bounds, so the search stops at the first entity that starts
+// behind the closest hit. Each candidate's mesh BVH is queried in its local space.
+bool scene_pick_ray(const scene_bvh &bvh, const scene_mesh_arena &arena, const DirectX::XMFLOAT3 &origin,
+                    const DirectX::XMFLOAT3 &direction, float max_distance, scene_pick_hit &hit);
+
+// Picks the entity under point (x, y) of the viewport image and makes it the selection; clicking empty space clears
+// the selection. Returns the new selection.
+flecs::entity scene_pick_select(float x, float y, float width, float height);
+} // namespace ash
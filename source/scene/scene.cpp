@@ -1,18 +1,23 @@
 #include "scene.h"
 #include "editor/console.h"
 #include "editor/editor.h"
+#include "job/scheduler.h"
 #include "renderer/core/command_queue.h"
 #include "renderer/core/swapchain.h"
 #include "renderer/pipeline/pipeline.h"
 #include "renderer/renderer.h"
+#include "scene/bvh.h"
 #include "scene/camera.h"
+#include "scene/culling.h"
+#include "scene/gltf_import.h"
+#include "scene/gpu_scene.h"
+#include "scene/lod.h"
+#include "scene/mesh.h"
+#include "scene/occlusion.h"
+#include "scene/transform.h"
 #include <common.h>
-#include <fastgltf/core.hpp>
-#include <fastgltf/math.hpp>
-#include <fastgltf/types.hpp>
 #include <filesystem>
-#include <functional>
-#include <iostream>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -21,50 +26,143 @@ using namespace DirectX;
 
 namespace
 {
-inline com_ptr<D3D12MA::Allocation> g_scene_buffer;
+std::vector<flecs::entity_t> g_visible_entities;
 
-flecs::entity lookup_name_in_scope(const std::string &name, flecs::entity parent)
+const ash::rhi_pl_pipeline_state &get_instanced_pipeline(ash::scene_inst_format format)
 {
-    if (parent.is_valid())
+    switch (format)
     {
-        return parent.lookup(name.c_str(), false);
+    case ash::scene_inst_format::affine:
+        return ash::rhi_pl_g_triangle_instanced_affine;
+    case ash::scene_inst_format::quantized_trs:
+        return ash::rhi_pl_g_triangle_instanced_trs;
+    case ash::scene_inst_format::matrix:
+    default:
+        return ash::rhi_pl_g_triangle_instanced;
     }
+}
+
+constexpr float g_clear_color[] = {0.0f, 0.0f, 0.0f, 1.0f};
+
+struct scene_pass
+{
+    XMFLOAT4X4 view_proj;
+    uint32_t visible_count;
+    ash::scene_inst_format format;
+    ID3D12GraphicsCommandList *command_list;
+};
+
+struct editor_pass
+{
+    uint8_t backbuffer;
+    ID3D12GraphicsCommandList *command_list;
+};
 
-    return ash::scene_g_world.lookup(name.c_str(), "::", "::", false);
+void transition(ID3D12GraphicsCommandList *command_list, ID3D12Resource *resource, D3D12_RESOURCE_STATES before,
+                D3D12_RESOURCE_STATES after)
+{
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Transition.pResource = resource;
+    barrier.Transition.StateBefore = before;
+    barrier.Transition.StateAfter = after;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    command_list->ResourceBarrier(1, &barrier);
 }
-} // namespace
 
-std::string ash::scene_make_unique_name(std::string_view desired_name, flecs::entity parent, flecs::entity ignore)
+// Draws the visible instances into the viewport texture. Runs on a job worker, into a list of its own.
+void record_scene_pass(scene_pass &pass)
 {
-    const std::string base_name = desired_name.empty() ? "GameObject" : std::string(desired_name);
-    std::string candidate_name = base_name;
+    SCOPED_CPU_EVENT(L"ash::scene_record_scene_pass")
 
-    uint32_t suffix = 2;
-    while (true)
+    ID3D12GraphicsCommandList *command_list = ash::rhi_cmd_acquire(ash::rhi_cmd_queue_type::direct);
+    pass.command_list = command_list;
     {
-        flecs::entity existing = lookup_name_in_scope(candidate_name, parent);
-        const bool is_unique = !existing.is_valid() || (ignore.is_valid() && existing.id() == ignore.id());
+        SCOPED_GPU_EVENT(command_list, L"ash::scene_render")
+
+        ID3D12DescriptorHeap *heap[] = {ash::rhi_g_cbv_srv_uav_heap.get(), ash::rhi_g_sampler_heap.get()};
+        command_list->SetDescriptorHeaps(2, heap);
+
+        const ash::rhi_pl_pipeline_state &pipeline = get_instanced_pipeline(pass.format);
+        command_list->SetGraphicsRootSignature(pipeline.root_signature.get());
+
+        transition(command_list, ash::rhi_g_viewport_texture->GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                   D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE viewport_rtv_handle =
+            ash::rhi_g_viewport_rtv_heap->GetCPUDescriptorHandleForHeapStart();
+        D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle = ash::rhi_g_viewport_dsv_heap->GetCPUDescriptorHandleForHeapStart();
 
-        if (is_unique)
+        command_list->OMSetRenderTargets(1, &viewport_rtv_handle, FALSE, &dsv_handle);
+
+        command_list->ClearRenderTargetView(viewport_rtv_handle, g_clear_color, 0, nullptr);
+        command_list->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+        command_list->SetPipelineState(pipeline.pso.get());
+        command_list->RSSetViewports(1, &ash::rhi_g_viewport);
+        D3D12_RECT scissorRect = {0, 0, static_cast<UINT>(ash::rhi_g_viewport.Width),
+                                  static_cast<UINT>(ash::rhi_g_viewport.Height)};
+        command_list->RSSetScissorRects(1, &scissorRect);
+        command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        struct SceneData
+        {
+            XMFLOAT4X4 vp;
+            uint32_t buffer_id;
+            uint32_t visible_buffer_id;
+        };
+
+        SceneData sd;
+        sd.vp = pass.view_proj;
+        sd.buffer_id = ash::scene_gpu_instance_descriptor + ash::rhi_frame_g_ring.index;
+        sd.visible_buffer_id = ash::scene_gpu_visible_descriptor + ash::rhi_frame_g_ring.index;
+
+        command_list->SetGraphicsRoot32BitConstants(0, 18, &sd, 0);
+
+        if (pass.visible_count > 0)
         {
-            return candidate_name;
+            command_list->DrawInstanced(3, pass.visible_count, 0, 0);
         }
 
-        candidate_name = base_name + " (" + std::to_string(suffix++) + ")";
+        transition(command_list, ash::rhi_g_viewport_texture->GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET,
+                   D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
     }
+    command_list->Close();
 }
 
-void ash::scene_set_entity_name_safe(flecs::entity entity, std::string_view desired_name)
+// Draws the editor UI, which samples the viewport texture, into the back buffer. Runs on a job worker, into a list of
+// its own that is submitted after the scene pass.
+void record_editor_pass(editor_pass &pass)
 {
-    if (!entity.is_valid())
+    SCOPED_CPU_EVENT(L"ash::scene_record_editor_pass")
+
+    ID3D12GraphicsCommandList *command_list = ash::rhi_cmd_acquire(ash::rhi_cmd_queue_type::direct);
+    pass.command_list = command_list;
     {
-        return;
-    }
+        SCOPED_GPU_EVENT(command_list, L"ash::ed_render_backend")
+
+        ID3D12Resource *render_target = ash::rhi_sw_g_render_targets[pass.backbuffer].get();
+
+        const uint32_t rtv_descriptor_size =
+            ash::rhi_g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        D3D12_CPU_DESCRIPTOR_HANDLE swapchain_rtv_Handle =
+            ash::rhi_sw_g_swapchain_rtv_heap->GetCPUDescriptorHandleForHeapStart();
+        swapchain_rtv_Handle.ptr += pass.backbuffer * rtv_descriptor_size;
+
+        transition(command_list, render_target, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-    const flecs::entity parent = entity.parent();
-    const std::string unique_name = scene_make_unique_name(desired_name, parent, entity);
-    entity.set_name(unique_name.c_str());
+        ID3D12DescriptorHeap *heap[] = {ash::rhi_g_cbv_srv_uav_heap.get(), ash::rhi_g_sampler_heap.get()};
+        command_list->SetDescriptorHeaps(2, heap);
+        command_list->OMSetRenderTargets(1, &swapchain_rtv_Handle, FALSE, nullptr);
+        command_list->ClearRenderTargetView(swapchain_rtv_Handle, g_clear_color, 0, nullptr);
+
+        ash::ed_render_backend(command_list);
+
+        transition(command_list, render_target, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    }
+    command_list->Close();
 }
+} // namespace
 
 flecs::entity ash::scene_create_empty(flecs::entity parent)
 {
@@ -86,275 +184,77 @@ flecs::entity ash::scene_create_empty(flecs::entity parent)
 
 bool ash::scene_load_gltf(const std::filesystem::path &path)
 {
-    ed_console_log(ed_console_log_level::info, "[Scene] glTF import begin.");
-
-    if (!std::filesystem::exists(path))
+    scene_gltf_import gltf_import;
+    if (!scene_gltf_parse(path, gltf_import))
     {
-        std::cerr << "glTF import failed. File does not exist: " << path << '\n';
-        ed_console_log(ed_console_log_level::error, "glTF import failed: file does not exist.");
         return false;
     }
 
-    fastgltf::Parser parser(fastgltf::Extensions::KHR_mesh_quantization);
-    constexpr auto options = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::DecomposeNodeMatrices;
-    constexpr auto categories =
-        fastgltf::Category::Asset | fastgltf::Category::Scenes | fastgltf::Category::Nodes | fastgltf::Category::Meshes;
-
-    auto gltf_file = fastgltf::MappedGltfFile::FromPath(path);
-    if (!bool(gltf_file))
-    {
-        std::cerr << "glTF import failed to open file: " << fastgltf::getErrorMessage(gltf_file.error()) << '\n';
-        ed_console_log(ed_console_log_level::error, "glTF import failed: unable to open file.");
-        return false;
-    }
-
-    auto loaded_asset = parser.loadGltf(gltf_file.get(), path.parent_path(), options, categories);
-    if (loaded_asset.error() != fastgltf::Error::None)
-    {
-        std::cerr << "glTF import failed to parse file: " << fastgltf::getErrorMessage(loaded_asset.error()) << '\n';
-        ed_console_log(ed_console_log_level::error, "glTF import failed: parse error.");
-        return false;
-    }
-
-    fastgltf::Asset asset = std::move(loaded_asset.get());
-    if (asset.scenes.empty())
-    {
-        std::cerr << "glTF import failed: no scenes in file.\n";
-        ed_console_log(ed_console_log_level::error, "glTF import failed: no scenes in file.");
-        return false;
-    }
-
-    std::size_t scene_index = asset.defaultScene.value_or(0);
-    if (scene_index >= asset.scenes.size())
-    {
-        scene_index = 0;
-    }
-
-    const auto &gltf_scene = asset.scenes[scene_index];
-    std::string scene_name = gltf_scene.name.empty() ? path.stem().string() : std::string(gltf_scene.name.c_str());
-    if (scene_name.empty())
-    {
-        scene_name = "Imported Scene";
-    }
-
-    flecs::entity import_root = scene_g_world.entity().add<ash::game_object>().set<ash::transform>({});
-    scene_set_entity_name_safe(import_root, "glTF: " + scene_name);
-    scene_g_selected = import_root;
-
-    std::function<void(std::size_t, flecs::entity)> import_node = [&](std::size_t node_index, flecs::entity parent) {
-        if (node_index >= asset.nodes.size())
-        {
-            return;
-        }
-
-        const auto &node = asset.nodes[node_index];
-        std::string node_name =
-            node.name.empty() ? ("Node_" + std::to_string(node_index)) : std::string(node.name.c_str());
-        if (node.meshIndex.has_value())
-        {
-            node_name += " [Mesh " + std::to_string(node.meshIndex.value()) + "]";
-        }
-
-        ash::transform entity_transform = {};
-        if (const auto *trs = std::get_if<fastgltf::TRS>(&node.transform))
-        {
-            entity_transform.position = {trs->translation[0], trs->translation[1], trs->translation[2]};
-            entity_transform.rotation = {trs->rotation[0], trs->rotation[1], trs->rotation[2], trs->rotation[3]};
-            entity_transform.scale = {trs->scale[0], trs->scale[1], trs->scale[2]};
-        }
-        else
-        {
-            fastgltf::math::fvec3 scale = {1.0f, 1.0f, 1.0f};
-            fastgltf::math::fquat rotation(0.0f, 0.0f, 0.0f, 1.0f);
-            fastgltf::math::fvec3 translation = {0.0f, 0.0f, 0.0f};
-
-            auto matrix = std::get<fastgltf::math::fmat4x4>(node.transform);
-            fastgltf::math::decomposeTransformMatrix(matrix, scale, rotation, translation);
-
-            entity_transform.position = {translation[0], translation[1], translation[2]};
-            entity_transform.rotation = {rotation[0], rotation[1], rotation[2], rotation[3]};
-            entity_transform.scale = {scale[0], scale[1], scale[2]};
-        }
-
-        flecs::entity entity = scene_g_world.entity().add<ash::game_object>().set<ash::transform>(entity_transform);
-        if (parent.is_valid())
-        {
-            entity.child_of(parent);
-        }
-        scene_set_entity_name_safe(entity, node_name);
-
-        for (std::size_t child_node_index : node.children)
-        {
-            import_node(child_node_index, entity);
-        }
-    };
-
-    for (std::size_t root_node_index : gltf_scene.nodeIndices)
-    {
-        import_node(root_node_index, import_root);
-    }
-
+    scene_gltf_commit(gltf_import, -1.0);
     ed_console_log(ed_console_log_level::info, "[Scene] glTF import complete.");
     return true;
 }
 
 void ash::scene_init()
 {
-    D3D12_RESOURCE_DESC buf_desc = {};
-    buf_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    buf_desc.Alignment = 0;
-    buf_desc.Width = sizeof(XMFLOAT4X4) * 256;
-    buf_desc.Height = 1;
-    buf_desc.DepthOrArraySize = 1;
-    buf_desc.DepthOrArraySize = 1;
-    buf_desc.MipLevels = 1;
-    buf_desc.Format = DXGI_FORMAT_UNKNOWN;
-    buf_desc.SampleDesc.Count = 1;
-    buf_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    buf_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-    D3D12MA::ALLOCATION_DESC alloc_desc = {};
-    alloc_desc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
-
-    rhi_g_allocator->CreateResource(&alloc_desc, &buf_desc, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, nullptr,
-                                    g_scene_buffer.put(), IID_NULL, nullptr);
-
-    assert(g_scene_buffer.get());
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.Buffer.FirstElement = 0;
-    srvDesc.Buffer.NumElements = 256;
-    srvDesc.Buffer.StructureByteStride = sizeof(XMFLOAT4X4);
-    srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
-
-    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle = rhi_g_cbv_srv_uav_heap->GetCPUDescriptorHandleForHeapStart();
-    UINT handle_size = rhi_g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-    cpu_handle.ptr += 5 * handle_size;
-
-    rhi_g_device->CreateShaderResourceView(g_scene_buffer->GetResource(), &srvDesc, cpu_handle);
+    scene_tf_init();
+    scene_lod_init();
+    scene_bvh_init();
+    scene_gpu_init();
+    scene_name_init();
 }
 
 void ash::scene_shutdown()
 {
-    g_scene_buffer = nullptr;
+    scene_gltf_shutdown();
+    scene_name_shutdown();
+    scene_mesh_clear(scene_mesh_g_arena);
+    scene_gpu_shutdown();
+    scene_bvh_shutdown();
+    scene_tf_shutdown();
 }
 
-void ash::scene_render()
+void ash::scene_render(std::vector<ID3D12CommandList *> &command_lists)
 {
-    {
-        cam_update_view_mat(g_camera);
-        cam_update_proj_mat(g_camera, XM_PI / 3, rhi_sw_g_viewport.Width / rhi_sw_g_viewport.Height, 0.1f, 1000.0f);
-
-        XMFLOAT4X4 view_proj = {};
-        DirectX::XMStoreFloat4x4(&view_proj, cam_get_view_proj_mat(g_camera));
+    scene_gltf_update();
+    scene_tf_update();
+    scene_bvh_update(scene_bvh_g_tree);
 
-        auto &command_list = rhi_cmd_g_command_list;
-        {
-            SCOPED_GPU_EVENT(rhi_cmd_g_command_list.get(), L"ash::scene_render")
+    cam_update_view_mat(g_camera);
+    cam_update_proj_mat(g_camera, XM_PI / 3, rhi_sw_g_viewport.Width / rhi_sw_g_viewport.Height, 0.1f, 1000.0f);
 
-            constexpr float clear_color[] = {0.0f, 0.0f, 0.0f, 1.0f};
+    scene_pass scene = {};
+    DirectX::XMStoreFloat4x4(&scene.view_proj, cam_get_view_proj_mat(g_camera));
 
-            ID3D12DescriptorHeap *heap[] = {rhi_g_cbv_srv_uav_heap.get(), rhi_g_sampler_heap.get()};
-            command_list->SetDescriptorHeaps(2, heap);
+    const scene_cull_frustum frustum = scene_cull_extract_frustum(XMLoadFloat4x4(&scene.view_proj));
+    g_visible_entities.clear();
+    scene_bvh_query_frustum(scene_bvh_g_tree, frustum, g_visible_entities);
+    scene_occ_cull(g_visible_entities, XMLoadFloat4x4(&scene.view_proj), g_camera.position);
+    scene_lod_select(g_visible_entities, g_camera, rhi_sw_g_viewport.Height);
 
-            command_list->SetGraphicsRootSignature(rhi_pl_g_triangle_instanced.root_signature.get());
-
-            D3D12_RESOURCE_BARRIER barrier = {};
-            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-            barrier.Transition.pResource = rhi_g_viewport_texture->GetResource();
-            barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-
-            command_list->ResourceBarrier(1, &barrier);
-
-            D3D12_CPU_DESCRIPTOR_HANDLE viewport_rtv_handle =
-                rhi_g_viewport_rtv_heap->GetCPUDescriptorHandleForHeapStart();
-            D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle = rhi_g_viewport_dsv_heap->GetCPUDescriptorHandleForHeapStart();
-
-            command_list->OMSetRenderTargets(1, &viewport_rtv_handle, FALSE, &dsv_handle);
-
-            command_list->ClearRenderTargetView(viewport_rtv_handle, clear_color, 0, nullptr);
-            command_list->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-
-            command_list->SetPipelineState(rhi_pl_g_triangle_instanced.pso.get());
-            command_list->RSSetViewports(1, &rhi_g_viewport);
-            D3D12_RECT scissorRect = {0, 0, static_cast<UINT>(rhi_g_viewport.Width),
-                                      static_cast<UINT>(rhi_g_viewport.Height)};
-            command_list->RSSetScissorRects(1, &scissorRect);
-            command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-            struct SceneData
-            {
-                XMFLOAT4X4 vp;
-                uint32_t buffer_id;
-            };
-
-            SceneData sd;
-            sd.vp = view_proj;
-            sd.buffer_id = 5;
-
-            command_list->SetGraphicsRoot32BitConstants(0, 17, &sd, 0);
-
-            XMFLOAT4X4 *mapped_data;
-            uint32_t id = 0;
-            g_scene_buffer->GetResource()->Map(0, nullptr, reinterpret_cast<void **>(&mapped_data));
-            scene_g_world.each([&](flecs::entity e, transform &t) {
-                DirectX::XMStoreFloat4x4(&mapped_data[id], get_world_transform_matrix(e));
-                id++;
-            });
-            g_scene_buffer->GetResource()->Unmap(0, nullptr);
-
-            if (id > 0)
-            {
-                command_list->DrawInstanced(3, id, 0, 0);
-            }
-
-            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-            barrier.Transition.pResource = rhi_g_viewport_texture->GetResource();
-            barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-
-            command_list->ResourceBarrier(1, &barrier);
-
-            //// Swapchain
-
-            rhi_sw_g_current_backbuffer = rhi_sw_g_swapchain->GetCurrentBackBufferIndex();
-            uint8_t &frame_index = rhi_sw_g_current_backbuffer;
-
-            const uint32_t rtv_descriptor_size =
-                rhi_g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-            D3D12_CPU_DESCRIPTOR_HANDLE swapchain_rtv_Handle =
-                rhi_sw_g_swapchain_rtv_heap->GetCPUDescriptorHandleForHeapStart();
-            swapchain_rtv_Handle.ptr += frame_index * rtv_descriptor_size;
-
-            barrier = {};
-            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-            barrier.Transition.pResource = rhi_sw_g_render_targets[frame_index].get();
-            barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-
-            command_list->ResourceBarrier(1, &barrier);
-
-            command_list->OMSetRenderTargets(1, &swapchain_rtv_Handle, FALSE, nullptr);
-            command_list->ClearRenderTargetView(swapchain_rtv_Handle, clear_color, 0, nullptr);
-
-            ed_render_backend();
-
-            barrier = {};
-            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-            barrier.Transition.pResource = rhi_sw_g_render_targets[frame_index].get();
-            barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-            barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-
-            command_list->ResourceBarrier(1, &barrier);
-        }
-        command_list->Close();
+    // The upload mutates the instance slots the visible list is built from, so it is recorded here, before the
+    // passes that only read the result.
+    ID3D12GraphicsCommandList *upload_list = rhi_cmd_acquire(rhi_cmd_queue_type::direct);
+    {
+        SCOPED_GPU_EVENT(upload_list, L"ash::scene_gpu_upload")
+        scene_gpu_upload(upload_list);
     }
+    upload_list->Close();
+    scene.visible_count = scene_gpu_write_visible(g_visible_entities);
+    scene.format = scene_gpu_get_format();
+
+    editor_pass editor = {};
+    rhi_sw_g_current_backbuffer = rhi_sw_g_swapchain->GetCurrentBackBufferIndex();
+    editor.backbuffer = rhi_sw_g_current_backbuffer;
+
+    // The passes share no CPU state, so workers record them side by side while this thread helps in job_wait.
+    const job_decl jobs[] = {{[](void *data) { record_scene_pass(*static_cast<scene_pass *>(data)); }, &scene},
+                             {[](void *data) { record_editor_pass(*static_cast<editor_pass *>(data)); }, &editor}};
+    job_counter counter;
+    job_submit(jobs, static_cast<uint32_t>(std::size(jobs)), &counter);
+    job_wait(counter);
+
+    command_lists.push_back(upload_list);
+    command_lists.push_back(scene.command_list);
+    command_lists.push_back(editor.command_list);
 }
@@ -1,9 +1,10 @@
 #pragma once
+#include "common.h"
 #include <filesystem>
 #include <flecs.h>
 #include <scene/component.h>
-#include <string>
-#include <string_view>
+#include <scene/name.h>
+#include <vector>
 
 namespace ash
 {
@@ -14,10 +15,10 @@ inline flecs::entity scene_g_selected;
 namespace ash
 {
 flecs::entity scene_create_empty(flecs::entity parent = {});
-std::string scene_make_unique_name(std::string_view desired_name, flecs::entity parent = {}, flecs::entity ignore = {});
-void scene_set_entity_name_safe(flecs::entity entity, std::string_view desired_name);
 bool scene_load_gltf(const std::filesystem::path &path);
-void scene_render();
+// Records the frame's passes, some of them on job workers, and appends their closed command lists in submission
+// order.
+void scene_render(std::vector<ID3D12CommandList *> &command_lists);
 void scene_init();
 void scene_shutdown();
 } // namespace ash
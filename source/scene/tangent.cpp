@@ -0,0 +1,371 @@
+#include "tangent.h"
+#include "job/parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <common.h>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_triangle_grain = 4096;
+constexpr uint32_t g_group_grain = 4096;
+
+// uv winding of a triangle. Triangles with no uv area or no position area take whichever side their vertices have.
+constexpr uint8_t g_preserving = 0;
+constexpr uint8_t g_flipped = 1;
+constexpr uint8_t g_any = 2;
+
+struct vertex_key
+{
+    uint32_t bits[8];
+
+    bool operator==(const vertex_key &other) const { return std::memcmp(bits, other.bits, sizeof(bits)) == 0; }
+};
+
+struct vertex_key_hash
+{
+    std::size_t operator()(const vertex_key &key) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t word : key.bits)
+        {
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        return static_cast<std::size_t>(hash);
+    }
+};
+
+// Tangents of a primitive's vertices followed by those of its split vertices. split_sources[k] is the vertex that
+// vertex_count + k copies; indices is only filled when there are splits.
+struct primitive_tangents
+{
+    std::vector<XMFLOAT4> tangents;
+    std::vector<uint32_t> split_sources;
+    std::vector<uint32_t> indices;
+};
+
+bool is_not_zero(FXMVECTOR v)
+{
+    return XMVectorGetX(XMVector3LengthSq(v)) > FLT_MIN;
+}
+
+XMVECTOR normalize_if_not_zero(FXMVECTOR v)
+{
+    return is_not_zero(v) ? XMVector3Normalize(v) : v;
+}
+
+XMVECTOR project_onto_plane(FXMVECTOR v, FXMVECTOR normal)
+{
+    return XMVectorSubtract(v, XMVectorScale(normal, XMVectorGetX(XMVector3Dot(normal, v))));
+}
+
+// Any unit vector perpendicular to `normal`, for vertices whose triangles have no usable uv gradient.
+XMVECTOR perpendicular(FXMVECTOR normal)
+{
+    if (!is_not_zero(normal))
+    {
+        return XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+    XMFLOAT3 n;
+    XMStoreFloat3(&n, XMVector3Normalize(normal));
+    const float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+    const float a = -1.0f / (sign + n.z);
+    return XMVectorSet(1.0f + sign * n.x * n.x * a, sign * n.x * n.y * a, -sign * n.x, 0.0f);
+}
+
+// Assigns every vertex the index of its bit-identical class, as MikkTSpace does before grouping.
+uint32_t group_vertices(const XMFLOAT3 *positions, const XMFLOAT3 *normals, const XMFLOAT2 *uvs,
+                        uint32_t vertex_count, std::vector<uint32_t> &groups)
+{
+    std::unordered_map<vertex_key, uint32_t, vertex_key_hash> classes;
+    classes.reserve(vertex_count);
+    groups.resize(vertex_count);
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        vertex_key key;
+        std::memcpy(key.bits + 0, &positions[v], sizeof(XMFLOAT3));
+        std::memcpy(key.bits + 3, &normals[v], sizeof(XMFLOAT3));
+        std::memcpy(key.bits + 6, &uvs[v], sizeof(XMFLOAT2));
+        groups[v] = classes.try_emplace(key, static_cast<uint32_t>(classes.size())).first->second;
+    }
+    return static_cast<uint32_t>(classes.size());
+}
+
+void generate_primitive(const ash::scene_mesh_arena &arena, const ash::scene_mesh_primitive &primitive,
+                        primitive_tangents &result)
+{
+    const XMFLOAT3 *positions = arena.positions.data() + primitive.first_vertex;
+    const XMFLOAT3 *normals = arena.normals.data() + primitive.first_vertex;
+    const XMFLOAT2 *uvs = arena.uvs.data() + primitive.first_vertex;
+    const uint32_t *indices = arena.indices.data() + primitive.first_index;
+    const uint32_t vertex_count = primitive.vertex_count;
+    const uint32_t triangle_count = primitive.index_count / 3;
+
+    std::vector<uint32_t> groups;
+    const uint32_t group_count = group_vertices(positions, normals, uvs, vertex_count, groups);
+
+    // Per triangle: uv winding and, per corner, the triangle's s direction projected onto the corner normal and
+    // weighted by the corner angle.
+    std::vector<uint8_t> orientations(triangle_count);
+    std::vector<XMFLOAT3> contributions(std::size_t(triangle_count) * 3);
+    ash::job_parallel_for(triangle_count, g_triangle_grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t t = begin; t < end; ++t)
+        {
+            const uint32_t *corner = indices + std::size_t(t) * 3;
+            const XMVECTOR p[3] = {XMLoadFloat3(&positions[corner[0]]), XMLoadFloat3(&positions[corner[1]]),
+                                   XMLoadFloat3(&positions[corner[2]])};
+            const XMFLOAT2 &t0 = uvs[corner[0]];
+            const XMFLOAT2 &t1 = uvs[corner[1]];
+            const XMFLOAT2 &t2 = uvs[corner[2]];
+
+            const XMVECTOR d1 = XMVectorSubtract(p[1], p[0]);
+            const XMVECTOR d2 = XMVectorSubtract(p[2], p[0]);
+            const float t21x = t1.x - t0.x;
+            const float t21y = t1.y - t0.y;
+            const float t31x = t2.x - t0.x;
+            const float t31y = t2.y - t0.y;
+            const float signed_area = t21x * t31y - t21y * t31x;
+
+            XMVECTOR os = XMVectorSubtract(XMVectorScale(d1, t31y), XMVectorScale(d2, t21y));
+            const bool degenerate = !is_not_zero(XMVector3Cross(d1, d2));
+            if (degenerate || signed_area == 0.0f)
+            {
+                orientations[t] = g_any;
+            }
+            else
+            {
+                orientations[t] = signed_area > 0.0f ? g_preserving : g_flipped;
+                const float length = XMVectorGetX(XMVector3Length(os));
+                if (length > FLT_MIN)
+                {
+                    os = XMVectorScale(os, (signed_area > 0.0f ? 1.0f : -1.0f) / length);
+                }
+            }
+
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                XMFLOAT3 &contribution = contributions[std::size_t(t) * 3 + c];
+                if (degenerate)
+                {
+                    contribution = {0.0f, 0.0f, 0.0f};
+                    continue;
+                }
+
+                const XMVECTOR normal = normalize_if_not_zero(XMLoadFloat3(&normals[corner[c]]));
+                const XMVECTOR edge1 =
+                    normalize_if_not_zero(project_onto_plane(XMVectorSubtract(p[(c + 1) % 3], p[c]), normal));
+                const XMVECTOR edge2 =
+                    normalize_if_not_zero(project_onto_plane(XMVectorSubtract(p[(c + 2) % 3], p[c]), normal));
+                const float angle = std::acos(std::clamp(XMVectorGetX(XMVector3Dot(edge1, edge2)), -1.0f, 1.0f));
+                const XMVECTOR direction = normalize_if_not_zero(project_onto_plane(os, normal));
+                XMStoreFloat3(&contribution, XMVectorScale(direction, angle));
+            }
+        }
+    });
+
+    // Triangles without a winding join the side their vertex group already has, preferring the preserving one.
+    std::vector<uint8_t> group_sides(group_count, 0);
+    for (uint32_t t = 0; t < triangle_count; ++t)
+    {
+        if (orientations[t] != g_any)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                group_sides[groups[indices[std::size_t(t) * 3 + c]]] |= 1u << orientations[t];
+            }
+        }
+    }
+
+    std::vector<uint8_t> corner_sides(std::size_t(triangle_count) * 3);
+    std::vector<uint32_t> offsets(std::size_t(group_count) * 2 + 1, 0);
+    for (std::size_t i = 0; i < corner_sides.size(); ++i)
+    {
+        const uint32_t group = groups[indices[i]];
+        const uint8_t orientation = orientations[i / 3];
+        corner_sides[i] = orientation != g_any ? orientation : (group_sides[group] == (1u << g_flipped) ? 1 : 0);
+        ++offsets[group * 2 + corner_sides[i] + 1];
+    }
+    for (std::size_t a = 1; a < offsets.size(); ++a)
+    {
+        offsets[a] += offsets[a - 1];
+    }
+
+    std::vector<uint32_t> corners(corner_sides.size());
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < corner_sides.size(); ++i)
+    {
+        corners[cursor[groups[indices[i]] * 2 + corner_sides[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<XMFLOAT3> sums(std::size_t(group_count) * 2);
+    ash::job_parallel_for(group_count * 2, g_group_grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t a = begin; a < end; ++a)
+        {
+            XMVECTOR sum = XMVectorZero();
+            for (uint32_t i = offsets[a]; i < offsets[a + 1]; ++i)
+            {
+                sum = XMVectorAdd(sum, XMLoadFloat3(&contributions[corners[i]]));
+            }
+            XMStoreFloat3(&sums[a], sum);
+        }
+    });
+
+    std::vector<uint8_t> vertex_sides(vertex_count, 0);
+    for (std::size_t i = 0; i < corner_sides.size(); ++i)
+    {
+        vertex_sides[indices[i]] |= 1u << corner_sides[i];
+    }
+
+    const auto make_tangent = [&](uint32_t v, uint32_t side) {
+        const XMVECTOR normal = normalize_if_not_zero(XMLoadFloat3(&normals[v]));
+        XMVECTOR tangent = project_onto_plane(XMLoadFloat3(&sums[std::size_t(groups[v]) * 2 + side]), normal);
+        tangent = is_not_zero(tangent) ? XMVector3Normalize(tangent) : perpendicular(normal);
+
+        XMFLOAT4 result;
+        XMStoreFloat4(&result, XMVectorSetW(tangent, side == g_preserving ? 1.0f : -1.0f));
+        return result;
+    };
+
+    result.tangents.resize(vertex_count);
+    std::vector<uint32_t> split_of(vertex_count, UINT32_MAX);
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        const uint32_t side = vertex_sides[v] == (1u << g_flipped) ? g_flipped : g_preserving;
+        result.tangents[v] = make_tangent(v, side);
+        if (vertex_sides[v] == ((1u << g_preserving) | (1u << g_flipped)))
+        {
+            split_of[v] = vertex_count + static_cast<uint32_t>(result.split_sources.size());
+            result.split_sources.push_back(v);
+            result.tangents.push_back(make_tangent(v, g_flipped));
+        }
+    }
+
+    if (!result.split_sources.empty())
+    {
+        result.indices.assign(indices, indices + primitive.index_count);
+        for (std::size_t i = 0; i < corner_sides.size(); ++i)
+        {
+            if (corner_sides[i] == g_flipped && split_of[indices[i]] != UINT32_MAX)
+            {
+                result.indices[i] = split_of[indices[i]];
+            }
+        }
+    }
+}
+
+bool has_tangents(const ash::scene_mesh_arena &arena, const ash::scene_mesh_primitive &primitive)
+{
+    for (uint32_t v = primitive.first_vertex; v < primitive.first_vertex + primitive.vertex_count; ++v)
+    {
+        if (arena.tangents[v].w != 0.0f)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+ash::scene_tan_stats ash::scene_tan_generate(scene_mesh_arena &arena)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_tan_generate")
+
+    arena.tangents.resize(arena.positions.size(), {0.0f, 0.0f, 0.0f, 0.0f});
+
+    std::vector<primitive_tangents> generated(arena.primitives.size());
+    std::vector<uint8_t> pending(arena.primitives.size());
+    job_parallel_for(static_cast<uint32_t>(arena.primitives.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t p = begin; p < end; ++p)
+        {
+            pending[p] = !has_tangents(arena, arena.primitives[p]);
+            if (pending[p])
+            {
+                generate_primitive(arena, arena.primitives[p], generated[p]);
+            }
+        }
+    });
+
+    scene_tan_stats stats;
+    bool has_splits = false;
+    for (std::size_t p = 0; p < arena.primitives.size(); ++p)
+    {
+        if (pending[p])
+        {
+            const scene_mesh_primitive &primitive = arena.primitives[p];
+            ++stats.primitives;
+            stats.triangles += primitive.index_count / 3;
+            stats.split_vertices += static_cast<uint32_t>(generated[p].split_sources.size());
+            has_splits |= !generated[p].split_sources.empty();
+        }
+    }
+
+    if (!has_splits)
+    {
+        for (std::size_t p = 0; p < arena.primitives.size(); ++p)
+        {
+            if (pending[p])
+            {
+                std::copy(generated[p].tangents.begin(), generated[p].tangents.end(),
+                          arena.tangents.begin() + arena.primitives[p].first_vertex);
+            }
+        }
+        return stats;
+    }
+
+    // Repack: split vertices are appended after their primitive's own, so every later range moves.
+    scene_mesh_arena packed;
+    const std::size_t vertex_count = arena.positions.size() + stats.split_vertices;
+    packed.positions.reserve(vertex_count);
+    packed.normals.reserve(vertex_count);
+    packed.tangents.reserve(vertex_count);
+    packed.uvs.reserve(vertex_count);
+
+    for (std::size_t p = 0; p < arena.primitives.size(); ++p)
+    {
+        scene_mesh_primitive &primitive = arena.primitives[p];
+        const primitive_tangents &primitive_result = generated[p];
+        const std::size_t first = primitive.first_vertex;
+        const std::size_t last = first + primitive.vertex_count;
+
+        packed.positions.insert(packed.positions.end(), arena.positions.begin() + first,
+                                arena.positions.begin() + last);
+        packed.normals.insert(packed.normals.end(), arena.normals.begin() + first, arena.normals.begin() + last);
+        packed.uvs.insert(packed.uvs.end(), arena.uvs.begin() + first, arena.uvs.begin() + last);
+        if (pending[p])
+        {
+            packed.tangents.insert(packed.tangents.end(), primitive_result.tangents.begin(),
+                                   primitive_result.tangents.end());
+        }
+        else
+        {
+            packed.tangents.insert(packed.tangents.end(), arena.tangents.begin() + first,
+                                   arena.tangents.begin() + last);
+        }
+
+        for (uint32_t source : primitive_result.split_sources)
+        {
+            packed.positions.push_back(arena.positions[first + source]);
+            packed.normals.push_back(arena.normals[first + source]);
+            packed.uvs.push_back(arena.uvs[first + source]);
+        }
+        if (!primitive_result.indices.empty())
+        {
+            std::copy(primitive_result.indices.begin(), primitive_result.indices.end(),
+                      arena.indices.begin() + primitive.first_index);
+        }
+
+        primitive.first_vertex = static_cast<uint32_t>(packed.positions.size() - primitive.vertex_count -
+                                                       primitive_result.split_sources.size());
+        primitive.vertex_count += static_cast<uint32_t>(primitive_result.split_sources.size());
+    }
+
+    arena.positions = std::move(packed.positions);
+    arena.normals = std::move(packed.normals);
+    arena.tangents = std::move(packed.tangents);
+    arena.uvs = std::move(packed.uvs);
+    return stats;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <scene/mesh.h>
+
+namespace ash
+{
+struct scene_tan_stats
+{
+    uint32_t primitives = 0;
+    uint64_t triangles = 0;
+    uint32_t split_vertices = 0;
+};
+} // namespace ash
+
+namespace ash
+{
+// Generates MikkTSpace-compatible tangents for every primitive of `arena` whose tangents are all zero, i.e. that had
+// no TANGENT attribute. As in MikkTSpace, bit-identical vertices are grouped, each group accumulates the per-triangle
+// uv gradients projected onto its normal and weighted by corner angle, and vertices shared by triangles of opposite
+// uv winding are split in two so each side gets its own handedness. Primitives are processed in parallel, and the
+// triangles of each primitive in parallel chunks. Run before scene_mopt_optimize; the arena is repacked if any
+// vertex was split.
+scene_tan_stats scene_tan_generate(scene_mesh_arena &arena);
+} // namespace ash
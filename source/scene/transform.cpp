@@ -0,0 +1,387 @@
+#include "transform.h"
+#include "job/parallel.h"
+#include "job/scheduler.h"
+#include "scene/scene.h"
+#include "scene/transform_soa.h"
+#include <algorithm>
+#include <common.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_invalid_index = ~0u;
+constexpr uint32_t g_level_grain = 1024;
+
+// One depth of the flattened hierarchy. Slots of destroyed entities are tombstoned (entity == 0) and reused, so the
+// parent indices held by the next level never have to be patched. children mirrors the next level's parents, so an
+// update reaches a node's subtree without scanning the levels below. dirty_list holds the slots flagged in dirty
+// since the last update; it may repeat slots or name released ones, the flags are authoritative.
+struct hierarchy_level
+{
+    std::vector<flecs::entity_t> entities;
+    std::vector<uint32_t> parents;
+    std::vector<std::vector<uint32_t>> children;
+    std::vector<uint8_t> dirty;
+    std::vector<XMFLOAT4X4> worlds;
+    std::vector<uint32_t> free_slots;
+    std::vector<uint32_t> dirty_list;
+};
+
+struct node_location
+{
+    uint32_t level;
+    uint32_t index;
+    uint32_t epoch;
+};
+
+std::vector<std::unique_ptr<hierarchy_level>> g_levels;
+std::unordered_map<flecs::entity_t, node_location> g_locations;
+std::vector<flecs::entity> g_pending;
+std::vector<flecs::entity> g_walk_stack;
+std::vector<flecs::entity> g_observers;
+std::vector<flecs::entity_t> g_updated_entities;
+std::vector<uint32_t> g_batch;
+uint32_t g_dirty_count = 0;
+uint32_t g_epoch = 0;
+int32_t g_stage_count = 1;
+
+hierarchy_level &get_level(uint32_t level)
+{
+    while (g_levels.size() <= level)
+    {
+        g_levels.push_back(std::make_unique<hierarchy_level>());
+    }
+
+    return *g_levels[level];
+}
+
+void mark_node_dirty(hierarchy_level &level, uint32_t index)
+{
+    if (!level.dirty[index])
+    {
+        level.dirty[index] = 1;
+        level.dirty_list.push_back(index);
+        g_dirty_count++;
+    }
+}
+
+void release_node(flecs::entity_t entity)
+{
+    auto it = g_locations.find(entity);
+    if (it == g_locations.end())
+    {
+        return;
+    }
+
+    hierarchy_level &level = *g_levels[it->second.level];
+    const uint32_t index = it->second.index;
+    const uint32_t parent = level.parents[index];
+    if (parent != g_invalid_index)
+    {
+        std::vector<uint32_t> &siblings = g_levels[it->second.level - 1]->children[parent];
+        if (auto sibling = std::find(siblings.begin(), siblings.end(), index); sibling != siblings.end())
+        {
+            *sibling = siblings.back();
+            siblings.pop_back();
+        }
+    }
+
+    level.entities[index] = 0;
+    level.parents[index] = g_invalid_index;
+    level.children[index].clear();
+    level.dirty[index] = 0;
+    level.free_slots.push_back(index);
+    g_locations.erase(it);
+}
+
+void insert_node(flecs::entity entity)
+{
+    uint32_t level_index = 0;
+    uint32_t parent_index = g_invalid_index;
+
+    const flecs::entity parent = entity.parent();
+    if (parent.is_valid())
+    {
+        if (auto it = g_locations.find(parent.id()); it != g_locations.end())
+        {
+            level_index = it->second.level + 1;
+            parent_index = it->second.index;
+        }
+    }
+
+    hierarchy_level &level = get_level(level_index);
+    uint32_t index;
+    if (!level.free_slots.empty())
+    {
+        index = level.free_slots.back();
+        level.free_slots.pop_back();
+        level.entities[index] = entity.id();
+        level.parents[index] = parent_index;
+    }
+    else
+    {
+        index = static_cast<uint32_t>(level.entities.size());
+        level.entities.push_back(entity.id());
+        level.parents.push_back(parent_index);
+        level.children.emplace_back();
+        level.dirty.push_back(0);
+        level.worlds.emplace_back();
+    }
+
+    if (parent_index != g_invalid_index)
+    {
+        g_levels[level_index - 1]->children[parent_index].push_back(index);
+    }
+    mark_node_dirty(level, index);
+    g_locations[entity.id()] = {level_index, index, g_epoch};
+}
+
+// Re-flattens the subtree rooted at `root`: its nodes are released and inserted again one level below their
+// (possibly new) parent, in pre-order so every parent is placed before its children.
+void place_subtree(flecs::entity root)
+{
+    g_walk_stack.clear();
+    g_walk_stack.push_back(root);
+    while (!g_walk_stack.empty())
+    {
+        flecs::entity entity = g_walk_stack.back();
+        g_walk_stack.pop_back();
+
+        release_node(entity.id());
+        entity.children([](flecs::entity child) {
+            if (child.has<ash::world_transform>())
+            {
+                g_walk_stack.push_back(child);
+            }
+        });
+    }
+
+    g_walk_stack.push_back(root);
+    while (!g_walk_stack.empty())
+    {
+        flecs::entity entity = g_walk_stack.back();
+        g_walk_stack.pop_back();
+
+        insert_node(entity);
+        entity.children([](flecs::entity child) {
+            if (child.has<ash::world_transform>())
+            {
+                g_walk_stack.push_back(child);
+            }
+        });
+    }
+}
+
+bool is_placed_this_epoch(flecs::entity entity)
+{
+    auto it = g_locations.find(entity.id());
+    return it != g_locations.end() && it->second.epoch == g_epoch;
+}
+
+void place_pending()
+{
+    if (g_pending.empty())
+    {
+        return;
+    }
+
+    g_epoch++;
+    for (flecs::entity entity : g_pending)
+    {
+        if (!entity.is_alive() || !entity.has<ash::world_transform>() || is_placed_this_epoch(entity))
+        {
+            continue;
+        }
+
+        // Ancestors that are still waiting for placement go first, otherwise this subtree would be flattened
+        // against a stale parent level.
+        flecs::entity top = entity;
+        for (flecs::entity cursor = entity.parent(); cursor.is_valid(); cursor = cursor.parent())
+        {
+            if (!cursor.has<ash::world_transform>())
+            {
+                break;
+            }
+            if (!g_locations.contains(cursor.id()))
+            {
+                top = cursor;
+            }
+        }
+
+        place_subtree(top);
+    }
+
+    g_pending.clear();
+}
+
+// Stage the calling thread uses while update_level holds the world read-only. Scheduler threads use the stage of
+// their index; a caller that is not attached to the scheduler takes the last one.
+flecs::world get_thread_stage()
+{
+    const uint32_t index = std::min(ash::job_get_thread_index(), static_cast<uint32_t>(g_stage_count - 1));
+    return ash::scene_g_world.get_stage(static_cast<int32_t>(index));
+}
+
+// Recomputes the dirty nodes of `level` and flags their children in `child_level`, so work stays proportional to the
+// nodes that moved and their subtrees. The world is read-only meanwhile, which is how flecs lets several threads use
+// it at once: each worker reads transform and writes world_transform and bounds through its own stage. The entities
+// already have those components, so get_mut never changes their table, and workers write disjoint entities. Only
+// the child flags are set afterwards on the calling thread, since they go into shared dirty lists.
+void update_level(hierarchy_level &level, const hierarchy_level *parent_level, hierarchy_level *child_level)
+{
+    g_batch.clear();
+    for (uint32_t i : level.dirty_list)
+    {
+        if (level.dirty[i])
+        {
+            level.dirty[i] = 0;
+            g_batch.push_back(i);
+        }
+    }
+    level.dirty_list.clear();
+
+    // Without a running scheduler job_parallel_for falls back to threads that have no index, and so no stage of
+    // their own; the level then runs as one chunk on the calling thread.
+    const uint32_t count = static_cast<uint32_t>(g_batch.size());
+    const uint32_t grain = ash::job_is_running() ? g_level_grain : count;
+    ash::scene_g_world.readonly_begin(true);
+    ash::job_parallel_for(count, grain, [&](uint32_t begin, uint32_t end) {
+        thread_local ash::scene_tf_soa soa;
+        thread_local std::vector<XMFLOAT3X4> locals;
+        const flecs::world stage = get_thread_stage();
+
+        const uint32_t batch_count = end - begin;
+        ash::scene_tf_soa_resize(soa, batch_count);
+        for (uint32_t k = 0; k < batch_count; ++k)
+        {
+            const flecs::entity entity(stage, level.entities[g_batch[begin + k]]);
+            ash::scene_tf_soa_store(soa, k, entity.get<ash::transform>());
+        }
+
+        locals.resize(batch_count);
+        ash::scene_tf_compose_local_batch(soa, 0, batch_count, locals.data());
+
+        for (uint32_t k = 0; k < batch_count; ++k)
+        {
+            const uint32_t i = g_batch[begin + k];
+            const uint32_t parent = level.parents[i];
+            const XMMATRIX parent_world = parent_level && parent != g_invalid_index
+                                              ? XMLoadFloat4x4(&parent_level->worlds[parent])
+                                              : XMMatrixIdentity();
+            const XMMATRIX world = XMLoadFloat3x4(&locals[k]) * parent_world;
+            XMStoreFloat4x4(&level.worlds[i], world);
+
+            const flecs::entity entity(stage, level.entities[i]);
+            entity.get_mut<ash::world_transform>().matrix = level.worlds[i];
+            if (ash::bounds *entity_bounds = entity.try_get_mut<ash::bounds>())
+            {
+                entity_bounds->world_sphere = ash::get_world_bounding_sphere(*entity_bounds, world);
+            }
+        }
+    });
+    ash::scene_g_world.readonly_end();
+
+    for (uint32_t i : g_batch)
+    {
+        g_updated_entities.push_back(level.entities[i]);
+        for (uint32_t child : level.children[i])
+        {
+            mark_node_dirty(*child_level, child);
+        }
+    }
+}
+} // namespace
+
+void ash::scene_tf_init()
+{
+    scene_g_world.component<transform>().add(flecs::With, scene_g_world.component<world_transform>());
+    scene_g_world.component<transform>().add(flecs::With, scene_g_world.component<bounds>());
+
+    g_observers.push_back(scene_g_world.observer<const transform>()
+                              .event(flecs::OnSet)
+                              .each([](flecs::entity entity, const transform &) { scene_tf_mark_dirty(entity); }));
+
+    g_observers.push_back(scene_g_world.observer<const bounds>()
+                              .event(flecs::OnSet)
+                              .each([](flecs::entity entity, const bounds &) { scene_tf_mark_dirty(entity); }));
+
+    g_observers.push_back(scene_g_world.observer()
+                              .with(flecs::ChildOf, flecs::Wildcard)
+                              .event(flecs::OnAdd)
+                              .each([](flecs::entity entity) { g_pending.push_back(entity); }));
+
+    g_observers.push_back(scene_g_world.observer<const world_transform>()
+                              .event(flecs::OnRemove)
+                              .each([](flecs::entity entity, const world_transform &) { release_node(entity.id()); }));
+}
+
+void ash::scene_tf_shutdown()
+{
+    for (flecs::entity observer : g_observers)
+    {
+        observer.destruct();
+    }
+
+    g_observers.clear();
+    g_levels.clear();
+    g_locations.clear();
+    g_pending.clear();
+    g_updated_entities.clear();
+    g_batch.clear();
+    g_dirty_count = 0;
+}
+
+void ash::scene_tf_mark_dirty(flecs::entity entity)
+{
+    auto it = g_locations.find(entity.id());
+    if (it == g_locations.end())
+    {
+        g_pending.push_back(entity);
+        return;
+    }
+
+    mark_node_dirty(*g_levels[it->second.level], it->second.index);
+}
+
+void ash::scene_tf_update()
+{
+    SCOPED_CPU_EVENT(L"ash::scene_tf_update")
+
+    g_updated_entities.clear();
+    place_pending();
+
+    if (g_dirty_count == 0)
+    {
+        return;
+    }
+
+    // One stage per scheduler thread plus one for a caller outside the scheduler, see update_level.
+    g_stage_count = static_cast<int32_t>(job_get_thread_count()) + 1;
+    if (scene_g_world.get_stage_count() != g_stage_count)
+    {
+        scene_g_world.set_stage_count(g_stage_count);
+    }
+
+    // Levels are processed top-down; nodes within a level only depend on the previous level, so each level is
+    // updated in parallel. Only dirty nodes are visited, and updating a node dirties its children in the next level.
+    for (std::size_t l = 0; l < g_levels.size(); ++l)
+    {
+        hierarchy_level &level = *g_levels[l];
+        if (!level.dirty_list.empty())
+        {
+            update_level(level, l > 0 ? g_levels[l - 1].get() : nullptr,
+                         l + 1 < g_levels.size() ? g_levels[l + 1].get() : nullptr);
+        }
+    }
+
+    g_dirty_count = 0;
+}
+
+const std::vector<flecs::entity_t> &ash::scene_tf_get_updated()
+{
+    return g_updated_entities;
+}
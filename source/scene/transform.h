@@ -0,0 +1,16 @@
+#pragma once
+
+#include <flecs.h>
+#include <scene/component.h>
+#include <vector>
+
+namespace ash
+{
+void scene_tf_init();
+void scene_tf_shutdown();
+void scene_tf_mark_dirty(flecs::entity entity);
+void scene_tf_update();
+
+// Entities whose world_transform was recomputed by the last scene_tf_update, in no particular order.
+const std::vector<flecs::entity_t> &scene_tf_get_updated();
+} // namespace ash
@@ -0,0 +1,231 @@
+#include "transform_soa.h"
+#include "job/cpu.h"
+#include <common.h>
+
+#if ASH_CPU_X86
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+void compose_scalar(const ash::scene_tf_soa &soa, uint32_t first, uint32_t count, XMFLOAT3X4 *out)
+{
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        const float x = soa.rotation_x[i];
+        const float y = soa.rotation_y[i];
+        const float z = soa.rotation_z[i];
+        const float w = soa.rotation_w[i];
+        const float sx = soa.scale_x[i];
+        const float sy = soa.scale_y[i];
+        const float sz = soa.scale_z[i];
+
+        const float xx = x * x, yy = y * y, zz = z * z;
+        const float xy = x * y, xz = x * z, yz = y * z;
+        const float xw = x * w, yw = y * w, zw = z * w;
+
+        XMFLOAT3X4 &m = out[i - first];
+        m.m[0][0] = sx * (1.0f - 2.0f * (yy + zz));
+        m.m[0][1] = sy * (2.0f * (xy - zw));
+        m.m[0][2] = sz * (2.0f * (xz + yw));
+        m.m[0][3] = soa.position_x[i];
+
+        m.m[1][0] = sx * (2.0f * (xy + zw));
+        m.m[1][1] = sy * (1.0f - 2.0f * (xx + zz));
+        m.m[1][2] = sz * (2.0f * (yz - xw));
+        m.m[1][3] = soa.position_y[i];
+
+        m.m[2][0] = sx * (2.0f * (xz - yw));
+        m.m[2][1] = sy * (2.0f * (yz + xw));
+        m.m[2][2] = sz * (1.0f - 2.0f * (xx + yy));
+        m.m[2][3] = soa.position_z[i];
+    }
+}
+
+#if ASH_CPU_X86
+const bool g_has_avx2 = ash::job_cpu_has_avx2();
+
+uint32_t compose_sse(const ash::scene_tf_soa &soa, uint32_t first, uint32_t count, XMFLOAT3X4 *out)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    uint32_t done = 0;
+    for (; done + 4 <= count; done += 4)
+    {
+        const uint32_t i = first + done;
+        const __m128 x = _mm_loadu_ps(&soa.rotation_x[i]);
+        const __m128 y = _mm_loadu_ps(&soa.rotation_y[i]);
+        const __m128 z = _mm_loadu_ps(&soa.rotation_z[i]);
+        const __m128 w = _mm_loadu_ps(&soa.rotation_w[i]);
+        const __m128 sx = _mm_loadu_ps(&soa.scale_x[i]);
+        const __m128 sy = _mm_loadu_ps(&soa.scale_y[i]);
+        const __m128 sz = _mm_loadu_ps(&soa.scale_z[i]);
+
+        const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        const __m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+
+        __m128 r00 = _mm_mul_ps(sx, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+        __m128 r01 = _mm_mul_ps(sy, _mm_mul_ps(two, _mm_sub_ps(xy, zw)));
+        __m128 r02 = _mm_mul_ps(sz, _mm_mul_ps(two, _mm_add_ps(xz, yw)));
+        __m128 r03 = _mm_loadu_ps(&soa.position_x[i]);
+
+        __m128 r10 = _mm_mul_ps(sx, _mm_mul_ps(two, _mm_add_ps(xy, zw)));
+        __m128 r11 = _mm_mul_ps(sy, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+        __m128 r12 = _mm_mul_ps(sz, _mm_mul_ps(two, _mm_sub_ps(yz, xw)));
+        __m128 r13 = _mm_loadu_ps(&soa.position_y[i]);
+
+        __m128 r20 = _mm_mul_ps(sx, _mm_mul_ps(two, _mm_sub_ps(xz, yw)));
+        __m128 r21 = _mm_mul_ps(sy, _mm_mul_ps(two, _mm_add_ps(yz, xw)));
+        __m128 r22 = _mm_mul_ps(sz, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+        __m128 r23 = _mm_loadu_ps(&soa.position_z[i]);
+
+        _MM_TRANSPOSE4_PS(r00, r01, r02, r03);
+        _MM_TRANSPOSE4_PS(r10, r11, r12, r13);
+        _MM_TRANSPOSE4_PS(r20, r21, r22, r23);
+
+        float *dst = &out[done].m[0][0];
+        _mm_storeu_ps(dst + 0, r00);
+        _mm_storeu_ps(dst + 4, r10);
+        _mm_storeu_ps(dst + 8, r20);
+        _mm_storeu_ps(dst + 12, r01);
+        _mm_storeu_ps(dst + 16, r11);
+        _mm_storeu_ps(dst + 20, r21);
+        _mm_storeu_ps(dst + 24, r02);
+        _mm_storeu_ps(dst + 28, r12);
+        _mm_storeu_ps(dst + 32, r22);
+        _mm_storeu_ps(dst + 36, r03);
+        _mm_storeu_ps(dst + 40, r13);
+        _mm_storeu_ps(dst + 44, r23);
+    }
+
+    return done;
+}
+
+// Transposes four 8-wide rows in place, per 128-bit lane: afterwards the low half of row N holds entity N and the
+// high half holds entity N + 4.
+inline void transpose_4x8(__m256 &a, __m256 &b, __m256 &c, __m256 &d)
+{
+    const __m256 t0 = _mm256_unpacklo_ps(a, b);
+    const __m256 t1 = _mm256_unpacklo_ps(c, d);
+    const __m256 t2 = _mm256_unpackhi_ps(a, b);
+    const __m256 t3 = _mm256_unpackhi_ps(c, d);
+    a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    c = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    d = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+inline void store_row_pair(float *dst, const __m256 &row0, const __m256 &row1, const __m256 &row2)
+{
+    _mm_storeu_ps(dst + 0, _mm256_castps256_ps128(row0));
+    _mm_storeu_ps(dst + 4, _mm256_castps256_ps128(row1));
+    _mm_storeu_ps(dst + 8, _mm256_castps256_ps128(row2));
+    _mm_storeu_ps(dst + 48, _mm256_extractf128_ps(row0, 1));
+    _mm_storeu_ps(dst + 52, _mm256_extractf128_ps(row1, 1));
+    _mm_storeu_ps(dst + 56, _mm256_extractf128_ps(row2, 1));
+}
+
+uint32_t compose_avx2(const ash::scene_tf_soa &soa, uint32_t first, uint32_t count, XMFLOAT3X4 *out)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    uint32_t done = 0;
+    for (; done + 8 <= count; done += 8)
+    {
+        const uint32_t i = first + done;
+        const __m256 x = _mm256_loadu_ps(&soa.rotation_x[i]);
+        const __m256 y = _mm256_loadu_ps(&soa.rotation_y[i]);
+        const __m256 z = _mm256_loadu_ps(&soa.rotation_z[i]);
+        const __m256 w = _mm256_loadu_ps(&soa.rotation_w[i]);
+        const __m256 sx = _mm256_loadu_ps(&soa.scale_x[i]);
+        const __m256 sy = _mm256_loadu_ps(&soa.scale_y[i]);
+        const __m256 sz = _mm256_loadu_ps(&soa.scale_z[i]);
+
+        const __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        const __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        const __m256 xw = _mm256_mul_ps(x, w), yw = _mm256_mul_ps(y, w), zw = _mm256_mul_ps(z, w);
+
+        __m256 r00 = _mm256_mul_ps(sx, _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))));
+        __m256 r01 = _mm256_mul_ps(sy, _mm256_mul_ps(two, _mm256_sub_ps(xy, zw)));
+        __m256 r02 = _mm256_mul_ps(sz, _mm256_mul_ps(two, _mm256_add_ps(xz, yw)));
+        __m256 r03 = _mm256_loadu_ps(&soa.position_x[i]);
+
+        __m256 r10 = _mm256_mul_ps(sx, _mm256_mul_ps(two, _mm256_add_ps(xy, zw)));
+        __m256 r11 = _mm256_mul_ps(sy, _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))));
+        __m256 r12 = _mm256_mul_ps(sz, _mm256_mul_ps(two, _mm256_sub_ps(yz, xw)));
+        __m256 r13 = _mm256_loadu_ps(&soa.position_y[i]);
+
+        __m256 r20 = _mm256_mul_ps(sx, _mm256_mul_ps(two, _mm256_sub_ps(xz, yw)));
+        __m256 r21 = _mm256_mul_ps(sy, _mm256_mul_ps(two, _mm256_add_ps(yz, xw)));
+        __m256 r22 = _mm256_mul_ps(sz, _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))));
+        __m256 r23 = _mm256_loadu_ps(&soa.position_z[i]);
+
+        transpose_4x8(r00, r01, r02, r03);
+        transpose_4x8(r10, r11, r12, r13);
+        transpose_4x8(r20, r21, r22, r23);
+
+        float *dst = &out[done].m[0][0];
+        store_row_pair(dst + 0, r00, r10, r20);
+        store_row_pair(dst + 12, r01, r11, r21);
+        store_row_pair(dst + 24, r02, r12, r22);
+        store_row_pair(dst + 36, r03, r13, r23);
+    }
+
+    return done;
+}
+#endif
+} // namespace
+
+void ash::scene_tf_soa_resize(scene_tf_soa &soa, uint32_t count)
+{
+    soa.position_x.resize(count);
+    soa.position_y.resize(count);
+    soa.position_z.resize(count);
+    soa.rotation_x.resize(count);
+    soa.rotation_y.resize(count);
+    soa.rotation_z.resize(count);
+    soa.rotation_w.resize(count);
+    soa.scale_x.resize(count);
+    soa.scale_y.resize(count);
+    soa.scale_z.resize(count);
+    soa.count = count;
+}
+
+void ash::scene_tf_soa_store(scene_tf_soa &soa, uint32_t index, const transform &transform)
+{
+    assert(index < soa.count);
+
+    soa.position_x[index] = transform.position.x;
+    soa.position_y[index] = transform.position.y;
+    soa.position_z[index] = transform.position.z;
+    soa.rotation_x[index] = transform.rotation.x;
+    soa.rotation_y[index] = transform.rotation.y;
+    soa.rotation_z[index] = transform.rotation.z;
+    soa.rotation_w[index] = transform.rotation.w;
+    soa.scale_x[index] = transform.scale.x;
+    soa.scale_y[index] = transform.scale.y;
+    soa.scale_z[index] = transform.scale.z;
+}
+
+void ash::scene_tf_compose_local_batch(const scene_tf_soa &soa, uint32_t first, uint32_t count, XMFLOAT3X4 *out)
+{
+    assert(first + count <= soa.count);
+
+    uint32_t done = 0;
+#if ASH_CPU_X86
+    if (g_has_avx2 && scene_tf_g_max_compose_path >= scene_tf_compose_path::avx2)
+    {
+        done = compose_avx2(soa, first, count, out);
+    }
+    if (scene_tf_g_max_compose_path >= scene_tf_compose_path::sse)
+    {
+        done += compose_sse(soa, first + done, count - done, out + done);
+    }
+#endif
+    compose_scalar(soa, first + done, count - done, out + done);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <new>
+#include <scene/component.h>
+#include <vector>
+
+namespace ash
+{
+template <typename T, std::size_t Alignment> struct scene_tf_aligned_allocator
+{
+    using value_type = T;
+
+    template <typename U> struct rebind
+    {
+        using other = scene_tf_aligned_allocator<U, Alignment>;
+    };
+
+    scene_tf_aligned_allocator() = default;
+
+    template <typename U> scene_tf_aligned_allocator(const scene_tf_aligned_allocator<U, Alignment> &)
+    {
+    }
+
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T *ptr, std::size_t)
+    {
+        ::operator delete(ptr, std::align_val_t{Alignment});
+    }
+
+    template <typename U> bool operator==(const scene_tf_aligned_allocator<U, Alignment> &) const
+    {
+        return true;
+    }
+};
+
+// Batch kernels, narrowest first.
+enum class scene_tf_compose_path : uint8_t
+{
+    scalar,
+    sse,
+    avx2
+};
+
+// Widest kernel scene_tf_compose_local_batch may use; the CPU still has to support it. Lowered by tests to check
+// the narrower kernels against DirectXMath.
+inline scene_tf_compose_path scene_tf_g_max_compose_path = scene_tf_compose_path::avx2;
+
+using scene_tf_stream = std::vector<float, scene_tf_aligned_allocator<float, 32>>;
+
+// Structure-of-arrays transform storage. Every channel lives in its own 32-byte aligned stream so the batch kernel
+// can load 4 (SSE) or 8 (AVX2) entities per register.
+struct scene_tf_soa
+{
+    scene_tf_stream position_x;
+    scene_tf_stream position_y;
+    scene_tf_stream position_z;
+    scene_tf_stream rotation_x;
+    scene_tf_stream rotation_y;
+    scene_tf_stream rotation_z;
+    scene_tf_stream rotation_w;
+    scene_tf_stream scale_x;
+    scene_tf_stream scale_y;
+    scene_tf_stream scale_z;
+    uint32_t count = 0;
+};
+} // namespace ash
+
+namespace ash
+{
+void scene_tf_soa_resize(scene_tf_soa &soa, uint32_t count);
+void scene_tf_soa_store(scene_tf_soa &soa, uint32_t index, const transform &transform);
+
+// Composes scale * rotation * translation for entities [first, first + count) and writes them as 3x4 affine
+// matrices in XMStoreFloat3x4 layout. Picks the AVX2, SSE or scalar path at runtime, up to
+// scene_tf_g_max_compose_path.
+void scene_tf_compose_local_batch(const scene_tf_soa &soa, uint32_t first, uint32_t count,
+                                  DirectX::XMFLOAT3X4 *out);
+} // namespace ash
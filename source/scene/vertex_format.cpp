@@ -0,0 +1,382 @@
+#include "vertex_format.h"
+#include "job/parallel.h"
+#include "scene/mesh.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <common.h>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr float g_position_max = 65535.0f;
+constexpr float g_radians_to_degrees = 57.2957795f;
+constexpr float g_two_pi = 6.28318531f;
+constexpr float g_tangent_steps = 32768.0f;
+constexpr uint16_t g_tangent_angle_mask = 0x7fff;
+constexpr uint16_t g_tangent_sign_bit = 0x8000;
+
+float sign_not_zero(float value)
+{
+    return value < 0.0f ? -1.0f : 1.0f;
+}
+
+uint16_t encode_unorm16(float value, float offset, float scale)
+{
+    if (scale <= 0.0f)
+    {
+        return 0;
+    }
+    const float unorm = std::clamp((value - offset) / scale, 0.0f, g_position_max);
+    return static_cast<uint16_t>(unorm + 0.5f);
+}
+
+float decode_snorm(int32_t bits, float max)
+{
+    return (std::max)(static_cast<float>(bits) / max, -1.0f);
+}
+
+// Rounds the octahedral coordinates of `normal` to snorms of `max` steps, trying both neighbours on each axis and
+// keeping the pair whose decoded direction is closest to the source.
+void encode_normal(const XMFLOAT3 &normal, float max, int32_t &x, int32_t &y)
+{
+    XMVECTOR source = XMLoadFloat3(&normal);
+    if (XMVectorGetX(XMVector3LengthSq(source)) == 0.0f)
+    {
+        source = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+    }
+    source = XMVector3Normalize(source);
+
+    const XMFLOAT2 encoded = ash::scene_vtx_encode_octahedral(source);
+    const float base_x = std::floor(encoded.x * max);
+    const float base_y = std::floor(encoded.y * max);
+
+    float best_dot = -2.0f;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        const float candidate_x = std::clamp(base_x + float(i & 1), -max, max);
+        const float candidate_y = std::clamp(base_y + float(i >> 1), -max, max);
+        const XMVECTOR decoded = ash::scene_vtx_decode_octahedral({candidate_x / max, candidate_y / max});
+        const float dot = XMVectorGetX(XMVector3Dot(decoded, source));
+        if (dot > best_dot)
+        {
+            best_dot = dot;
+            x = static_cast<int32_t>(candidate_x);
+            y = static_cast<int32_t>(candidate_y);
+        }
+    }
+}
+
+void decode_normal(int32_t x, int32_t y, float max, XMFLOAT3 &normal)
+{
+    XMStoreFloat3(&normal, ash::scene_vtx_decode_octahedral({decode_snorm(x, max), decode_snorm(y, max)}));
+}
+
+uint16_t encode_tangent(const XMFLOAT4 &tangent, const XMFLOAT3 &normal)
+{
+    XMFLOAT3 axis1, axis2;
+    ash::scene_vtx_tangent_basis(normal, axis1, axis2);
+
+    const XMVECTOR direction = XMLoadFloat4(&tangent);
+    const float x = XMVectorGetX(XMVector3Dot(direction, XMLoadFloat3(&axis1)));
+    const float y = XMVectorGetX(XMVector3Dot(direction, XMLoadFloat3(&axis2)));
+    float angle = std::atan2(y, x);
+    angle = angle < 0.0f ? angle + g_two_pi : angle;
+
+    const uint16_t bits = static_cast<uint16_t>(static_cast<uint32_t>(angle / g_two_pi * g_tangent_steps + 0.5f));
+    return (bits & g_tangent_angle_mask) | (tangent.w < 0.0f ? g_tangent_sign_bit : 0);
+}
+
+void decode_tangent(uint16_t bits, const XMFLOAT3 &normal, XMFLOAT4 &tangent)
+{
+    XMFLOAT3 axis1, axis2;
+    ash::scene_vtx_tangent_basis(normal, axis1, axis2);
+
+    const float angle = static_cast<float>(bits & g_tangent_angle_mask) * (g_two_pi / g_tangent_steps);
+    const XMVECTOR direction = XMVectorAdd(XMVectorScale(XMLoadFloat3(&axis1), std::cos(angle)),
+                                           XMVectorScale(XMLoadFloat3(&axis2), std::sin(angle)));
+    XMStoreFloat4(&tangent, XMVectorSetW(direction, (bits & g_tangent_sign_bit) ? -1.0f : 1.0f));
+}
+
+uint16_t encode_half(float value)
+{
+    return PackedVector::XMConvertFloatToHalf(value);
+}
+
+float decode_half(uint16_t bits)
+{
+    return PackedVector::XMConvertHalfToFloat(static_cast<PackedVector::HALF>(bits));
+}
+
+// Angle in degrees between two directions. atan2 keeps precision for the tiny angles that acos loses.
+float angle_between(FXMVECTOR a, FXMVECTOR b)
+{
+    const XMVECTOR unit_a = XMVector3Normalize(a);
+    const XMVECTOR unit_b = XMVector3Normalize(b);
+    const float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(unit_a, unit_b)));
+    const float cosine = XMVectorGetX(XMVector3Dot(unit_a, unit_b));
+    return std::atan2(sine, cosine) * g_radians_to_degrees;
+}
+
+void accumulate(ash::scene_vtx_stats &total, const ash::scene_vtx_stats &mesh)
+{
+    total.vertices += mesh.vertices;
+    total.float_bytes += mesh.float_bytes;
+    total.packed_bytes += mesh.packed_bytes;
+    total.max_position_error = (std::max)(total.max_position_error, mesh.max_position_error);
+    total.max_normal_error = (std::max)(total.max_normal_error, mesh.max_normal_error);
+    total.max_tangent_error = (std::max)(total.max_tangent_error, mesh.max_tangent_error);
+    total.max_uv_error = (std::max)(total.max_uv_error, mesh.max_uv_error);
+}
+} // namespace
+
+uint32_t ash::scene_vtx_get_stride(scene_vtx_format format)
+{
+    switch (format)
+    {
+    case scene_vtx_format::quantized:
+        return sizeof(scene_vtx_quantized);
+    case scene_vtx_format::compact:
+        return sizeof(scene_vtx_compact);
+    case scene_vtx_format::full:
+    default:
+        return sizeof(scene_vtx_full);
+    }
+}
+
+XMFLOAT2 ash::scene_vtx_encode_octahedral(FXMVECTOR normal)
+{
+    XMFLOAT3 n;
+    XMStoreFloat3(&n, normal);
+
+    const float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (length == 0.0f)
+    {
+        return {0.0f, 0.0f};
+    }
+
+    float x = n.x / length;
+    float y = n.y / length;
+    if (n.z < 0.0f)
+    {
+        // Fold the lower hemisphere over the diagonals.
+        const float folded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+        const float folded_y = (1.0f - std::abs(x)) * sign_not_zero(y);
+        x = folded_x;
+        y = folded_y;
+    }
+    return {x, y};
+}
+
+XMVECTOR ash::scene_vtx_decode_octahedral(const XMFLOAT2 &encoded)
+{
+    float x = encoded.x;
+    float y = encoded.y;
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+    if (z < 0.0f)
+    {
+        const float unfolded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+        const float unfolded_y = (1.0f - std::abs(x)) * sign_not_zero(y);
+        x = unfolded_x;
+        y = unfolded_y;
+    }
+    return XMVector3Normalize(XMVectorSet(x, y, z, 0.0f));
+}
+
+void ash::scene_vtx_tangent_basis(const XMFLOAT3 &normal, XMFLOAT3 &axis1, XMFLOAT3 &axis2)
+{
+    const float sign = normal.z >= 0.0f ? 1.0f : -1.0f;
+    const float a = -1.0f / (sign + normal.z);
+    const float b = normal.x * normal.y * a;
+    axis1 = {1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x};
+    axis2 = {b, sign + normal.y * normal.y * a, -normal.y};
+}
+
+void ash::scene_vtx_encode(const scene_vtx_stream &stream, const XMFLOAT3 &position, const XMFLOAT3 &normal,
+                           const XMFLOAT4 &tangent, const XMFLOAT2 &uv, void *out)
+{
+    const XMFLOAT3 &offset = stream.position_offset;
+    const XMFLOAT3 &scale = stream.position_scale;
+
+    switch (stream.format)
+    {
+    case scene_vtx_format::quantized: {
+        scene_vtx_quantized vertex = {};
+        vertex.position[0] = encode_unorm16(position.x, offset.x, scale.x);
+        vertex.position[1] = encode_unorm16(position.y, offset.y, scale.y);
+        vertex.position[2] = encode_unorm16(position.z, offset.z, scale.z);
+
+        int32_t x = 0, y = 0;
+        encode_normal(normal, 32767.0f, x, y);
+        vertex.normal[0] = static_cast<int16_t>(x);
+        vertex.normal[1] = static_cast<int16_t>(y);
+
+        XMFLOAT3 decoded_normal;
+        decode_normal(x, y, 32767.0f, decoded_normal);
+        vertex.tangent = encode_tangent(tangent, decoded_normal);
+
+        vertex.uv[0] = encode_half(uv.x);
+        vertex.uv[1] = encode_half(uv.y);
+        std::memcpy(out, &vertex, sizeof(vertex));
+        break;
+    }
+    case scene_vtx_format::compact: {
+        scene_vtx_compact vertex = {};
+        vertex.position[0] = encode_unorm16(position.x, offset.x, scale.x);
+        vertex.position[1] = encode_unorm16(position.y, offset.y, scale.y);
+        vertex.position[2] = encode_unorm16(position.z, offset.z, scale.z);
+
+        int32_t x = 0, y = 0;
+        encode_normal(normal, 127.0f, x, y);
+        vertex.normal[0] = static_cast<int8_t>(x);
+        vertex.normal[1] = static_cast<int8_t>(y);
+
+        vertex.uv[0] = encode_half(uv.x);
+        vertex.uv[1] = encode_half(uv.y);
+        std::memcpy(out, &vertex, sizeof(vertex));
+        break;
+    }
+    case scene_vtx_format::full:
+    default: {
+        const scene_vtx_full vertex = {position, normal, tangent, uv};
+        std::memcpy(out, &vertex, sizeof(vertex));
+        break;
+    }
+    }
+}
+
+void ash::scene_vtx_decode(const scene_vtx_stream &stream, const void *in, XMFLOAT3 &position, XMFLOAT3 &normal,
+                           XMFLOAT4 &tangent, XMFLOAT2 &uv)
+{
+    const XMFLOAT3 &offset = stream.position_offset;
+    const XMFLOAT3 &scale = stream.position_scale;
+
+    switch (stream.format)
+    {
+    case scene_vtx_format::quantized: {
+        scene_vtx_quantized vertex;
+        std::memcpy(&vertex, in, sizeof(vertex));
+        position = {offset.x + vertex.position[0] * scale.x, offset.y + vertex.position[1] * scale.y,
+                    offset.z + vertex.position[2] * scale.z};
+        decode_normal(vertex.normal[0], vertex.normal[1], 32767.0f, normal);
+        decode_tangent(vertex.tangent, normal, tangent);
+        uv = {decode_half(vertex.uv[0]), decode_half(vertex.uv[1])};
+        break;
+    }
+    case scene_vtx_format::compact: {
+        scene_vtx_compact vertex;
+        std::memcpy(&vertex, in, sizeof(vertex));
+        position = {offset.x + vertex.position[0] * scale.x, offset.y + vertex.position[1] * scale.y,
+                    offset.z + vertex.position[2] * scale.z};
+        decode_normal(vertex.normal[0], vertex.normal[1], 127.0f, normal);
+        tangent = {0.0f, 0.0f, 0.0f, 0.0f};
+        uv = {decode_half(vertex.uv[0]), decode_half(vertex.uv[1])};
+        break;
+    }
+    case scene_vtx_format::full:
+    default: {
+        scene_vtx_full vertex;
+        std::memcpy(&vertex, in, sizeof(vertex));
+        position = vertex.position;
+        normal = vertex.normal;
+        tangent = vertex.tangent;
+        uv = vertex.uv;
+        break;
+    }
+    }
+}
+
+ash::scene_vtx_stats ash::scene_vtx_quantize(scene_mesh_arena &arena, scene_vtx_format format)
+{
+    SCOPED_CPU_EVENT(L"ash::scene_vtx_quantize")
+    assert(arena.normals.size() == arena.positions.size());
+
+    // Meshes own contiguous vertex ranges since their primitives are contiguous, so each gets one packed run.
+    const uint32_t stride = scene_vtx_get_stride(format);
+    arena.vertex_streams.assign(arena.meshes.size(), {});
+    std::size_t data_size = 0;
+    for (std::size_t m = 0; m < arena.meshes.size(); ++m)
+    {
+        const scene_mesh &mesh = arena.meshes[m];
+        scene_vtx_stream &stream = arena.vertex_streams[m];
+        stream.format = format;
+        stream.stride = stride;
+        stream.data_offset = static_cast<uint32_t>(data_size);
+        if (mesh.primitive_count == 0)
+        {
+            continue;
+        }
+
+        const scene_mesh_primitive &first = arena.primitives[mesh.first_primitive];
+        const scene_mesh_primitive &last = arena.primitives[mesh.first_primitive + mesh.primitive_count - 1];
+        stream.first_vertex = first.first_vertex;
+        stream.position_offset = {mesh.center.x - mesh.extents.x, mesh.center.y - mesh.extents.y,
+                                  mesh.center.z - mesh.extents.z};
+        stream.position_scale = {mesh.extents.x * 2.0f / g_position_max, mesh.extents.y * 2.0f / g_position_max,
+                                 mesh.extents.z * 2.0f / g_position_max};
+        data_size += std::size_t(last.first_vertex + last.vertex_count - first.first_vertex) * stride;
+    }
+    arena.vertex_data.assign(data_size, 0);
+
+    std::vector<scene_vtx_stats> mesh_stats(arena.meshes.size());
+    job_parallel_for(static_cast<uint32_t>(arena.meshes.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t m = begin; m < end; ++m)
+        {
+            const scene_mesh &mesh = arena.meshes[m];
+            const scene_vtx_stream &stream = arena.vertex_streams[m];
+            scene_vtx_stats &stats = mesh_stats[m];
+            for (uint32_t p = mesh.first_primitive; p < mesh.first_primitive + mesh.primitive_count; ++p)
+            {
+                const scene_mesh_primitive &primitive = arena.primitives[p];
+                for (uint32_t v = primitive.first_vertex; v < primitive.first_vertex + primitive.vertex_count; ++v)
+                {
+                    uint8_t *packed = arena.vertex_data.data() + stream.data_offset +
+                                      std::size_t(v - stream.first_vertex) * stream.stride;
+                    scene_vtx_encode(stream, arena.positions[v], arena.normals[v], arena.tangents[v], arena.uvs[v],
+                                     packed);
+
+                    XMFLOAT3 position, normal;
+                    XMFLOAT4 tangent;
+                    XMFLOAT2 uv;
+                    scene_vtx_decode(stream, packed, position, normal, tangent, uv);
+
+                    const XMFLOAT3 &source_position = arena.positions[v];
+                    stats.max_position_error = (std::max)({stats.max_position_error,
+                                                           std::abs(position.x - source_position.x),
+                                                           std::abs(position.y - source_position.y),
+                                                           std::abs(position.z - source_position.z)});
+
+                    const XMVECTOR source_normal = XMLoadFloat3(&arena.normals[v]);
+                    if (XMVectorGetX(XMVector3LengthSq(source_normal)) > 0.0f)
+                    {
+                        stats.max_normal_error = (std::max)(
+                            stats.max_normal_error, angle_between(source_normal, XMLoadFloat3(&normal)));
+                    }
+
+                    const XMVECTOR source_tangent = XMLoadFloat4(&arena.tangents[v]);
+                    if (tangent.w != 0.0f && XMVectorGetX(XMVector3LengthSq(source_tangent)) > 0.0f)
+                    {
+                        stats.max_tangent_error = (std::max)(
+                            stats.max_tangent_error, angle_between(source_tangent, XMLoadFloat4(&tangent)));
+                    }
+
+                    stats.max_uv_error = (std::max)({stats.max_uv_error, std::abs(uv.x - arena.uvs[v].x),
+                                                     std::abs(uv.y - arena.uvs[v].y)});
+                }
+                stats.vertices += primitive.vertex_count;
+            }
+            stats.float_bytes = stats.vertices * (sizeof(XMFLOAT3) * 2 + sizeof(XMFLOAT4) + sizeof(XMFLOAT2));
+            stats.packed_bytes = stats.vertices * stream.stride;
+        }
+    });
+
+    scene_vtx_stats stats;
+    for (const scene_vtx_stats &mesh : mesh_stats)
+    {
+        accumulate(stats, mesh);
+    }
+    return stats;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+
+namespace ash
+{
+struct scene_mesh_arena;
+
+// Layout of one vertex in scene_mesh_arena::vertex_data. Must match VERTEX_FORMAT in shaders/vertex.hlsli.
+enum class scene_vtx_format : uint8_t
+{
+    full,      // float3 position, float3 normal, float4 tangent, float2 uv, 48 bytes
+    quantized, // unorm16x3 position + tangent angle, octahedral snorm16x2 normal, half2 uv, 16 bytes
+    compact,   // unorm16x3 position, octahedral snorm8x2 normal, half2 uv, 12 bytes; no tangent
+    count
+};
+
+// Format applied to meshes imported from now on.
+inline scene_vtx_format scene_vtx_g_format = scene_vtx_format::quantized;
+
+struct scene_vtx_full
+{
+    DirectX::XMFLOAT3 position;
+    DirectX::XMFLOAT3 normal;
+    DirectX::XMFLOAT4 tangent;
+    DirectX::XMFLOAT2 uv;
+};
+
+// Positions are unorms over the mesh AABB, see scene_vtx_stream. Normals are octahedral-mapped onto [-1, 1]^2 and
+// stored as snorms; uvs are halves. The tangent takes the fourth position slot: bits 0-14 are its angle around the
+// decoded normal, measured from the first axis of scene_vtx_tangent_basis, and bit 15 is set when w is -1.
+struct scene_vtx_quantized
+{
+    uint16_t position[3];
+    uint16_t tangent;
+    int16_t normal[2];
+    uint16_t uv[2];
+};
+
+struct scene_vtx_compact
+{
+    uint16_t position[3];
+    int8_t normal[2];
+    uint16_t uv[2];
+};
+
+static_assert(sizeof(scene_vtx_full) == 48);
+static_assert(sizeof(scene_vtx_quantized) == 16);
+static_assert(sizeof(scene_vtx_compact) == 12);
+
+// Where and how the vertices of one mesh are packed, with their dequantization constants. Arena vertex v of the mesh
+// starts at byte data_offset + (v - first_vertex) * stride, and a position decodes to position_offset + q *
+// position_scale, where q is the raw unorm16 value. position_scale is zero on axes where the mesh is flat.
+struct scene_vtx_stream
+{
+    scene_vtx_format format = scene_vtx_format::full;
+    uint32_t stride = 0;
+    uint32_t first_vertex = 0;
+    uint32_t data_offset = 0;
+    DirectX::XMFLOAT3 position_offset = {0.0f, 0.0f, 0.0f};
+    DirectX::XMFLOAT3 position_scale = {0.0f, 0.0f, 0.0f};
+};
+
+static_assert(sizeof(scene_vtx_stream) == 40);
+
+// Footprint of the source float streams against the packed ones, and the largest reconstruction errors seen while
+// packing: position error in object units per axis, normal and tangent error in degrees, uv error in texture
+// coordinates. Formats without a tangent do not contribute to the tangent error.
+struct scene_vtx_stats
+{
+    uint64_t vertices = 0;
+    uint64_t float_bytes = 0;
+    uint64_t packed_bytes = 0;
+    float max_position_error = 0.0f;
+    float max_normal_error = 0.0f;
+    float max_tangent_error = 0.0f;
+    float max_uv_error = 0.0f;
+};
+} // namespace ash
+
+namespace ash
+{
+uint32_t scene_vtx_get_stride(scene_vtx_format format);
+
+// Maps a unit vector onto the octahedron unfolded over [-1, 1]^2, and back.
+DirectX::XMFLOAT2 scene_vtx_encode_octahedral(DirectX::FXMVECTOR normal);
+DirectX::XMVECTOR scene_vtx_decode_octahedral(const DirectX::XMFLOAT2 &encoded);
+
+// Branchless orthonormal basis around a unit normal (Duff et al. 2017), the reference frame of quantized tangents.
+void scene_vtx_tangent_basis(const DirectX::XMFLOAT3 &normal, DirectX::XMFLOAT3 &axis1, DirectX::XMFLOAT3 &axis2);
+
+// Encodes one vertex into `out`, which must hold stream.stride bytes. Normals are rounded to the snorm pair whose
+// decoded direction is closest to the source, not just the nearest one, and tangents are encoded against the decoded
+// normal. Formats without a tangent decode it as zero.
+void scene_vtx_encode(const scene_vtx_stream &stream, const DirectX::XMFLOAT3 &position,
+                      const DirectX::XMFLOAT3 &normal, const DirectX::XMFLOAT4 &tangent, const DirectX::XMFLOAT2 &uv,
+                      void *out);
+void scene_vtx_decode(const scene_vtx_stream &stream, const void *in, DirectX::XMFLOAT3 &position,
+                      DirectX::XMFLOAT3 &normal, DirectX::XMFLOAT4 &tangent, DirectX::XMFLOAT2 &uv);
+
+// Packs the float streams of every mesh of `arena` into arena.vertex_data in `format`, quantizing positions against
+// the mesh AABB, and fills arena.vertex_streams. Meshes are packed in parallel. Needs the float attributes, so run it
+// before scene_mesh_release_attributes, after scene_mesh_compute_bounds and after any pass that moves vertices.
+scene_vtx_stats scene_vtx_quantize(scene_mesh_arena &arena, scene_vtx_format format);
+} // namespace ash
@@ -0,0 +1,337 @@
+#include "job/scheduler.h"
+#include "scene/bvh.h"
+#include "tests/test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+
+using namespace DirectX;
+
+namespace
+{
+struct test_box
+{
+    XMFLOAT3 min;
+    XMFLOAT3 max;
+    XMFLOAT4 sphere;
+};
+
+test_box make_box(ash::test_random &random, float world_size)
+{
+    const XMFLOAT3 center = {random.uniform(-world_size, world_size),
+                             random.uniform(-world_size * 0.1f, world_size * 0.1f),
+                             random.uniform(-world_size, world_size)};
+    const XMFLOAT3 extents = {random.uniform(0.1f, 2.0f), random.uniform(0.1f, 2.0f), random.uniform(0.1f, 2.0f)};
+    const float radius = std::sqrt(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+    return {{center.x - extents.x, center.y - extents.y, center.z - extents.z},
+            {center.x + extents.x, center.y + extents.y, center.z + extents.z},
+            {center.x, center.y, center.z, radius}};
+}
+
+void set_box(ash::scene_bvh &bvh, std::map<flecs::entity_t, test_box> &boxes, flecs::entity_t entity,
+             const test_box &box)
+{
+    ash::scene_bvh_set_bounds(bvh, entity, box.min, box.max, box.sphere);
+    boxes[entity] = box;
+}
+
+ash::scene_cull_frustum make_frustum(float yaw)
+{
+    const XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f),
+                                           XMVectorSet(std::sin(yaw), -0.2f, std::cos(yaw), 0.0f),
+                                           XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 150.0f);
+    return ash::scene_cull_extract_frustum(XMMatrixMultiply(view, projection));
+}
+
+bool ray_hits(const test_box &box, const XMFLOAT3 &origin, const XMFLOAT3 &inv_direction, float max_distance)
+{
+    const float tx1 = (box.min.x - origin.x) * inv_direction.x, tx2 = (box.max.x - origin.x) * inv_direction.x;
+    const float ty1 = (box.min.y - origin.y) * inv_direction.y, ty2 = (box.max.y - origin.y) * inv_direction.y;
+    const float tz1 = (box.min.z - origin.z) * inv_direction.z, tz2 = (box.max.z - origin.z) * inv_direction.z;
+    const float t_near = std::max({std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f});
+    const float t_far = std::min({std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), max_distance});
+    return t_near <= t_far;
+}
+
+bool is_box_visible(const ash::scene_cull_frustum &frustum, const test_box &box)
+{
+    const XMFLOAT3 c = {0.5f * (box.min.x + box.max.x), 0.5f * (box.min.y + box.max.y), 0.5f * (box.min.z + box.max.z)};
+    const XMFLOAT3 e = {0.5f * (box.max.x - box.min.x), 0.5f * (box.max.y - box.min.y), 0.5f * (box.max.z - box.min.z)};
+    for (const XMFLOAT4 &plane : frustum.planes)
+    {
+        const float distance = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+        const float radius = std::abs(plane.x) * e.x + std::abs(plane.y) * e.y + std::abs(plane.z) * e.z;
+        if (distance + radius < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs every query kind against the tree and against a brute-force pass over `boxes`; returns the mismatch count.
+uint32_t check_queries(ash::test_random &random, const ash::scene_bvh &bvh,
+                       const std::map<flecs::entity_t, test_box> &boxes)
+{
+    uint32_t mismatches = 0;
+    std::vector<flecs::entity_t> found, expected;
+    auto compare = [&] {
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        mismatches += found != expected;
+        found.clear();
+        expected.clear();
+    };
+
+    for (uint32_t q = 0; q < 8; ++q)
+    {
+        const test_box query = make_box(random, 100.0f);
+        const XMFLOAT3 min = {query.min.x - 10.0f, query.min.y - 10.0f, query.min.z - 10.0f};
+        const XMFLOAT3 max = {query.max.x + 10.0f, query.max.y + 10.0f, query.max.z + 10.0f};
+        ash::scene_bvh_query_aabb(bvh, min, max, found);
+        for (const auto &[entity, box] : boxes)
+        {
+            if (box.min.x <= max.x && box.max.x >= min.x && box.min.y <= max.y && box.max.y >= min.y &&
+                box.min.z <= max.z && box.max.z >= min.z)
+            {
+                expected.push_back(entity);
+            }
+        }
+        compare();
+
+        const XMFLOAT4 sphere = {query.sphere.x, query.sphere.y, query.sphere.z, 15.0f};
+        ash::scene_bvh_query_sphere(bvh, sphere, found);
+        for (const auto &[entity, box] : boxes)
+        {
+            const float dx = std::max({box.min.x - sphere.x, 0.0f, sphere.x - box.max.x});
+            const float dy = std::max({box.min.y - sphere.y, 0.0f, sphere.y - box.max.y});
+            const float dz = std::max({box.min.z - sphere.z, 0.0f, sphere.z - box.max.z});
+            if (dx * dx + dy * dy + dz * dz <= sphere.w * sphere.w)
+            {
+                expected.push_back(entity);
+            }
+        }
+        compare();
+
+        const XMFLOAT3 origin = {query.sphere.x, query.sphere.y, query.sphere.z};
+        XMFLOAT3 direction;
+        XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(random.uniform(-1.0f, 1.0f),
+                                                                 random.uniform(-0.2f, 0.2f),
+                                                                 random.uniform(-1.0f, 1.0f), 0.0f)));
+        const XMFLOAT3 inv_direction = {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+        std::vector<ash::scene_bvh_ray_hit> hits;
+        ash::scene_bvh_query_ray(bvh, origin, direction, 200.0f, hits);
+        for (uint32_t i = 0; i < hits.size(); ++i)
+        {
+            mismatches += i > 0 && hits[i - 1].distance > hits[i].distance;
+            found.push_back(hits[i].entity);
+        }
+        for (const auto &[entity, box] : boxes)
+        {
+            if (ray_hits(box, origin, inv_direction, 200.0f))
+            {
+                expected.push_back(entity);
+            }
+        }
+        compare();
+
+        // Nodes are culled by their boxes and leaf items by their spheres, so an item whose sphere reaches into the
+        // frustum while its box does not may be dropped. Everything else must match the sphere test.
+        const ash::scene_cull_frustum frustum = make_frustum(random.uniform(-3.0f, 3.0f));
+        ash::scene_bvh_query_frustum(bvh, frustum, found);
+        ash::scene_cull_spheres spheres;
+        std::vector<flecs::entity_t> entities;
+        for (const auto &[entity, box] : boxes)
+        {
+            ash::scene_cull_spheres_push(spheres, box.sphere);
+            entities.push_back(entity);
+        }
+        std::vector<uint32_t> visible(entities.size());
+        const uint32_t visible_count = ash::scene_cull_frustum_spheres(frustum, spheres, visible.data());
+        std::sort(found.begin(), found.end());
+        for (uint32_t i = 0; i < visible_count; ++i)
+        {
+            const flecs::entity_t entity = entities[visible[i]];
+            const bool box_visible = is_box_visible(frustum, boxes.at(entity));
+            const bool reported = std::binary_search(found.begin(), found.end(), entity);
+            mismatches += box_visible && !reported;
+            expected.push_back(entity);
+        }
+        std::sort(expected.begin(), expected.end());
+        mismatches += !std::includes(expected.begin(), expected.end(), found.begin(), found.end());
+        found.clear();
+        expected.clear();
+    }
+    return mismatches;
+}
+
+ash::scene_bvh make_tree(ash::test_random &random, uint32_t count, std::map<flecs::entity_t, test_box> &boxes)
+{
+    ash::scene_bvh bvh;
+    for (flecs::entity_t entity = 1; entity <= count; ++entity)
+    {
+        set_box(bvh, boxes, entity, make_box(random, 100.0f));
+    }
+    ash::scene_bvh_rebuild(bvh);
+    return bvh;
+}
+} // namespace
+
+TEST_CASE(bvh, queries_match_brute_force_while_the_scene_changes)
+{
+    ash::test_random random;
+    std::map<flecs::entity_t, test_box> boxes;
+    ash::scene_bvh bvh = make_tree(random, 5000, boxes);
+    CHECK(bvh.overflow.empty());
+    CHECK(check_queries(random, bvh, boxes) == 0);
+
+    flecs::entity_t next_entity = 5001;
+    uint32_t mismatches = 0;
+    for (uint32_t frame = 0; frame < 40; ++frame)
+    {
+        for (uint32_t i = 0; i < 50; ++i)
+        {
+            set_box(bvh, boxes, next_entity++, make_box(random, 100.0f));
+        }
+        for (uint32_t i = 0; i < 200; ++i)
+        {
+            auto it = boxes.lower_bound(random.next() % next_entity);
+            if (it != boxes.end())
+            {
+                // Small moves refit in place, some entities jump across the world to degrade their subtree.
+                test_box box = i % 10 == 0 ? make_box(random, 100.0f) : it->second;
+                const float dx = random.uniform(-1.0f, 1.0f);
+                box.min.x += dx;
+                box.max.x += dx;
+                box.sphere.x += dx;
+                set_box(bvh, boxes, it->first, box);
+            }
+        }
+        for (uint32_t i = 0; i < 30; ++i)
+        {
+            auto it = boxes.lower_bound(random.next() % next_entity);
+            if (it != boxes.end())
+            {
+                ash::scene_bvh_remove(bvh, it->first);
+                boxes.erase(it);
+            }
+        }
+
+        ash::scene_bvh_update(bvh);
+        mismatches += check_queries(random, bvh, boxes);
+    }
+    CHECK(mismatches == 0);
+    CHECK(bvh.lookup.size() == boxes.size());
+}
+
+TEST_CASE(bvh, new_items_are_inserted_into_leaves)
+{
+    ash::test_random random;
+    std::map<flecs::entity_t, test_box> boxes;
+    ash::scene_bvh bvh = make_tree(random, 10000, boxes);
+    const std::size_t slot_count = bvh.item_refs.size();
+
+    for (flecs::entity_t entity = 10001; entity <= 10500; ++entity)
+    {
+        set_box(bvh, boxes, entity, make_box(random, 100.0f));
+    }
+    CHECK(bvh.overflow.size() == 500);
+    ash::scene_bvh_update(bvh);
+
+    // Free leaf slots take in nearly all of them, and every item is either in its leaf or in the overflow list.
+    std::printf("  %zu of 500 items left in the overflow list\n", bvh.overflow.size());
+    CHECK(bvh.overflow.size() < 25);
+    CHECK(bvh.item_refs.size() == slot_count); // a full rebuild would have resized item_refs
+    uint32_t misplaced = 0;
+    for (uint32_t i = 0; i < bvh.items.size(); ++i)
+    {
+        const ash::scene_bvh_item &item = bvh.items[i];
+        if (item.node == ash::scene_bvh_invalid)
+        {
+            misplaced += bvh.overflow[item.overflow_slot] != i;
+            continue;
+        }
+        const ash::scene_bvh_node &leaf = bvh.nodes[item.node];
+        misplaced += leaf.count == 0 || leaf.count > leaf.range_count ||
+                     std::find(bvh.item_refs.begin() + leaf.first, bvh.item_refs.begin() + leaf.first + leaf.count,
+                               i) == bvh.item_refs.begin() + leaf.first + leaf.count;
+    }
+    CHECK(misplaced == 0);
+    CHECK(check_queries(random, bvh, boxes) == 0);
+}
+
+TEST_CASE(bvh, overflow_removal_keeps_the_rest)
+{
+    ash::test_random random;
+    std::map<flecs::entity_t, test_box> boxes;
+    ash::scene_bvh bvh;
+    for (flecs::entity_t entity = 1; entity <= 40; ++entity)
+    {
+        set_box(bvh, boxes, entity, make_box(random, 10.0f));
+    }
+    for (flecs::entity_t entity : {1, 17, 40, 2})
+    {
+        ash::scene_bvh_remove(bvh, entity);
+        boxes.erase(entity);
+    }
+
+    CHECK(bvh.overflow.size() == 36);
+    uint32_t misplaced = 0;
+    for (uint32_t o = 0; o < bvh.overflow.size(); ++o)
+    {
+        misplaced += bvh.items[bvh.overflow[o]].overflow_slot != o || bvh.items[bvh.overflow[o]].entity == 0;
+    }
+    CHECK(misplaced == 0);
+    CHECK(check_queries(random, bvh, boxes) == 0);
+}
+
+BENCHMARK_CASE(bvh, build_refit_query)
+{
+    ash::job_init(0);
+    ash::test_random random;
+    for (const uint32_t count : {10000u, 100000u, 1000000u})
+    {
+        std::map<flecs::entity_t, test_box> boxes;
+        ash::scene_bvh bvh = make_tree(random, count, boxes);
+        const double build_ns = ash::test_measure_ns(3, [&] { ash::scene_bvh_rebuild(bvh); });
+
+        // One percent of the items move a little every frame.
+        std::vector<flecs::entity_t> moving(count / 100);
+        for (flecs::entity_t &entity : moving)
+        {
+            entity = 1 + random.next() % count;
+        }
+        const double refit_ns = ash::test_measure_ns(20, [&] {
+            for (flecs::entity_t entity : moving)
+            {
+                test_box &box = boxes[entity];
+                const float dy = random.uniform(-0.1f, 0.1f);
+                box.min.y += dy;
+                box.max.y += dy;
+                box.sphere.y += dy;
+                ash::scene_bvh_set_bounds(bvh, entity, box.min, box.max, box.sphere);
+            }
+            ash::scene_bvh_update(bvh);
+        });
+
+        std::vector<flecs::entity_t> out;
+        const ash::scene_cull_frustum frustum = make_frustum(0.5f);
+        const double frustum_ns = ash::test_measure_ns(20, [&] {
+            out.clear();
+            ash::scene_bvh_query_frustum(bvh, frustum, out);
+        });
+        const std::size_t visible = out.size();
+
+        std::vector<ash::scene_bvh_ray_hit> hits;
+        const double ray_ns = ash::test_measure_ns(1000, [&] {
+            hits.clear();
+            ash::scene_bvh_query_ray(bvh, {0.0f, 1.0f, 0.0f}, {0.6f, 0.0f, 0.8f}, 1000.0f, hits);
+        });
+
+        std::printf("  %7u items: build %8.2f ms, refit 1%% %7.3f ms, frustum %7.3f ms (%zu visible), ray %6.2f us\n",
+                    count, build_ns * 1e-6, refit_ns * 1e-6, frustum_ns * 1e-6, visible, ray_ns * 1e-3);
+    }
+    ash::job_shutdown();
+}
@@ -0,0 +1,180 @@
+#include "job/parallel.h"
+#include "job/scheduler.h"
+#include "renderer/core/command_queue.h"
+#include "renderer/core/frame_ring.h"
+#include "renderer/renderer.h"
+#include "tests/test.h"
+#include <chrono>
+#include <cstdio>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+constexpr uint32_t g_lists_per_frame = 64;
+constexpr uint32_t g_commands_per_list = 2000;
+
+// The renderer has no null backend; WARP is the software device every Windows install has, and recording into it is
+// CPU work only. Returns false, leaving rhi_g_device empty, where it cannot be created.
+bool create_warp_device()
+{
+    winrt::com_ptr<IDXGIFactory4> factory;
+    winrt::com_ptr<IDXGIAdapter> adapter;
+    if (FAILED(CreateDXGIFactory2(0, IID_PPV_ARGS(factory.put()))) ||
+        FAILED(factory->EnumWarpAdapter(IID_PPV_ARGS(adapter.put()))) ||
+        FAILED(D3D12CreateDevice(adapter.get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(ash::rhi_g_device.put()))))
+    {
+        std::printf("  WARP device unavailable, skipped\n");
+        ash::rhi_g_device = nullptr;
+        return false;
+    }
+
+    ash::rhi_cmd_init();
+    return true;
+}
+
+void destroy_warp_device()
+{
+    ash::rhi_cmd_shutdown();
+    ash::rhi_cmd_g_direct = nullptr;
+    ash::rhi_cmd_g_compute = nullptr;
+    ash::rhi_cmd_g_copy = nullptr;
+    ash::rhi_g_device = nullptr;
+}
+
+// Fixed-function state only, so no pipeline or resources are needed and the cost is the recording itself.
+ID3D12GraphicsCommandList *record_list()
+{
+    ID3D12GraphicsCommandList *list = ash::rhi_cmd_acquire(ash::rhi_cmd_queue_type::direct);
+    const D3D12_VIEWPORT viewport = {0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f};
+    const D3D12_RECT scissor = {0, 0, 1920, 1080};
+    for (uint32_t i = 0; i < g_commands_per_list; i += 4)
+    {
+        list->RSSetViewports(1, &viewport);
+        list->RSSetScissorRects(1, &scissor);
+        list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        list->OMSetStencilRef(i);
+    }
+    list->Close();
+    return list;
+}
+
+// Submits `lists` in one batch and blocks until the GPU is done, so the frame slot can be recycled right away.
+void submit_and_wait(const std::vector<ID3D12CommandList *> &lists, ID3D12Fence *fence, uint64_t &fence_value)
+{
+    ash::rhi_cmd_g_direct->ExecuteCommandLists(static_cast<UINT>(lists.size()), lists.data());
+    ash::rhi_cmd_g_direct->Signal(fence, ++fence_value);
+    fence->SetEventOnCompletion(fence_value, nullptr);
+}
+} // namespace
+
+TEST_CASE(command_queue, pools_hand_out_distinct_reused_lists)
+{
+    if (!create_warp_device())
+    {
+        return;
+    }
+    ash::job_init(3);
+
+    winrt::com_ptr<ID3D12Fence> fence;
+    ash::rhi_g_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(fence.put()));
+    uint64_t fence_value = 0;
+
+    // Lists acquired in parallel within one frame are all different.
+    std::vector<ID3D12CommandList *> lists(g_lists_per_frame);
+    for (uint32_t frame = 0; frame < 3; ++frame)
+    {
+        ash::rhi_cmd_begin_frame(ash::rhi_frame_g_ring.index);
+        ash::job_parallel_for(g_lists_per_frame, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                lists[i] = record_list();
+            }
+        });
+        CHECK(std::unordered_set<ID3D12CommandList *>(lists.begin(), lists.end()).size() == lists.size());
+        submit_and_wait(lists, fence.get(), fence_value);
+    }
+
+    // One thread gets its lists back in the same order once the slot is recycled.
+    std::vector<ID3D12CommandList *> first(4), second(4);
+    ash::rhi_cmd_begin_frame(ash::rhi_frame_g_ring.index);
+    for (ID3D12CommandList *&list : first)
+    {
+        list = record_list();
+    }
+    submit_and_wait(first, fence.get(), fence_value);
+    ash::rhi_cmd_begin_frame(ash::rhi_frame_g_ring.index);
+    for (ID3D12CommandList *&list : second)
+    {
+        list = record_list();
+    }
+    submit_and_wait(second, fence.get(), fence_value);
+    CHECK(first == second);
+    CHECK(ash::rhi_g_device->GetDeviceRemovedReason() == S_OK);
+
+    ash::job_shutdown();
+    fence = nullptr;
+    destroy_warp_device();
+}
+
+BENCHMARK_CASE(command_queue, recording_throughput)
+{
+    if (!create_warp_device())
+    {
+        return;
+    }
+
+    winrt::com_ptr<ID3D12Fence> fence;
+    ash::rhi_g_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(fence.put()));
+    uint64_t fence_value = 0;
+
+    // One thread records every list itself; more threads split them with job_parallel_for, as scene_render does.
+    double single_thread_ns = 0.0;
+    for (const uint32_t threads : {1u, 2u, 4u, 8u, 16u})
+    {
+        ash::job_init(threads > 1 ? threads - 1 : 1);
+
+        std::vector<ID3D12CommandList *> lists(g_lists_per_frame);
+        double record_ns = 0.0;
+        constexpr uint32_t frames = 20;
+        for (uint32_t frame = 0; frame < frames + 3; ++frame)
+        {
+            ash::rhi_cmd_begin_frame(ash::rhi_frame_g_ring.index);
+            const auto begin = std::chrono::high_resolution_clock::now();
+            if (threads == 1)
+            {
+                for (ID3D12CommandList *&list : lists)
+                {
+                    list = record_list();
+                }
+            }
+            else
+            {
+                ash::job_parallel_for(g_lists_per_frame, 1, [&](uint32_t first, uint32_t last) {
+                    for (uint32_t i = first; i < last; ++i)
+                    {
+                        lists[i] = record_list();
+                    }
+                });
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+
+            // The first frames create the pooled lists and are not timed.
+            if (frame >= 3)
+            {
+                record_ns += std::chrono::duration<double, std::nano>(end - begin).count();
+            }
+            submit_and_wait(lists, fence.get(), fence_value);
+        }
+        record_ns /= frames;
+        single_thread_ns = threads == 1 ? record_ns : single_thread_ns;
+
+        std::printf("  %2u threads: %7.3f ms per frame of %u lists, %8.0f commands/ms, %.2fx\n", threads,
+                    record_ns * 1e-6, g_lists_per_frame, g_lists_per_frame * g_commands_per_list * 1e6 / record_ns,
+                    single_thread_ns / record_ns);
+        ash::job_shutdown();
+    }
+
+    fence = nullptr;
+    destroy_warp_device();
+}
@@ -0,0 +1,72 @@
+#include "job/cpu.h"
+#include "tests/test.h"
+#include <algorithm>
+#include <set>
+
+#if defined(_WIN32)
+#include <common.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+TEST_CASE(cpu, topology_respects_process_affinity)
+{
+    const ash::job_cpu_topology &topology = ash::job_cpu_get_topology();
+    CHECK(!topology.logical.empty());
+
+    // Processors outside the affinity the process was started with, e.g. through taskset or start /affinity, must
+    // not be offered to the scheduler.
+    uint32_t outside = 0;
+#if defined(_WIN32)
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) && process_mask != 0)
+    {
+        for (const ash::job_cpu_logical &logical : topology.logical)
+        {
+            outside += (process_mask & (DWORD_PTR(1) << logical.id)) == 0;
+        }
+    }
+#elif defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        for (const ash::job_cpu_logical &logical : topology.logical)
+        {
+            outside += logical.id >= CPU_SETSIZE || !CPU_ISSET(logical.id, &allowed);
+        }
+    }
+#endif
+    CHECK(outside == 0);
+
+    // Core indices are dense, so core_count only counts cores the process can use.
+    std::set<uint32_t> cores;
+    for (const ash::job_cpu_logical &logical : topology.logical)
+    {
+        cores.insert(logical.core);
+    }
+    CHECK(cores.size() == topology.core_count);
+    CHECK(*cores.rbegin() + 1 == topology.core_count);
+    CHECK(topology.performance_core_count >= 1 && topology.performance_core_count <= topology.core_count);
+}
+
+TEST_CASE(cpu, placement_spreads_over_cores_first)
+{
+    const ash::job_cpu_topology &topology = ash::job_cpu_get_topology();
+    const std::vector<uint32_t> placement = ash::job_cpu_get_placement(topology);
+    CHECK(placement.size() == topology.logical.size());
+
+    std::vector<uint32_t> sorted = placement;
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+    CHECK(sorted.empty() || sorted.back() < topology.logical.size());
+
+    // The first core_count placements each get a core of their own.
+    std::set<uint32_t> cores;
+    for (uint32_t i = 0; i < std::min<size_t>(topology.core_count, placement.size()); ++i)
+    {
+        cores.insert(topology.logical[placement[i]].core);
+    }
+    CHECK(cores.size() == std::min<size_t>(topology.core_count, placement.size()));
+}
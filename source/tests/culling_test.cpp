@@ -0,0 +1,141 @@
+#include "scene/culling.h"
+#include "tests/test.h"
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+ash::scene_cull_frustum make_frustum(float yaw)
+{
+    const XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 2.0f, -10.0f, 1.0f),
+                                           XMVectorSet(std::sin(yaw), -0.1f, std::cos(yaw), 0.0f),
+                                           XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 200.0f);
+    return ash::scene_cull_extract_frustum(XMMatrixMultiply(view, projection));
+}
+
+ash::scene_cull_spheres make_spheres(ash::test_random &random, uint32_t count)
+{
+    ash::scene_cull_spheres spheres;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ash::scene_cull_spheres_push(spheres, {random.uniform(-150.0f, 150.0f), random.uniform(-50.0f, 50.0f),
+                                               random.uniform(-150.0f, 250.0f), random.uniform(0.0f, 20.0f)});
+    }
+    return spheres;
+}
+
+// Spheres that touch a frustum plane from outside, so the result hinges on the last bit of the plane distance.
+void push_touching_spheres(ash::test_random &random, const ash::scene_cull_frustum &frustum,
+                           ash::scene_cull_spheres &spheres, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const XMFLOAT4 &plane = frustum.planes[random.next() % 6];
+        const XMFLOAT3 point = {random.uniform(-100.0f, 100.0f), random.uniform(-100.0f, 100.0f),
+                                random.uniform(-100.0f, 100.0f)};
+        const float distance = plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+        const float radius = random.uniform(0.0f, 5.0f);
+        const float offset = distance + radius;
+        ash::scene_cull_spheres_push(spheres, {point.x - plane.x * offset, point.y - plane.y * offset,
+                                               point.z - plane.z * offset, radius});
+    }
+}
+
+// One bit per sphere from the plain per-sphere test, in the same operation order as the engine's scalar path.
+std::vector<bool> get_reference_mask(const ash::scene_cull_frustum &frustum, const ash::scene_cull_spheres &spheres)
+{
+    std::vector<bool> mask(spheres.radius.size(), true);
+    for (std::size_t i = 0; i < mask.size(); ++i)
+    {
+        for (const XMFLOAT4 &plane : frustum.planes)
+        {
+            if (plane.x * spheres.center_x[i] + plane.y * spheres.center_y[i] + plane.z * spheres.center_z[i] +
+                    plane.w <
+                -spheres.radius[i])
+            {
+                mask[i] = false;
+            }
+        }
+    }
+    return mask;
+}
+
+std::vector<bool> get_mask(const ash::scene_cull_frustum &frustum, const ash::scene_cull_spheres &spheres,
+                           bool &ascending)
+{
+    std::vector<uint32_t> visible(spheres.radius.size());
+    const uint32_t visible_count = ash::scene_cull_frustum_spheres(frustum, spheres, visible.data());
+    std::vector<bool> mask(spheres.radius.size(), false);
+    ascending = true;
+    for (uint32_t i = 0; i < visible_count; ++i)
+    {
+        ascending = ascending && (i == 0 || visible[i - 1] < visible[i]);
+        mask[visible[i]] = true;
+    }
+    return mask;
+}
+} // namespace
+
+TEST_CASE(culling, matches_scalar_reference)
+{
+    ash::test_random random;
+    uint32_t mismatches = 0;
+    uint32_t unordered = 0;
+    uint32_t visible = 0;
+    for (uint32_t round = 0; round < 200; ++round)
+    {
+        // Every remainder modulo the SIMD width, so the scalar tail is covered as well as the 4-wide kernel.
+        const uint32_t count = round < 16 ? round : random.next() % 2000;
+        const ash::scene_cull_frustum frustum = make_frustum(random.uniform(-3.0f, 3.0f));
+        ash::scene_cull_spheres spheres = make_spheres(random, count / 2);
+        push_touching_spheres(random, frustum, spheres, count - count / 2);
+
+        bool ascending = false;
+        const std::vector<bool> mask = get_mask(frustum, spheres, ascending);
+        const std::vector<bool> reference = get_reference_mask(frustum, spheres);
+        mismatches += mask != reference;
+        unordered += !ascending;
+        for (const bool v : mask)
+        {
+            visible += v;
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(unordered == 0);
+    // The scene straddles the frustum, so both outcomes are exercised.
+    CHECK(visible > 0);
+}
+
+TEST_CASE(culling, extracted_planes_bound_the_view)
+{
+    const ash::scene_cull_frustum frustum = make_frustum(0.0f);
+    ash::scene_cull_spheres spheres;
+    ash::scene_cull_spheres_push(spheres, {0.0f, 2.0f, 0.0f, 0.5f});    // ahead of the camera
+    ash::scene_cull_spheres_push(spheres, {0.0f, 2.0f, -20.0f, 0.5f});  // behind it
+    ash::scene_cull_spheres_push(spheres, {0.0f, 2.0f, 300.0f, 0.5f});  // past the far plane
+    ash::scene_cull_spheres_push(spheres, {-40.0f, 2.0f, 0.0f, 0.5f});  // off to the left
+    ash::scene_cull_spheres_push(spheres, {-40.0f, 2.0f, 0.0f, 40.0f}); // large enough to reach into view
+
+    uint32_t visible[5];
+    const uint32_t visible_count = ash::scene_cull_frustum_spheres(frustum, spheres, visible);
+    CHECK(visible_count == 2);
+    CHECK(visible[0] == 0);
+    CHECK(visible[1] == 4);
+}
+
+BENCHMARK_CASE(culling, frustum_spheres)
+{
+    ash::test_random random;
+    const ash::scene_cull_frustum frustum = make_frustum(0.3f);
+    for (const uint32_t count : {1000u, 100000u, 1000000u})
+    {
+        const ash::scene_cull_spheres spheres = make_spheres(random, count);
+        std::vector<uint32_t> visible(count);
+        uint32_t visible_count = 0;
+        const double ns = ash::test_measure_ns(
+            20, [&] { visible_count = ash::scene_cull_frustum_spheres(frustum, spheres, visible.data()); });
+        std::printf("  %7u spheres: %8.0f entities/ms, %u visible\n", count, count * 1e6 / ns, visible_count);
+    }
+}
@@ -0,0 +1,92 @@
+#include "renderer/core/frame_ring.h"
+#include "tests/test.h"
+
+namespace
+{
+// Stands in for the GPU fence: frames complete only when the CPU waits for them, and then only up to the value
+// waited on, so any wait that covers more than the slot being reused shows up as frames completed too early.
+struct fake_fence
+{
+    uint64_t completed = 0;
+    uint32_t waits = 0;
+
+    void wait(uint64_t value)
+    {
+        if (completed < value)
+        {
+            completed = value;
+            ++waits;
+        }
+    }
+};
+
+void check_ring(uint32_t frame_count)
+{
+    ash::rhi_frame_ring ring;
+    ash::rhi_frame_init(ring, frame_count);
+    CHECK(ring.frame_count == frame_count);
+    CHECK(ash::rhi_frame_is_idle(ring, 0));
+
+    fake_fence fence;
+    constexpr uint32_t frames = 100;
+    for (uint32_t frame = 0; frame < frames; ++frame)
+    {
+        CHECK(ring.index == frame % frame_count);
+
+        const uint64_t wait_value = ash::rhi_frame_get_wait_value(ring);
+        if (frame < frame_count)
+        {
+            // The first lap uses fresh slots and never waits.
+            CHECK(wait_value == 0);
+        }
+        else
+        {
+            // Only the frame that last used this slot, frame_count frames ago, has to be finished.
+            CHECK(wait_value == frame - frame_count + 1);
+        }
+        fence.wait(wait_value);
+
+        // The frames submitted after the reused slot's frame are still in flight.
+        CHECK(ring.last_signalled - fence.completed == (frame < frame_count ? frame : frame_count - 1));
+
+        const uint64_t signalled = ash::rhi_frame_advance(ring);
+        CHECK(signalled == frame + 1);
+        CHECK(!ash::rhi_frame_is_idle(ring, fence.completed));
+    }
+    CHECK(fence.waits == frames - frame_count);
+
+    fence.wait(ring.last_signalled);
+    CHECK(ash::rhi_frame_is_idle(ring, fence.completed));
+}
+} // namespace
+
+TEST_CASE(frame_ring, double_buffered_waits_only_for_reused_slot)
+{
+    check_ring(2);
+}
+
+TEST_CASE(frame_ring, triple_buffered_waits_only_for_reused_slot)
+{
+    check_ring(3);
+}
+
+TEST_CASE(frame_ring, frame_count_is_clamped)
+{
+    ash::rhi_frame_ring ring;
+    ash::rhi_frame_init(ring, 0);
+    CHECK(ring.frame_count == 1);
+    ash::rhi_frame_init(ring, 8);
+    CHECK(ring.frame_count == ash::rhi_frame_max_in_flight);
+}
+
+TEST_CASE(frame_ring, init_forgets_frames_in_flight)
+{
+    ash::rhi_frame_ring ring;
+    ash::rhi_frame_init(ring, 3);
+    ash::rhi_frame_advance(ring);
+    ash::rhi_frame_advance(ring);
+    ash::rhi_frame_init(ring, 2);
+    CHECK(ring.index == 0);
+    CHECK(ring.last_signalled == 0);
+    CHECK(ash::rhi_frame_get_wait_value(ring) == 0);
+}
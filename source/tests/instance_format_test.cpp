@@ -0,0 +1,157 @@
+#include "scene/instance_format.h"
+#include "tests/test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+// Half a 10-bit step over [-1/sqrt(2), 1/sqrt(2)], the rounding error of each stored quaternion component.
+constexpr float g_rotation_step_error = 0.70710678f / 1023.0f; // about 7e-4
+
+XMVECTOR random_rotation(ash::test_random &random)
+{
+    XMVECTOR q;
+    do
+    {
+        q = XMVectorSet(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f),
+                        random.uniform(-1.0f, 1.0f));
+    } while (XMVectorGetX(XMVector4Dot(q, q)) < 0.01f);
+    return XMQuaternionNormalize(q);
+}
+
+XMMATRIX random_world(ash::test_random &random)
+{
+    return XMMatrixScaling(random.uniform(0.1f, 10.0f), random.uniform(0.1f, 10.0f), random.uniform(0.1f, 10.0f)) *
+           XMMatrixRotationQuaternion(random_rotation(random)) *
+           XMMatrixTranslation(random.uniform(-500.0f, 500.0f), random.uniform(-500.0f, 500.0f),
+                               random.uniform(-500.0f, 500.0f));
+}
+
+// Largest per-component difference between two quaternions, taking q and -q as the same rotation.
+float get_rotation_error(FXMVECTOR a, FXMVECTOR b)
+{
+    XMFLOAT4 x, y;
+    XMStoreFloat4(&x, a);
+    XMStoreFloat4(&y, b);
+    const float same = std::max({std::abs(x.x - y.x), std::abs(x.y - y.y), std::abs(x.z - y.z), std::abs(x.w - y.w)});
+    const float flipped =
+        std::max({std::abs(x.x + y.x), std::abs(x.y + y.y), std::abs(x.z + y.z), std::abs(x.w + y.w)});
+    return std::min(same, flipped);
+}
+} // namespace
+
+TEST_CASE(instance_format, strides)
+{
+    CHECK(ash::scene_inst_get_stride(ash::scene_inst_format::matrix) == 64);
+    CHECK(ash::scene_inst_get_stride(ash::scene_inst_format::affine) == 48);
+    CHECK(ash::scene_inst_get_stride(ash::scene_inst_format::quantized_trs) == 24);
+}
+
+TEST_CASE(instance_format, affine_is_exact)
+{
+    ash::test_random random;
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, random_world(random));
+
+        ash::scene_inst_affine affine;
+        ash::scene_inst_encode(ash::scene_inst_format::affine, world, &affine);
+        XMFLOAT4X4 decoded;
+        XMStoreFloat4x4(&decoded, XMLoadFloat3x4(&affine.matrix));
+        mismatches += std::memcmp(&decoded, &world, sizeof(world)) != 0;
+    }
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE(instance_format, smallest_three_rotation_error_is_bounded)
+{
+    ash::test_random random;
+    float max_stored_error = 0.0f;
+    float max_error = 0.0f;
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        const XMVECTOR rotation = random_rotation(random);
+        const uint32_t packed = ash::scene_inst_encode_rotation(rotation);
+
+        // Each stored component is within half a 10-bit step of the original, with the sign chosen so that the
+        // dropped component is positive.
+        XMFLOAT4 q;
+        XMStoreFloat4(&q, rotation);
+        const float components[4] = {q.x, q.y, q.z, q.w};
+        const uint32_t largest = packed >> 30;
+        const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+        uint32_t shift = 20;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            if (c != largest)
+            {
+                const float stored = (float((packed >> shift) & 0x3ff) / 1023.0f * 2.0f - 1.0f) * 0.70710678f;
+                max_stored_error = std::max(max_stored_error, std::abs(stored - components[c] * sign));
+                shift -= 10;
+            }
+        }
+
+        // Rebuilding the dropped component and renormalizing spreads that error by a few steps at most.
+        const XMVECTOR decoded = ash::scene_inst_decode_rotation(packed);
+        max_error = std::max(max_error, get_rotation_error(rotation, decoded));
+    }
+    CHECK(max_stored_error <= g_rotation_step_error + 1e-6f);
+    CHECK(max_error <= 3.0f * g_rotation_step_error);
+
+    // Axis-aligned rotations keep zero components zero and the dropped component exact.
+    for (const XMVECTOR rotation : {XMQuaternionIdentity(), XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f),
+                                    XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 0.0f, 0.0f, -1.0f)})
+    {
+        const XMVECTOR decoded = ash::scene_inst_decode_rotation(ash::scene_inst_encode_rotation(rotation));
+        CHECK(get_rotation_error(rotation, decoded) <= g_rotation_step_error);
+    }
+}
+
+TEST_CASE(instance_format, quantized_trs_round_trip)
+{
+    ash::test_random random;
+    float max_position_error = 0.0f;
+    float max_scale_error = 0.0f;
+    float max_point_error = 0.0f;
+    for (uint32_t i = 0; i < 10000; ++i)
+    {
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, random_world(random));
+
+        ash::scene_inst_trs trs;
+        ash::scene_inst_encode(ash::scene_inst_format::quantized_trs, world, &trs);
+        const XMMATRIX decoded = ash::scene_inst_decode_trs(trs);
+
+        XMVECTOR scale, rotation, translation;
+        XMVECTOR decoded_scale, decoded_rotation, decoded_translation;
+        XMMatrixDecompose(&scale, &rotation, &translation, XMLoadFloat4x4(&world));
+        XMMatrixDecompose(&decoded_scale, &decoded_rotation, &decoded_translation, decoded);
+
+        const XMVECTOR position_error = XMVector3Length(XMVectorSubtract(translation, decoded_translation));
+        max_position_error = std::max(max_position_error, XMVectorGetX(position_error));
+        const XMVECTOR scale_error = XMVectorDivide(XMVectorAbs(XMVectorSubtract(scale, decoded_scale)), scale);
+        max_scale_error = std::max({max_scale_error, XMVectorGetX(scale_error), XMVectorGetY(scale_error),
+                                    XMVectorGetZ(scale_error)});
+
+        // A point on the unit sphere moves by at most the rotation and scale error times the largest scale.
+        const XMVECTOR point = XMVector3Normalize(
+            XMVectorSet(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), 0.0f));
+        const XMVECTOR expected = XMVector3TransformCoord(point, XMLoadFloat4x4(&world));
+        const XMVECTOR actual = XMVector3TransformCoord(point, decoded);
+        const float largest_scale = std::max({XMVectorGetX(scale), XMVectorGetY(scale), XMVectorGetZ(scale)});
+        max_point_error = std::max(max_point_error,
+                                   XMVectorGetX(XMVector3Length(XMVectorSubtract(expected, actual))) / largest_scale);
+    }
+
+    // Translation stays float; the decomposition itself adds only float rounding.
+    CHECK(max_position_error < 1e-3f);
+    // Half floats have 11 significant bits.
+    CHECK(max_scale_error <= 1.0f / 2048.0f);
+    // A quaternion off by e per component moves a unit vector by a small multiple of e.
+    CHECK(max_point_error < 8.0f * g_rotation_step_error);
+}
@@ -0,0 +1,200 @@
+#include "job/scheduler.h"
+#include "scene/lod.h"
+#include "scene/mesh.h"
+#include "scene/mesh_simplify.h"
+#include "scene/scene.h"
+#include "tests/test.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_lod_count = 5;
+constexpr float g_viewport_height = 1080.0f;
+
+// One mesh with a unit-cube bound whose LOD l has error 0.002 * 4^l and a quarter of the previous LOD's triangles.
+void make_lod_mesh()
+{
+    ash::scene_mesh_arena &arena = ash::scene_mesh_g_arena;
+    ash::scene_mesh_clear(arena);
+
+    ash::scene_mesh_primitive primitive;
+    primitive.index_count = 3 * 65536;
+    primitive.first_lod = 0;
+    primitive.lod_count = g_lod_count;
+    for (uint32_t l = 0; l < g_lod_count; ++l)
+    {
+        arena.lods.push_back({0, primitive.index_count >> (2 * l), 0.002f * float(1u << (2 * l))});
+    }
+    arena.primitives.push_back(primitive);
+
+    ash::scene_mesh mesh;
+    mesh.first_primitive = 0;
+    mesh.primitive_count = 1;
+    mesh.extents = {1.0f, 1.0f, 1.0f};
+    arena.meshes.push_back(mesh);
+}
+
+ash::camera make_camera(const XMFLOAT3 &position)
+{
+    ash::camera cam = {};
+    cam.position = position;
+    XMStoreFloat4x4(&cam.mat_proj, XMMatrixPerspectiveFovLH(XM_PI / 3, 16.0f / 9.0f, 0.1f, 1000.0f));
+    return cam;
+}
+
+// Instances of the LOD mesh at `scale` times its size, on the x axis.
+std::vector<flecs::entity_t> make_instances(const std::vector<float> &distances, float scale)
+{
+    std::vector<flecs::entity_t> instances;
+    for (const float x : distances)
+    {
+        ash::bounds instance_bounds;
+        instance_bounds.world_sphere = {x, 0.0f, 0.0f, std::sqrt(3.0f) * scale};
+        flecs::entity entity = ash::scene_g_world.entity();
+        entity.set<ash::mesh>({0}).set<ash::bounds>(instance_bounds);
+        instances.push_back(entity.id());
+    }
+    return instances;
+}
+
+uint32_t get_lod(flecs::entity_t entity)
+{
+    return flecs::entity(ash::scene_g_world, entity).get<ash::mesh_lod>().lod;
+}
+
+// The selection rule written out per instance: the coarsest LOD whose projected error is within the threshold,
+// loosened for the current LOD and tightened for coarser ones.
+uint32_t get_expected_lod(float sphere_x, float sphere_radius, float scale, uint32_t current, const ash::camera &cam)
+{
+    const float distance = std::max(std::abs(sphere_x - cam.position.x) - sphere_radius, 0.1f);
+    const float pixels_per_unit = scale * (0.5f * g_viewport_height * cam.mat_proj._22) / distance;
+    uint32_t expected = 0;
+    for (uint32_t l = 0; l < g_lod_count; ++l)
+    {
+        const float factor = l < current ? 1.0f : l == current ? 1.0f + ash::scene_lod_hysteresis
+                                                                 : 1.0f - ash::scene_lod_hysteresis;
+        if (ash::scene_mesh_g_arena.lods[l].error * pixels_per_unit <= ash::scene_lod_g_pixel_error * factor)
+        {
+            expected = l;
+        }
+    }
+    return expected;
+}
+
+void destroy(const std::vector<flecs::entity_t> &entities)
+{
+    for (const flecs::entity_t entity : entities)
+    {
+        flecs::entity(ash::scene_g_world, entity).destruct();
+    }
+}
+} // namespace
+
+TEST_CASE(lod, selection_follows_projected_error)
+{
+    ash::scene_lod_init();
+    make_lod_mesh();
+
+    // An odd count so both the four-wide path and the scalar tail run.
+    ash::test_random random;
+    std::vector<float> distances(1003);
+    for (float &distance : distances)
+    {
+        distance = random.uniform(2.0f, 600.0f);
+    }
+    const std::vector<flecs::entity_t> instances = make_instances(distances, 2.0f);
+
+    ash::camera cam = make_camera({0.0f, 0.0f, 0.0f});
+    for (const float eye_x : {0.0f, 40.0f, 45.0f, 300.0f, 35.0f})
+    {
+        cam.position.x = eye_x;
+        std::vector<uint32_t> expected(instances.size());
+        for (std::size_t i = 0; i < instances.size(); ++i)
+        {
+            expected[i] = get_expected_lod(distances[i], std::sqrt(3.0f) * 2.0f, 2.0f, get_lod(instances[i]), cam);
+        }
+
+        ash::scene_lod_select(instances, cam, g_viewport_height);
+        uint64_t triangles_after = 0;
+        uint32_t mismatches = 0;
+        for (std::size_t i = 0; i < instances.size(); ++i)
+        {
+            mismatches += get_lod(instances[i]) != expected[i];
+            triangles_after += ash::scene_mesh_g_arena.lods[get_lod(instances[i])].index_count / 3;
+        }
+        CHECK(mismatches == 0);
+        CHECK(ash::scene_lod_g_stats.instances == instances.size());
+        CHECK(ash::scene_lod_g_stats.triangles_before == instances.size() * 65536ull);
+        CHECK(ash::scene_lod_g_stats.triangles_after == triangles_after);
+    }
+
+    destroy(instances);
+    ash::scene_mesh_clear(ash::scene_mesh_g_arena);
+}
+
+TEST_CASE(lod, hysteresis_prevents_popping)
+{
+    ash::scene_lod_init();
+    make_lod_mesh();
+    const std::vector<flecs::entity_t> instance = make_instances({0.0f}, 1.0f);
+    const float radius = std::sqrt(3.0f);
+
+    // Distance from the sphere's surface at which LOD 1 projects to exactly the pixel threshold.
+    const ash::camera probe = make_camera({0.0f, 0.0f, 0.0f});
+    const float boundary = ash::scene_mesh_g_arena.lods[1].error * 0.5f * g_viewport_height * probe.mat_proj._22 /
+                           ash::scene_lod_g_pixel_error;
+
+    // Walking away, LOD 1 is only taken once it is well below the threshold...
+    const auto select_at = [&](float distance) {
+        ash::scene_lod_select(instance, make_camera({-(distance + radius), 0.0f, 0.0f}), g_viewport_height);
+        return get_lod(instance[0]);
+    };
+    CHECK(select_at(boundary * 0.5f) == 0);
+    CHECK(select_at(boundary * 1.1f) == 0);
+    CHECK(select_at(boundary * 1.4f) == 1);
+
+    // ...and kept when walking back past the boundary, until it is well above the threshold.
+    CHECK(select_at(boundary * 0.9f) == 1);
+    CHECK(select_at(boundary * 0.85f) == 1);
+    CHECK(select_at(boundary * 0.75f) == 0);
+
+    // Selecting again from the same place never changes the result.
+    for (const float distance : {0.79f, 0.81f, 1.3f, 1.34f})
+    {
+        const uint32_t first = select_at(boundary * distance);
+        CHECK(select_at(boundary * distance) == first);
+    }
+
+    destroy(instance);
+    ash::scene_mesh_clear(ash::scene_mesh_g_arena);
+}
+
+BENCHMARK_CASE(lod, select)
+{
+    ash::job_init(0);
+    ash::scene_lod_init();
+    make_lod_mesh();
+    ash::test_random random;
+    for (const uint32_t count : {10000u, 100000u, 1000000u})
+    {
+        std::vector<float> distances(count);
+        for (float &distance : distances)
+        {
+            distance = random.uniform(2.0f, 1000.0f);
+        }
+        const std::vector<flecs::entity_t> instances = make_instances(distances, 1.0f);
+        const ash::camera cam = make_camera({0.0f, 0.0f, 0.0f});
+
+        const double ns = ash::test_measure_ns(10, [&] { ash::scene_lod_select(instances, cam, g_viewport_height); });
+        std::printf("  %7u instances: %7.3f ms (%5.1f ns per instance), triangles %llu -> %llu\n", count, ns * 1e-6,
+                    ns / count, static_cast<unsigned long long>(ash::scene_lod_g_stats.triangles_before),
+                    static_cast<unsigned long long>(ash::scene_lod_g_stats.triangles_after));
+        destroy(instances);
+    }
+    ash::scene_mesh_clear(ash::scene_mesh_g_arena);
+    ash::job_shutdown();
+}
@@ -0,0 +1,250 @@
+#include "scene/mesh_codec.h"
+#include "tests/test.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+enum class vertex_pattern : uint8_t
+{
+    smooth,   // small deltas between neighbours, as quantized and optimized vertices have
+    random,   // full-range noise, every plane at 8 bits
+    constant, // every plane at 0 bits
+    count
+};
+
+std::vector<uint8_t> make_vertices(ash::test_random &random, std::size_t count, std::size_t stride,
+                                   vertex_pattern pattern)
+{
+    const std::size_t words = stride / 2;
+    std::vector<uint16_t> record(words);
+    for (uint16_t &word : record)
+    {
+        word = static_cast<uint16_t>(random.next());
+    }
+
+    std::vector<uint8_t> vertices(count * stride);
+    for (std::size_t v = 0; v < count; ++v)
+    {
+        for (std::size_t w = 0; w < words; ++w)
+        {
+            switch (pattern)
+            {
+            case vertex_pattern::smooth:
+                record[w] = static_cast<uint16_t>(record[w] + random.next() % 9 - 4);
+                break;
+            case vertex_pattern::random:
+                record[w] = static_cast<uint16_t>(random.next());
+                break;
+            default:
+                break;
+            }
+        }
+        std::memcpy(vertices.data() + v * stride, record.data(), stride);
+    }
+    return vertices;
+}
+
+// Row-major grid of quads, two triangles each.
+std::vector<uint32_t> make_grid_indices(uint32_t width, uint32_t height)
+{
+    std::vector<uint32_t> indices;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint32_t v = y * (width + 1) + x;
+            indices.insert(indices.end(), {v, v + width + 1, v + 1, v + 1, v + width + 1, v + width + 2});
+        }
+    }
+    return indices;
+}
+
+std::vector<uint32_t> make_random_indices(ash::test_random &random, std::size_t triangle_count, uint32_t vertex_count)
+{
+    std::vector<uint32_t> indices(triangle_count * 3);
+    for (uint32_t &index : indices)
+    {
+        index = random.next() % vertex_count;
+    }
+    return indices;
+}
+
+// The codec may rotate a triangle but keeps its winding.
+bool is_same_triangle(const uint32_t *a, const uint32_t *b)
+{
+    for (uint32_t r = 0; r < 3; ++r)
+    {
+        if (a[0] == b[r] && a[1] == b[(r + 1) % 3] && a[2] == b[(r + 2) % 3])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool round_trip_indices(const std::vector<uint32_t> &indices)
+{
+    std::vector<uint8_t> encoded;
+    ash::scene_codec_encode_indices(indices.data(), indices.size(), encoded);
+    std::vector<uint32_t> decoded(indices.size());
+    if (!ash::scene_codec_decode_indices(decoded.data(), decoded.size(), encoded.data(), encoded.size()))
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < indices.size(); i += 3)
+    {
+        if (!is_same_triangle(&indices[i], &decoded[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+TEST_CASE(mesh_codec, vertices_round_trip)
+{
+    ash::test_random random;
+    uint32_t mismatches = 0;
+    for (uint32_t round = 0; round < 300; ++round)
+    {
+        // Counts that are and are not multiples of the block size, and every even stride up to the maximum.
+        const std::size_t count = round % 3 == 0 ? (random.next() % 8) * ash::scene_codec_block_size
+                                                 : random.next() % 700;
+        const std::size_t stride = (random.next() % (ash::scene_codec_max_stride / 2) + 1) * 2;
+        const vertex_pattern pattern = static_cast<vertex_pattern>(round % uint32_t(vertex_pattern::count));
+        const std::vector<uint8_t> vertices = make_vertices(random, count, stride, pattern);
+
+        std::vector<uint8_t> encoded;
+        ash::scene_codec_encode_vertices(vertices.data(), count, stride, encoded);
+        std::vector<uint8_t> decoded(vertices.size() + 1, 0xcd);
+        const bool ok = ash::scene_codec_decode_vertices(decoded.data(), count, stride, encoded.data(), encoded.size());
+        mismatches += !ok || !std::equal(vertices.begin(), vertices.end(), decoded.begin()) || decoded.back() != 0xcd;
+    }
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE(mesh_codec, smooth_vertices_compress)
+{
+    ash::test_random random;
+    const std::vector<uint8_t> vertices = make_vertices(random, 4096, 16, vertex_pattern::smooth);
+    std::vector<uint8_t> encoded;
+    ash::scene_codec_encode_vertices(vertices.data(), 4096, 16, encoded);
+    CHECK(encoded.size() < vertices.size() / 2);
+}
+
+TEST_CASE(mesh_codec, indices_round_trip)
+{
+    ash::test_random random;
+    CHECK(round_trip_indices({}));
+    CHECK(round_trip_indices(make_grid_indices(1, 1)));
+    CHECK(round_trip_indices(make_grid_indices(64, 48)));
+
+    uint32_t failures = 0;
+    for (uint32_t round = 0; round < 200; ++round)
+    {
+        const uint32_t vertex_count = random.next() % 5000 + 1;
+        failures += !round_trip_indices(make_random_indices(random, random.next() % 600, vertex_count));
+    }
+    CHECK(failures == 0);
+}
+
+TEST_CASE(mesh_codec, grid_indices_compress)
+{
+    const std::vector<uint32_t> indices = make_grid_indices(64, 64);
+    std::vector<uint8_t> encoded;
+    ash::scene_codec_encode_indices(indices.data(), indices.size(), encoded);
+    // Raw triangles take 12 bytes.
+    CHECK(encoded.size() < indices.size() / 3 * 2);
+}
+
+TEST_CASE(mesh_codec, truncated_input_is_rejected)
+{
+    ash::test_random random;
+    const std::vector<uint8_t> vertices = make_vertices(random, 100, 12, vertex_pattern::smooth);
+    std::vector<uint8_t> encoded_vertices;
+    ash::scene_codec_encode_vertices(vertices.data(), 100, 12, encoded_vertices);
+
+    const std::vector<uint32_t> indices = make_grid_indices(8, 8);
+    std::vector<uint8_t> encoded_indices;
+    ash::scene_codec_encode_indices(indices.data(), indices.size(), encoded_indices);
+
+    uint32_t accepted = 0;
+    std::vector<uint8_t> decoded_vertices(vertices.size());
+    for (std::size_t size = 0; size < encoded_vertices.size(); ++size)
+    {
+        // A copy of exactly `size` bytes, so reading past the end is caught by the address sanitizer.
+        const std::vector<uint8_t> truncated(encoded_vertices.begin(), encoded_vertices.begin() + size);
+        accepted += ash::scene_codec_decode_vertices(decoded_vertices.data(), 100, 12, truncated.data(), size);
+    }
+    std::vector<uint32_t> decoded_indices(indices.size());
+    for (std::size_t size = 0; size < encoded_indices.size(); ++size)
+    {
+        const std::vector<uint8_t> truncated(encoded_indices.begin(), encoded_indices.begin() + size);
+        accepted += ash::scene_codec_decode_indices(decoded_indices.data(), indices.size(), truncated.data(), size);
+    }
+    CHECK(accepted == 0);
+}
+
+TEST_CASE(mesh_codec, corrupt_input_stays_in_bounds)
+{
+    // Flipped bytes may still decode to something, but must never read or write out of bounds; run under the address
+    // sanitizer to check.
+    ash::test_random random;
+    const std::vector<uint8_t> vertices = make_vertices(random, 200, 20, vertex_pattern::smooth);
+    std::vector<uint8_t> encoded_vertices;
+    ash::scene_codec_encode_vertices(vertices.data(), 200, 20, encoded_vertices);
+
+    const std::vector<uint32_t> indices = make_random_indices(random, 300, 400);
+    std::vector<uint8_t> encoded_indices;
+    ash::scene_codec_encode_indices(indices.data(), indices.size(), encoded_indices);
+
+    std::vector<uint8_t> decoded_vertices(vertices.size());
+    std::vector<uint32_t> decoded_indices(indices.size());
+    for (uint32_t round = 0; round < 2000; ++round)
+    {
+        std::vector<uint8_t> corrupt = round % 2 ? encoded_vertices : encoded_indices;
+        for (uint32_t flips = random.next() % 4 + 1; flips > 0; --flips)
+        {
+            corrupt[random.next() % corrupt.size()] ^= static_cast<uint8_t>(random.next() % 255 + 1);
+        }
+        if (round % 2)
+        {
+            ash::scene_codec_decode_vertices(decoded_vertices.data(), 200, 20, corrupt.data(), corrupt.size());
+        }
+        else
+        {
+            ash::scene_codec_decode_indices(decoded_indices.data(), indices.size(), corrupt.data(), corrupt.size());
+        }
+    }
+}
+
+BENCHMARK_CASE(mesh_codec, decode_throughput)
+{
+    ash::test_random random;
+    for (const std::size_t stride : {8, 16, 32})
+    {
+        constexpr std::size_t count = 1 << 18;
+        const std::vector<uint8_t> vertices = make_vertices(random, count, stride, vertex_pattern::smooth);
+        std::vector<uint8_t> encoded;
+        ash::scene_codec_encode_vertices(vertices.data(), count, stride, encoded);
+        std::vector<uint8_t> decoded(vertices.size());
+        const double ns = ash::test_measure_ns(20, [&] {
+            ash::scene_codec_decode_vertices(decoded.data(), count, stride, encoded.data(), encoded.size());
+        });
+        std::printf("  vertices, stride %2zu: %7.1f MB/s decoded, %.2f:1\n", stride, vertices.size() * 1e3 / ns,
+                    double(vertices.size()) / encoded.size());
+    }
+
+    const std::vector<uint32_t> indices = make_grid_indices(512, 512);
+    std::vector<uint8_t> encoded;
+    ash::scene_codec_encode_indices(indices.data(), indices.size(), encoded);
+    std::vector<uint32_t> decoded(indices.size());
+    const double ns = ash::test_measure_ns(20, [&] {
+        ash::scene_codec_decode_indices(decoded.data(), decoded.size(), encoded.data(), encoded.size());
+    });
+    std::printf("  indices: %7.1f M triangles/s decoded, %.2f bytes per triangle\n", indices.size() / 3 * 1e3 / ns,
+                double(encoded.size()) / (indices.size() / 3));
+}
@@ -0,0 +1,173 @@
+#include "job/scheduler.h"
+#include "scene/mesh_optimize.h"
+#include "tests/test.h"
+#include "tests/test_mesh.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+using test_triangle = std::array<XMFLOAT3, 3>;
+
+struct sample_mesh
+{
+    const char *name;
+    ash::scene_mesh_arena arena;
+};
+
+// Fisher-Yates over whole triangles, the order some exporters leave meshes in.
+void shuffle_triangles(ash::scene_mesh_arena &arena, ash::test_random &random)
+{
+    const std::size_t triangle_count = arena.indices.size() / 3;
+    for (std::size_t t = triangle_count - 1; t > 0; --t)
+    {
+        const std::size_t other = random.next() % (t + 1);
+        std::swap_ranges(arena.indices.begin() + 3 * t, arena.indices.begin() + 3 * t + 3,
+                         arena.indices.begin() + 3 * other);
+    }
+}
+
+// Gives every triangle corner its own copy of the vertex, as unindexed exports do.
+void split_vertices(ash::scene_mesh_arena &arena)
+{
+    ash::scene_mesh_arena split = arena;
+    split.positions.clear();
+    split.normals.clear();
+    split.tangents.clear();
+    split.uvs.clear();
+    for (uint32_t &index : split.indices)
+    {
+        split.positions.push_back(arena.positions[index]);
+        split.normals.push_back(arena.normals[index]);
+        split.tangents.push_back(arena.tangents[index]);
+        split.uvs.push_back(arena.uvs[index]);
+        index = static_cast<uint32_t>(split.positions.size() - 1);
+    }
+    split.primitives[0].vertex_count = static_cast<uint32_t>(split.positions.size());
+    arena = std::move(split);
+}
+
+std::vector<sample_mesh> make_sample_meshes()
+{
+    ash::test_random random;
+    std::vector<sample_mesh> meshes;
+
+    meshes.push_back({"grid 128x128"});
+    ash::test_add_grid(meshes.back().arena, 128, 128);
+
+    meshes.push_back({"shuffled grid 128x128"});
+    ash::test_add_grid(meshes.back().arena, 128, 128);
+    shuffle_triangles(meshes.back().arena, random);
+
+    meshes.push_back({"unwelded shuffled grid 64x64"});
+    ash::test_add_grid(meshes.back().arena, 64, 64);
+    shuffle_triangles(meshes.back().arena, random);
+    split_vertices(meshes.back().arena);
+
+    meshes.push_back({"bumpy strip 16x1024"});
+    ash::test_add_grid(meshes.back().arena, 16, 1024,
+                       [](float x, float z) { return std::sin(x * 0.7f) * std::cos(z * 0.3f); });
+    return meshes;
+}
+
+// The triangles of primitive 0 by position, each rotated to start at its smallest corner so that winding is kept but
+// the starting vertex does not matter, then sorted.
+std::vector<test_triangle> get_triangles(const ash::scene_mesh_arena &arena)
+{
+    const auto less = [](const XMFLOAT3 &a, const XMFLOAT3 &b) {
+        return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+    };
+
+    const ash::scene_mesh_primitive &primitive = arena.primitives[0];
+    std::vector<test_triangle> triangles;
+    for (uint32_t i = 0; i + 2 < primitive.index_count; i += 3)
+    {
+        test_triangle triangle;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            triangle[k] = arena.positions[primitive.first_vertex + arena.indices[primitive.first_index + i + k]];
+        }
+        const auto first = std::min_element(triangle.begin(), triangle.end(), less);
+        std::rotate(triangle.begin(), first, triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end(), [&](const test_triangle &a, const test_triangle &b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+    });
+    return triangles;
+}
+
+bool are_equal(const std::vector<test_triangle> &a, const std::vector<test_triangle> &b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const test_triangle &x, const test_triangle &y) {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            if (x[k].x != y[k].x || x[k].y != y[k].y || x[k].z != y[k].z)
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+} // namespace
+
+TEST_CASE(mesh_optimize, sample_meshes_keep_triangles_and_improve_cache)
+{
+    for (sample_mesh &sample : make_sample_meshes())
+    {
+        const std::vector<test_triangle> before = get_triangles(sample.arena);
+        const ash::scene_mopt_stats stats = ash::scene_mopt_optimize(sample.arena);
+        std::printf("  %-30s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", sample.name, stats.before.acmr(),
+                    stats.after.acmr(), stats.before.atvr(), stats.after.atvr());
+
+        CHECK(are_equal(get_triangles(sample.arena), before));
+        CHECK(stats.after.triangles == stats.before.triangles);
+        CHECK(stats.after.acmr() <= stats.before.acmr());
+
+        // A regular grid cannot do better than about one new vertex per two triangles; a cache-optimized order stays
+        // within 1.5x of its vertex count.
+        CHECK(stats.after.acmr() < 0.8);
+        CHECK(stats.after.atvr() < 1.5);
+
+        // Vertices are renumbered in first-use order.
+        const ash::scene_mesh_primitive &primitive = sample.arena.primitives[0];
+        uint32_t next_vertex = 0;
+        bool first_use_order = true;
+        for (uint32_t i = 0; i < primitive.index_count; ++i)
+        {
+            const uint32_t index = sample.arena.indices[primitive.first_index + i];
+            first_use_order &= index <= next_vertex;
+            next_vertex = std::max(next_vertex, index + 1);
+        }
+        CHECK(first_use_order);
+        CHECK(next_vertex == primitive.vertex_count);
+    }
+
+    // Welding merges the split copies back into one vertex per grid point.
+    const std::vector<sample_mesh> meshes = make_sample_meshes();
+    ash::scene_mesh_arena unwelded = meshes[2].arena;
+    ash::scene_mopt_optimize(unwelded);
+    CHECK(unwelded.primitives[0].vertex_count == 65 * 65);
+}
+
+BENCHMARK_CASE(mesh_optimize, sample_meshes)
+{
+    ash::job_init(0);
+    for (const sample_mesh &sample : make_sample_meshes())
+    {
+        ash::scene_mopt_stats stats;
+        const double ns = ash::test_measure_ns(5, [&] {
+            ash::scene_mesh_arena arena = sample.arena;
+            stats = ash::scene_mopt_optimize(arena);
+        });
+        std::printf("  %-30s %7llu triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %7.2f ms\n", sample.name,
+                    static_cast<unsigned long long>(stats.before.triangles), stats.before.acmr(), stats.after.acmr(),
+                    stats.before.atvr(), stats.after.atvr(), ns * 1e-6);
+    }
+    ash::job_shutdown();
+}
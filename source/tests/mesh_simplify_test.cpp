@@ -0,0 +1,132 @@
+#include "job/scheduler.h"
+#include "scene/mesh_simplify.h"
+#include "tests/test.h"
+#include "tests/test_mesh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+float get_terrain_height(float x, float z)
+{
+    return 2.0f * std::sin(x * 0.15f) * std::cos(z * 0.1f) + 0.5f * std::sin((x + z) * 0.4f);
+}
+
+// Largest vertical distance between the source heightfield, sampled at every source vertex, and the surface of the
+// LOD. The LOD is still a heightfield because border vertices are locked and collapses never flip a triangle, so each
+// sample falls into exactly one LOD triangle's xz projection.
+float get_max_deviation(const ash::scene_mesh_arena &arena, const ash::scene_mesh_lod &lod)
+{
+    const DirectX::XMFLOAT3 *positions = arena.positions.data();
+    float max_deviation = 0.0f;
+    for (const DirectX::XMFLOAT3 &sample : arena.positions)
+    {
+        float height = FLT_MAX;
+        for (uint32_t i = lod.first_index; i < lod.first_index + lod.index_count && height == FLT_MAX; i += 3)
+        {
+            const DirectX::XMFLOAT3 &a = positions[arena.indices[i]];
+            const DirectX::XMFLOAT3 &b = positions[arena.indices[i + 1]];
+            const DirectX::XMFLOAT3 &c = positions[arena.indices[i + 2]];
+            const float area = (b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z);
+            const float u = ((b.x - sample.x) * (c.z - sample.z) - (c.x - sample.x) * (b.z - sample.z)) / area;
+            const float v = ((c.x - sample.x) * (a.z - sample.z) - (a.x - sample.x) * (c.z - sample.z)) / area;
+            const float w = 1.0f - u - v;
+            if (u >= -1e-5f && v >= -1e-5f && w >= -1e-5f)
+            {
+                height = u * a.y + v * b.y + w * c.y;
+            }
+        }
+        max_deviation = std::max(max_deviation, height == FLT_MAX ? FLT_MAX : std::abs(height - sample.y));
+    }
+    return max_deviation;
+}
+} // namespace
+
+TEST_CASE(mesh_simplify, heightfield_error_grows_with_each_lod)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 48, 48, get_terrain_height);
+    const ash::scene_simp_stats stats = ash::scene_simp_build_lods(arena);
+
+    const ash::scene_mesh_primitive &primitive = arena.primitives[0];
+    CHECK(stats.lod_count == primitive.lod_count - 1);
+    CHECK(primitive.lod_count >= 4);
+
+    const ash::scene_mesh_lod &base = arena.lods[primitive.first_lod];
+    CHECK(base.first_index == primitive.first_index);
+    CHECK(base.index_count == primitive.index_count);
+    CHECK(base.error == 0.0f);
+
+    uint32_t out_of_range = 0;
+    float previous_deviation = 0.0f;
+    for (uint32_t l = primitive.first_lod + 1; l < primitive.first_lod + primitive.lod_count; ++l)
+    {
+        const ash::scene_mesh_lod &previous = arena.lods[l - 1];
+        const ash::scene_mesh_lod &lod = arena.lods[l];
+
+        // Every level removes at least scene_simp_min_reduction of the previous one's triangles.
+        CHECK(lod.index_count % 3 == 0);
+        CHECK(float(lod.index_count) <= float(previous.index_count) * (1.0f - ash::scene_simp_min_reduction));
+
+        // The reported error never decreases, neither does the measured deviation from the source surface (up to a
+        // little noise), and the reported error is a usable estimate of that deviation for LOD selection.
+        CHECK(lod.error >= previous.error);
+        const float deviation = get_max_deviation(arena, lod);
+        CHECK(deviation >= previous_deviation * 0.9f);
+        CHECK(deviation <= 2.0f * lod.error + 0.05f);
+        previous_deviation = std::max(previous_deviation, deviation);
+
+        for (uint32_t i = lod.first_index; i < lod.first_index + lod.index_count; ++i)
+        {
+            out_of_range += arena.indices[i] >= primitive.vertex_count;
+        }
+    }
+    CHECK(out_of_range == 0);
+    CHECK(arena.lods[primitive.first_lod + primitive.lod_count - 1].error > 0.0f);
+}
+
+TEST_CASE(mesh_simplify, flat_grid_simplifies_without_error)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 32, 32);
+    ash::scene_simp_build_lods(arena);
+
+    const ash::scene_mesh_primitive &primitive = arena.primitives[0];
+    CHECK(primitive.lod_count >= 3);
+    for (uint32_t l = primitive.first_lod; l < primitive.first_lod + primitive.lod_count; ++l)
+    {
+        CHECK(arena.lods[l].error < 1e-4f);
+        CHECK(get_max_deviation(arena, arena.lods[l]) < 1e-4f);
+    }
+}
+
+TEST_CASE(mesh_simplify, small_primitives_keep_only_lod_zero)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 2, 2);
+    ash::scene_simp_build_lods(arena);
+    CHECK(arena.primitives[0].lod_count == 1);
+    CHECK(arena.lods.size() == 1);
+}
+
+BENCHMARK_CASE(mesh_simplify, terrain_grid)
+{
+    ash::job_init(0);
+    for (const uint32_t size : {128u, 256u, 512u})
+    {
+        ash::scene_mesh_arena source;
+        ash::test_add_grid(source, size, size, get_terrain_height);
+
+        ash::scene_simp_stats stats;
+        const double ns = ash::test_measure_ns(3, [&] {
+            ash::scene_mesh_arena arena = source;
+            stats = ash::scene_simp_build_lods(arena);
+        });
+        std::printf("  %3ux%-3u grid: %7llu triangles, %u LODs of %7llu, %8.2f ms, %5.2f M source triangles/s\n", size,
+                    size, static_cast<unsigned long long>(stats.source_triangles), stats.lod_count,
+                    static_cast<unsigned long long>(stats.lod_triangles), ns * 1e-6, stats.source_triangles * 1e3 / ns);
+    }
+    ash::job_shutdown();
+}
@@ -0,0 +1,108 @@
+#include "job/scheduler.h"
+#include "scene/meshlet.h"
+#include "tests/test.h"
+#include "tests/test_mesh.h"
+#include <cmath>
+
+namespace
+{
+ash::scene_mesh_arena make_meshlet_grid(uint32_t width, uint32_t depth)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, width, depth, [](float x, float z) { return std::sin(x * 0.3f) * std::cos(z * 0.2f); });
+    ash::scene_mlet_build(arena);
+    return arena;
+}
+} // namespace
+
+TEST_CASE(meshlet, grid_meshlets_are_valid_and_full)
+{
+    const ash::scene_mesh_arena arena = make_meshlet_grid(64, 64);
+    CHECK(ash::scene_mlet_validate(arena));
+
+    const ash::scene_mesh_primitive &primitive = arena.primitives[0];
+    uint32_t triangles = 0;
+    for (uint32_t m = primitive.first_meshlet; m < primitive.first_meshlet + primitive.meshlet_count; ++m)
+    {
+        triangles += arena.meshlets[m].triangle_count;
+    }
+    CHECK(triangles == 64 * 64 * 2);
+
+    // Meshlets should be vertex-bound: on a grid, a meshlet that uses most of its 64 vertices carries about as many
+    // triangles.
+    CHECK(primitive.meshlet_count * 56 <= triangles);
+}
+
+TEST_CASE(meshlet, primitives_are_built_independently)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 10, 3);
+    ash::test_add_grid(arena, 1, 1);
+    ash::test_add_grid(arena, 30, 30);
+    ash::scene_mlet_build(arena);
+    CHECK(ash::scene_mlet_validate(arena));
+    CHECK(arena.primitives[1].meshlet_count == 1);
+    CHECK(arena.meshlets[arena.primitives[1].first_meshlet].triangle_count == 2);
+}
+
+TEST_CASE(meshlet, corrupted_meshlets_fail_validation)
+{
+    const ash::scene_mesh_arena valid = make_meshlet_grid(16, 16);
+    CHECK(ash::scene_mlet_validate(valid));
+
+    // A triangle pointing at a different meshlet vertex: one source triangle is missing, another appears.
+    ash::scene_mesh_arena arena = valid;
+    const ash::scene_mesh_meshlet &first = arena.meshlets[0];
+    uint8_t &corner = arena.meshlet_triangles[first.first_triangle * 3];
+    corner = static_cast<uint8_t>((corner + 1) % first.vertex_count);
+    CHECK(!ash::scene_mlet_validate(arena));
+
+    // A triangle referencing a vertex past the meshlet's own.
+    arena = valid;
+    arena.meshlet_triangles[arena.meshlets[0].first_triangle * 3 + 1] = ash::scene_mlet_max_vertices;
+    CHECK(!ash::scene_mlet_validate(arena));
+
+    // A meshlet vertex outside the primitive.
+    arena = valid;
+    arena.meshlet_vertices[arena.meshlets[0].first_vertex] = arena.primitives[0].vertex_count;
+    CHECK(!ash::scene_mlet_validate(arena));
+
+    // A triangle dropped from a meshlet.
+    arena = valid;
+    --arena.meshlets[0].triangle_count;
+    CHECK(!ash::scene_mlet_validate(arena));
+
+    // Meshlets past the end of the array.
+    arena = valid;
+    ++arena.primitives[0].meshlet_count;
+    CHECK(!ash::scene_mlet_validate(arena));
+}
+
+TEST_CASE(meshlet, flat_grid_is_backfacing_from_below)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 8, 8);
+    ash::scene_mlet_build(arena);
+    const ash::scene_mesh_meshlet &meshlet = arena.meshlets[0];
+
+    const DirectX::XMVECTOR above = DirectX::XMVectorSet(4.0f, 10.0f, 4.0f, 1.0f);
+    const DirectX::XMVECTOR below = DirectX::XMVectorSet(4.0f, -10.0f, 4.0f, 1.0f);
+    CHECK(ash::scene_mlet_is_backfacing(meshlet, above) != ash::scene_mlet_is_backfacing(meshlet, below));
+}
+
+BENCHMARK_CASE(meshlet, build)
+{
+    ash::job_init(0);
+    for (const uint32_t size : {64u, 256u, 512u})
+    {
+        ash::scene_mesh_arena grid;
+        ash::test_add_grid(grid, size, size);
+        const double ns = ash::test_measure_ns(5, [&] {
+            ash::scene_mesh_arena arena = grid;
+            ash::scene_mlet_build(arena);
+        });
+        const uint32_t triangles = size * size * 2;
+        std::printf("  %7u triangles: %8.2f ms, %6.1f M triangles/s\n", triangles, ns * 1e-6, triangles * 1e3 / ns);
+    }
+    ash::job_shutdown();
+}
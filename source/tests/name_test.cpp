@@ -0,0 +1,77 @@
+#include "scene/scene.h"
+#include "tests/test.h"
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+std::vector<flecs::entity> add_named_children(flecs::entity parent, uint32_t count, const char *name)
+{
+    std::vector<flecs::entity> children(count);
+    for (flecs::entity &child : children)
+    {
+        child = ash::scene_g_world.entity().child_of(parent);
+        ash::scene_set_entity_name_safe(child, name);
+    }
+    return children;
+}
+} // namespace
+
+TEST_CASE(name, same_named_siblings_get_unique_suffixes)
+{
+    ash::scene_name_init();
+    flecs::entity parent = ash::scene_g_world.entity();
+    flecs::entity other_parent = ash::scene_g_world.entity();
+
+    std::vector<flecs::entity> children = add_named_children(parent, 1000, "Node");
+    CHECK(std::string(children[0].name().c_str()) == "Node");
+    CHECK(std::string(children[1].name().c_str()) == "Node (2)");
+    CHECK(std::string(children[999].name().c_str()) == "Node (1000)");
+    std::unordered_set<std::string> names;
+    for (const flecs::entity &child : children)
+    {
+        names.insert(child.name().c_str());
+    }
+    CHECK(names.size() == children.size());
+
+    // Scopes are independent.
+    CHECK(std::string(add_named_children(other_parent, 1, "Node")[0].name().c_str()) == "Node");
+
+    // Deleted and renamed siblings hand their suffixes back, lowest first.
+    children[41].destruct();
+    children[9].destruct();
+    ash::scene_set_entity_name_safe(children[500], "Mesh");
+    CHECK(std::string(children[500].name().c_str()) == "Mesh");
+    const std::vector<flecs::entity> refill = add_named_children(parent, 4, "Node");
+    CHECK(std::string(refill[0].name().c_str()) == "Node (10)");
+    CHECK(std::string(refill[1].name().c_str()) == "Node (42)");
+    CHECK(std::string(refill[2].name().c_str()) == "Node (501)");
+    CHECK(std::string(refill[3].name().c_str()) == "Node (1001)");
+
+    // Renaming an entity to its own name keeps it.
+    ash::scene_set_entity_name_safe(refill[3], "Node (1001)");
+    CHECK(std::string(refill[3].name().c_str()) == "Node (1001)");
+
+    // Names set without the index are never handed out twice.
+    ash::scene_g_world.entity().child_of(parent).set_name("Node (1002)");
+    CHECK(std::string(add_named_children(parent, 1, "Node")[0].name().c_str()) == "Node (1003)");
+
+    parent.destruct();
+    other_parent.destruct();
+    ash::scene_name_shutdown();
+}
+
+BENCHMARK_CASE(name, same_named_siblings)
+{
+    ash::scene_name_init();
+    for (const uint32_t count : {1000u, 10000u, 100000u})
+    {
+        flecs::entity parent = ash::scene_g_world.entity();
+        const double ns = ash::test_measure_ns(1, [&] { add_named_children(parent, count, "Node"); });
+        std::printf("  %6u siblings: %8.2f ms, %6.0f ns per name\n", count, ns * 1e-6, ns / count);
+        parent.destruct();
+    }
+    ash::scene_name_shutdown();
+}
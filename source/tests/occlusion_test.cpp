@@ -0,0 +1,153 @@
+#include "job/scheduler.h"
+#include "scene/occlusion.h"
+#include "tests/test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr float g_fov_y = XM_PI / 3;
+constexpr float g_aspect = 16.0f / 9.0f;
+
+// Same projection as the scene camera, looking down +z from `eye_z`.
+XMMATRIX make_view_proj(float eye_z)
+{
+    const XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 0.0f, eye_z, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f),
+                                           XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    return XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(g_fov_y, g_aspect, 0.1f, 1000.0f));
+}
+
+// The test layout has no rotations.
+XMMATRIX get_world(const ash::transform &t)
+{
+    return XMMatrixScaling(t.scale.x, t.scale.y, t.scale.z) *
+           XMMatrixTranslation(t.position.x, t.position.y, t.position.z);
+}
+
+void rasterize_walls(ash::scene_occ_buffer &buffer, const ash::scene_occ_test_layout &layout, float eye_z)
+{
+    ash::scene_occ_begin(buffer, make_view_proj(eye_z));
+    for (const ash::transform &wall : layout.occluders)
+    {
+        ash::scene_occ_add_occluder(buffer, layout.occluder_bounds, get_world(wall));
+    }
+    ash::scene_occ_rasterize(buffer);
+}
+
+std::vector<bool> test_instances(const ash::scene_occ_buffer &buffer, const ash::scene_occ_test_layout &layout)
+{
+    std::vector<bool> kept(layout.instances.size());
+    for (std::size_t i = 0; i < kept.size(); ++i)
+    {
+        kept[i] = ash::scene_occ_test_box(buffer, {}, get_world(layout.instances[i]));
+    }
+    return kept;
+}
+
+// Largest |x| / depth and |y| / depth over the corners of an instance's default bounds, seen from (0, 0, eye_z).
+XMFLOAT2 get_max_slope(const ash::transform &t, float eye_z)
+{
+    const ash::bounds box;
+    XMFLOAT2 slope = {0.0f, 0.0f};
+    for (const float sx : {-1.0f, 1.0f})
+    {
+        for (const float sy : {-1.0f, 1.0f})
+        {
+            const float x = t.position.x + (box.center.x + sx * box.extents.x) * t.scale.x;
+            const float y = t.position.y + (box.center.y + sy * box.extents.y) * t.scale.y;
+            const float depth = t.position.z + box.center.z * t.scale.z - eye_z;
+            slope.x = std::max(slope.x, std::abs(x) / depth);
+            slope.y = std::max(slope.y, std::abs(y) / depth);
+        }
+    }
+    return slope;
+}
+} // namespace
+
+TEST_CASE(occlusion, test_scene_hides_only_instances_behind_walls)
+{
+    // Pulled back far enough that the wall no longer fills the screen and the sides of the block show.
+    constexpr float eye_z = -20.0f;
+    const ash::scene_occ_test_layout layout = ash::scene_occ_get_test_layout();
+    ash::scene_occ_buffer buffer;
+    rasterize_walls(buffer, layout, eye_z);
+
+    // Triangles are counted once however many bands they cover, so at most the 12 of every wall's box.
+    CHECK(ash::scene_occ_g_stats.rasterized_triangles > 0);
+    CHECK(ash::scene_occ_g_stats.rasterized_triangles <= 12 * layout.occluders.size());
+
+    // The walls share depth and height and sit side by side, spanning |x| <= 16 and |y| <= 6 between z = 9.9 and
+    // z = 10.1.
+    const ash::bounds &wall = layout.occluder_bounds;
+    const ash::transform &first = layout.occluders[0];
+    float half_width = 0.0f;
+    for (const ash::transform &occluder : layout.occluders)
+    {
+        half_width = std::max(half_width, std::abs(occluder.position.x) + occluder.scale.x * wall.extents.x);
+    }
+    const float half_height = first.scale.y * wall.extents.y;
+    const float front_z = first.position.z - first.scale.z * wall.extents.z;
+    const float back_z = first.position.z + first.scale.z * wall.extents.z;
+
+    // Two pixels of slack in slope units for the conservative pixel rounding of the box test.
+    const float pixel_x = 2.0f * std::tan(g_fov_y * 0.5f) * g_aspect / ash::scene_occ_width;
+    const float pixel_y = 2.0f * std::tan(g_fov_y * 0.5f) / ash::scene_occ_height;
+
+    const std::vector<bool> kept = test_instances(buffer, layout);
+    uint32_t culled = 0, hidden = 0;
+    for (std::size_t i = 0; i < kept.size(); ++i)
+    {
+        const XMFLOAT2 slope = get_max_slope(layout.instances[i], eye_z);
+        const bool inside_silhouette = slope.x <= half_width / (front_z - eye_z) + 2.0f * pixel_x &&
+                                       slope.y <= half_height / (front_z - eye_z) + 2.0f * pixel_y;
+        const bool behind_back_face = slope.x <= half_width / (back_z - eye_z) - 2.0f * pixel_x &&
+                                      slope.y <= half_height / (back_z - eye_z) - 2.0f * pixel_y;
+
+        // Culling never removes an instance that pokes out from behind the walls, and does remove every one that
+        // sits well inside them.
+        CHECK(kept[i] || inside_silhouette);
+        CHECK(!kept[i] || !behind_back_face);
+        culled += !kept[i];
+        hidden += behind_back_face;
+    }
+    CHECK(hidden > 0);
+    CHECK(culled >= hidden && culled < kept.size());
+
+    // The walls themselves are in front of their own depth.
+    for (const ash::transform &occluder : layout.occluders)
+    {
+        CHECK(ash::scene_occ_test_box(buffer, wall, get_world(occluder)));
+    }
+}
+
+BENCHMARK_CASE(occlusion, test_scene)
+{
+    ash::job_init(0);
+    const ash::scene_occ_test_layout layout = ash::scene_occ_get_test_layout();
+    ash::scene_occ_buffer buffer;
+
+    // The editor camera starts at z = -1, where the walls cover the whole screen; z = -20 shows the block's sides.
+    for (const float eye_z : {-1.0f, -20.0f})
+    {
+        const double raster_ns = ash::test_measure_ns(200, [&] { rasterize_walls(buffer, layout, eye_z); });
+        const uint32_t triangles = ash::scene_occ_g_stats.rasterized_triangles;
+
+        std::vector<bool> kept;
+        const double test_ns = ash::test_measure_ns(20, [&] { kept = test_instances(buffer, layout); });
+        std::size_t culled = 0;
+        for (const bool k : kept)
+        {
+            culled += !k;
+        }
+
+        std::printf("  eye z %5.1f: %u triangles in %6.3f ms (%8.0f triangles/ms), %zu instances tested in %6.3f ms, "
+                    "%.1f%% culled\n",
+                    eye_z, triangles, raster_ns * 1e-6, triangles * 1e6 / raster_ns, kept.size(), test_ns * 1e-6,
+                    100.0 * culled / kept.size());
+    }
+    ash::job_shutdown();
+}
@@ -0,0 +1,283 @@
+#include "job/scheduler.h"
+#include "scene/mesh_bvh.h"
+#include "scene/pick.h"
+#include "scene/scene.h"
+#include "tests/test.h"
+#include "tests/test_mesh.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+struct test_instance
+{
+    flecs::entity_t entity;
+    uint32_t mesh;
+    XMFLOAT4X4 world;
+};
+
+// Adds an entity drawing `mesh_index` with the given world matrix, and its world AABB and sphere to `bvh`.
+test_instance add_instance(ash::scene_bvh &bvh, const ash::scene_mesh_arena &arena, uint32_t mesh_index,
+                           FXMMATRIX world)
+{
+    test_instance instance;
+    instance.mesh = mesh_index;
+    XMStoreFloat4x4(&instance.world, world);
+
+    ash::world_transform entity_transform;
+    entity_transform.matrix = instance.world;
+    flecs::entity entity = ash::scene_g_world.entity();
+    entity.set<ash::mesh>({mesh_index}).set<ash::world_transform>(entity_transform);
+    instance.entity = entity.id();
+
+    const ash::scene_mesh &mesh = arena.meshes[mesh_index];
+    XMVECTOR min = XMVectorReplicate(FLT_MAX), max = XMVectorReplicate(-FLT_MAX);
+    for (uint32_t corner = 0; corner < 8; ++corner)
+    {
+        const XMVECTOR local = XMVectorSet(mesh.center.x + (corner & 1 ? mesh.extents.x : -mesh.extents.x),
+                                           mesh.center.y + (corner & 2 ? mesh.extents.y : -mesh.extents.y),
+                                           mesh.center.z + (corner & 4 ? mesh.extents.z : -mesh.extents.z), 1.0f);
+        const XMVECTOR point = XMVector3TransformCoord(local, world);
+        min = XMVectorMin(min, point);
+        max = XMVectorMax(max, point);
+    }
+    XMFLOAT3 world_min, world_max;
+    XMStoreFloat3(&world_min, min);
+    XMStoreFloat3(&world_max, max);
+    const XMVECTOR center = XMVectorScale(XMVectorAdd(min, max), 0.5f);
+    const float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(max, center)));
+    ash::scene_bvh_set_bounds(bvh, instance.entity, world_min, world_max,
+                              {XMVectorGetX(center), XMVectorGetY(center), XMVectorGetZ(center), radius});
+    return instance;
+}
+
+// Double-sided Moller-Trumbore; returns the ray parameter or FLT_MAX.
+float intersect_triangle(FXMVECTOR origin, FXMVECTOR direction, FXMVECTOR a, GXMVECTOR b, HXMVECTOR c)
+{
+    const XMVECTOR edge_ab = XMVectorSubtract(b, a);
+    const XMVECTOR edge_ac = XMVectorSubtract(c, a);
+    const XMVECTOR p = XMVector3Cross(direction, edge_ac);
+    const float determinant = XMVectorGetX(XMVector3Dot(edge_ab, p));
+    if (std::abs(determinant) < 1e-12f)
+    {
+        return FLT_MAX;
+    }
+
+    const float inv_determinant = 1.0f / determinant;
+    const XMVECTOR to_origin = XMVectorSubtract(origin, a);
+    const float u = XMVectorGetX(XMVector3Dot(to_origin, p)) * inv_determinant;
+    const XMVECTOR q = XMVector3Cross(to_origin, edge_ab);
+    const float v = XMVectorGetX(XMVector3Dot(direction, q)) * inv_determinant;
+    const float t = XMVectorGetX(XMVector3Dot(edge_ac, q)) * inv_determinant;
+    return u < 0.0f || v < 0.0f || u + v > 1.0f || t < 0.0f ? FLT_MAX : t;
+}
+
+// Nearest hit over every triangle of every instance, in world space.
+float pick_brute_force(const ash::scene_mesh_arena &arena, const std::vector<test_instance> &instances,
+                       const XMFLOAT3 &origin, const XMFLOAT3 &direction, flecs::entity_t &entity)
+{
+    const XMVECTOR ray_origin = XMLoadFloat3(&origin);
+    const XMVECTOR ray_direction = XMLoadFloat3(&direction);
+    float nearest = FLT_MAX;
+    for (const test_instance &instance : instances)
+    {
+        const XMMATRIX world = XMLoadFloat4x4(&instance.world);
+        const ash::scene_mesh &mesh = arena.meshes[instance.mesh];
+        for (uint32_t p = mesh.first_primitive; p < mesh.first_primitive + mesh.primitive_count; ++p)
+        {
+            const ash::scene_mesh_primitive &primitive = arena.primitives[p];
+            const auto corner = [&](uint32_t i) {
+                const uint32_t vertex = primitive.first_vertex + arena.indices[primitive.first_index + i];
+                return XMVector3TransformCoord(XMLoadFloat3(&arena.positions[vertex]), world);
+            };
+            for (uint32_t i = 0; i + 2 < primitive.index_count; i += 3)
+            {
+                const float t = intersect_triangle(ray_origin, ray_direction, corner(i), corner(i + 1), corner(i + 2));
+                if (t < nearest)
+                {
+                    nearest = t;
+                    entity = instance.entity;
+                }
+            }
+        }
+    }
+    return nearest;
+}
+
+XMFLOAT3 get_random_direction(ash::test_random &random)
+{
+    const XMVECTOR v = XMVectorSet(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f),
+                                   random.uniform(-1.0f, 1.0f), 0.0f);
+    XMFLOAT3 direction;
+    XMStoreFloat3(&direction, XMVector3Normalize(XMVectorAdd(v, XMVectorSet(0.0f, 0.0f, 1e-3f, 0.0f))));
+    return direction;
+}
+
+void destroy(const std::vector<test_instance> &instances)
+{
+    for (const test_instance &instance : instances)
+    {
+        flecs::entity(ash::scene_g_world, instance.entity).destruct();
+    }
+}
+} // namespace
+
+TEST_CASE(pick, nearest_hit_matches_brute_force)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 16, 16, [](float x, float z) { return 2.0f * std::sin(x * 0.5f) * std::cos(z * 0.4f); });
+    ash::test_add_grid(arena, 6, 3);
+    ash::scene_mbvh_build(arena);
+    CHECK(ash::scene_mbvh_validate(arena));
+
+    // Rotated, non-uniformly scaled and overlapping instances, so local-space rays and depth order both matter.
+    ash::test_random random;
+    ash::scene_bvh bvh;
+    std::vector<test_instance> instances;
+    for (uint32_t i = 0; i < 150; ++i)
+    {
+        const XMMATRIX world =
+            XMMatrixScaling(random.uniform(0.3f, 1.5f), random.uniform(0.3f, 1.5f), random.uniform(0.3f, 1.5f)) *
+            XMMatrixRotationRollPitchYaw(random.uniform(-XM_PI, XM_PI), random.uniform(-XM_PI, XM_PI),
+                                         random.uniform(-XM_PI, XM_PI)) *
+            XMMatrixTranslation(random.uniform(-40.0f, 40.0f), random.uniform(-10.0f, 10.0f),
+                                random.uniform(-40.0f, 40.0f));
+        instances.push_back(add_instance(bvh, arena, random.next() % 2, world));
+    }
+    ash::scene_bvh_rebuild(bvh);
+
+    uint32_t hits = 0, mismatches = 0;
+    for (uint32_t r = 0; r < 300; ++r)
+    {
+        const XMFLOAT3 origin = {random.uniform(-60.0f, 60.0f), random.uniform(-20.0f, 20.0f),
+                                 random.uniform(-60.0f, 60.0f)};
+        const XMFLOAT3 direction = get_random_direction(random);
+
+        flecs::entity_t expected_entity = 0;
+        const float expected = pick_brute_force(arena, instances, origin, direction, expected_entity);
+
+        ash::scene_pick_hit hit;
+        const bool found = ash::scene_pick_ray(bvh, arena, origin, direction, FLT_MAX, hit);
+        hits += found;
+
+        // Two entities can be hit at almost the same distance; only the distance has to agree then.
+        const float tolerance = 1e-3f * std::max(1.0f, expected);
+        if (found != (expected != FLT_MAX) ||
+            (found && (std::abs(hit.distance - expected) > tolerance ||
+                       (hit.entity != expected_entity && std::abs(hit.distance - expected) > 1e-5f))))
+        {
+            ++mismatches;
+        }
+    }
+    std::printf("  %u of 300 rays hit\n", hits);
+    CHECK(hits > 50);
+    CHECK(mismatches == 0);
+
+    // A limited ray misses what lies beyond its end.
+    ash::scene_pick_hit near_hit;
+    const XMFLOAT3 origin = {0.0f, 50.0f, 0.0f}, down = {0.0f, -1.0f, 0.0f};
+    CHECK(!ash::scene_pick_ray(bvh, arena, origin, down, 1.0f, near_hit));
+
+    destroy(instances);
+}
+
+TEST_CASE(pick, viewport_click_selects_entity_under_cursor)
+{
+    ash::scene_mesh_arena &arena = ash::scene_mesh_g_arena;
+    ash::scene_mesh_clear(arena);
+    ash::test_add_grid(arena, 4, 4);
+    ash::scene_mbvh_build(arena);
+
+    // Two upright 4x4 panels facing the camera, the left one in front of the right one's plane.
+    ash::scene_bvh &bvh = ash::scene_bvh_g_tree;
+    const XMMATRIX upright = XMMatrixTranslation(-2.0f, 0.0f, -2.0f) * XMMatrixRotationX(-XM_PIDIV2);
+    const test_instance left = add_instance(bvh, arena, 0, upright * XMMatrixTranslation(-3.0f, 0.0f, 10.0f));
+    const test_instance right = add_instance(bvh, arena, 0, upright * XMMatrixTranslation(3.0f, 0.0f, 20.0f));
+    ash::scene_bvh_rebuild(bvh);
+
+    constexpr float width = 1280.0f, height = 720.0f;
+    ash::g_camera.position = {0.0f, 0.0f, 0.0f};
+    XMStoreFloat4x4(&ash::g_camera.mat_view,
+                    XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f),
+                                     XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+    XMStoreFloat4x4(&ash::g_camera.mat_proj, XMMatrixPerspectiveFovLH(XM_PI / 3, width / height, 0.1f, 1000.0f));
+    const XMMATRIX view_proj = XMLoadFloat4x4(&ash::g_camera.mat_view) * XMLoadFloat4x4(&ash::g_camera.mat_proj);
+
+    // Click at points projected from the panels, away from their vertices and edges.
+    const auto click_at = [&](FXMVECTOR world_point) {
+        const XMVECTOR ndc = XMVector3TransformCoord(world_point, view_proj);
+        const float x = (XMVectorGetX(ndc) * 0.5f + 0.5f) * width;
+        const float y = (0.5f - XMVectorGetY(ndc) * 0.5f) * height;
+
+        // The pick ray passes through the point it was made from.
+        XMFLOAT3 origin, direction;
+        ash::scene_pick_get_ray(ash::g_camera, x, y, width, height, origin, direction);
+        const XMVECTOR to_point = XMVectorSubtract(world_point, XMLoadFloat3(&origin));
+        const float miss = XMVectorGetX(XMVector3Length(XMVector3Cross(to_point, XMLoadFloat3(&direction))));
+        CHECK(miss < 1e-3f);
+        return ash::scene_pick_select(x, y, width, height);
+    };
+    CHECK(click_at(XMVectorSet(-2.6f, 0.3f, 10.0f, 1.0f)).id() == left.entity);
+    CHECK(ash::scene_g_selected.id() == left.entity);
+    CHECK(click_at(XMVectorSet(3.4f, -1.3f, 20.0f, 1.0f)).id() == right.entity);
+
+    // Empty space clears the selection.
+    CHECK(!click_at(XMVectorSet(0.0f, 8.0f, 20.0f, 1.0f)).is_valid());
+    CHECK(!ash::scene_g_selected.is_valid());
+
+    destroy({left, right});
+    bvh = {};
+    ash::scene_mesh_clear(arena);
+}
+
+BENCHMARK_CASE(pick, ten_million_triangles)
+{
+    ash::job_init(0);
+
+    // 80 instances of a 131k-triangle terrain tile.
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 256, 256,
+                       [](float x, float z) { return 4.0f * std::sin(x * 0.1f) * std::cos(z * 0.13f); });
+    const double build_ns = ash::test_measure_ns(1, [&] { ash::scene_mbvh_build(arena); });
+
+    ash::scene_bvh bvh;
+    std::vector<test_instance> instances;
+    uint64_t triangles = 0;
+    for (uint32_t i = 0; i < 80; ++i)
+    {
+        const XMMATRIX world = XMMatrixRotationY(0.3f * i) *
+                               XMMatrixTranslation(300.0f * (i % 10) - 1500.0f, 10.0f * (i % 3), 300.0f * (i / 10));
+        instances.push_back(add_instance(bvh, arena, 0, world));
+        triangles += arena.indices.size() / 3;
+    }
+    ash::scene_bvh_rebuild(bvh);
+
+    ash::test_random random;
+    std::vector<double> times;
+    uint32_t hits = 0;
+    for (uint32_t r = 0; r < 2000; ++r)
+    {
+        const XMFLOAT3 origin = {random.uniform(-1500.0f, 1500.0f), 200.0f, random.uniform(-200.0f, 0.0f)};
+        XMFLOAT3 direction;
+        XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(random.uniform(-0.5f, 0.5f),
+                                                                 random.uniform(-0.8f, -0.1f), 1.0f, 0.0f)));
+        ash::scene_pick_hit hit;
+        const auto begin = std::chrono::high_resolution_clock::now();
+        hits += ash::scene_pick_ray(bvh, arena, origin, direction, FLT_MAX, hit);
+        times.push_back(std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - begin)
+                            .count());
+    }
+    std::sort(times.begin(), times.end());
+    std::printf("  %llu triangles, mesh BVH build %.1f ms: %u of %zu rays hit, pick median %.2f us, p99 %.2f us, "
+                "max %.2f us\n",
+                static_cast<unsigned long long>(triangles), build_ns * 1e-6, hits, times.size(),
+                times[times.size() / 2], times[times.size() * 99 / 100], times.back());
+
+    destroy(instances);
+    ash::job_shutdown();
+}
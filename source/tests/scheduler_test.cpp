@@ -0,0 +1,400 @@
+#include "job/deque.h"
+#include "job/scheduler.h"
+#include "tests/test.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct hit_context
+{
+    std::atomic<uint32_t> *hits;
+    uint32_t index;
+};
+
+void count_hit(void *data)
+{
+    const hit_context &context = *static_cast<hit_context *>(data);
+    context.hits[context.index].fetch_add(1, std::memory_order_relaxed);
+}
+
+void increment(void *data)
+{
+    static_cast<std::atomic<uint32_t> *>(data)->fetch_add(1, std::memory_order_relaxed);
+}
+
+void do_nothing(void *)
+{
+}
+
+// Records when a job started, in steady_clock nanoseconds.
+void record_start(void *data)
+{
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count();
+    static_cast<std::atomic<int64_t> *>(data)->store(now, std::memory_order_relaxed);
+}
+} // namespace
+
+TEST_CASE(scheduler, deque_steal_while_owner_pushes_and_pops)
+{
+    // A small ring wraps around thousands of times, so stale-slot and last-item races are hit constantly.
+    constexpr uint32_t item_count = 200000;
+    constexpr uint32_t thief_count = 6;
+    ash::job_deque<uint32_t, 64> deque;
+    std::vector<uint32_t> items(item_count);
+    std::unique_ptr<std::atomic<uint32_t>[]> taken(new std::atomic<uint32_t>[item_count]);
+    for (uint32_t i = 0; i < item_count; ++i)
+    {
+        items[i] = i;
+        taken[i].store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<bool> done = false;
+    std::vector<std::thread> thieves;
+    for (uint32_t t = 0; t < thief_count; ++t)
+    {
+        thieves.emplace_back([&] {
+            while (!done.load(std::memory_order_acquire))
+            {
+                if (uint32_t *item = ash::job_deque_steal(deque))
+                {
+                    taken[*item].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    ash::test_random random;
+    uint32_t next = 0;
+    while (next < item_count)
+    {
+        // Bursts of pushes, then pops, so the owner keeps meeting thieves on both nearly-empty and full rings.
+        const uint32_t pushes = random.next() % 48 + 1;
+        for (uint32_t i = 0; i < pushes && next < item_count; ++i)
+        {
+            if (!ash::job_deque_push(deque, &items[next]))
+            {
+                break;
+            }
+            ++next;
+        }
+
+        const uint32_t pops = random.next() % 32;
+        for (uint32_t i = 0; i < pops; ++i)
+        {
+            if (uint32_t *item = ash::job_deque_pop(deque))
+            {
+                taken[*item].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    while (uint32_t *item = ash::job_deque_pop(deque))
+    {
+        taken[*item].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    done.store(true, std::memory_order_release);
+    for (std::thread &thief : thieves)
+    {
+        thief.join();
+    }
+
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < item_count; ++i)
+    {
+        wrong += taken[i].load(std::memory_order_relaxed) != 1;
+    }
+    CHECK(wrong == 0);
+    CHECK(ash::job_deque_pop(deque) == nullptr);
+    CHECK(ash::job_deque_steal(deque) == nullptr);
+}
+
+TEST_CASE(scheduler, deque_push_fails_when_full)
+{
+    ash::job_deque<uint32_t, 8> deque;
+    uint32_t items[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        CHECK(ash::job_deque_push(deque, &items[i]));
+    }
+    CHECK(!ash::job_deque_push(deque, &items[8]));
+
+    // Steals take the oldest item, pops the newest.
+    CHECK(ash::job_deque_steal(deque) == &items[0]);
+    CHECK(ash::job_deque_pop(deque) == &items[7]);
+    CHECK(ash::job_deque_push(deque, &items[8]));
+    CHECK(ash::job_deque_pop(deque) == &items[8]);
+}
+
+TEST_CASE(scheduler, full_deque_spills_into_injection_queue)
+{
+    ash::job_init(2);
+
+    // One batch three times the deque's capacity: the submitting thread's deque fills up and the rest goes through
+    // the injection queue. Every job must still run exactly once.
+    constexpr uint32_t job_count = ash::job_deque_capacity * 3;
+    std::unique_ptr<std::atomic<uint32_t>[]> hits(new std::atomic<uint32_t>[job_count]);
+    std::vector<hit_context> contexts(job_count);
+    std::vector<ash::job_decl> jobs(job_count);
+    for (uint32_t i = 0; i < job_count; ++i)
+    {
+        hits[i].store(0, std::memory_order_relaxed);
+        contexts[i] = {hits.get(), i};
+        jobs[i] = {count_hit, &contexts[i]};
+    }
+
+    ash::job_counter counter;
+    ash::job_submit(jobs.data(), job_count, &counter);
+    ash::job_wait(counter);
+
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < job_count; ++i)
+    {
+        wrong += hits[i].load(std::memory_order_relaxed) != 1;
+    }
+    CHECK(wrong == 0);
+
+    ash::job_shutdown();
+}
+
+TEST_CASE(scheduler, submit_after_zero_counter_runs_immediately)
+{
+    ash::job_init(2);
+
+    ash::job_counter dependency;
+    std::atomic<uint32_t> runs = 0;
+    const ash::job_decl job = {increment, &runs};
+    ash::job_counter counter;
+    ash::job_submit_after(dependency, &job, 1, &counter);
+    ash::job_wait(counter);
+    CHECK(runs.load() == 1);
+
+    // A counter that was used and waited on is zero again, and behaves the same.
+    ash::job_submit(&job, 1, &dependency);
+    ash::job_wait(dependency);
+    ash::job_submit_after(dependency, &job, 1, &counter);
+    ash::job_wait(counter);
+    CHECK(runs.load() == 3);
+
+    ash::job_shutdown();
+}
+
+TEST_CASE(scheduler, submit_after_pending_counter_waits_for_it)
+{
+    ash::job_init(4);
+
+    struct gate
+    {
+        std::atomic<bool> open = false;
+        std::atomic<bool> first_done = false;
+        std::atomic<uint32_t> ran_early = 0;
+        std::atomic<uint32_t> ran = 0;
+    } state;
+
+    const ash::job_decl first = {[](void *data) {
+                                     gate &state = *static_cast<gate *>(data);
+                                     while (!state.open.load(std::memory_order_acquire))
+                                     {
+                                         std::this_thread::yield();
+                                     }
+                                     state.first_done.store(true, std::memory_order_release);
+                                 },
+                                 &state};
+    const ash::job_decl second = {[](void *data) {
+                                      gate &state = *static_cast<gate *>(data);
+                                      if (!state.first_done.load(std::memory_order_acquire))
+                                      {
+                                          state.ran_early.fetch_add(1);
+                                      }
+                                      state.ran.fetch_add(1);
+                                  },
+                                  &state};
+
+    ash::job_counter dependency;
+    ash::job_counter counter;
+    ash::job_submit(&first, 1, &dependency);
+    const ash::job_decl seconds[] = {second, second, second, second};
+    ash::job_submit_after(dependency, seconds, 4, &counter);
+
+    // The continuation is parked, so it cannot have run while the first job is still blocked.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(state.ran.load() == 0);
+    CHECK(counter.state.load() != 0);
+
+    state.open.store(true, std::memory_order_release);
+    ash::job_wait(counter);
+    ash::job_wait(dependency);
+    CHECK(state.ran.load() == 4);
+    CHECK(state.ran_early.load() == 0);
+
+    ash::job_shutdown();
+}
+
+TEST_CASE(scheduler, counter_reused_right_after_wait)
+{
+    ash::job_init(4);
+
+    // Reusing the counter as soon as job_wait returns is only safe if the finishing thread has fully let go of it;
+    // a use-after-release shows up as a lost or extra decrement, or under ThreadSanitizer.
+    std::atomic<uint32_t> runs = 0;
+    const ash::job_decl jobs[] = {{increment, &runs}, {increment, &runs}, {increment, &runs}};
+    ash::job_counter counter;
+    ash::job_counter chained;
+    constexpr uint32_t rounds = 20000;
+    for (uint32_t round = 0; round < rounds; ++round)
+    {
+        ash::job_submit(jobs, 3, &counter);
+        ash::job_submit_after(counter, jobs, 1, &chained);
+        ash::job_wait(chained);
+        ash::job_wait(counter);
+    }
+    CHECK(runs.load() == rounds * 4);
+    CHECK(counter.state.load() == 0);
+    CHECK(chained.state.load() == 0);
+
+    ash::job_shutdown();
+}
+
+TEST_CASE(scheduler, dependency_chain_runs_in_order)
+{
+    ash::job_init(4);
+
+    constexpr uint32_t link_count = 256;
+    struct link
+    {
+        std::atomic<uint32_t> *sequence;
+        uint32_t index;
+        bool in_order;
+    };
+
+    std::atomic<uint32_t> sequence = 0;
+    std::vector<link> links(link_count);
+    std::unique_ptr<ash::job_counter[]> counters(new ash::job_counter[link_count]);
+    for (uint32_t i = 0; i < link_count; ++i)
+    {
+        links[i] = {&sequence, i, false};
+        const ash::job_decl job = {[](void *data) {
+                                       link &self = *static_cast<link *>(data);
+                                       self.in_order = self.sequence->fetch_add(1) == self.index;
+                                   },
+                                   &links[i]};
+        if (i == 0)
+        {
+            ash::job_submit(&job, 1, &counters[i]);
+        }
+        else
+        {
+            ash::job_submit_after(counters[i - 1], &job, 1, &counters[i]);
+        }
+    }
+
+    // Every counter is waited on before the array goes away, as the job_counter contract requires.
+    for (uint32_t i = 0; i < link_count; ++i)
+    {
+        ash::job_wait(counters[i]);
+    }
+
+    CHECK(std::all_of(links.begin(), links.end(), [](const link &l) { return l.in_order; }));
+    ash::job_shutdown();
+}
+
+BENCHMARK_CASE(scheduler, fork_join)
+{
+    const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t workers = 1; workers <= hardware; workers *= 2)
+    {
+        ash::job_init(workers);
+
+        constexpr uint32_t batch = 256;
+        std::vector<ash::job_decl> jobs(batch, ash::job_decl{do_nothing, nullptr});
+        const double ns = ash::test_measure_ns(2000, [&] {
+            ash::job_counter counter;
+            ash::job_submit(jobs.data(), batch, &counter);
+            ash::job_wait(counter);
+        });
+        std::printf("  %2u workers: %8.1f ns per fork-join of %u jobs, %6.1f ns per job\n", workers, ns, batch,
+                    ns / batch);
+
+        ash::job_shutdown();
+    }
+}
+
+BENCHMARK_CASE(scheduler, dependency_chain)
+{
+    const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t workers = 1; workers <= hardware; workers *= 2)
+    {
+        ash::job_init(workers);
+
+        constexpr uint32_t link_count = 1000;
+        std::unique_ptr<ash::job_counter[]> counters(new ash::job_counter[link_count]);
+        const ash::job_decl job = {do_nothing, nullptr};
+        const double ns = ash::test_measure_ns(50, [&] {
+            ash::job_submit(&job, 1, &counters[0]);
+            for (uint32_t i = 1; i < link_count; ++i)
+            {
+                ash::job_submit_after(counters[i - 1], &job, 1, &counters[i]);
+            }
+            for (uint32_t i = 0; i < link_count; ++i)
+            {
+                ash::job_wait(counters[i]);
+            }
+        });
+        std::printf("  %2u workers: %8.1f ns per dependent link\n", workers, ns / link_count);
+
+        ash::job_shutdown();
+    }
+}
+
+BENCHMARK_CASE(scheduler, placement_latency)
+{
+    // Time from submitting one job per worker to the last of them starting, after the workers have gone to sleep,
+    // with workers only preferring their processors and with them pinned.
+    const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t workers = std::max(1u, std::min(hardware, 8u));
+    const bool pin_threads = ash::job_g_pin_threads;
+    for (const bool pin : {false, true})
+    {
+        ash::job_g_pin_threads = pin;
+        ash::job_init(workers);
+
+        std::vector<std::atomic<int64_t>> starts(workers);
+        std::vector<ash::job_decl> jobs(workers);
+        for (uint32_t i = 0; i < workers; ++i)
+        {
+            jobs[i] = {record_start, &starts[i]};
+        }
+
+        std::vector<double> latencies;
+        for (uint32_t round = 0; round < 500; ++round)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            const int64_t submitted = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count();
+            ash::job_counter counter;
+            ash::job_submit(jobs.data(), workers, &counter);
+            ash::job_wait(counter);
+
+            int64_t last = 0;
+            for (const std::atomic<int64_t> &start : starts)
+            {
+                last = std::max(last, start.load(std::memory_order_relaxed));
+            }
+            latencies.push_back(double(last - submitted));
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("  %2u workers, %s: median %8.1f us, p99 %8.1f us\n", workers, pin ? "pinned   " : "preferred",
+                    latencies[latencies.size() / 2] * 1e-3, latencies[latencies.size() * 99 / 100] * 1e-3);
+
+        ash::job_shutdown();
+    }
+    ash::job_g_pin_threads = pin_threads;
+}
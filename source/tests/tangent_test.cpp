@@ -0,0 +1,147 @@
+#include "job/scheduler.h"
+#include "scene/tangent.h"
+#include "tests/test.h"
+#include "tests/test_mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_size = 40;
+
+float get_wave_height(float x, float z)
+{
+    return 1.5f * std::sin(x * 0.2f) + std::cos(z * 0.15f);
+}
+
+// With uv = (x, z) / g_size, dP/du points along the surface in x and dP/dv along it in z.
+XMVECTOR get_analytic_tangent(float x, float)
+{
+    return XMVector3Normalize(XMVectorSet(1.0f, 0.3f * std::cos(x * 0.2f), 0.0f, 0.0f));
+}
+
+XMVECTOR get_analytic_bitangent(float, float z)
+{
+    return XMVector3Normalize(XMVectorSet(0.0f, -0.15f * std::sin(z * 0.15f), 1.0f, 0.0f));
+}
+
+float get_angle_degrees(FXMVECTOR a, FXMVECTOR b)
+{
+    return XMVectorGetX(XMVector3AngleBetweenNormals(XMVector3Normalize(a), XMVector3Normalize(b))) * 180.0f / XM_PI;
+}
+} // namespace
+
+TEST_CASE(tangent, heightfield_matches_analytic_tangents)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, g_size, g_size, get_wave_height);
+    const ash::scene_tan_stats stats = ash::scene_tan_generate(arena);
+    CHECK(stats.primitives == 1);
+    CHECK(stats.triangles == g_size * g_size * 2);
+    CHECK(stats.split_vertices == 0);
+
+    float max_interior_error = 0.0f;
+    float max_border_error = 0.0f;
+    float min_orthogonality = 1.0f;
+    uint32_t wrong_handedness = 0;
+    for (std::size_t v = 0; v < arena.positions.size(); ++v)
+    {
+        const XMFLOAT3 &p = arena.positions[v];
+        const XMVECTOR normal = XMLoadFloat3(&arena.normals[v]);
+        const XMVECTOR tangent = XMLoadFloat4(&arena.tangents[v]);
+
+        // The analytic tangent, made orthogonal to the vertex normal the way MikkTSpace does.
+        XMVECTOR expected = get_analytic_tangent(p.x, p.z);
+        expected = XMVectorSubtract(expected, XMVectorScale(normal, XMVectorGetX(XMVector3Dot(normal, expected))));
+        const float error = get_angle_degrees(tangent, expected);
+        const bool border = p.x == 0.0f || p.z == 0.0f || p.x == float(g_size) || p.z == float(g_size);
+        float &max_error = border ? max_border_error : max_interior_error;
+        max_error = std::max(max_error, error);
+        const float normal_dot = XMVectorGetX(XMVector3Dot(normal, XMVector3Normalize(tangent)));
+        min_orthogonality = std::min(min_orthogonality, 1.0f - std::abs(normal_dot));
+
+        // w gives the bitangent as cross(normal, tangent) * w, which must point along dP/dv.
+        const XMVECTOR bitangent = XMVectorScale(XMVector3Cross(normal, tangent), arena.tangents[v].w);
+        wrong_handedness += XMVectorGetX(XMVector3Dot(bitangent, get_analytic_bitangent(p.x, p.z))) <= 0.0f;
+    }
+
+    // One-sided differences at the border are coarser than the central ones inside.
+    CHECK(max_interior_error < 0.5f);
+    CHECK(max_border_error < 2.0f);
+    CHECK(min_orthogonality > 0.999f);
+    CHECK(wrong_handedness == 0);
+}
+
+TEST_CASE(tangent, mirrored_uvs_split_the_seam)
+{
+    // The right half mirrors u, as a symmetric model sharing one texture half would, so triangles on either side of
+    // the seam column have opposite uv winding.
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, g_size, 8);
+    for (std::size_t v = 0; v < arena.positions.size(); ++v)
+    {
+        const float x = arena.positions[v].x;
+        arena.uvs[v].x = x <= g_size / 2 ? x / g_size : (g_size - x) / g_size;
+    }
+
+    const ash::scene_tan_stats stats = ash::scene_tan_generate(arena);
+    CHECK(stats.split_vertices == 9);
+    CHECK(arena.positions.size() == (g_size + 1) * 9 + 9);
+    CHECK(arena.primitives[0].vertex_count == arena.positions.size());
+
+    // Every triangle sees the handedness of its own half, and the tangent follows +u on both sides.
+    uint32_t wrong = 0;
+    const ash::scene_mesh_primitive &primitive = arena.primitives[0];
+    for (uint32_t i = 0; i < primitive.index_count; ++i)
+    {
+        const uint32_t first = arena.indices[primitive.first_index + i - i % 3];
+        const uint32_t second = arena.indices[primitive.first_index + i - i % 3 + 1];
+        const uint32_t third = arena.indices[primitive.first_index + i - i % 3 + 2];
+        const float center_x =
+            (arena.positions[first].x + arena.positions[second].x + arena.positions[third].x) / 3.0f;
+        const XMFLOAT4 &tangent = arena.tangents[arena.indices[primitive.first_index + i]];
+        const bool left = center_x < g_size / 2;
+        wrong += (tangent.x > 0.99f) != left || (tangent.x < -0.99f) == left;
+        wrong += tangent.w != arena.tangents[first].w;
+    }
+    CHECK(wrong == 0);
+}
+
+TEST_CASE(tangent, existing_tangents_are_kept)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 4, 4);
+    for (XMFLOAT4 &tangent : arena.tangents)
+    {
+        tangent = {0.0f, 0.0f, 1.0f, -1.0f};
+    }
+    const ash::scene_tan_stats stats = ash::scene_tan_generate(arena);
+    CHECK(stats.primitives == 0);
+    CHECK(std::all_of(arena.tangents.begin(), arena.tangents.end(),
+                      [](const XMFLOAT4 &t) { return t.z == 1.0f && t.w == -1.0f; }));
+}
+
+BENCHMARK_CASE(tangent, large_grid)
+{
+    ash::job_init(0);
+    ash::scene_mesh_arena source;
+    ash::test_add_grid(source, 1500, 1500, get_wave_height);
+
+    // Generation only runs on primitives without tangents, so each run gets a fresh copy, made outside the timing.
+    constexpr uint32_t runs = 3;
+    double ns = 0.0;
+    ash::scene_tan_stats stats;
+    for (uint32_t run = 0; run < runs; ++run)
+    {
+        ash::scene_mesh_arena arena = source;
+        ns += ash::test_measure_ns(1, [&] { stats = ash::scene_tan_generate(arena); });
+    }
+    ns /= runs;
+    std::printf("  1500x1500 grid, %llu triangles: %8.2f ms, %7.0f triangles/ms, %u split vertices\n",
+                static_cast<unsigned long long>(stats.triangles), ns * 1e-6, stats.triangles * 1e6 / ns,
+                stats.split_vertices);
+    ash::job_shutdown();
+}
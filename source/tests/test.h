@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Minimal headless test runner. Each *_test.cpp file is one suite, named after the file without the suffix, and
+// registers its cases with TEST_CASE and its benchmarks with BENCHMARK_CASE. `AshenvaleTests <suite>` runs the tests
+// of one suite (one ctest entry per suite); `AshenvaleTests --benchmark [suite]` runs benchmarks instead.
+
+namespace ash
+{
+struct test_case
+{
+    const char *suite;
+    const char *name;
+    void (*fn)();
+    bool benchmark;
+};
+
+inline uint32_t test_g_failures = 0;
+
+inline std::vector<test_case> &test_get_registry()
+{
+    static std::vector<test_case> registry;
+    return registry;
+}
+
+struct test_registrar
+{
+    test_registrar(const char *suite, const char *name, void (*fn)(), bool benchmark)
+    {
+        test_get_registry().push_back({suite, name, fn, benchmark});
+    }
+};
+
+inline void test_fail(const char *file, int line, const char *expression)
+{
+    std::fprintf(stderr, "%s(%d): CHECK failed: %s\n", file, line, expression);
+    ++test_g_failures;
+}
+
+// Runs `fn` `iterations` times and returns the mean wall time per call in nanoseconds.
+template <typename Fn> double test_measure_ns(uint32_t iterations, Fn &&fn)
+{
+    const auto begin = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        fn();
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
+
+// Deterministic generator for randomized tests, so a failure reproduces.
+struct test_random
+{
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<uint32_t>(state >> 32);
+    }
+
+    float uniform(float lo, float hi)
+    {
+        return lo + (hi - lo) * (next() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+} // namespace ash
+
+#define TEST_CONCAT_INTERNAL(x, y) x##y
+#define TEST_CONCAT(x, y) TEST_CONCAT_INTERNAL(x, y)
+
+#define TEST_REGISTER(suite, name, benchmark)                                                                          \
+    static void TEST_CONCAT(suite##_, name)();                                                                         \
+    static ash::test_registrar TEST_CONCAT(suite##_registrar_, name)(#suite, #name, TEST_CONCAT(suite##_, name),       \
+                                                                     benchmark);                                       \
+    static void TEST_CONCAT(suite##_, name)()
+
+#define TEST_CASE(suite, name) TEST_REGISTER(suite, name, false)
+#define BENCHMARK_CASE(suite, name) TEST_REGISTER(suite, name##_benchmark, true)
+
+#define CHECK(expression)                                                                                              \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(expression))                                                                                             \
+        {                                                                                                              \
+            ash::test_fail(__FILE__, __LINE__, #expression);                                                           \
+        }                                                                                                              \
+    } while (false)
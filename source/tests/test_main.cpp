@@ -0,0 +1,44 @@
+#include "tests/test.h"
+#include <cstring>
+
+int main(int argc, char **argv)
+{
+    bool benchmark = false;
+    const char *suite = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--benchmark") == 0)
+        {
+            benchmark = true;
+        }
+        else
+        {
+            suite = argv[i];
+        }
+    }
+
+    uint32_t ran = 0;
+    for (const ash::test_case &test : ash::test_get_registry())
+    {
+        if (test.benchmark != benchmark || (suite != nullptr && std::strcmp(suite, test.suite) != 0))
+        {
+            continue;
+        }
+
+        const uint32_t failures = ash::test_g_failures;
+        std::printf("[ RUN  ] %s.%s\n", test.suite, test.name);
+        std::fflush(stdout);
+        test.fn();
+        std::printf("[ %s ] %s.%s\n", ash::test_g_failures == failures ? " OK " : "FAIL", test.suite, test.name);
+        ++ran;
+    }
+
+    if (ran == 0)
+    {
+        std::fprintf(stderr, "No %s matched '%s'.\n", benchmark ? "benchmark" : "test", suite ? suite : "");
+        return 1;
+    }
+
+    std::printf("%u ran, %u failed checks.\n", ran, ash::test_g_failures);
+    return ash::test_g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "scene/mesh.h"
+#include <cmath>
+
+// Procedural meshes for geometry tests.
+
+namespace ash
+{
+// Appends a mesh with one primitive to `arena`: a grid of `width` by `depth` quads over [0, width] x [0, depth] in the
+// xz plane, lifted to y = height(x, z). Triangles are wound so that their cross product points up; normals are the
+// area-weighted sum of those, uvs span [0, 1] and tangents are left for scene_tan_generate. Returns the mesh index.
+template <typename Height>
+uint32_t test_add_grid(scene_mesh_arena &arena, uint32_t width, uint32_t depth, Height &&height)
+{
+    const uint32_t first_vertex = static_cast<uint32_t>(arena.positions.size());
+    const uint32_t first_index = static_cast<uint32_t>(arena.indices.size());
+    for (uint32_t z = 0; z <= depth; ++z)
+    {
+        for (uint32_t x = 0; x <= width; ++x)
+        {
+            const float fx = static_cast<float>(x);
+            const float fz = static_cast<float>(z);
+            arena.positions.push_back({fx, height(fx, fz), fz});
+            arena.normals.push_back({0.0f, 0.0f, 0.0f});
+            arena.tangents.push_back({0.0f, 0.0f, 0.0f, 0.0f});
+            arena.uvs.push_back({fx / width, fz / depth});
+        }
+    }
+
+    for (uint32_t z = 0; z < depth; ++z)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint32_t v = z * (width + 1) + x;
+            arena.indices.insert(arena.indices.end(), {v, v + width + 1, v + 1, v + 1, v + width + 1, v + width + 2});
+        }
+    }
+
+    DirectX::XMFLOAT3 *positions = arena.positions.data() + first_vertex;
+    DirectX::XMFLOAT3 *normals = arena.normals.data() + first_vertex;
+    for (std::size_t i = first_index; i < arena.indices.size(); i += 3)
+    {
+        const uint32_t a = arena.indices[i], b = arena.indices[i + 1], c = arena.indices[i + 2];
+        const DirectX::XMVECTOR pa = DirectX::XMLoadFloat3(&positions[a]);
+        const DirectX::XMVECTOR normal =
+            DirectX::XMVector3Cross(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&positions[b]), pa),
+                                    DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&positions[c]), pa));
+        for (const uint32_t v : {a, b, c})
+        {
+            DirectX::XMStoreFloat3(&normals[v], DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&normals[v]), normal));
+        }
+    }
+    for (uint32_t v = 0; v < (width + 1) * (depth + 1); ++v)
+    {
+        DirectX::XMStoreFloat3(&normals[v], DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&normals[v])));
+    }
+
+    scene_mesh_primitive primitive;
+    primitive.first_vertex = first_vertex;
+    primitive.vertex_count = (width + 1) * (depth + 1);
+    primitive.first_index = first_index;
+    primitive.index_count = width * depth * 6;
+    primitive.lod_count = 0;
+
+    scene_mesh mesh;
+    mesh.first_primitive = static_cast<uint32_t>(arena.primitives.size());
+    mesh.primitive_count = 1;
+    arena.primitives.push_back(primitive);
+    arena.meshes.push_back(mesh);
+    scene_mesh_compute_bounds(arena);
+    return static_cast<uint32_t>(arena.meshes.size() - 1);
+}
+
+inline uint32_t test_add_grid(scene_mesh_arena &arena, uint32_t width, uint32_t depth)
+{
+    return test_add_grid(arena, width, depth, [](float, float) { return 0.0f; });
+}
+} // namespace ash
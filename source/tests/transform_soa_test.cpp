@@ -0,0 +1,120 @@
+#include "job/cpu.h"
+#include "scene/transform_soa.h"
+#include "tests/test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+// Normalized rotations, non-uniform and mirrored scales, and positions far enough out that translation error shows.
+std::vector<ash::transform> make_transforms(uint32_t count)
+{
+    ash::test_random random;
+    std::vector<ash::transform> transforms(count);
+    for (ash::transform &transform : transforms)
+    {
+        transform.position = {random.uniform(-500.0f, 500.0f), random.uniform(-500.0f, 500.0f),
+                              random.uniform(-500.0f, 500.0f)};
+        XMStoreFloat4(&transform.rotation,
+                      XMQuaternionNormalize(XMVectorSet(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f),
+                                                        random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f))));
+        transform.scale = {random.uniform(0.1f, 10.0f), random.uniform(-10.0f, -0.1f), random.uniform(0.1f, 10.0f)};
+    }
+    return transforms;
+}
+
+ash::scene_tf_soa make_soa(const std::vector<ash::transform> &transforms)
+{
+    ash::scene_tf_soa soa;
+    ash::scene_tf_soa_resize(soa, static_cast<uint32_t>(transforms.size()));
+    for (uint32_t i = 0; i < soa.count; ++i)
+    {
+        ash::scene_tf_soa_store(soa, i, transforms[i]);
+    }
+    return soa;
+}
+
+// Largest difference to get_local_transform_matrix over the composed range, relative to the element's magnitude
+// where that is above one.
+float get_max_error(const std::vector<ash::transform> &transforms, uint32_t first, const std::vector<XMFLOAT3X4> &out)
+{
+    float max_error = 0.0f;
+    for (uint32_t i = 0; i < out.size(); ++i)
+    {
+        XMFLOAT3X4 expected;
+        XMStoreFloat3x4(&expected, ash::get_local_transform_matrix(transforms[first + i]));
+        for (uint32_t r = 0; r < 3; ++r)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                const float error = std::abs(out[i].m[r][c] - expected.m[r][c]);
+                max_error = (std::max)(max_error, error / (std::max)(std::abs(expected.m[r][c]), 1.0f));
+            }
+        }
+    }
+    return max_error;
+}
+} // namespace
+
+TEST_CASE(transform_soa, batch_paths_match_directxmath)
+{
+    const std::vector<ash::transform> transforms = make_transforms(64);
+    const ash::scene_tf_soa soa = make_soa(transforms);
+
+    for (const ash::scene_tf_compose_path path :
+         {ash::scene_tf_compose_path::scalar, ash::scene_tf_compose_path::sse, ash::scene_tf_compose_path::avx2})
+    {
+        if (path == ash::scene_tf_compose_path::avx2 && !ash::job_cpu_has_avx2())
+        {
+            std::printf("  AVX2 unavailable, skipped\n");
+            continue;
+        }
+        ash::scene_tf_g_max_compose_path = path;
+
+        // Every count up to 8 + 4 + 3 and unaligned starts, so each wide loop ends in every possible tail.
+        float max_error = 0.0f;
+        for (uint32_t first = 0; first < 4; ++first)
+        {
+            for (uint32_t count = 0; count <= 20; ++count)
+            {
+                // One guard matrix past the range catches stores beyond `count`.
+                std::vector<XMFLOAT3X4> out(count + 1);
+                out[count].m[0][0] = 12345.0f;
+                ash::scene_tf_compose_local_batch(soa, first, count, out.data());
+                CHECK(out[count].m[0][0] == 12345.0f);
+                out.pop_back();
+                max_error = (std::max)(max_error, get_max_error(transforms, first, out));
+            }
+        }
+        std::printf("  path %u: max relative error %g\n", static_cast<uint32_t>(path), max_error);
+        CHECK(max_error < 1e-5f);
+    }
+    ash::scene_tf_g_max_compose_path = ash::scene_tf_compose_path::avx2;
+}
+
+BENCHMARK_CASE(transform_soa, compose_local)
+{
+    for (const uint32_t count : {10000u, 100000u, 1000000u})
+    {
+        const std::vector<ash::transform> transforms = make_transforms(count);
+        const ash::scene_tf_soa soa = make_soa(transforms);
+        std::vector<XMFLOAT3X4> out(count);
+
+        // The per-entity path scene_tf_update used before the batch kernel.
+        const double reference_ns = ash::test_measure_ns(10, [&] {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                XMStoreFloat3x4(&out[i], ash::get_local_transform_matrix(transforms[i]));
+            }
+        });
+        const double batch_ns =
+            ash::test_measure_ns(10, [&] { ash::scene_tf_compose_local_batch(soa, 0, count, out.data()); });
+        std::printf("  %7u transforms: DirectXMath %7.3f ms (%5.2f ns each), batch %7.3f ms (%5.2f ns each), %.2fx\n",
+                    count, reference_ns * 1e-6, reference_ns / count, batch_ns * 1e-6, batch_ns / count,
+                    reference_ns / batch_ns);
+    }
+}
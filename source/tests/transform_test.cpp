@@ -0,0 +1,181 @@
+#include "job/scheduler.h"
+#include "scene/scene.h"
+#include "scene/transform.h"
+#include "tests/test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+constexpr uint32_t g_root_count = 64;
+constexpr uint32_t g_chain_count = 16;
+
+ash::transform make_transform(ash::test_random &random)
+{
+    ash::transform transform;
+    transform.position = {random.uniform(-2.0f, 2.0f), random.uniform(-2.0f, 2.0f), random.uniform(-2.0f, 2.0f)};
+    XMStoreFloat4(&transform.rotation,
+                  XMQuaternionRotationRollPitchYaw(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f),
+                                                   random.uniform(-1.0f, 1.0f)));
+    transform.scale = {random.uniform(0.8f, 1.2f), random.uniform(0.8f, 1.2f), random.uniform(0.8f, 1.2f)};
+    return transform;
+}
+
+// g_root_count binary trees filled breadth-first, so the hierarchy is wide, plus g_chain_count chains of
+// `chain_length` nodes hanging off the first root, so it is also deep. Returns every node, roots first.
+std::vector<flecs::entity> make_hierarchy(uint32_t tree_nodes, uint32_t chain_length)
+{
+    ash::test_random random;
+    std::vector<flecs::entity> nodes;
+    nodes.reserve(tree_nodes + g_chain_count * chain_length);
+    for (uint32_t i = 0; i < tree_nodes; ++i)
+    {
+        flecs::entity entity = ash::scene_g_world.entity();
+        if (i >= g_root_count)
+        {
+            entity.child_of(nodes[(i - g_root_count) / 2]);
+        }
+        entity.set<ash::transform>(make_transform(random));
+        nodes.push_back(entity);
+    }
+
+    for (uint32_t c = 0; c < g_chain_count; ++c)
+    {
+        flecs::entity parent = nodes[0];
+        for (uint32_t i = 0; i < chain_length; ++i)
+        {
+            flecs::entity entity = ash::scene_g_world.entity();
+            entity.child_of(parent).set<ash::transform>(make_transform(random));
+            nodes.push_back(entity);
+            parent = entity;
+        }
+    }
+    return nodes;
+}
+
+void destroy_roots(const std::vector<flecs::entity> &nodes)
+{
+    for (uint32_t i = 0; i < g_root_count; ++i)
+    {
+        nodes[i].destruct();
+    }
+}
+
+// The world matrix multiplied out from the entity's own transform up to its root.
+XMMATRIX get_reference_world(flecs::entity entity)
+{
+    XMMATRIX world = ash::get_local_transform_matrix(entity.get<ash::transform>());
+    for (flecs::entity parent = entity.parent(); parent.is_valid(); parent = parent.parent())
+    {
+        world = world * ash::get_local_transform_matrix(parent.get<ash::transform>());
+    }
+    return world;
+}
+
+uint32_t count_wrong_worlds(const std::vector<flecs::entity> &nodes)
+{
+    uint32_t wrong = 0;
+    for (const flecs::entity &node : nodes)
+    {
+        XMFLOAT4X4 expected;
+        XMStoreFloat4x4(&expected, get_reference_world(node));
+        const XMFLOAT4X4 &world = node.get<ash::world_transform>().matrix;
+        float error = 0.0f;
+        for (uint32_t r = 0; r < 4; ++r)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                error = std::max(error, std::abs(world.m[r][c] - expected.m[r][c]));
+            }
+        }
+
+        const ash::bounds &node_bounds = node.get<ash::bounds>();
+        const XMFLOAT4 sphere = ash::get_world_bounding_sphere(node_bounds, XMLoadFloat4x4(&world));
+        wrong += error > 1e-3f || std::abs(sphere.x - node_bounds.world_sphere.x) > 1e-4f ||
+                 std::abs(sphere.w - node_bounds.world_sphere.w) > 1e-4f;
+    }
+    return wrong;
+}
+
+void add_subtree(flecs::entity entity, std::set<flecs::entity_t> &subtree)
+{
+    subtree.insert(entity.id());
+    entity.children([&](flecs::entity child) { add_subtree(child, subtree); });
+}
+} // namespace
+
+TEST_CASE(transform, updates_match_hierarchy_and_visit_only_moved_subtrees)
+{
+    ash::job_init(3);
+    ash::scene_tf_init();
+    const std::vector<flecs::entity> nodes = make_hierarchy(20000, 64);
+
+    ash::scene_tf_update();
+    CHECK(ash::scene_tf_get_updated().size() == nodes.size());
+    CHECK(count_wrong_worlds(nodes) == 0);
+
+    // Moving a node updates exactly its subtree, whichever level it is on.
+    ash::test_random random;
+    for (const uint32_t moved : {0u, 1u, 100u, 5000u, 19999u, 20000u + 64u * 3u + 10u})
+    {
+        nodes[moved].set<ash::transform>(make_transform(random));
+        ash::scene_tf_update();
+
+        std::set<flecs::entity_t> expected;
+        add_subtree(nodes[moved], expected);
+        const std::vector<flecs::entity_t> &updated = ash::scene_tf_get_updated();
+        CHECK(std::set<flecs::entity_t>(updated.begin(), updated.end()) == expected);
+        CHECK(updated.size() == expected.size());
+    }
+    CHECK(count_wrong_worlds(nodes) == 0);
+
+    // Nothing moved, nothing is updated.
+    ash::scene_tf_update();
+    CHECK(ash::scene_tf_get_updated().empty());
+
+    destroy_roots(nodes);
+    ash::scene_tf_shutdown();
+    ash::job_shutdown();
+}
+
+BENCHMARK_CASE(transform, update_hierarchy)
+{
+    // 64 binary trees 13 levels deep and 16 chains of 256 nodes: about 500k nodes over 256 levels.
+    double single_thread_ns = 0.0;
+    for (const uint32_t threads : {1u, 2u, 4u, 8u})
+    {
+        // One thread runs without a scheduler; otherwise the calling thread joins threads - 1 workers.
+        if (threads > 1)
+        {
+            ash::job_init(threads - 1);
+        }
+        ash::scene_tf_init();
+        const std::vector<flecs::entity> nodes = make_hierarchy(496000, 256);
+        ash::scene_tf_update();
+
+        // Moving every root dirties the whole hierarchy.
+        ash::test_random random;
+        const double ns = ash::test_measure_ns(5, [&] {
+            for (uint32_t i = 0; i < g_root_count; ++i)
+            {
+                nodes[i].set<ash::transform>(make_transform(random));
+            }
+            ash::scene_tf_update();
+        });
+        single_thread_ns = threads == 1 ? ns : single_thread_ns;
+
+        std::printf("  %u threads: %zu nodes in %7.2f ms (%5.1f ns per node), %.2fx\n", threads,
+                    ash::scene_tf_get_updated().size(), ns * 1e-6, ns / nodes.size(), single_thread_ns / ns);
+        destroy_roots(nodes);
+        ash::scene_tf_shutdown();
+        if (threads > 1)
+        {
+            ash::job_shutdown();
+        }
+    }
+}
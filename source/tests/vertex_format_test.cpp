@@ -0,0 +1,186 @@
+#include "scene/vertex_format.h"
+#include "tests/test.h"
+#include "tests/test_mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+struct vertex_errors
+{
+    float position = 0.0f;       // object units
+    float position_steps = 0.0f; // unorm16 steps of the mesh's own scale
+    float normal = 0.0f;   // degrees
+    float tangent = 0.0f;  // degrees
+    float uv = 0.0f;
+    uint32_t wrong_sign = 0;
+};
+
+float get_angle_degrees(FXMVECTOR a, FXMVECTOR b)
+{
+    const XMVECTOR unit_a = XMVector3Normalize(a);
+    const XMVECTOR unit_b = XMVector3Normalize(b);
+    const float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(unit_a, unit_b)));
+    return std::atan2(sine, XMVectorGetX(XMVector3Dot(unit_a, unit_b))) * 180.0f / XM_PI;
+}
+
+XMVECTOR get_random_direction(ash::test_random &random)
+{
+    for (;;)
+    {
+        const XMVECTOR v = XMVectorSet(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f),
+                                       random.uniform(-1.0f, 1.0f), 0.0f);
+        const float length_sq = XMVectorGetX(XMVector3LengthSq(v));
+        if (length_sq > 1e-4f && length_sq <= 1.0f)
+        {
+            return XMVector3Normalize(v);
+        }
+    }
+}
+
+// A bumpy grid whose attributes are replaced by random unit normals, tangents orthogonal to them and uvs in [0, 1],
+// so every octant and tangent angle is exercised.
+ash::scene_mesh_arena make_random_mesh(ash::test_random &random)
+{
+    ash::scene_mesh_arena arena;
+    ash::test_add_grid(arena, 63, 63, [&](float, float) { return random.uniform(-3.0f, 3.0f); });
+    for (std::size_t v = 0; v < arena.positions.size(); ++v)
+    {
+        const XMVECTOR normal = get_random_direction(random);
+        XMVECTOR tangent = get_random_direction(random);
+        tangent = XMVector3Normalize(XMVector3Cross(normal, tangent));
+        XMStoreFloat3(&arena.normals[v], normal);
+        XMStoreFloat4(&arena.tangents[v], XMVectorSetW(tangent, random.next() & 1 ? 1.0f : -1.0f));
+        arena.uvs[v] = {random.uniform(0.0f, 1.0f), random.uniform(0.0f, 1.0f)};
+    }
+    return arena;
+}
+
+// Decodes every packed vertex of `packed` and compares it against the float streams of `source`.
+vertex_errors get_errors(const ash::scene_mesh_arena &source, const ash::scene_mesh_arena &packed)
+{
+    vertex_errors errors;
+    const ash::scene_vtx_stream &stream = packed.vertex_streams[0];
+    for (std::size_t v = 0; v < source.positions.size(); ++v)
+    {
+        XMFLOAT3 position, normal;
+        XMFLOAT4 tangent;
+        XMFLOAT2 uv;
+        ash::scene_vtx_decode(stream, packed.vertex_data.data() + v * stream.stride, position, normal, tangent, uv);
+
+        const XMFLOAT3 &p = source.positions[v];
+        const XMFLOAT3 &scale = stream.position_scale;
+        const XMFLOAT3 delta = {std::abs(position.x - p.x), std::abs(position.y - p.y), std::abs(position.z - p.z)};
+        errors.position = std::max({errors.position, delta.x, delta.y, delta.z});
+        errors.position_steps =
+            std::max({errors.position_steps, delta.x / std::max(scale.x, 1e-20f), delta.y / std::max(scale.y, 1e-20f),
+                      delta.z / std::max(scale.z, 1e-20f)});
+        errors.normal = std::max(errors.normal, get_angle_degrees(XMLoadFloat3(&source.normals[v]),
+                                                                  XMLoadFloat3(&normal)));
+        if (tangent.w != 0.0f)
+        {
+            errors.tangent = std::max(errors.tangent, get_angle_degrees(XMLoadFloat4(&source.tangents[v]),
+                                                                        XMLoadFloat4(&tangent)));
+            errors.wrong_sign += tangent.w != source.tangents[v].w;
+        }
+        errors.uv = std::max({errors.uv, std::abs(uv.x - source.uvs[v].x), std::abs(uv.y - source.uvs[v].y)});
+    }
+    return errors;
+}
+} // namespace
+
+TEST_CASE(vertex_format, reconstruction_error_is_bounded)
+{
+    ash::test_random random;
+    const ash::scene_mesh_arena source = make_random_mesh(random);
+    for (uint32_t f = 0; f < uint32_t(ash::scene_vtx_format::count); ++f)
+    {
+        const ash::scene_vtx_format format = static_cast<ash::scene_vtx_format>(f);
+        ash::scene_mesh_arena arena = source;
+        const ash::scene_vtx_stats stats = ash::scene_vtx_quantize(arena, format);
+        CHECK(stats.vertices == source.positions.size());
+        CHECK(stats.packed_bytes == stats.vertices * ash::scene_vtx_get_stride(format));
+        CHECK(arena.vertex_data.size() == stats.packed_bytes);
+
+        const vertex_errors errors = get_errors(source, arena);
+        std::printf("  format %u: position %.3f steps, normal %.4f deg, tangent %.4f deg, uv %.2e\n", f,
+                    errors.position_steps, errors.normal, errors.tangent, errors.uv);
+        CHECK(errors.wrong_sign == 0);
+
+        // The reported maxima are the ones a decoder sees.
+        CHECK(stats.max_position_error == errors.position);
+        CHECK(std::abs(stats.max_normal_error - errors.normal) < 1e-3f);
+        CHECK(std::abs(stats.max_tangent_error - errors.tangent) < 1e-3f);
+        CHECK(stats.max_uv_error == errors.uv);
+
+        switch (format)
+        {
+        case ash::scene_vtx_format::full:
+            CHECK(errors.position_steps == 0.0f);
+            CHECK(errors.normal < 1e-3f);
+            CHECK(errors.tangent < 1e-3f);
+            CHECK(errors.uv == 0.0f);
+            break;
+        case ash::scene_vtx_format::quantized:
+            // Half a unorm16 step per axis, plus float rounding of offset + q * scale; half a half-float ulp below 1
+            // for uvs.
+            CHECK(errors.position_steps <= 0.51f);
+            CHECK(errors.normal < 0.01f);
+            CHECK(errors.tangent < 0.02f);
+            CHECK(errors.uv <= 1.0f / 4096.0f);
+            break;
+        case ash::scene_vtx_format::compact:
+            CHECK(errors.position_steps <= 0.51f);
+            CHECK(errors.normal < 1.0f);
+            CHECK(errors.tangent == 0.0f);
+            CHECK(errors.uv <= 1.0f / 4096.0f);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+TEST_CASE(vertex_format, octahedral_mapping_round_trips)
+{
+    ash::test_random random;
+    float max_error = 0.0f;
+    uint32_t outside = 0;
+    // The axes land on the corners and edge midpoints of the unfolded octahedron.
+    const XMFLOAT3 axes[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        const XMVECTOR normal = i < 6 ? XMLoadFloat3(&axes[i]) : get_random_direction(random);
+        const XMFLOAT2 encoded = ash::scene_vtx_encode_octahedral(normal);
+        outside += std::abs(encoded.x) > 1.0f || std::abs(encoded.y) > 1.0f;
+        max_error = std::max(max_error, get_angle_degrees(normal, ash::scene_vtx_decode_octahedral(encoded)));
+    }
+    CHECK(outside == 0);
+    CHECK(max_error < 0.01f);
+}
+
+TEST_CASE(vertex_format, released_attributes_keep_packed_vertices)
+{
+    ash::test_random random;
+    ash::scene_mesh_arena arena = make_random_mesh(random);
+    ash::scene_vtx_quantize(arena, ash::scene_vtx_format::quantized);
+    const ash::scene_mesh_arena packed = arena;
+
+    const std::size_t released = ash::scene_mesh_release_attributes(arena);
+    CHECK(released >= packed.positions.size() * (sizeof(XMFLOAT3) + sizeof(XMFLOAT4) + sizeof(XMFLOAT2)));
+    CHECK(arena.normals.capacity() == 0 && arena.tangents.capacity() == 0 && arena.uvs.capacity() == 0);
+    CHECK(arena.positions.size() == packed.positions.size());
+    CHECK(arena.vertex_data == packed.vertex_data);
+
+    // Released arenas append to each other like full ones.
+    ash::scene_mesh_arena scene;
+    ash::scene_mesh_append(scene, arena);
+    CHECK(ash::scene_mesh_append(scene, arena) == 1);
+    CHECK(scene.normals.empty());
+    CHECK(scene.positions.size() == 2 * arena.positions.size());
+    CHECK(scene.vertex_streams[1].first_vertex == arena.positions.size());
+    CHECK(scene.vertex_streams[1].data_offset == arena.vertex_data.size());
+}
@@ -1,6 +1,8 @@
 #include "window/window.h"
 #include "editor/console.h"
 #include "editor/editor.h"
+#include "job/scheduler.h"
+#include "job/task.h"
 #include "renderer/core/swapchain.h"
 #include "renderer/renderer.h"
 #include "scene/scene.h"
@@ -91,6 +93,9 @@ void ash::win_init(HINSTANCE hInstance, PWSTR pCmdLine, int nCmdShow)
 
     ShowWindow(win_g_hwnd, SW_SHOWMAXIMIZED);
     UpdateWindow(win_g_hwnd);
+    job_init();
+    job_task_init();
+    job_task_attach(job_affinity::main);
     rhi_init();
     ed_init();
     scene_init();
@@ -107,6 +112,7 @@ void ash::win_run()
     while (GetMessage(&msg, nullptr, 0, 0))
     {
         SCOPED_CPU_EVENT(L"ash::win_run");
+        job_task_drain(job_affinity::main);
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
@@ -143,6 +149,8 @@ static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM l
         ash::scene_shutdown();
         ash::ed_shutdown();
         ash::rhi_shutdown();
+        ash::job_task_shutdown();
+        ash::job_shutdown();
         ash::ed_console_log(ash::ed_console_log_level::info, "[App] Shutdown sequence end.");
         PostQuitMessage(0);
         return 0;